@@ -2,36 +2,371 @@
 #define LATTICE
 
 
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
-#include <boost/interprocess/sync/interprocess_condition.hpp>
-#include<boost/interprocess/offset_ptr.hpp>
+#include <vector>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/interprocess/detail/atomic.hpp>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "tgt/types.h"
 #include "tgt/vector.h"
 
 #define SHARED_MEMORY_DEFAULT_NAME "volume_shared_memory"
 
-struct ipc_volume_info
+//! Frames in the ring: the simulator holds two (current and next state),
+//! the rest give the viewer time to copy the latest one. Viewers holding
+//! reader leases need one more frame per lease.
+#define IPC_VOLUME_MIN_FRAMES 3
+#define IPC_VOLUME_MAX_FRAMES 8
+#define IPC_VOLUME_DEFAULT_FRAMES 3
+
+//! No frame published yet
+#define IPC_VOLUME_NO_FRAME 0xffffffffu
+
+//! Edge length of the bricks dirty regions are tracked in
+#define IPC_VOLUME_BRICK_SIZE 16
+
+//! Publish-to-display latency histogram: bucket i counts latencies below
+//! 2^(i+1) microseconds, the last one everything above
+#define IPC_VOLUME_LATENCY_BUCKETS 24
+
+//!
+//! One lattice frame of the ring
+struct ipc_volume_frame
 {
-    //! IPC Mutex
-    boost::interprocess::interprocess_mutex mutex;
+    //! Sequence lock: odd while the simulator writes into the frame
+    volatile boost::uint32_t sequence;
 
-    //!Condition to wait when processing visualization
-    boost::interprocess::interprocess_condition cond_processing_visuals;
+    //! Simulation step the frame holds
+    volatile boost::uint32_t step;
 
-    //! A pointer to the data buffer to be read (used for double-buffering)
-    boost::interprocess::offset_ptr<uint16_t> offset_ptr;
+    //! Reader leases: while non-zero the simulator does not overwrite the frame
+    volatile boost::uint32_t readers;
+
+    //! Time the step was published, in microseconds (see ipc_volume_info::now)
+    boost::uint64_t publish_time;
+
+    //! Lattice data of the frame
+    boost::interprocess::offset_ptr<uint16_t> data;
+};
+
+//!
+//! Shared segment header: an N-slot ring of lattice frames driven by atomic
+//! sequence numbers.
+//!
+//! The simulator (single producer) never waits: it writes each new step
+//! into the oldest frame and then publishes it as the latest one. The viewer
+//! (single consumer) always picks up the latest complete frame and validates
+//! its sequence number after copying, so a frame overwritten while being
+//! read is detected instead of shown torn.
+//!
+//! Alongside the ring, the simulator records for every brick of
+//! IPC_VOLUME_BRICK_SIZE^3 cells the last step that changed it. A viewer
+//! holding the frame of step s only needs the bricks stamped after s to catch
+//! up with any later frame.
+struct ipc_volume_info
+{
+    typedef boost::uint32_t atomic_t;
 
-    //! Double-buffered?
-    bool double_buffer;
+    //! Frame ring
+    ipc_volume_frame frames[IPC_VOLUME_MAX_FRAMES];
+    atomic_t num_frames;
 
-    //!Is there any message
-    bool fresh_data;
+    //! Index of the latest complete frame or IPC_VOLUME_NO_FRAME
+    volatile atomic_t latest;
+
+    //! Frames published by the simulator
+    volatile atomic_t frames_published;
+    //! Frames picked up by the viewer
+    volatile atomic_t frames_consumed;
+    //! Published frames overwritten before the viewer picked them up
+    volatile atomic_t frames_dropped;
+    //! Reads discarded because the frame was overwritten during the copy
+    volatile atomic_t frames_torn;
 
     //! Dimensions
     size_t size_x;
     size_t size_y;
     size_t size_z;
+
+    //! Dirty brick grid: last step that changed each brick
+    boost::interprocess::offset_ptr<atomic_t> brick_steps;
+    atomic_t bricks_x;
+    atomic_t bricks_y;
+    atomic_t bricks_z;
+    //! Bumped whenever a simulator attaches, brick steps of an older
+    //! simulator run say nothing about the current one
+    volatile atomic_t writer_epoch;
+
+    //! Wakes a viewer blocked in wait_publish(). Posted at most once until
+    //! the viewer picks it up, so the count never grows.
+    boost::interprocess::interprocess_semaphore publish_signal;
+    volatile atomic_t signal_pending;
+
+    //! Latencies from publishing a step to the viewer invalidating its output
+    volatile atomic_t latency_histogram[IPC_VOLUME_LATENCY_BUCKETS];
+
+    ipc_volume_info()
+        : num_frames(0)
+        , latest(IPC_VOLUME_NO_FRAME)
+        , frames_published(0)
+        , frames_consumed(0)
+        , frames_dropped(0)
+        , frames_torn(0)
+        , size_x(0)
+        , size_y(0)
+        , size_z(0)
+        , bricks_x(0)
+        , bricks_y(0)
+        , bricks_z(0)
+        , writer_epoch(0)
+        , publish_signal(0)
+        , signal_pending(0)
+    {
+        for(int i=0; i<IPC_VOLUME_MAX_FRAMES; i++)
+        {
+            frames[i].sequence = 0;
+            frames[i].step = 0;
+            frames[i].readers = 0;
+            frames[i].publish_time = 0;
+        }
+        for(int i=0; i<IPC_VOLUME_LATENCY_BUCKETS; i++) latency_histogram[i] = 0;
+    }
+
+    size_t num_voxels() const
+    {
+        return size_x * size_y * size_z;
+    }
+
+    //! Attach the ring to a buffer of num_frames * num_voxels() voxels
+    void set_frames(uint16_t* buffer, atomic_t n)
+    {
+        num_frames = n;
+        for(atomic_t i=0; i<n; i++) frames[i].data = buffer + i * num_voxels();
+    }
+
+    size_t num_bricks() const
+    {
+        return size_t(bricks_x) * bricks_y * bricks_z;
+    }
+
+    //! Attach the brick grid to a buffer of num_bricks() entries; call after
+    //! setting the dimensions
+    void set_bricks(atomic_t* buffer)
+    {
+        bricks_x = (size_x + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE;
+        bricks_y = (size_y + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE;
+        bricks_z = (size_z + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE;
+        brick_steps = buffer;
+        for(size_t i=0; i<num_bricks(); i++) brick_steps[i] = 0;
+    }
+
+    static atomic_t read(volatile atomic_t* v)
+    {
+        return boost::interprocess::ipcdetail::atomic_read32(v);
+    }
+
+    static void write(volatile atomic_t* v, atomic_t value)
+    {
+        boost::interprocess::ipcdetail::atomic_write32(v, value);
+    }
+
+    //! Full memory barrier. read() and write() only order accesses on x86,
+    //! so the sequence lock fences explicitly.
+    static void fence()
+    {
+        __sync_synchronize();
+    }
+
+    //! Wall clock in microseconds, comparable between processes
+    static boost::uint64_t now()
+    {
+        static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+        return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Simulator side
+
+    //! Pick the frame for the next step (the oldest one without reader
+    //! leases) and mark it as being written. Never blocks; returns
+    //! IPC_VOLUME_NO_FRAME if every other frame is leased.
+    atomic_t begin_write()
+    {
+        atomic_t last = read(&latest);
+        for(atomic_t i=0; i<num_frames; i++)
+        {
+            atomic_t slot = last == IPC_VOLUME_NO_FRAME ? i : (last + 1 + i) % num_frames;
+            if(slot == last || read(&frames[slot].readers)) continue;
+
+            // Mark as written, then check for a lease taken in between (the
+            // fence pairs with the increment in acquire_lease, and keeps the
+            // frame data from being written before the mark)
+            atomic_t sequence = frames[slot].sequence;
+            write(&frames[slot].sequence, sequence + 1);
+            fence();
+            if(read(&frames[slot].readers))
+            {
+                write(&frames[slot].sequence, sequence);
+                continue;
+            }
+            return slot;
+        }
+        return IPC_VOLUME_NO_FRAME;
+    }
+
+    //! Start a new simulator run; returns its epoch
+    atomic_t attach_writer()
+    {
+        return boost::interprocess::ipcdetail::atomic_inc32(&writer_epoch) + 1;
+    }
+
+    //! Stamp every brick overlapping the cells [begin, end) as changed in
+    //! step. Call before publishing the frame of that step.
+    void mark_dirty(const tgt::ivec3& begin, const tgt::ivec3& end, atomic_t step)
+    {
+        if(!brick_steps) return;
+        tgt::ivec3 b0 = begin / IPC_VOLUME_BRICK_SIZE;
+        tgt::ivec3 b1 = (end + tgt::ivec3(IPC_VOLUME_BRICK_SIZE - 1)) / IPC_VOLUME_BRICK_SIZE;
+        b1 = tgt::min(b1, tgt::ivec3(bricks_x, bricks_y, bricks_z));
+        atomic_t* p = brick_steps.get();
+        for(int z=b0.z; z<b1.z; z++)
+            for(int y=b0.y; y<b1.y; y++)
+                for(int x=b0.x; x<b1.x; x++)
+                    p[(size_t(z)*bricks_y + y)*bricks_x + x] = step;
+    }
+
+    //! Make a frame written since begin_write() the latest one
+    void publish(atomic_t slot, atomic_t step)
+    {
+        frames[slot].step = step;
+        frames[slot].publish_time = now();
+        fence();
+        write(&frames[slot].sequence, frames[slot].sequence + 1);
+        write(&latest, slot);
+        boost::interprocess::ipcdetail::atomic_inc32(&frames_published);
+
+        // Wake the viewer unless a wakeup is already on its way
+        if(boost::interprocess::ipcdetail::atomic_cas32(&signal_pending, 1, 0) == 0)
+            publish_signal.post();
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Viewer side
+
+    //! Snapshot of the latest complete frame. Returns false if nothing has
+    //! been published yet or the frame is being rewritten right now.
+    bool acquire_latest(atomic_t& slot, atomic_t& sequence, atomic_t& step)
+    {
+        slot = read(&latest);
+        if(slot == IPC_VOLUME_NO_FRAME) return false;
+        sequence = read(&frames[slot].sequence);
+        if(sequence & 1) return false;
+        fence();
+        step = read(&frames[slot].step);
+        return true;
+    }
+
+    //! Whether the frame was left untouched since acquire_latest(); call
+    //! after copying. Counts torn reads.
+    bool validate(atomic_t slot, atomic_t sequence)
+    {
+        fence();
+        if(read(&frames[slot].sequence) == sequence) return true;
+        boost::interprocess::ipcdetail::atomic_inc32(&frames_torn);
+        return false;
+    }
+
+    //! Pin the latest complete frame so it can be used in place. The lease
+    //! must be given back with release_lease().
+    bool acquire_lease(atomic_t& slot, atomic_t& step)
+    {
+        atomic_t sequence;
+        if(!acquire_latest(slot, sequence, step)) return false;
+
+        boost::interprocess::ipcdetail::atomic_inc32(&frames[slot].readers);
+        if(read(&frames[slot].sequence) != sequence)
+        {
+            // Overwrite started before the lease was visible
+            boost::interprocess::ipcdetail::atomic_dec32(&frames[slot].readers);
+            boost::interprocess::ipcdetail::atomic_inc32(&frames_torn);
+            return false;
+        }
+        return true;
+    }
+
+    void release_lease(atomic_t slot)
+    {
+        boost::interprocess::ipcdetail::atomic_dec32(&frames[slot].readers);
+    }
+
+    //! Block until a frame is published or the timeout (in milliseconds)
+    //! expires. Returns whether a frame was published.
+    bool wait_publish(unsigned int timeout)
+    {
+        boost::posix_time::ptime until = boost::posix_time::microsec_clock::universal_time()
+                                       + boost::posix_time::milliseconds(timeout);
+        if(!publish_signal.timed_wait(until)) return false;
+        write(&signal_pending, 0);
+        return true;
+    }
+
+    //! Wake a viewer blocked in wait_publish() without publishing, e.g. to
+    //! shut its waiting thread down
+    void interrupt_wait()
+    {
+        publish_signal.post();
+    }
+
+    //! Account for a frame of the given publish time reaching the display
+    void record_latency(boost::uint64_t publish_time)
+    {
+        boost::uint64_t t = now();
+        boost::uint64_t us = t > publish_time ? t - publish_time : 0;
+        int bucket = 0;
+        while(bucket < IPC_VOLUME_LATENCY_BUCKETS - 1 && (us >> (bucket + 1))) bucket++;
+        boost::interprocess::ipcdetail::atomic_inc32(&latency_histogram[bucket]);
+    }
+
+    //! Upper bound (in microseconds) of the latency bucket holding the
+    //! given fraction of all recorded frames, 0 if none was recorded
+    boost::uint64_t latency_percentile(double fraction)
+    {
+        atomic_t counts[IPC_VOLUME_LATENCY_BUCKETS];
+        boost::uint64_t total = 0;
+        for(int i=0; i<IPC_VOLUME_LATENCY_BUCKETS; i++) total += counts[i] = read(&latency_histogram[i]);
+        if(!total) return 0;
+
+        boost::uint64_t seen = 0;
+        for(int i=0; i<IPC_VOLUME_LATENCY_BUCKETS; i++)
+        {
+            seen += counts[i];
+            if(seen >= fraction * total) return boost::uint64_t(2) << i;
+        }
+        return boost::uint64_t(2) << (IPC_VOLUME_LATENCY_BUCKETS - 1);
+    }
+
+    //! Bricks changed after step, as flags in brick grid order. Returns
+    //! false if the brick steps cannot tell (no grid or another simulator
+    //! run), then the whole volume has to be taken.
+    bool dirty_bricks(atomic_t step, atomic_t epoch, std::vector<boost::uint8_t>& dirty) const
+    {
+        if(!brick_steps || read(const_cast<volatile atomic_t*>(&writer_epoch)) != epoch) return false;
+        dirty.resize(num_bricks());
+        const atomic_t* p = brick_steps.get();
+        for(size_t i=0; i<dirty.size(); i++) dirty[i] = p[i] > step;
+        return true;
+    }
+
+    //! Account for a consumed frame; steps skipped since the previous one
+    //! count as dropped
+    void consume(atomic_t step, atomic_t previous_step, bool first)
+    {
+        boost::interprocess::ipcdetail::atomic_inc32(&frames_consumed);
+        if(!first && step > previous_step + 1)
+            boost::interprocess::ipcdetail::atomic_add32(&frames_dropped, step - previous_step - 1);
+    }
 };
 
 #endif
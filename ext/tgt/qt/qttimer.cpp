@@ -25,6 +25,8 @@
 #include "tgt/qt/qttimer.h"
 #include "tgt/event/timeevent.h"
 #include <QObject>
+#include <QEvent>
+#include <QCoreApplication>
 
 namespace tgt {
 
@@ -58,6 +60,18 @@ void QtTimer::setTickTime(const int msec) {
     start( msec, limit_ );
 }
 
+void QtTimer::wakeup() {
+    // Posting is thread-safe, the event is delivered in the timer's thread
+    QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+}
+
+void QtTimer::customEvent(QEvent* e) {
+    if (e->type() == QEvent::User && !stopped_) {
+        tgt::TimeEvent* te = new tgt::TimeEvent(this);
+        eventHandler_->broadcast(te);
+    }
+}
+
 void QtTimer::timerEvent(QTimerEvent* /*e*/) {
     ++count_;
         
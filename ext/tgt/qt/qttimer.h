@@ -39,7 +39,9 @@ public:
     virtual void start( const int msec, const int limit = 0 );
     virtual void stop();
     virtual void setTickTime( const int msec );
+    virtual void wakeup();
     virtual void timerEvent( QTimerEvent* e );
+    virtual void customEvent( QEvent* e );
 
 private:
     int id_;
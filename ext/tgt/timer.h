@@ -53,6 +53,12 @@ public:
     /// Abstract method. Used to stop the timer.
     virtual void stop() = 0;
 
+    /// Fires one extra tgt::TimeEvent as soon as possible, without counting
+    /// towards the limit. Unlike the other methods this may be called from any
+    /// thread. The default implementation does nothing, so the event is only
+    /// picked up by the next regular tick.
+    virtual void wakeup() {}
+
 
     // * getter / setter *
 
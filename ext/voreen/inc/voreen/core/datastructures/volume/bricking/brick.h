@@ -406,7 +406,7 @@ namespace voreen {
         //delete all volumedata
         std::map<size_t,char* >::iterator it = levelOfDetailMap_.begin();
         for ( ; it != levelOfDetailMap_.end(); ++it) {
-            delete it->second;
+            delete[] it->second;
         }
     }
 
@@ -481,6 +481,8 @@ namespace voreen {
         std::map<size_t,char* >::iterator it;
         it = levelOfDetailMap_.find(i);
         if (it != levelOfDetailMap_.end() ) {
+            if (ramManager_)
+                ramManager_->brickAccessed(this, i);
             return it->second;
         } else {
             //If the volumedata isn't in memory, load it from disk.
@@ -507,7 +509,7 @@ namespace voreen {
 
         char* vol = levelOfDetailMap_[lod];
         levelOfDetailMap_.erase(lod);
-        delete vol;
+        delete[] vol;
         vol = 0;
         return true;
     }
@@ -166,6 +166,12 @@ namespace voreen {
         */
         void fillPackingBricks();
 
+        /**
+        * Starts reading the volume data of all VolumeBricks at their determined level of
+        * detail in the background, in the order the BrickLodSelector assigned the levels.
+        */
+        void prefetchBricks();
+
         /**
         * Writes to volume data from all PackingBricks in bricksWithData_ to the
         * packed volume.
@@ -562,6 +568,26 @@ namespace voreen {
         }
     }
 
+    template<class T>
+    void BrickingManager<T>::prefetchBricks() {
+        std::vector<typename RamManager<T>::BrickLod> requests;
+        std::set<Brick*> requested;
+
+        // most important bricks first, then the ones the selector left at their level
+        std::vector<Brick*> order = brickLodSelector_->getSelectionOrder();
+        order.insert(order.end(), brickingInformation_.volumeBricks.begin(), brickingInformation_.volumeBricks.end());
+
+        for (size_t i=0; i < order.size(); i++) {
+            VolumeBrick<T>* currentBrick = dynamic_cast<VolumeBrick<T>*>(order.at(i));
+            if (currentBrick && requested.insert(currentBrick).second) {
+                requests.push_back(typename RamManager<T>::BrickLod(currentBrick,
+                    currentBrick->getCurrentLevelOfDetail()));
+            }
+        }
+
+        ramManager_->prefetch(requests);
+    }
+
     template<class T>
     void BrickingManager<T>::writeVolumeDataToPackedVolume() {
 
@@ -824,6 +850,7 @@ namespace voreen {
         if (progressBar_)
             progressBar_->setProgress(1.f);
 
+        prefetchBricks();
         fillPackingBricks();
 
         writeVolumeDataToPackedVolume();
@@ -843,12 +870,23 @@ namespace voreen {
 
         brickLodSelector_->selectLods();
 
+        prefetchBricks();
+
         packingBrickAssigner_->deletePackingBricks();
 
         packingBrickAssigner_->createPackingBricksFromBackup();
 
         fillPackingBricks();
 
+#ifdef TGT_DEBUG
+        {
+            const typename RamManager<T>::Statistics stats = ramManager_->getStatistics();
+            LDEBUG("brick RAM: " << stats.hits << " hits, " << stats.prefetchHits << " prefetched, "
+                   << stats.misses << " misses, " << stats.evictions << " evictions, "
+                   << stats.bytesRead / (1024*1024) << " MB read");
+        }
+#endif
+
         BrickedVolumeGL* brickedVolumeGL = dynamic_cast<BrickedVolumeGL*>(volumeHandle_->getVolumeGL());
         if (!brickedVolumeGL) {
             return;
@@ -52,9 +52,23 @@ public:
      */
     virtual void selectLods() = 0;
 
+    /**
+     * Returns the bricks in the order the last selectLods() call assigned their
+     * levels of detail, most important first. Bricks may appear more than once
+     * or not at all. Used to order the reads of the bricks.
+     */
+    const std::vector<Brick*>& getSelectionOrder() const;
+
 protected:
+    /**
+     * Sets the level of detail of the brick and appends it to the selection order.
+     */
+    void assignLod(Brick* brick, size_t lod);
+
     BrickingInformation& brickingInformation_;
 
+    std::vector<Brick*> selectionOrder_;
+
 private:
 
 }; //end of class
@@ -30,6 +30,18 @@
 
 
 #include "voreen/core/datastructures/volume/bricking/brickinginformation.h"
+#include "voreen/core/io/brickedvolumereader.h"
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 namespace voreen {
     class BrickedVolumeReader;
@@ -38,17 +50,66 @@ namespace voreen {
     * Manages the RAM while bricking large datasets that wouldn't fit into
     * the RAM otherwise. The bricks of the volume are accessed through this
     * class, and if a brick isn't resident in the RAM, it is loaded from
-    * the harddrive. If there isn't enough RAM available for that, another
-    * (currently not needed) brick is deleted from RAM.
+    * the harddrive. If there isn't enough RAM available for that, the least
+    * recently used brick is deleted from RAM.
+    *
+    * Bricks that are going to be needed can be read ahead by a pool of I/O
+    * threads (see prefetch()), so the reads overlap with each other and with
+    * the work on the bricks already loaded.
     */
     template<class T>
     class RamManager {
     public:
+        /// A level of detail of a brick
+        typedef std::pair<VolumeBrick<T>*, size_t> BrickLod;
+
+        /**
+        * Counters for sizing the RAM limit. A high eviction count compared to the
+        * misses means bricks are dropped and read again.
+        */
+        struct Statistics {
+            Statistics()
+                : hits(0), prefetchHits(0), misses(0), evictions(0), bytesRead(0)
+            {}
+
+            size_t hits;            ///< requests for bricks that were in RAM
+            size_t prefetchHits;    ///< requests served by a read started by prefetch()
+            size_t misses;          ///< requests that had to wait for a read of their own
+            size_t evictions;       ///< bricks deleted from RAM to make room for others
+            uint64_t bytesRead;     ///< bytes read from disk, including prefetched bricks
+        };
+
+        /**
+        * @param ramSize RAM available for bricks in megabytes
+        * @param numIoThreads number of threads reading prefetched bricks. They are
+        *     started with the first prefetch() call.
+        */
         RamManager(BrickingInformation& brickingInformation, BrickedVolumeReader* brickedVolumeReader,
-            size_t ramSize);
+            size_t ramSize, size_t numIoThreads = 2);
+
+        ~RamManager();
 
         bool readBrickFromDisk(VolumeBrick<T>* volBrick, size_t lod);
 
+        /**
+        * Marks the level of detail of the brick as most recently used. Called by
+        * VolumeBrick::getLodVolume() whenever the volume data is already in RAM.
+        */
+        void brickAccessed(VolumeBrick<T>* volBrick, size_t lod);
+
+        /**
+        * Starts reading the requested levels of detail in the background, in the given
+        * order, most important first. Requests still queued from the previous call are
+        * dropped. The requested bricks already in RAM are not evicted to make room for
+        * the others; reading ahead stops when the RAM limit is reached.
+        */
+        void prefetch(const std::vector<BrickLod>& requests);
+
+        /// Returns a snapshot of the counters, taken while the I/O threads are locked out
+        Statistics getStatistics() const;
+
+        void resetStatistics();
+
         BrickedVolumeReader* getBrickedVolumeReader();
 
         void setBrickedVolumeReader(BrickedVolumeReader* brickedVolumeReader);
@@ -59,20 +120,48 @@ namespace voreen {
         void freeAll();
 
     protected:
+        /// A read started by prefetch()
+        struct PendingRead {
+            char* data;
+            int numBytes;
+            bool done;
+        };
+
         /**
         * Calculates how many bytes will be needed to store the brick in RAM.
         */
         int getNumBytes(size_t lod);
 
         /**
-        * Deletes bricks from RAM until numBytes have been freed.
+        * Deletes bricks from RAM until numBytes have been freed, least recently used
+        * first. Bricks requested by the last prefetch() call are only deleted if
+        * evictWanted is set, and only after all others.
+        */
+        bool freeMem(size_t numBytes, bool evictWanted = true);
+
+        /**
+        * Increases usedRamInByte_ by numBytes, freeing memory if necessary.
         */
-        bool freeMem(size_t numBytes);
+        bool increaseUsedRam(size_t numBytes, bool evictWanted = true);
 
         /**
-        * Increases usedRamInByte_ by numBytes. Exception handling will be added.
+        * Inserts a level of detail read into RAM into the brick and the LRU list.
         */
-        bool increaseUsedRam(size_t numBytes);
+        void addToRam(const BrickLod& brickLod, char* data, bool mostRecent = true);
+
+        /**
+        * Drops all queued reads and waits for the running ones, which are kept in RAM
+        * as least recently used bricks.
+        */
+        void cancelPrefetch();
+
+        /**
+        * Reads a level of detail of a brick into data.
+        */
+        void readBrick(const BrickLod& brickLod, char* data, int numBytes);
+
+        /// Loop of the I/O threads
+        void ioThread();
 
         BrickingInformation& brickingInformation_;
 
@@ -92,13 +181,39 @@ namespace voreen {
 
         /**
         * This list logs which lods of which bricks are resident in the RAM
-        * at the moment. Every time a lod of a brick is read into the RAM,
-        * a pair is inserted at the end of this list, consisting of the brick
-        * and the lod. Whenever there isn't enough RAM available, the first
-        * element of this list gets deleted, and of course the associated brick and
-        * its lod aswell.
+        * at the moment, least recently used first. Every time a lod of a brick
+        * is read into the RAM or accessed, it is moved to the end of this list.
+        * Whenever there isn't enough RAM available, the elements at the front
+        * of this list get deleted, and of course the associated bricks and lods
+        * as well.
         */
-        std::list<std::pair<VolumeBrick<T>*, size_t> > volumesInRam_;
+        std::list<BrickLod> volumesInRam_;
+
+        /// Position of every lod in volumesInRam_
+        std::map<BrickLod, typename std::list<BrickLod>::iterator> ramPositions_;
+
+        /// The lods requested by the last prefetch() call
+        std::set<BrickLod> wanted_;
+
+        /// Reads started by prefetch() and not yet added to RAM. Only used by the calling thread.
+        std::map<BrickLod, PendingRead*> pending_;
+
+        Statistics statistics_;
+
+        size_t numIoThreads_;
+        boost::thread_group ioThreads_;
+
+        // guard the members below, as well as the done flags and statistics_.bytesRead
+        mutable boost::mutex mutex_;
+        boost::condition_variable queueChanged_;
+        boost::condition_variable readDone_;
+        std::deque<std::pair<BrickLod, PendingRead*> > queue_;
+        bool stopIoThreads_;
+
+#ifdef _MSC_VER
+        // the reader seeks on a shared file handle on Windows
+        boost::mutex readerMutex_;
+#endif
 
     private:
 
@@ -108,16 +223,35 @@ namespace voreen {
 
     template<class T>
     RamManager<T>::RamManager(BrickingInformation& brickingInformation, BrickedVolumeReader* brickedVolumeReader,
-                             size_t ramSize)
+                             size_t ramSize, size_t numIoThreads)
         : brickingInformation_(brickingInformation),
           ramSizeInMegaByte_(ramSize),
           usedRamInByte_(0),
-          brickedReader_(brickedVolumeReader)
+          brickedReader_(brickedVolumeReader),
+          numIoThreads_(numIoThreads),
+          stopIoThreads_(false)
     {
             ramSizeInByte_ = ramSizeInMegaByte_ * 1024 * 1024;
             //ramThresholdInByte_ = 1048576;
     }
 
+    template<class T>
+    RamManager<T>::~RamManager() {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            stopIoThreads_ = true;
+        }
+        queueChanged_.notify_all();
+        ioThreads_.join_all();
+
+        // the bricks own the data that has been added to RAM, only the pending reads are left
+        typename std::map<BrickLod, PendingRead*>::iterator it = pending_.begin();
+        for ( ; it != pending_.end(); ++it) {
+            delete[] it->second->data;
+            delete it->second;
+        }
+    }
+
     template<class T>
     BrickedVolumeReader* RamManager<T>::getBrickedVolumeReader() {
         return brickedReader_;
@@ -125,16 +259,28 @@ namespace voreen {
 
     template<class T>
     void RamManager<T>::setBrickedVolumeReader(BrickedVolumeReader* brickedVolumeReader) {
+        cancelPrefetch();
         brickedReader_ = brickedVolumeReader;
     }
 
+    template<class T>
+    typename RamManager<T>::Statistics RamManager<T>::getStatistics() const {
+        boost::mutex::scoped_lock lock(mutex_);
+        return statistics_;
+    }
+
+    template<class T>
+    void RamManager<T>::resetStatistics() {
+        boost::mutex::scoped_lock lock(mutex_);
+        statistics_ = Statistics();
+    }
 
     template<class T>
-    bool RamManager<T>::increaseUsedRam(size_t numBytes) {
+    bool RamManager<T>::increaseUsedRam(size_t numBytes, bool evictWanted) {
         bool success = true;
 
         if (usedRamInByte_ + numBytes > ramSizeInByte_) {
-            success = freeMem(numBytes);
+            success = freeMem(usedRamInByte_ + numBytes - ramSizeInByte_, evictWanted);
         }
 
         if (!success) {
@@ -155,8 +301,75 @@ namespace voreen {
         return numVoxels * brickingInformation_.originalVolumeBytesAllocated;
     }
 
+    template<class T>
+    void RamManager<T>::readBrick(const BrickLod& brickLod, char* data, int numBytes) {
+#ifdef _MSC_VER
+        boost::mutex::scoped_lock lock(readerMutex_);
+#endif
+        brickedReader_->readBrick(brickLod.first, data, numBytes, brickLod.second);
+    }
+
+    template<class T>
+    void RamManager<T>::addToRam(const BrickLod& brickLod, char* data, bool mostRecent) {
+        brickLod.first->addLodVolume(data, brickLod.second);
+
+        if (!brickLod.first->getAllVoxelsEqual() ) {
+            typename std::list<BrickLod>::iterator pos =
+                volumesInRam_.insert(mostRecent ? volumesInRam_.end() : volumesInRam_.begin(), brickLod);
+            ramPositions_[brickLod] = pos;
+        }
+    }
+
+    template<class T>
+    void RamManager<T>::brickAccessed(VolumeBrick<T>* volBrick, size_t lod) {
+        statistics_.hits++;
+
+        typename std::map<BrickLod, typename std::list<BrickLod>::iterator>::iterator it =
+            ramPositions_.find(BrickLod(volBrick, lod));
+        if (it != ramPositions_.end())
+            volumesInRam_.splice(volumesInRam_.end(), volumesInRam_, it->second);
+    }
+
     template<class T>
     bool RamManager<T>::readBrickFromDisk(voreen::VolumeBrick<T> *volBrick, size_t lod) {
+        BrickLod brickLod(volBrick, lod);
+
+        typename std::map<BrickLod, PendingRead*>::iterator it = pending_.find(brickLod);
+        if (it != pending_.end()) {
+            // Prefetched: the memory has already been accounted for. If no I/O thread
+            // has picked up the read yet, it is done right here.
+            PendingRead* read = it->second;
+            bool queued = false;
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                for (size_t i = 0; i < queue_.size(); ++i) {
+                    if (queue_[i].second == read) {
+                        queue_.erase(queue_.begin() + i);
+                        queued = true;
+                        break;
+                    }
+                }
+                while (!queued && !read->done)
+                    readDone_.wait(lock);
+            }
+
+            if (queued) {
+                statistics_.misses++;
+                readBrick(brickLod, read->data, read->numBytes);
+                boost::mutex::scoped_lock lock(mutex_);
+                statistics_.bytesRead += read->numBytes;
+            }
+            else
+                statistics_.prefetchHits++;
+
+            addToRam(brickLod, read->data);
+            pending_.erase(it);
+            delete read;
+            return true;
+        }
+
+        statistics_.misses++;
+
         size_t bytes = getNumBytes(lod);
 
         bool memAllocated = increaseUsedRam(bytes);
@@ -170,54 +383,122 @@ namespace voreen {
         int numVoxels = dimensions.x*dimensions.y*dimensions.z;
         int numBytes = numVoxels*sizeof(T);
 
-        T* newVolume = new T[numVoxels];
+        char* newVolume = new char[numBytes];
 
-        brickedReader_->readBrick(volBrick, (char*)newVolume,numBytes, lod);
-
-        volBrick->addLodVolume((char*)newVolume,lod);
-
-        if (!volBrick->getAllVoxelsEqual() ) {
-            volumesInRam_.push_back(std::pair<VolumeBrick<T>*,size_t> (volBrick,lod) );
+        readBrick(brickLod, newVolume, numBytes);
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            statistics_.bytesRead += numBytes;
         }
 
+        addToRam(brickLod, newVolume);
+
         return true;
 
     }
 
     template<class T>
-    void RamManager<T>::freeAll() {
-        size_t bytesFreed = 0;
+    void RamManager<T>::prefetch(const std::vector<BrickLod>& requests) {
+        cancelPrefetch();
 
-        while (volumesInRam_.size() > 0) {
-            std::pair<VolumeBrick<T>* , size_t> element = volumesInRam_.front();
+        wanted_.clear();
+        wanted_.insert(requests.begin(), requests.end());
 
-            //Delete the volume. This is done in the deleteLodVolume function of
-            //the VolumeBrick, so that the brick knows that that lod isn't there anymore
-            element.first->deleteLodVolume(element.second);
+        if (numIoThreads_ > 0 && ioThreads_.size() == 0) {
+            for (size_t i = 0; i < numIoThreads_; ++i)
+                ioThreads_.create_thread(boost::bind(&RamManager<T>::ioThread, this));
+        }
 
-            //Remove the entry from the list, because it's no longer in RAM.
-            volumesInRam_.pop_front();
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const BrickLod& brickLod = requests[i];
+
+            // bricks with equal voxels are never reloaded, resident ones not read twice
+            if (brickLod.first->getAllVoxelsEqual() || ramPositions_.count(brickLod) || pending_.count(brickLod))
+                continue;
 
-            int newBytesFreed = brickingInformation_.numVoxelsInBrick /
-                static_cast<int> ( pow(8.0f,(float)element.second) );
+            size_t bytes = getNumBytes(brickLod.second);
+            if (!increaseUsedRam(bytes, false))
+                break;
 
-            newBytesFreed = newBytesFreed * brickingInformation_.originalVolumeBytesAllocated;
+            tgt::ivec3 dimensions = tgt::ivec3(brickingInformation_.brickSize) /
+                static_cast<int>(pow(2.0f,(float)brickLod.second));
 
-            bytesFreed += newBytesFreed;
+            PendingRead* read = new PendingRead();
+            read->numBytes = dimensions.x*dimensions.y*dimensions.z*sizeof(T);
+            read->data = new char[read->numBytes];
+            read->done = false;
+            pending_[brickLod] = read;
+
+            boost::mutex::scoped_lock lock(mutex_);
+            queue_.push_back(std::make_pair(brickLod, read));
         }
-        usedRamInByte_ = usedRamInByte_ - bytesFreed;
+
+        queueChanged_.notify_all();
     }
 
     template<class T>
-    bool RamManager<T>::freeMem(size_t numBytes) {
-        size_t bytesFreed = 0;
+    void RamManager<T>::cancelPrefetch() {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            for (size_t i = 0; i < queue_.size(); ++i) {
+                PendingRead* read = queue_[i].second;
+                usedRamInByte_ -= getNumBytes(queue_[i].first.second);
+                pending_.erase(queue_[i].first);
+                delete[] read->data;
+                delete read;
+            }
+            queue_.clear();
+        }
+
+        typename std::map<BrickLod, PendingRead*>::iterator it = pending_.begin();
+        for ( ; it != pending_.end(); ++it) {
+            PendingRead* read = it->second;
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                while (!read->done)
+                    readDone_.wait(lock);
+            }
+            // not requested so far, so it is the first to go
+            addToRam(it->first, read->data, false);
+            delete read;
+        }
+        pending_.clear();
+    }
 
-        while (bytesFreed < numBytes) {
+    template<class T>
+    void RamManager<T>::ioThread() {
+        for (;;) {
+            std::pair<BrickLod, PendingRead*> job;
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                while (queue_.empty() && !stopIoThreads_)
+                    queueChanged_.wait(lock);
+                if (stopIoThreads_)
+                    return;
+                job = queue_.front();
+                queue_.pop_front();
+            }
 
-            if (volumesInRam_.size() == 0) {
-                return false; //This means something has gone wrong, we can't free any more RAM
+            readBrick(job.first, job.second->data, job.second->numBytes);
+
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                job.second->done = true;
+                statistics_.bytesRead += job.second->numBytes;
             }
-            std::pair<VolumeBrick<T>* , size_t> element = volumesInRam_.front();
+            readDone_.notify_all();
+        }
+    }
+
+    template<class T>
+    void RamManager<T>::freeAll() {
+        cancelPrefetch();
+        wanted_.clear();
+
+        size_t bytesFreed = 0;
+
+        while (volumesInRam_.size() > 0) {
+            BrickLod element = volumesInRam_.front();
 
             //Delete the volume. This is done in the deleteLodVolume function of
             //the VolumeBrick, so that the brick knows that that lod isn't there anymore
@@ -225,16 +506,43 @@ namespace voreen {
 
             //Remove the entry from the list, because it's no longer in RAM.
             volumesInRam_.pop_front();
+            ramPositions_.erase(element);
 
-            int newBytesFreed = brickingInformation_.numVoxelsInBrick /
-                static_cast<int> ( pow(8.0f,(float)element.second) );
+            bytesFreed += getNumBytes(element.second);
+        }
+        usedRamInByte_ = usedRamInByte_ - bytesFreed;
+    }
 
-            newBytesFreed = newBytesFreed * brickingInformation_.originalVolumeBytesAllocated;
+    template<class T>
+    bool RamManager<T>::freeMem(size_t numBytes, bool evictWanted) {
+        size_t bytesFreed = 0;
 
-            bytesFreed += newBytesFreed;
+        // first the bricks not requested by the last prefetch, then the others
+        for (int pass = 0; pass < (evictWanted ? 2 : 1) && bytesFreed < numBytes; ++pass) {
+            typename std::list<BrickLod>::iterator it = volumesInRam_.begin();
+            while (bytesFreed < numBytes && it != volumesInRam_.end()) {
+                BrickLod element = *it;
+                if (pass == 0 && wanted_.count(element)) {
+                    ++it;
+                    continue;
+                }
+
+                //Delete the volume. This is done in the deleteLodVolume function of
+                //the VolumeBrick, so that the brick knows that that lod isn't there anymore
+                element.first->deleteLodVolume(element.second);
+
+                //Remove the entry from the list, because it's no longer in RAM.
+                it = volumesInRam_.erase(it);
+                ramPositions_.erase(element);
+                statistics_.evictions++;
+
+                bytesFreed += getNumBytes(element.second);
+            }
         }
         usedRamInByte_ = usedRamInByte_ - bytesFreed;
-        return true;
+
+        //If not enough could be freed, something has gone wrong
+        return bytesFreed >= numBytes;
     }
 
 
@@ -30,6 +30,7 @@
 
 #include "voreen/core/datastructures/volume/volumeatomic.h"
 #include "voreen/core/datastructures/volume/volume.h"
+#include "voreen/core/datastructures/volume/gradientengine.h"
 
 #include <string>
 #include <iostream>
@@ -42,94 +43,94 @@ namespace voreen {
 
 // TODO: these functions should be encapsulated somewhere
 
-template<class U, class T>
-VolumeAtomic<U>* calcGradients(VolumeAtomic<T>* input) {
+/// Writes the first three channels of a gradient voxel
+template<class U>
+inline void setGradientChannels(U& voxel, const tgt::vec3& gradient) {
+    typedef typename VolumeElement<U>::BaseType Base;
+    voxel[0] = static_cast<Base>(gradient.x);
+    voxel[1] = static_cast<Base>(gradient.y);
+    voxel[2] = static_cast<Base>(gradient.z);
+}
 
-    VolumeAtomic<U>* result = new VolumeAtomic<U>(input->getDimensions(), input->getSpacing());
-    int channel = VolumeElement<U>::getNumChannels();
-
-    int bitsU = result->getBitsStored() / result->getNumChannels();
-    int bitsT = input->getBitsStored();
-
-    tgt::vec3 gradient;
-    tgt::ivec3 pos;
-    tgt::ivec3 dim = input->getDimensions();
-
-    for (pos.z = 0; pos.z < input->getDimensions().z; pos.z++) {
-        for (pos.y = 0; pos.y < input->getDimensions().y; pos.y++) {
-            for (pos.x = 0; pos.x < input->getDimensions().x; pos.x++) {
-                T v0, v1, v2, v3, v4, v5;
-
-                if (pos.x != dim.x-1)
-                    v0 = input->voxel(pos + tgt::ivec3(1, 0, 0));
-                else
-                    v0 = 0;
-                if (pos.y != dim.y-1)
-                    v1 = input->voxel(pos + tgt::ivec3(0, 1, 0));
-                else
-                    v1 = 0;
-                if (pos.z != dim.z-1)
-                    v2 = input->voxel(pos + tgt::ivec3(0, 0, 1));
-                else
-                    v2 = 0;
-
-                if (pos.x != 0)
-                    v3 = input->voxel(pos + tgt::ivec3(-1, 0, 0));
-                else
-                    v3 = 0;
-                if (pos.y != 0)
-                    v4 = input->voxel(pos + tgt::ivec3(0, -1, 0));
-                else
-                    v4 = 0;
-                if (pos.z != 0)
-                    v5 = input->voxel(pos + tgt::ivec3(0, 0, -1));
-                else
-                    v5 = 0;
-
-                gradient = tgt::vec3(static_cast<float>(v3 - v0), static_cast<float>(v4 - v1), static_cast<float>(v5 - v2)) / 2.f;
-                //gradient *= input->getSpacing();
-
-                float scaleFactor = pow(2.f, bitsU-bitsT);
-                gradient = scaleFactor*gradient;
-
-                // template argument U contains 4 channels
-                // -> write intensity to 4th channel
-                if (channel == 4) {
-                    if (bitsU == 8) {
-                        gradient = tgt::iround(gradient + 127.5f);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).r = static_cast<uint8_t>(gradient.x);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).g = static_cast<uint8_t>(gradient.y);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).b = static_cast<uint8_t>(gradient.z);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).a = static_cast<uint8_t>(input->getVoxelFloat(pos) * 255.f);
-                    }
-                    else if (bitsU == 16) {
-                        gradient = tgt::iround(gradient + 32767.5f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>(gradient.x);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>(gradient.y);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>(gradient.z);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).a = static_cast<uint8_t>(input->getVoxelFloat(pos) * 65535.f);
-                    }
-                }
-                else {
-                    if (bitsU == 8) {
+/// Writes the intensity to the alpha channel of 4 channel gradient voxels
+template<class S>
+inline void setGradientIntensity(tgt::Vector3<S>& /*voxel*/, float /*intensity*/) {}
+
+template<class S>
+inline void setGradientIntensity(tgt::Vector4<S>& voxel, float intensity) {
+    voxel.a = static_cast<S>(intensity * static_cast<float>(VolumeElement<S>::rangeMax()));
+}
+
+/**
+ * Tile operation of the central-difference gradients, see GradientEngine.
+ */
+template<class U, class T>
+class CentralDifferenceGradients {
+public:
+    typedef std::vector<tgt::vec3> Scratch;
+
+    CentralDifferenceGradients(const VolumeAtomic<T>* input, VolumeAtomic<U>* result)
+        : input_(input)
+        , result_(result)
+        , dims_(input->getDimensions())
+        , bitsU_(result->getBitsStored() / result->getNumChannels())
+        , scaleFactor_(pow(2.f, bitsU_ - static_cast<int>(input->getBitsStored())))
+        , range_(input->elementRange())
+    {}
+
+    void processTile(const tgt::ivec3& llf, const tgt::ivec3& urb, Scratch& gradients) const {
+        gradients.resize(urb.x - llf.x);
+        for (int z = llf.z; z < urb.z; z++) {
+            for (int y = llf.y; y < urb.y; y++) {
+                GradientEngine::centralDifferencesRow(input_->voxel(), dims_, y, z, llf.x, urb.x, &gradients[0]);
+                const size_t row = (static_cast<size_t>(z) * dims_.y + y) * dims_.x;
+                for (int x = llf.x; x < urb.x; x++) {
+                    tgt::vec3 gradient = scaleFactor_ * gradients[x - llf.x];
+                    if (bitsU_ == 8)
                         gradient = tgt::iround(gradient + 127.5f);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).r = static_cast<uint8_t>(gradient.x);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).g = static_cast<uint8_t>(gradient.y);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).b = static_cast<uint8_t>(gradient.z);
-                    }
-                    else if (bitsU == 16) {
+                    else if (bitsU_ == 16)
                         gradient = tgt::iround(gradient + 32767.5f);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>(gradient.x);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>(gradient.y);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>(gradient.z);
-                    }
+                    else
+                        continue;
+
+                    U& voxel = result_->voxel(row + x);
+                    setGradientChannels(voxel, gradient);
+                    // template argument U contains 4 channels -> write intensity to 4th channel
+                    setGradientIntensity(voxel, (static_cast<float>(input_->voxel(row + x)) - range_.x) /
+                                                (range_.y - range_.x));
                 }
             }
         }
     }
-    return result;
+
+private:
+    const VolumeAtomic<T>* input_;
+    VolumeAtomic<U>* result_;
+    tgt::ivec3 dims_;
+    int bitsU_;
+    float scaleFactor_;
+    tgt::vec2 range_;
+};
+
+/**
+ * Calculates the central-difference gradients of the voxels in [llf, urb)
+ * into result, which must have the dimensions of input.
+ */
+template<class U, class T>
+void calcGradients(const VolumeAtomic<T>* input, VolumeAtomic<U>* result,
+                   const tgt::ivec3& llf, const tgt::ivec3& urb)
+{
+    tgtAssert(input->getDimensions() == result->getDimensions(), "Dimensions mismatch");
+    GradientEngine::forEachTile(CentralDifferenceGradients<U, T>(input, result),
+                                tgt::max(llf, tgt::ivec3(0, 0, 0)), tgt::min(urb, input->getDimensions()));
 }
 
+template<class U, class T>
+VolumeAtomic<U>* calcGradients(VolumeAtomic<T>* input) {
+    VolumeAtomic<U>* result = new VolumeAtomic<U>(input->getDimensions(), input->getSpacing());
+    calcGradients(input, result, tgt::ivec3(0, 0, 0), input->getDimensions());
+    return result;
+}
 
 /**
  * Calculates gradients by central differences.
@@ -168,6 +169,24 @@ VolumeAtomic<U>* calcGradients(Volume* vol) {
     return 0;
 }
 
+/**
+ * Updates the central-difference gradients in result after the voxels of vol
+ * in [llf, urb) changed. Only the affected voxels are recomputed.
+ *
+ * @return false if vol is not a 8-, 12- or 16-bit dataset
+ */
+template<class U>
+bool updateGradients(Volume* vol, VolumeAtomic<U>* result, tgt::ivec3 llf, tgt::ivec3 urb) {
+    GradientEngine::growBox(vol->getDimensions(), 1, llf, urb);
+    if (vol->getFormatId() == Volume::FORMAT_UINT8)
+        calcGradients<U, uint8_t>(static_cast<VolumeUInt8*>(vol), result, llf, urb);
+    else if (vol->getFormatId() == Volume::FORMAT_UINT16)
+        calcGradients<U, uint16_t>(static_cast<VolumeUInt16*>(vol), result, llf, urb);
+    else
+        return false;
+    return true;
+}
+
 /**
  * Calculates gradients using linear regression according to Neumann et al.
  *
@@ -362,178 +381,87 @@ VolumeAtomic<U>* calcGradientsLinearRegression(Volume* vol) {
 
 
 /**
- * Calculates gradients with neighborhood of 26, using the Sobel filter.
- *
+ * Tile operation of the Sobel gradients, see GradientEngine.
  */
 template<class U, class T>
-VolumeAtomic<U>* calcGradientsSobel(VolumeAtomic<T> *input, int mapping) {
-    VolumeAtomic<U>* result = new VolumeAtomic<U>(input->getDimensions(), input->getSpacing());
-
-    using tgt::vec3;
-    using tgt::ivec3;
-
-    int bitsU = result->getBitsStored() / result->getNumChannels();
-
-    vec3 gradient;
-
-    ivec3 pos;
-    ivec3 dim = input->getDimensions();
-
-    //check for 4 channels...write intensity to this channel
-    bool v4 = VolumeElement<U>::getNumChannels() == 4;
-
-    for (pos.z = 0; pos.z < dim.z; pos.z++) {
-        for (pos.y = 0; pos.y < dim.y; pos.y++) {
-            for (pos.x = 0; pos.x < dim.x; pos.x++) {
-
-                gradient = vec3(0.f);
-
-                if (pos.x >= 1 && pos.x < dim.x-1 &&
-                    pos.y >= 1 && pos.y < dim.y-1 &&
-                    pos.z >= 1 && pos.z < dim.z-1)
-                {
-
-                    //left plane
-                    T v000 = input->voxel(pos + ivec3(-1, -1, -1));
-                    T v001 = input->voxel(pos + ivec3(-1, -1, 0));
-                    T v002 = input->voxel(pos + ivec3(-1, -1, 1));
-                    T v010 = input->voxel(pos + ivec3(-1, 0, -1));
-                    T v011 = input->voxel(pos + ivec3(-1, 0, 0));
-                    T v012 = input->voxel(pos + ivec3(-1, 0, 1));
-                    T v020 = input->voxel(pos + ivec3(-1, 1, -1));
-                    T v021 = input->voxel(pos + ivec3(-1, 1, 0));
-                    T v022 = input->voxel(pos + ivec3(-1, 1, 1));
-                    //mid plane
-                    T v100 = input->voxel(pos + ivec3(0, -1, -1));
-                    T v101 = input->voxel(pos + ivec3(0, -1, 0));
-                    T v102 = input->voxel(pos + ivec3(0, -1, 1));
-                    T v110 = input->voxel(pos + ivec3(0, 0, -1));
-                    //T v111 = input->voxel(pos + ivec3(0, 0, 0)); //not needed for calculation
-                    T v112 = input->voxel(pos + ivec3(0, 0, 1));
-                    T v120 = input->voxel(pos + ivec3(0, -1, -1));
-                    T v121 = input->voxel(pos + ivec3(0, -1, 0));
-                    T v122 = input->voxel(pos + ivec3(0, -1, 1));
-                    //right plane
-                    T v200 = input->voxel(pos + ivec3(1, -1, -1));
-                    T v201 = input->voxel(pos + ivec3(1, -1, 0));
-                    T v202 = input->voxel(pos + ivec3(1, -1, 1));
-                    T v210 = input->voxel(pos + ivec3(1, 0, -1));
-                    T v211 = input->voxel(pos + ivec3(1, 0, 0));
-                    T v212 = input->voxel(pos + ivec3(1, 0, 1));
-                    T v220 = input->voxel(pos + ivec3(1, 1, -1));
-                    T v221 = input->voxel(pos + ivec3(1, 1, 0));
-                    T v222 = input->voxel(pos + ivec3(1, 1, 1));
-
-                    //filter x-direction
-                    gradient.x += -1 * v000;
-                    gradient.x += -3 * v010;
-                    gradient.x += -1 * v020;
-                    gradient.x += 1 * v200;
-                    gradient.x += 3 * v210;
-                    gradient.x += 1 * v220;
-                    gradient.x += -3 * v001;
-                    gradient.x += -6 * v011;
-                    gradient.x += -3 * v021;
-                    gradient.x += +3 * v201;
-                    gradient.x += +6 * v211;
-                    gradient.x += +3 * v221;
-                    gradient.x += -1 * v002;
-                    gradient.x += -3 * v012;
-                    gradient.x += -1 * v022;
-                    gradient.x += +1 * v202;
-                    gradient.x += +3 * v212;
-                    gradient.x += +1 * v222;
-
-                    //filter y-direction
-                    gradient.y += -1 * v000;
-                    gradient.y += -3 * v100;
-                    gradient.y += -1 * v200;
-                    gradient.y += +1 * v020;
-                    gradient.y += +3 * v120;
-                    gradient.y += +1 * v220;
-                    gradient.y += -3 * v001;
-                    gradient.y += -6 * v101;
-                    gradient.y += -3 * v201;
-                    gradient.y += +3 * v021;
-                    gradient.y += +6 * v121;
-                    gradient.y += +3 * v221;
-                    gradient.y += -1 * v002;
-                    gradient.y += -3 * v102;
-                    gradient.y += -1 * v202;
-                    gradient.y += +1 * v022;
-                    gradient.y += +3 * v122;
-                    gradient.y += +1 * v222;
-
-                    //filter z-direction
-                    gradient.z += -1 * v000;
-                    gradient.z += -3 * v100;
-                    gradient.z += -1 * v200;
-                    gradient.z += +1 * v002;
-                    gradient.z += +3 * v102;
-                    gradient.z += +1 * v202;
-                    gradient.z += -3 * v010;
-                    gradient.z += -6 * v110;
-                    gradient.z += -3 * v210;
-                    gradient.z += +3 * v012;
-                    gradient.z += +6 * v112;
-                    gradient.z += +3 * v212;
-                    gradient.z += -1 * v020;
-                    gradient.z += -3 * v120;
-                    gradient.z += -1 * v220;
-                    gradient.z += +1 * v022;
-                    gradient.z += +3 * v122;
-                    gradient.z += +1 * v222;
-
+class SobelGradients {
+public:
+    struct Scratch {
+        std::vector<tgt::ivec3> sums;
+        std::vector<int> columns;
+    };
+
+    SobelGradients(const VolumeAtomic<T>* input, VolumeAtomic<U>* result, int mapping)
+        : input_(input)
+        , result_(result)
+        , dims_(input->getDimensions())
+        , bitsU_(result->getBitsStored() / result->getNumChannels())
+        , mapping_(mapping)
+        , spacing_(input->getSpacing())
+        , range_(input->elementRange())
+    {}
+
+    void processTile(const tgt::ivec3& llf, const tgt::ivec3& urb, Scratch& scratch) const {
+        scratch.sums.resize(urb.x - llf.x);
+        for (int z = llf.z; z < urb.z; z++) {
+            for (int y = llf.y; y < urb.y; y++) {
+                GradientEngine::sobelRow(input_->voxel(), dims_, y, z, llf.x, urb.x, &scratch.sums[0], scratch.columns);
+                const size_t row = (static_cast<size_t>(z) * dims_.y + y) * dims_.x;
+                for (int x = llf.x; x < urb.x; x++) {
+                    tgt::vec3 gradient = tgt::vec3(scratch.sums[x - llf.x]);
                     gradient /= 22.f;   // sum of all positive weights
                     gradient /= 2.f;    // this mask has a step length of 2 voxels
-                    gradient /= input->getSpacing();
+                    gradient /= spacing_;
                     gradient *= -1.f;
 
-                }
-
-                if (v4) {
-                    if (bitsU == 8) {
+                    if (bitsU_ == 8)
                         gradient = tgt::iround(gradient + 127.5f);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).r = static_cast<uint8_t>(gradient.x);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).g = static_cast<uint8_t>(gradient.y);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).b = static_cast<uint8_t>(gradient.z);
-                        reinterpret_cast<Volume4xUInt8*>(result)->voxel(pos).a = static_cast<uint8_t>(input->getVoxelFloat(pos) * 255.f);
-                    }
-                    else if (bitsU == 16) {
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>((gradient.x/mapping * 256.f) + 32768.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>((gradient.y/mapping * 256.f) + 32768.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>((gradient.z/mapping * 256.f) + 32768.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).a = static_cast<uint16_t>((input->getVoxelFloat(pos) * 65535.f));
-                    }
-                    else if (bitsU == 12) {
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>((gradient.x/mapping * 16.f) + 2048.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>((gradient.y/mapping * 16.f) + 2048.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>((gradient.z/mapping * 16.f) + 2048.f);
-                        reinterpret_cast<Volume4xUInt16*>(result)->voxel(pos).a = static_cast<uint16_t>((input->getVoxelFloat(pos) * 4095.f));
-                    }
-                }
-                else {
-                    if (bitsU == 8) {
-                        gradient = tgt::iround(gradient + 127.5f);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).r = static_cast<uint8_t>(gradient.x);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).g = static_cast<uint8_t>(gradient.y);
-                        reinterpret_cast<Volume3xUInt8*>(result)->voxel(pos).b = static_cast<uint8_t>(gradient.z);
-                    }
-                    else if (bitsU == 16) {
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>((gradient.x/mapping * 256.f) + 32768.f);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>((gradient.y/mapping * 256.f) + 32768.f);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>((gradient.z/mapping * 256.f) + 32768.f);
-                    }
-                     else if (bitsU == 12) {
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).r = static_cast<uint16_t>((gradient.x/mapping * 16.f) + 2048.f);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).g = static_cast<uint16_t>((gradient.y/mapping * 16.f) + 2048.f);
-                        reinterpret_cast<Volume3xUInt16*>(result)->voxel(pos).b = static_cast<uint16_t>((gradient.z/mapping * 16.f) + 2048.f);
-                    }
+                    else if (bitsU_ == 16)
+                        gradient = (gradient / static_cast<float>(mapping_) * 256.f) + 32768.f;
+                    else
+                        continue;
+
+                    U& voxel = result_->voxel(row + x);
+                    setGradientChannels(voxel, gradient);
+                    //check for 4 channels...write intensity to this channel
+                    setGradientIntensity(voxel, (static_cast<float>(input_->voxel(row + x)) - range_.x) /
+                                                (range_.y - range_.x));
                 }
-
             }
         }
     }
+
+private:
+    const VolumeAtomic<T>* input_;
+    VolumeAtomic<U>* result_;
+    tgt::ivec3 dims_;
+    int bitsU_;
+    int mapping_;
+    tgt::vec3 spacing_;
+    tgt::vec2 range_;
+};
+
+/**
+ * Calculates gradients with neighborhood of 26, using the Sobel filter, for
+ * the voxels in [llf, urb) of result, which must have the dimensions of input.
+ */
+template<class U, class T>
+void calcGradientsSobel(const VolumeAtomic<T>* input, VolumeAtomic<U>* result, int mapping,
+                        const tgt::ivec3& llf, const tgt::ivec3& urb)
+{
+    tgtAssert(input->getDimensions() == result->getDimensions(), "Dimensions mismatch");
+    GradientEngine::forEachTile(SobelGradients<U, T>(input, result, mapping),
+                                tgt::max(llf, tgt::ivec3(0, 0, 0)), tgt::min(urb, input->getDimensions()));
+}
+
+/**
+ * Calculates gradients with neighborhood of 26, using the Sobel filter.
+ *
+ */
+template<class U, class T>
+VolumeAtomic<U>* calcGradientsSobel(VolumeAtomic<T> *input, int mapping) {
+    VolumeAtomic<U>* result = new VolumeAtomic<U>(input->getDimensions(), input->getSpacing());
+    calcGradientsSobel(input, result, mapping, tgt::ivec3(0, 0, 0), input->getDimensions());
     return result;
 }
 
@@ -559,6 +487,25 @@ VolumeAtomic<U>* calcGradientsSobel(Volume* vol) {
 }
 
 
+/**
+ * Updates the Sobel gradients in result after the voxels of vol in [llf, urb)
+ * changed. Only the affected voxels are recomputed.
+ *
+ * @return false if vol is not a 8-, 12- or 16-bit dataset
+ */
+template<class U>
+bool updateGradientsSobel(Volume* vol, VolumeAtomic<U>* result, tgt::ivec3 llf, tgt::ivec3 urb) {
+    GradientEngine::growBox(vol->getDimensions(), 1, llf, urb);
+    int bits = vol->getBitsStored();
+    if (bits == 8 && vol->getFormatId() == Volume::FORMAT_UINT8)
+        calcGradientsSobel<U, uint8_t>(static_cast<VolumeUInt8*>(vol), result, 1, llf, urb);
+    else if ((bits == 12 || bits == 16) && vol->getFormatId() == Volume::FORMAT_UINT16)
+        calcGradientsSobel<U, uint16_t>(static_cast<VolumeUInt16*>(vol), result, (bits == 12) ? 32 : 512, llf, urb);
+    else
+        return false;
+    return true;
+}
+
 /**
  * Calculates gradient magnitudes from a gradient volume.
  *
@@ -601,16 +548,20 @@ VolumeAtomic<U>* calcGradientMagnitudes(VolumeAtomic<T> *input) {
     }
 
 
-    ivec3 pos;
     ivec3 dim = input->getDimensions();
-    for (pos.z = 0; pos.z < dim.z; pos.z++) {
-        for (pos.y = 0; pos.y < dim.y; pos.y++) {
-            for (pos.x = 0; pos.x < dim.x; pos.x++) {
-
-                vec3 gradient;
-                gradient.x = input->getVoxelFloat(pos, 0);
-                gradient.y = input->getVoxelFloat(pos, 1);
-                gradient.z = input->getVoxelFloat(pos, 2);
+    std::vector<float> channels[3];
+    for (int c = 0; c < 3; ++c)
+        channels[c].resize(dim.x);
+    U* out = result->voxel();
+    for (int z = 0; z < dim.z; z++) {
+        for (int y = 0; y < dim.y; y++) {
+            // fetch the three channels of the whole row
+            size_t rowIndex = static_cast<size_t>(dim.x) * (y + static_cast<size_t>(dim.y) * z);
+            for (int c = 0; c < 3; ++c)
+                input->getVoxelsFloat(rowIndex, dim.x, &channels[c][0], c);
+
+            for (int x = 0; x < dim.x; x++) {
+                vec3 gradient(channels[0][x], channels[1][x], channels[2][x]);
 
                 // input value range is [0:maxValue] with (maxValue/2.f) corresponding to zero
                 gradient = (gradient*2.f)-1.f;
@@ -618,8 +569,7 @@ VolumeAtomic<U>* calcGradientMagnitudes(VolumeAtomic<T> *input) {
                 float gradientMagnitude = tgt::length(gradient);
 
                 //result->voxel(pos) = static_cast<U>( ( (derivative / maxValueT) / 2.f + 0.5f ) * maxValueU );
-                result->voxel(pos) = static_cast<U>( gradientMagnitude * maxValueU );
-
+                out[rowIndex + x] = static_cast<U>( gradientMagnitude * maxValueU );
             }
         }
     }
@@ -930,12 +880,43 @@ VolumeAtomic<U>* calcCurvature(Volume* vol, unsigned int curvatureType) {
 }
 
 
+/**
+ * Filters applicable to gradients stored in a 32 bit volume data set.
+ */
+enum GradientFilter {
+    GRADIENT_FILTER_NONE,
+    GRADIENT_FILTER_ZERO,               ///< see filterGradients()
+    GRADIENT_FILTER_MID,                ///< see filterGradientsMid()
+    GRADIENT_FILTER_WEIGHTED,           ///< see filterGradientsWeighted()
+    GRADIENT_FILTER_WEIGHTED_INTENSITY  ///< see filterGradientsWeighted() with intensity check
+};
+
 /**
  * Calculates gradients with neighborhood of 26.
  * Slower, but should result in better gradients.
  */
 Volume4xUInt8* calcGradients26(Volume* vol);
 
+/**
+ * Calculates gradients with neighborhood of 26 and filters them in the same
+ * pass, without allocating the unfiltered gradients.
+ */
+Volume4xUInt8* calcGradients26(Volume* vol, GradientFilter filter);
+
+/**
+ * Updates gradients calculated by calcGradients26() after the voxels of vol
+ * in [llf, urb) changed. Only the affected voxels are recomputed.
+ *
+ * @return false if vol is not a 8-bit dataset
+ */
+bool updateGradients26(Volume* vol, Volume4xUInt8* gradients, tgt::ivec3 llf, tgt::ivec3 urb,
+                       GradientFilter filter = GRADIENT_FILTER_NONE);
+
+/**
+ * Applies filter to the gradients stored in a 32 bit volume data set.
+ */
+Volume4xUInt8* filterGradients(Volume* vol, GradientFilter filter);
+
 /**
  * Filters gradients stored in a 32 bit volume data set. A very simple interpolation
  * adapted to binary data sets is performed, which replaces zero gradients by
@@ -0,0 +1,301 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#ifndef VRN_GRADIENTENGINE_H
+#define VRN_GRADIENTENGINE_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace voreen {
+
+/**
+ * Building blocks for computing gradient volumes in parallel.
+ *
+ * The output box is split into tiles of TILE_ROWS rows by TILE_SLICES slices
+ * of full width that are processed by the threads in turn, so the rows a
+ * stencil touches stay in cache. Kernels work on raw voxel pointers of one
+ * row at a time instead of the generic Volume accessors.
+ */
+class GradientEngine {
+public:
+    enum {
+        TILE_ROWS = 16,
+        TILE_SLICES = 8
+    };
+
+    /**
+     * Calls op.processTile(llf, urb, scratch) for tiles covering the box
+     * [llf, urb), in parallel. Every thread has its own typename Op::Scratch.
+     */
+    template<class Op>
+    static void forEachTile(const Op& op, const tgt::ivec3& llf, const tgt::ivec3& urb);
+
+    /**
+     * Returns the box [llf, urb) grown by margin voxels on every side and
+     * clipped to dims, for updating the output after the input changed.
+     */
+    static void growBox(const tgt::ivec3& dims, int margin, tgt::ivec3& llf, tgt::ivec3& urb) {
+        llf = tgt::max(llf - tgt::ivec3(margin, margin, margin), tgt::ivec3(0, 0, 0));
+        urb = tgt::min(urb + tgt::ivec3(margin, margin, margin), dims);
+    }
+
+    /**
+     * Central differences (f(x-1) - f(x+1)) / 2 of the voxels [x0, x1) of
+     * row (y, z), taking voxels outside of the volume as 0.
+     */
+    template<class T>
+    static void centralDifferencesRow(const T* data, const tgt::ivec3& dims, int y, int z,
+                                      int x0, int x1, tgt::vec3* out);
+
+    /**
+     * Sums of the 3x3x3 Sobel operator (weights 1, 3, 6 across the
+     * derivative direction) of the voxels [x0, x1) of row (y, z), pointing
+     * from lower to higher values. The sums are zero at the border.
+     *
+     * @param scratch at least 5 * dims.x ints, reused across calls
+     */
+    template<class T>
+    static void sobelRow(const T* data, const tgt::ivec3& dims, int y, int z, int x0, int x1,
+                         tgt::ivec3* out, std::vector<int>& scratch);
+
+    /**
+     * Sums of the differences of the 13 pairs of opposite neighbors in the
+     * 26-neighborhood of an inner voxel, pointing from higher to lower values.
+     */
+    template<class T>
+    static tgt::ivec3 neighbors26(const T* v, ptrdiff_t sy, ptrdiff_t sz);
+
+    /**
+     * The filters of 32 bit gradients from gradient.h for an inner voxel g,
+     * with row and slice strides sy and sz.
+     */
+    static tgt::col4 filterZero(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz);
+    static tgt::col4 filterMid(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz);
+    static tgt::col4 filterWeighted(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz, bool intensityCheck);
+};
+
+// ----------------------------------------------------------------------------
+
+template<class Op>
+void GradientEngine::forEachTile(const Op& op, const tgt::ivec3& llf, const tgt::ivec3& urb) {
+    const int rows = urb.y - llf.y;
+    const int slices = urb.z - llf.z;
+    if (rows <= 0 || slices <= 0 || urb.x <= llf.x)
+        return;
+
+    const int tilesY = (rows + TILE_ROWS - 1) / TILE_ROWS;
+    const int numTiles = tilesY * ((slices + TILE_SLICES - 1) / TILE_SLICES);
+
+    #ifdef _OPENMP
+    #pragma omp parallel if (numTiles > 1)
+    #endif
+    {
+        typename Op::Scratch scratch;
+
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+        #endif
+        for (int t = 0; t < numTiles; t++) {
+            tgt::ivec3 first(llf.x, llf.y + (t % tilesY) * TILE_ROWS, llf.z + (t / tilesY) * TILE_SLICES);
+            tgt::ivec3 last(urb.x, std::min(first.y + static_cast<int>(TILE_ROWS), urb.y),
+                            std::min(first.z + static_cast<int>(TILE_SLICES), urb.z));
+            op.processTile(first, last, scratch);
+        }
+    }
+}
+
+template<class T>
+void GradientEngine::centralDifferencesRow(const T* data, const tgt::ivec3& dims, int y, int z,
+                                           int x0, int x1, tgt::vec3* out)
+{
+    const ptrdiff_t sy = dims.x;
+    const ptrdiff_t sz = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    const T* row = data + z * sz + y * sy;
+    const bool hasUp = (y != dims.y - 1);
+    const bool hasDown = (y != 0);
+    const bool hasBack = (z != dims.z - 1);
+    const bool hasFront = (z != 0);
+
+    for (int x = x0; x < x1; x++) {
+        const T* v = row + x;
+        T v0 = (x != dims.x - 1) ? v[1] : T(0);
+        T v1 = hasUp ? v[sy] : T(0);
+        T v2 = hasBack ? v[sz] : T(0);
+        T v3 = (x != 0) ? v[-1] : T(0);
+        T v4 = hasDown ? v[-sy] : T(0);
+        T v5 = hasFront ? v[-sz] : T(0);
+        out[x - x0] = tgt::vec3(static_cast<float>(v3 - v0), static_cast<float>(v4 - v1),
+                                static_cast<float>(v5 - v2)) / 2.f;
+    }
+}
+
+template<class T>
+void GradientEngine::sobelRow(const T* data, const tgt::ivec3& dims, int y, int z, int x0, int x1,
+                              tgt::ivec3* out, std::vector<int>& scratch)
+{
+    if (y < 1 || y >= dims.y - 1 || z < 1 || z >= dims.z - 1 || dims.x < 3) {
+        std::fill(out, out + (x1 - x0), tgt::ivec3(0, 0, 0));
+        return;
+    }
+
+    const ptrdiff_t sy = dims.x;
+    const ptrdiff_t sz = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    const T* c = data + z * sz + y * sy;
+
+    // Per column: the cross-smoothed values for x, and for y and z the
+    // differences along the axis in the center plane (0) and the two outer
+    // planes (1) of the other axis
+    const int first = std::max(x0 - 1, 0);
+    const int last = std::min(x1 + 1, dims.x);
+    scratch.resize(5 * static_cast<size_t>(dims.x));
+    int* smoothX = &scratch[0];
+    int* diffY0 = smoothX + dims.x;
+    int* diffY1 = diffY0 + dims.x;
+    int* diffZ0 = diffY1 + dims.x;
+    int* diffZ1 = diffZ0 + dims.x;
+    for (int x = first; x < last; x++) {
+        const T* v = c + x;
+        int edges = static_cast<int>(v[-sy]) + v[sy] + v[-sz] + v[sz];
+        int corners = static_cast<int>(v[-sy - sz]) + v[-sy + sz] + v[sy - sz] + v[sy + sz];
+        smoothX[x] = 6 * static_cast<int>(v[0]) + 3 * edges + corners;
+        diffY0[x] = static_cast<int>(v[sy]) - v[-sy];
+        diffY1[x] = static_cast<int>(v[sy - sz]) - v[-sy - sz] + v[sy + sz] - v[-sy + sz];
+        diffZ0[x] = static_cast<int>(v[sz]) - v[-sz];
+        diffZ1[x] = static_cast<int>(v[sz - sy]) - v[-sz - sy] + v[sz + sy] - v[-sz + sy];
+    }
+
+    for (int x = x0; x < x1; x++) {
+        if (x < 1 || x >= dims.x - 1) {
+            out[x - x0] = tgt::ivec3(0, 0, 0);
+            continue;
+        }
+        out[x - x0] = tgt::ivec3(
+            smoothX[x + 1] - smoothX[x - 1],
+            6 * diffY0[x] + 3 * (diffY0[x - 1] + diffY0[x + 1] + diffY1[x]) + diffY1[x - 1] + diffY1[x + 1],
+            6 * diffZ0[x] + 3 * (diffZ0[x - 1] + diffZ0[x + 1] + diffZ1[x]) + diffZ1[x - 1] + diffZ1[x + 1]);
+    }
+}
+
+template<class T>
+tgt::ivec3 GradientEngine::neighbors26(const T* v, ptrdiff_t sy, ptrdiff_t sz) {
+    // v[dx + dy * sy + dz * sz]
+    #define VRN_N26(dx, dy, dz) static_cast<int>(v[(dx) + (dy) * sy + (dz) * sz])
+    const int dx  = VRN_N26( 1, 0, 0) - VRN_N26(-1, 0, 0);
+    const int dy  = VRN_N26( 0, 1, 0) - VRN_N26( 0,-1, 0);
+    const int dz  = VRN_N26( 0, 0, 1) - VRN_N26( 0, 0,-1);
+    const int xy  = VRN_N26( 1, 1, 0) - VRN_N26(-1,-1, 0);
+    const int xmy = VRN_N26( 1,-1, 0) - VRN_N26(-1, 1, 0);
+    const int yz  = VRN_N26( 0, 1, 1) - VRN_N26( 0,-1,-1);
+    const int myz = VRN_N26( 0,-1, 1) - VRN_N26( 0, 1,-1);
+    const int mxz = VRN_N26(-1, 0, 1) - VRN_N26( 1, 0,-1);
+    const int xz  = VRN_N26( 1, 0, 1) - VRN_N26(-1, 0,-1);
+    const int xyz   = VRN_N26( 1, 1, 1) - VRN_N26(-1,-1,-1);
+    const int mxyz  = VRN_N26(-1, 1, 1) - VRN_N26( 1,-1,-1);
+    const int xmyz  = VRN_N26( 1,-1, 1) - VRN_N26(-1, 1,-1);
+    const int xymz  = VRN_N26( 1, 1,-1) - VRN_N26(-1,-1, 1);
+    #undef VRN_N26
+
+    return -tgt::ivec3(dx + xy + xmy - mxz + xz + xyz - mxyz + xmyz + xymz,
+                       dy + xy - xmy + yz - myz + xyz + mxyz - xmyz + xymz,
+                       dz + yz + myz + mxz + xz + xyz + mxyz + xmyz - xymz);
+}
+
+inline tgt::col4 GradientEngine::filterZero(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz) {
+    // gradients are stored in the interval [0..256], with (128,128,128) being the zero gradient
+    const tgt::col3 zeroGrad(128, 128, 128);
+    tgt::col4 filteredGrad = g[0];
+    if (g[0].xyz() == zeroGrad) {
+        const ptrdiff_t offsets[6] = { 1, sy, sz, -1, -sy, -sz };
+        for (int i = 0; i < 6; i++) {
+            if (g[offsets[i]].xyz() != zeroGrad) {
+                filteredGrad = g[offsets[i]];
+                break;
+            }
+        }
+    }
+    return tgt::col4(filteredGrad.x, filteredGrad.y, filteredGrad.z, g[0].a);
+}
+
+inline tgt::col4 GradientEngine::filterMid(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz) {
+    using tgt::vec4;
+    vec4 g0 = vec4(g[0]);
+
+    vec4 g1 = vec4(g[-1 - sy - sz]);
+    vec4 g2 = vec4(g[ 1 + sy + sz]);
+    vec4 g3 = vec4(g[-1 + sy - sz]);
+    vec4 g4 = vec4(g[ 1 - sy + sz]);
+    vec4 g5 = vec4(g[-1 - sy + sz]);
+    vec4 g6 = vec4(g[ 1 + sy - sz]);
+    vec4 g7 = vec4(g[-1 + sy + sz]);
+    vec4 g8 = vec4(g[ 1 - sy - sz]);
+
+    vec4 mix0 = vec4(0.5)*(vec4(0.5)*g1+vec4(0.5)*g2) + vec4(0.5)*(vec4(0.5)*g3+vec4(0.5)*g4);
+    vec4 mix1 = vec4(0.5)*(vec4(0.5)*g5+vec4(0.5)*g6) + vec4(0.5)*(vec4(0.5)*g7+vec4(0.5)*g8);
+
+    vec4 filteredGrad = vec4(0.25)*(vec4(0.5)*mix0+vec4(0.5)*mix1) + vec4(0.75)*g0;
+    return tgt::col4(vec4(filteredGrad.x, filteredGrad.y, filteredGrad.z, g0.a));
+}
+
+inline tgt::col4 GradientEngine::filterWeighted(const tgt::col4* g, ptrdiff_t sy, ptrdiff_t sz,
+                                                bool intensityCheck)
+{
+    using tgt::vec4;
+    // weights by the number of non-zero offsets: center, direct, diagonal, diagonal-diagonal
+    const float weights[4] = { 9.f, 6.f, 3.f, 1.f };
+    const float sumWeight = 8 * weights[3] + 12 * weights[2] + 6 * weights[1] + weights[0];
+    const uint8_t center = g[0].a;
+
+    // summed per x plane first, as the separate terms of the original filter
+    vec4 mix[3];
+    for (int dx = -1; dx <= 1; dx++) {
+        vec4 sum(0.f, 0.f, 0.f, 0.f);
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                vec4 n = vec4(g[dx + dy * sy + dz * sz]);
+                if (intensityCheck && g[dx + dy * sy + dz * sz].a != center)
+                    n = vec4(128, 128, 128, 0);
+                sum += weights[(dx != 0) + (dy != 0) + (dz != 0)] * n;
+            }
+        }
+        mix[dx + 1] = sum;
+    }
+
+    vec4 filteredGrad = (mix[0] + mix[1] + mix[2]) / sumWeight;
+    return tgt::col4(vec4(filteredGrad.x, filteredGrad.y, filteredGrad.z, static_cast<float>(center)));
+}
+
+} // namespace voreen
+
+#endif // VRN_GRADIENTENGINE_H
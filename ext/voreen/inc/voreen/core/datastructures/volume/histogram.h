@@ -34,6 +34,8 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <utility>
 
 namespace voreen {
 
@@ -44,7 +46,11 @@ class Histogram {
 
 // ----------------------------------------------------------------------------
 
-/// 1D Intensity Histogram.
+/**
+ * 1D Intensity Histogram.
+ *
+ * The voxels are counted in parallel with private buckets per thread.
+ */
 class HistogramIntensity : public Histogram {
 public:
     /// Create new histogram with bucketCount buckets from volume
@@ -78,6 +84,12 @@ public:
     tgt::ivec2 getSignificantRange() const;
 
 protected:
+    /// Adds the count of the voxel ranges [first, second) to the buckets
+    void accumulate(const Volume* volume, const std::vector<std::pair<size_t, size_t> >& ranges);
+
+    /// Updates the maximum and the significant range from the buckets
+    void updateStatistics();
+
     std::vector<int> hist_;
     int maxValue_;
     tgt::ivec2 significantRange_;
@@ -133,7 +145,7 @@ protected:
 
     float scaleFactor_;
 
-    // calculate the histogram
+    // calculate the histogram in a single parallel pass, two if scaled
     template<class U>
     void calcHG(const VolumeAtomic<U>* volumeGrad, const Volume* volumeIntensity, int bucketCounti, int bucketCountg, bool scale);
 };
@@ -0,0 +1,474 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+#ifndef VRN_MARCHINGCUBES_H
+#define VRN_MARCHINGCUBES_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/io/progressbar.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace voreen {
+
+/**
+ * Indexed triangle mesh of an isosurface, in voxel coordinates.
+ */
+struct IsosurfaceMesh {
+    std::vector<tgt::vec3> vertices;
+    /// Per vertex, pointing towards higher values like the counter-clockwise
+    /// winding of the triangles. Empty unless requested.
+    std::vector<tgt::vec3> normals;
+    /// Three vertex indices per triangle
+    std::vector<uint32_t> indices;
+
+    size_t getNumTriangles() const { return indices.size() / 3; }
+};
+
+/**
+ * Slab-parallel Marching Cubes producing an indexed mesh.
+ *
+ * Every surface vertex lies on a lattice edge whose endpoints are on
+ * different sides of the isovalue, and is owned by the edge's first voxel.
+ * Vertices are numbered in raster order of their voxels, so a cell finds the
+ * ids of its edges in caches of the two voxel slices it spans and vertices
+ * are shared between all cells around an edge.
+ *
+ * Extraction runs in two passes over slabs of 8 slices: a count pass, after
+ * which the vertex and triangle offsets of every slab are known, and a fill
+ * pass writing directly into the preallocated mesh. Bricks of 8^3 cells
+ * whose value range does not contain the isovalue are skipped by both
+ * passes.
+ *
+ * A corner is inside if its value is below the isovalue, as in the tables
+ * of Paul Bourke (http://paulbourke.net/geometry/polygonise/). Vertices of
+ * edges ending in a voxel equal to the isovalue lie on that voxel, and
+ * triangles with two such vertices on the same voxel are dropped.
+ */
+class MarchingCubes {
+public:
+    /**
+     * Extracts the isosurface of volume into mesh, replacing its contents.
+     *
+     * @param computeNormals interpolate normalized gradients to the vertices
+     */
+    template<class T>
+    static void extract(const VolumeAtomic<T>* volume, double isovalue, IsosurfaceMesh& mesh,
+                        bool computeNormals = false, ProgressBar* progress = 0);
+
+private:
+    enum {
+        BRICK_SIZE = 8,
+        NO_VERTEX = 0xffffffffu
+    };
+
+    /// Vertex ids of the x, y and z edges owned by the voxels of a slice
+    struct SliceCache {
+        std::vector<uint32_t> ids[3];
+
+        void resize(size_t n) {
+            for (int a = 0; a < 3; a++)
+                ids[a].resize(n);
+        }
+    };
+
+    /// Volume, isovalue and brick summary shared by the passes
+    template<class T>
+    struct Context {
+        const T* data;
+        tgt::ivec3 dims;
+        ptrdiff_t sliceSize;
+        double isovalue;
+        tgt::ivec3 numBricks;
+        std::vector<uint8_t> activeBricks;
+
+        bool below(ptrdiff_t i) const {
+            return static_cast<double>(data[i]) < isovalue;
+        }
+
+        /// Brick of the cells around voxel or cell coordinate c along one axis
+        int brick(int c, int axis) const {
+            return std::min(c, dims[axis] - 2) / BRICK_SIZE;
+        }
+
+        bool active(int bx, int by, int bz) const {
+            return activeBricks[(static_cast<size_t>(bz) * numBricks.y + by) * numBricks.x + bx] != 0;
+        }
+    };
+
+    template<class T>
+    static void summarizeBricks(Context<T>& context);
+
+    /**
+     * Numbers the vertices of the edges owned by slice z, starting at
+     * firstId. Ids are stored in cache and vertices written to mesh if they
+     * are not null.
+     *
+     * @return the number of vertices of the slice
+     */
+    template<class T>
+    static uint32_t numberSlice(const Context<T>& context, int z, uint32_t firstId,
+                                SliceCache* cache, IsosurfaceMesh* mesh, bool computeNormals);
+
+    /**
+     * Triangulates the cells between slices z and z+1, writing the indices
+     * to out if it is not null.
+     *
+     * @return the number of triangles
+     */
+    template<class T>
+    static size_t polygonizeSlice(const Context<T>& context, int z, const SliceCache* lower,
+                                  const SliceCache* upper, uint32_t* out);
+
+    template<class T>
+    static tgt::vec3 gradient(const Context<T>& context, const tgt::ivec3& p);
+
+    /// Case index of the cell at p, one bit per inside corner
+    template<class T>
+    static int cubeIndex(const Context<T>& context, ptrdiff_t cell);
+
+    /// Whether a corner of the cell equals the isovalue, so its triangles may be degenerate
+    template<class T>
+    static bool touchesIsovalue(const Context<T>& context, ptrdiff_t cell);
+
+    /// Voxel the vertex of a cube edge lies on, -1 if it is inside the edge
+    template<class T>
+    static ptrdiff_t snappedVoxel(const Context<T>& context, ptrdiff_t cell, int edge);
+
+    /// Whether two vertices of the triangle given by three cube edges coincide
+    template<class T>
+    static bool isDegenerate(const Context<T>& context, ptrdiff_t cell, const int* edges);
+
+public:
+    /// Intersected edges of each case
+    static const int edgeTable[256];
+    /// Triangles of each case as triples of edges, terminated by -1
+    static const int triTable[256][16];
+    /// Triangles of each case
+    static const int numTriangles[256];
+    /// First corner offset and axis of each cube edge
+    static const int edgeOrigins[12][4];
+};
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void MarchingCubes::summarizeBricks(Context<T>& context) {
+    const tgt::ivec3& dims = context.dims;
+    const tgt::ivec3& nb = context.numBricks;
+    context.activeBricks.assign(static_cast<size_t>(nb.x) * nb.y * nb.z, 0);
+
+    const int rows = nb.y * nb.z;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (int row = 0; row < rows; row++) {
+        const int by = row % nb.y;
+        const int bz = row / nb.y;
+        for (int bx = 0; bx < nb.x; bx++) {
+            // The voxels of a brick's cells, including the far faces
+            tgt::ivec3 llf(bx, by, bz);
+            llf *= static_cast<int>(BRICK_SIZE);
+            tgt::ivec3 urb = tgt::min(llf + tgt::ivec3(BRICK_SIZE), dims - 1);
+            bool anyBelow = false;
+            bool anyAbove = false;
+            for (int z = llf.z; z <= urb.z && !(anyBelow && anyAbove); z++) {
+                for (int y = llf.y; y <= urb.y; y++) {
+                    const ptrdiff_t rowStart = z * context.sliceSize + static_cast<ptrdiff_t>(y) * dims.x;
+                    for (int x = llf.x; x <= urb.x; x++) {
+                        if (context.below(rowStart + x))
+                            anyBelow = true;
+                        else
+                            anyAbove = true;
+                    }
+                }
+            }
+            context.activeBricks[(static_cast<size_t>(bz) * nb.y + by) * nb.x + bx] = (anyBelow && anyAbove);
+        }
+    }
+}
+
+template<class T>
+tgt::vec3 MarchingCubes::gradient(const Context<T>& context, const tgt::ivec3& p) {
+    const tgt::ivec3& dims = context.dims;
+    const ptrdiff_t i = p.z * context.sliceSize + static_cast<ptrdiff_t>(p.y) * dims.x + p.x;
+    const ptrdiff_t step[3] = { 1, dims.x, context.sliceSize };
+    tgt::vec3 g;
+    for (int a = 0; a < 3; a++) {
+        // Central differences, one-sided at the borders
+        const ptrdiff_t lower = (p[a] > 0) ? i - step[a] : i;
+        const ptrdiff_t upper = (p[a] < dims[a] - 1) ? i + step[a] : i;
+        const float h = static_cast<float>((upper - lower) / step[a]);
+        g[a] = (h > 0.f) ? static_cast<float>(static_cast<double>(context.data[upper]) -
+                                              static_cast<double>(context.data[lower])) / h : 0.f;
+    }
+    return g;
+}
+
+template<class T>
+int MarchingCubes::cubeIndex(const Context<T>& context, ptrdiff_t cell) {
+    const ptrdiff_t dx = context.dims.x;
+    const ptrdiff_t dz = context.sliceSize;
+    int index = 0;
+    if (context.below(cell))                  index |= 1;
+    if (context.below(cell + 1))              index |= 2;
+    if (context.below(cell + 1 + dz))         index |= 4;
+    if (context.below(cell + dz))             index |= 8;
+    if (context.below(cell + dx))             index |= 16;
+    if (context.below(cell + 1 + dx))         index |= 32;
+    if (context.below(cell + 1 + dx + dz))    index |= 64;
+    if (context.below(cell + dx + dz))        index |= 128;
+    return index;
+}
+
+template<class T>
+bool MarchingCubes::touchesIsovalue(const Context<T>& context, ptrdiff_t cell) {
+    for (int dz = 0; dz < 2; dz++) {
+        for (int dy = 0; dy < 2; dy++) {
+            const ptrdiff_t i = cell + dz * context.sliceSize + static_cast<ptrdiff_t>(dy) * context.dims.x;
+            if (static_cast<double>(context.data[i]) == context.isovalue ||
+                static_cast<double>(context.data[i + 1]) == context.isovalue)
+                return true;
+        }
+    }
+    return false;
+}
+
+template<class T>
+ptrdiff_t MarchingCubes::snappedVoxel(const Context<T>& context, ptrdiff_t cell, int edge) {
+    const int* e = edgeOrigins[edge];
+    const ptrdiff_t step[3] = { 1, context.dims.x, context.sliceSize };
+    const ptrdiff_t first = cell + e[0] + e[1] * step[1] + e[2] * step[2];
+    // the vertex is at t = 0 or 1 only if the outside end equals the isovalue
+    const ptrdiff_t outside = context.below(first) ? first + step[e[3]] : first;
+    return (static_cast<double>(context.data[outside]) == context.isovalue) ? outside : -1;
+}
+
+template<class T>
+bool MarchingCubes::isDegenerate(const Context<T>& context, ptrdiff_t cell, const int* edges) {
+    const ptrdiff_t a = snappedVoxel(context, cell, edges[0]);
+    const ptrdiff_t b = snappedVoxel(context, cell, edges[1]);
+    const ptrdiff_t c = snappedVoxel(context, cell, edges[2]);
+    return (a >= 0 && (a == b || a == c)) || (b >= 0 && b == c);
+}
+
+template<class T>
+uint32_t MarchingCubes::numberSlice(const Context<T>& context, int z, uint32_t firstId,
+                                    SliceCache* cache, IsosurfaceMesh* mesh, bool computeNormals)
+{
+    const tgt::ivec3& dims = context.dims;
+    const ptrdiff_t step[3] = { 1, dims.x, context.sliceSize };
+    const int bz = context.brick(z, 2);
+    uint32_t id = firstId;
+
+    if (cache) {
+        for (int a = 0; a < 3; a++)
+            std::fill(cache->ids[a].begin(), cache->ids[a].end(), static_cast<uint32_t>(NO_VERTEX));
+    }
+
+    for (int y = 0; y < dims.y; y++) {
+        const int by = context.brick(y, 1);
+        for (int bx = 0; bx < context.numBricks.x; bx++) {
+            if (!context.active(bx, by, bz))
+                continue;
+            const int xEnd = (bx + 1 == context.numBricks.x) ? dims.x : (bx + 1) * BRICK_SIZE;
+            for (int x = bx * BRICK_SIZE; x < xEnd; x++) {
+                const tgt::ivec3 p(x, y, z);
+                const ptrdiff_t i = z * context.sliceSize + static_cast<ptrdiff_t>(y) * dims.x + x;
+                const bool inside = context.below(i);
+                for (int a = 0; a < 3; a++) {
+                    if (p[a] + 1 >= dims[a] || context.below(i + step[a]) == inside)
+                        continue;
+                    if (cache)
+                        cache->ids[a][static_cast<size_t>(y) * dims.x + x] = id;
+                    if (mesh) {
+                        const double v0 = static_cast<double>(context.data[i]);
+                        const double v1 = static_cast<double>(context.data[i + step[a]]);
+                        const float t = static_cast<float>((context.isovalue - v0) / (v1 - v0));
+                        tgt::vec3 position(p);
+                        position[a] += t;
+                        mesh->vertices[id] = position;
+                        if (computeNormals) {
+                            tgt::ivec3 q = p;
+                            q[a]++;
+                            tgt::vec3 g = gradient(context, p) * (1.f - t) + gradient(context, q) * t;
+                            const float len = tgt::length(g);
+                            mesh->normals[id] = (len > 0.f) ? g / len : tgt::vec3(0.f);
+                        }
+                    }
+                    id++;
+                }
+            }
+        }
+    }
+    return id - firstId;
+}
+
+template<class T>
+size_t MarchingCubes::polygonizeSlice(const Context<T>& context, int z, const SliceCache* lower,
+                                      const SliceCache* upper, uint32_t* out)
+{
+    const tgt::ivec3& dims = context.dims;
+    const int bz = context.brick(z, 2);
+    size_t triangles = 0;
+
+    for (int y = 0; y < dims.y - 1; y++) {
+        const int by = context.brick(y, 1);
+        for (int bx = 0; bx < context.numBricks.x; bx++) {
+            if (!context.active(bx, by, bz))
+                continue;
+            const int xEnd = std::min((bx + 1) * static_cast<int>(BRICK_SIZE), dims.x - 1);
+            for (int x = bx * BRICK_SIZE; x < xEnd; x++) {
+                const ptrdiff_t cell = z * context.sliceSize + static_cast<ptrdiff_t>(y) * dims.x + x;
+                const int index = cubeIndex(context, cell);
+                if (!numTriangles[index])
+                    continue;
+                const bool exact = touchesIsovalue(context, cell);
+                if (!out && !exact) {
+                    triangles += numTriangles[index];
+                    continue;
+                }
+                for (int t = 0; triTable[index][t] != -1; t += 3) {
+                    if (exact && isDegenerate(context, cell, &triTable[index][t]))
+                        continue;
+                    triangles++;
+                    if (!out)
+                        continue;
+                    for (int v = 0; v < 3; v++) {
+                        const int* e = edgeOrigins[triTable[index][t + v]];
+                        const SliceCache* cache = e[2] ? upper : lower;
+                        *out++ = cache->ids[e[3]][static_cast<size_t>(y + e[1]) * dims.x + x + e[0]];
+                    }
+                }
+            }
+        }
+    }
+    return triangles;
+}
+
+template<class T>
+void MarchingCubes::extract(const VolumeAtomic<T>* volume, double isovalue, IsosurfaceMesh& mesh,
+                            bool computeNormals, ProgressBar* progress)
+{
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.indices.clear();
+
+    Context<T> context;
+    context.data = volume->voxel();
+    context.dims = volume->getDimensions();
+    context.sliceSize = static_cast<ptrdiff_t>(context.dims.x) * context.dims.y;
+    context.isovalue = isovalue;
+    if (tgt::min(context.dims) < 2)
+        return;
+    context.numBricks = (context.dims - 2) / static_cast<int>(BRICK_SIZE) + 1;
+    summarizeBricks(context);
+
+    const tgt::ivec3& dims = context.dims;
+    const int numSlabs = context.numBricks.z;
+    const size_t sliceSize = static_cast<size_t>(context.sliceSize);
+    std::vector<uint32_t> slabVertices(numSlabs + 1, 0);
+    std::vector<size_t> slabTriangles(numSlabs + 1, 0);
+
+    // Count pass
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (int s = 0; s < numSlabs; s++) {
+        const int z0 = s * BRICK_SIZE;
+        const int z1 = (s + 1 == numSlabs) ? dims.z : z0 + BRICK_SIZE;
+        uint32_t vertices = 0;
+        size_t triangles = 0;
+        for (int z = z0; z < z1; z++) {
+            vertices += numberSlice(context, z, 0, static_cast<SliceCache*>(0),
+                                    static_cast<IsosurfaceMesh*>(0), false);
+            if (z + 1 < dims.z)
+                triangles += polygonizeSlice(context, z, 0, 0, static_cast<uint32_t*>(0));
+        }
+        slabVertices[s + 1] = vertices;
+        slabTriangles[s + 1] = triangles;
+    }
+    for (int s = 0; s < numSlabs; s++) {
+        slabVertices[s + 1] += slabVertices[s];
+        slabTriangles[s + 1] += slabTriangles[s];
+    }
+    if (progress)
+        progress->setProgress(0.3f);
+
+    mesh.vertices.resize(slabVertices[numSlabs]);
+    if (computeNormals)
+        mesh.normals.resize(slabVertices[numSlabs]);
+    mesh.indices.resize(3 * slabTriangles[numSlabs]);
+    if (mesh.indices.empty()) {
+        if (progress)
+            progress->setProgress(1.f);
+        return;
+    }
+
+    // Fill pass. The vertices of the slice above a slab are numbered like
+    // the next slab does, without emitting them.
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        SliceCache caches[2];
+        caches[0].resize(sliceSize);
+        caches[1].resize(sliceSize);
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+        #endif
+        for (int s = 0; s < numSlabs; s++) {
+            const int z0 = s * BRICK_SIZE;
+            const int z1 = (s + 1 == numSlabs) ? dims.z : z0 + BRICK_SIZE;
+            SliceCache* lower = &caches[0];
+            SliceCache* upper = &caches[1];
+            uint32_t id = slabVertices[s];
+            uint32_t* out = &mesh.indices[3 * slabTriangles[s]];
+
+            id += numberSlice(context, z0, id, lower, &mesh, computeNormals);
+            for (int z = z0; z < z1 && z + 1 < dims.z; z++) {
+                if (z + 1 < z1)
+                    id += numberSlice(context, z + 1, id, upper, &mesh, computeNormals);
+                else
+                    numberSlice(context, z + 1, slabVertices[s + 1], upper, static_cast<IsosurfaceMesh*>(0), false);
+                out += 3 * polygonizeSlice(context, z, lower, upper, out);
+                std::swap(lower, upper);
+            }
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f);
+}
+
+} // namespace voreen
+
+#endif // VRN_MARCHINGCUBES_H
@@ -0,0 +1,178 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#ifndef VRN_SOFTWARERAYCASTER_H
+#define VRN_SOFTWARERAYCASTER_H
+
+#include "voreen/core/datastructures/volume/volume.h"
+
+#include <string>
+#include <vector>
+
+namespace tgt {
+    class Camera;
+}
+
+namespace voreen {
+
+class TransFuncIntensity;
+
+/**
+ * Direct volume rendering on the CPU, without an OpenGL context.
+ *
+ * Rays are traced in packets of 2x2 pixels that are distributed over the
+ * threads. The four rays of a packet advance in lockstep, so their
+ * trilinear interpolation runs in one SSE register. A ray terminates once
+ * its opacity reaches the termination threshold.
+ *
+ * For empty space skipping the volume is divided into macro cells of
+ * getMacroCellSize()^3 voxels whose minimum and maximum intensities are
+ * computed by setVolume(). A cell is transparent if the transfer function
+ * maps its whole intensity range to zero opacity; a packet whose rays are
+ * all inside transparent cells jumps to the first sample behind them.
+ *
+ * Intensities are normalized to [0, 1] by the element range of the volume.
+ * Images are RGBA float with premultiplied colors and the first row at the
+ * bottom, as read back from OpenGL.
+ */
+class SoftwareRaycaster {
+public:
+    SoftwareRaycaster();
+
+    /**
+     * Sets the volume to render and rebuilds the macro cells. Supported are
+     * VolumeUInt8, VolumeUInt16 and VolumeFloat; the volume must live at
+     * least as long as it is set.
+     *
+     * @return false if the format is not supported, then nothing is rendered
+     */
+    bool setVolume(const Volume* volume);
+    const Volume* getVolume() const { return volume_; }
+
+    /**
+     * Sets the transfer function as a table of colors for equidistant
+     * intensities in [0, 1]. The alpha values are the opacities of a ray
+     * segment of one voxel length.
+     */
+    void setTransferFunction(const std::vector<tgt::vec4>& table);
+
+    /**
+     * Samples an intensity transfer function into a table of tableSize entries,
+     * on the CPU.
+     */
+    void setTransferFunction(const TransFuncIntensity* transferFunction, int tableSize = 256);
+
+    /// Samples per voxel length along a ray, 2 by default.
+    void setSamplingRate(float samplingRate);
+    float getSamplingRate() const { return samplingRate_; }
+
+    /// Opacity at which a ray is terminated, 0.99 by default. 1 disables early ray termination.
+    void setTerminationThreshold(float threshold) { terminationThreshold_ = threshold; }
+    float getTerminationThreshold() const { return terminationThreshold_; }
+
+    /// Edge length of the macro cells in voxels, 8 by default. 0 disables empty space skipping.
+    void setMacroCellSize(int size);
+    int getMacroCellSize() const { return macroCellSize_; }
+
+    /**
+     * Renders a volume from entry and exit point images: RGBA float per pixel
+     * holding the texture coordinates of the ray's entry and exit in the xyz
+     * components. Pixels whose entry and exit points are both zero are left
+     * transparent.
+     *
+     * @param output size.x * size.y * 4 floats
+     */
+    void render(const float* entryPoints, const float* exitPoints, const tgt::ivec2& size,
+                float* output);
+
+    /**
+     * Renders the volume as seen by the camera, taking the physical size and
+     * the transformation of the volume into account.
+     */
+    void render(const tgt::Camera& camera, const tgt::ivec2& size, float* output);
+
+    /// Number of samples taken by the last render call.
+    size_t getNumSamples() const { return numSamples_; }
+
+    /// Number of samples skipped by empty space skipping in the last render call.
+    size_t getNumSkippedSamples() const { return numSkippedSamples_; }
+
+    /**
+     * Writes an image in the layout of render() as 8 bit binary PAM with
+     * alpha (.pam), or PPM composited onto black for any other extension.
+     *
+     * @return false if the file could not be written
+     */
+    static bool writeImage(const std::string& fileName, const float* image, const tgt::ivec2& size);
+
+private:
+    /// The rays of one 2x2 pixel packet, in voxel coordinates.
+    struct RayPacket;
+
+    template<class T>
+    void buildMacroCells(const T* data);
+
+    void classifyMacroCells();
+
+    template<class T>
+    void renderPackets(const T* data, const float* entryPoints, const float* exitPoints,
+                       const tgt::ivec2& size, float* output);
+
+    template<class T>
+    void tracePacket(const T* data, RayPacket& packet, size_t& numSamples,
+                     size_t& numSkipped) const;
+
+    /// Number of steps until the ray leaves its current macro cell, at least 1.
+    int stepsToCellExit(const tgt::vec3& position, const tgt::vec3& step) const;
+
+    size_t cellIndex(const tgt::vec3& position) const;
+
+    const Volume* volume_;
+    tgt::ivec3 dims_;
+    float intensityScale_;          ///< maps voxel values to [0, 1]
+    float intensityOffset_;
+
+    std::vector<tgt::vec4> transferFunction_;   ///< alpha for one voxel length
+    std::vector<tgt::vec4> correctedTable_;     ///< alpha corrected for the sampling rate
+
+    float samplingRate_;
+    float terminationThreshold_;
+
+    int macroCellSize_;
+    tgt::ivec3 cellDims_;
+    std::vector<tgt::vec2> cellRanges_;         ///< normalized min/max per macro cell
+    std::vector<char> transparentCells_;
+    bool cellsInvalid_;                         ///< transparentCells_ needs to be reclassified
+
+    size_t numSamples_;
+    size_t numSkippedSamples_;
+};
+
+} // namespace voreen
+
+#endif // VRN_SOFTWARERAYCASTER_H
@@ -53,6 +53,43 @@ public:
         LINEAR
     };
 
+    /**
+     * Voxel format of a VolumeAtomic, set by its constructors. Volume operators
+     * dispatch on it instead of probing the type with dynamic_casts.
+     *
+     * @see VolumeFormatId, getFormatId
+     */
+    enum FormatId {
+        FORMAT_UNKNOWN = 0,
+        FORMAT_UINT8,
+        FORMAT_UINT16,
+        FORMAT_UINT32,
+        FORMAT_INT8,
+        FORMAT_INT16,
+        FORMAT_INT32,
+        FORMAT_FLOAT,
+        FORMAT_DOUBLE,
+        FORMAT_2xUINT8,
+        FORMAT_2xINT8,
+        FORMAT_2xUINT16,
+        FORMAT_2xINT16,
+        FORMAT_2xFLOAT,
+        FORMAT_2xDOUBLE,
+        FORMAT_3xUINT8,
+        FORMAT_3xINT8,
+        FORMAT_3xUINT16,
+        FORMAT_3xINT16,
+        FORMAT_3xFLOAT,
+        FORMAT_3xDOUBLE,
+        FORMAT_4xUINT8,
+        FORMAT_4xINT8,
+        FORMAT_4xUINT16,
+        FORMAT_4xINT16,
+        FORMAT_4xFLOAT,
+        FORMAT_4xDOUBLE,
+        NUM_FORMATS
+    };
+
     /**
      * Constructor.
      *
@@ -120,6 +157,12 @@ public:
     /// Returns the number of bytes that are allocated for each voxel.
     virtual int getBytesPerVoxel() const = 0;
 
+    /// Returns the voxel format, FORMAT_UNKNOWN for volumes that are no VolumeAtomic.
+    /// Not virtual, so it is cheap enough to be queried for every operator call.
+    FormatId getFormatId() const {
+        return formatId_;
+    }
+
     /**
      * Assigns a transformation matrix to the volume.
      *
@@ -286,6 +329,49 @@ public:
      */
     virtual float getVoxelFloatLinear(const tgt::vec3& pos, size_t channel = 0) const;
 
+    /**
+     * Converts count consecutive voxels of a channel to floats like getVoxelFloat().
+     * Use this instead of per-voxel calls in loops: VolumeAtomic converts the
+     * whole batch within one virtual call.
+     *
+     * @param index the index of the first voxel, a scanline (y, z) starts at
+     *      dims.x * (y + dims.y * z)
+     * @param count the number of voxels, index + count must not exceed getNumVoxels()
+     * @param values receives count floats
+     * @param channel the channel of the voxels
+     */
+    virtual void getVoxelsFloat(size_t index, size_t count, float* values, size_t channel = 0) const;
+
+    /**
+     * Sets count consecutive voxels of a channel from floats like setVoxelFloat().
+     *
+     * @see getVoxelsFloat
+     */
+    virtual void setVoxelsFloat(const float* values, size_t index, size_t count, size_t channel = 0);
+
+    /**
+     * Returns the values of the voxels nearest to count positions given in voxel
+     * coordinates, converted to floats. Positions outside the volume are clamped.
+     */
+    virtual void getVoxelsFloatNearest(const tgt::vec3* positions, size_t count, float* values,
+                                       size_t channel = 0) const;
+
+    /**
+     * Returns the trilinearly interpolated values at count positions given in
+     * voxel coordinates, like getVoxelFloatLinear().
+     */
+    virtual void getVoxelsFloatLinear(const tgt::vec3* positions, size_t count, float* values,
+                                      size_t channel = 0) const;
+
+    /**
+     * Returns the trilinearly interpolated values at the count positions
+     * start + i * step in voxel coordinates, like getVoxelFloatLinear().
+     * Rows along the x axis (step.y = step.z = 0) are cheaper than arbitrary
+     * positions, since their y and z corners are the same for all samples.
+     */
+    virtual void getVoxelsFloatLinear(const tgt::vec3& start, const tgt::vec3& step, size_t count,
+                                      float* values, size_t channel = 0) const;
+
     /// Set all volume data to zero
     virtual void clear() = 0;
 
@@ -300,7 +386,7 @@ public:
 
 protected:
     // protected default constructor
-    Volume() {}
+    Volume() : formatId_(FORMAT_UNKNOWN) {}
     void calculateProperties();
 
     tgt::ivec3  dimensions_;
@@ -314,6 +400,8 @@ protected:
 
     tgt::mat4 transformationMatrix_;
 
+    FormatId formatId_;
+
     VolumeMetaData meta_;
 
     static const std::string loggerCat_;
@@ -29,8 +29,10 @@
 #define VRN_VOLUMEATOMIC_H
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <fstream>
+#include <vector>
 
 #include "tgt/assert.h"
 #include "tgt/logmanager.h"
@@ -42,6 +44,15 @@
 
 namespace voreen {
 
+/**
+ * Maps a voxel type to its Volume::FormatId. Types without a specialization
+ * are FORMAT_UNKNOWN.
+ */
+template<class T>
+struct VolumeFormatId {
+    enum { value = Volume::FORMAT_UNKNOWN };
+};
+
 template<class T>
 class VolumeAtomic : public Volume {
 
@@ -181,6 +192,18 @@ public:
     virtual void setVoxelFloat(float value, size_t x, size_t y, size_t z, size_t channel = 0);
     virtual void setVoxelFloat(float value, size_t index, size_t channel = 0);
 
+    /*
+     * Batch access, converting directly from and to the typed voxels
+     */
+    virtual void getVoxelsFloat(size_t index, size_t count, float* values, size_t channel = 0) const;
+    virtual void setVoxelsFloat(const float* values, size_t index, size_t count, size_t channel = 0);
+    virtual void getVoxelsFloatNearest(const tgt::vec3* positions, size_t count, float* values,
+                                       size_t channel = 0) const;
+    virtual void getVoxelsFloatLinear(const tgt::vec3* positions, size_t count, float* values,
+                                      size_t channel = 0) const;
+    virtual void getVoxelsFloatLinear(const tgt::vec3& start, const tgt::vec3& step, size_t count,
+                                      float* values, size_t channel = 0) const;
+
     virtual void clear();
     virtual void* getData();
 
@@ -192,7 +215,12 @@ public:
     //-------------------------------------------------------------------
 protected:
     // protected default constructor
-    VolumeAtomic() {}
+    VolumeAtomic() {
+        formatId_ = static_cast<FormatId>(VolumeFormatId<T>::value);
+    }
+
+    /// Weighs the normalized corner values v like Volume::getVoxelFloatLinear(), p being the fractional position.
+    inline static float interpolateLinear(const float* v, const tgt::vec3& p);
 
     T* data_;
 
@@ -239,6 +267,38 @@ typedef VolumeAtomic<tgt::dvec3> Volume3xDouble;
 typedef VolumeAtomic<tgt::vec4>  Volume4xFloat;
 typedef VolumeAtomic<tgt::dvec4> Volume4xDouble;
 
+#define VRN_VOLUME_FORMAT_ID(TYPE, ID) \
+    template<> struct VolumeFormatId<TYPE > { enum { value = Volume::ID }; };
+
+VRN_VOLUME_FORMAT_ID(uint8_t,                   FORMAT_UINT8)
+VRN_VOLUME_FORMAT_ID(uint16_t,                  FORMAT_UINT16)
+VRN_VOLUME_FORMAT_ID(uint32_t,                  FORMAT_UINT32)
+VRN_VOLUME_FORMAT_ID(int8_t,                    FORMAT_INT8)
+VRN_VOLUME_FORMAT_ID(int16_t,                   FORMAT_INT16)
+VRN_VOLUME_FORMAT_ID(int32_t,                   FORMAT_INT32)
+VRN_VOLUME_FORMAT_ID(float,                     FORMAT_FLOAT)
+VRN_VOLUME_FORMAT_ID(double,                    FORMAT_DOUBLE)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<uint8_t>,     FORMAT_2xUINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<int8_t>,      FORMAT_2xINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<uint16_t>,    FORMAT_2xUINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<int16_t>,     FORMAT_2xINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<float>,       FORMAT_2xFLOAT)
+VRN_VOLUME_FORMAT_ID(tgt::Vector2<double>,      FORMAT_2xDOUBLE)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<uint8_t>,     FORMAT_3xUINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<int8_t>,      FORMAT_3xINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<uint16_t>,    FORMAT_3xUINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<int16_t>,     FORMAT_3xINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<float>,       FORMAT_3xFLOAT)
+VRN_VOLUME_FORMAT_ID(tgt::Vector3<double>,      FORMAT_3xDOUBLE)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<uint8_t>,     FORMAT_4xUINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<int8_t>,      FORMAT_4xINT8)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<uint16_t>,    FORMAT_4xUINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<int16_t>,     FORMAT_4xINT16)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<float>,       FORMAT_4xFLOAT)
+VRN_VOLUME_FORMAT_ID(tgt::Vector4<double>,      FORMAT_4xDOUBLE)
+
+#undef VRN_VOLUME_FORMAT_ID
+
 //------------------------------------------------------------------------------
 //  implementation
 //------------------------------------------------------------------------------
@@ -258,6 +318,7 @@ VolumeAtomic<T>::VolumeAtomic(const tgt::ivec3& dimensions, const tgt::vec3& spa
         static_cast<float>(VolumeElement<T>::rangeMaxElement()))
     , minMaxValid_(false)
 {
+    formatId_ = static_cast<FormatId>(VolumeFormatId<T>::value);
 
     // special treatment for 12 bit volumes stored in 16 bit
     if (typeid(T) == typeid(uint16_t) && bitsStored == 12)
@@ -286,6 +347,8 @@ VolumeAtomic<T>::VolumeAtomic(T* data,
          static_cast<float>(VolumeElement<T>::rangeMaxElement()))
     , minMaxValid_(false)
 {
+    formatId_ = static_cast<FormatId>(VolumeFormatId<T>::value);
+
     // special treatment for 12 bit volumes stored in 16 bit
     if (typeid(T) == typeid(uint16_t) && bitsStored == 12)
         elementRange_.y = static_cast<float>((1 << 12) - 1);
@@ -408,6 +471,131 @@ void voreen::VolumeAtomic<T>::setVoxelFloat(float value, size_t index, size_t ch
         voxel(index), channel);
 }
 
+template<class T>
+void VolumeAtomic<T>::getVoxelsFloat(size_t index, size_t count, float* values, size_t channel) const {
+    tgtAssert(index + count <= numVoxels_, "Voxels out of range");
+
+    const tgt::vec2 elemRange = elementRange();
+    const float range = elemRange.y - elemRange.x;
+    const T* v = data_ + index;
+    for (size_t i = 0; i < count; ++i)
+        values[i] = (static_cast<float>(VolumeElement<T>::getChannel(v[i], channel)) - elemRange.x) / range;
+}
+
+template<class T>
+void VolumeAtomic<T>::setVoxelsFloat(const float* values, size_t index, size_t count, size_t channel) {
+    tgtAssert(index + count <= numVoxels_, "Voxels out of range");
+
+    typedef typename VolumeElement<T>::BaseType Base;
+    const tgt::vec2 elemRange = elementRange();
+    const float range = elemRange.y - elemRange.x;
+    T* v = data_ + index;
+    for (size_t i = 0; i < count; ++i)
+        VolumeElement<T>::setChannel(static_cast<Base>(elemRange.x + values[i] * range), v[i], channel);
+}
+
+template<class T>
+void VolumeAtomic<T>::getVoxelsFloatNearest(const tgt::vec3* positions, size_t count, float* values,
+                                            size_t channel) const
+{
+    const tgt::vec2 elemRange = elementRange();
+    const float range = elemRange.y - elemRange.x;
+    const tgt::ivec3 maxPos = dimensions_ - 1;
+    for (size_t i = 0; i < count; ++i) {
+        tgt::ivec3 pos = tgt::clamp(tgt::ivec3(tgt::floor(positions[i] + tgt::vec3(0.5f))), tgt::ivec3(0), maxPos);
+        values[i] = (static_cast<float>(VolumeElement<T>::getChannel(voxel(pos), channel)) - elemRange.x) / range;
+    }
+}
+
+template<class T>
+inline float VolumeAtomic<T>::interpolateLinear(const float* v, const tgt::vec3& p) {
+    return v[0] * (1.f-p.x)*(1.f-p.y)*(1.f-p.z)
+         + v[1] * (    p.x)*(1.f-p.y)*(1.f-p.z)
+         + v[2] * (    p.x)*(    p.y)*(1.f-p.z)
+         + v[3] * (1.f-p.x)*(    p.y)*(1.f-p.z)
+         + v[4] * (1.f-p.x)*(1.f-p.y)*(    p.z)
+         + v[5] * (    p.x)*(1.f-p.y)*(    p.z)
+         + v[6] * (    p.x)*(    p.y)*(    p.z)
+         + v[7] * (1.f-p.x)*(    p.y)*(    p.z);
+}
+
+template<class T>
+void VolumeAtomic<T>::getVoxelsFloatLinear(const tgt::vec3* positions, size_t count, float* values,
+                                           size_t channel) const
+{
+    const tgt::vec2 elemRange = elementRange();
+    const float range = elemRange.y - elemRange.x;
+    const tgt::ivec3 maxPos = dimensions_ - 1;
+    const size_t sliceSize = static_cast<size_t>(dimensions_.x) * dimensions_.y;
+    for (size_t i = 0; i < count; ++i) {
+        // same corners as Volume::getVoxelFloatLinear()
+        const tgt::vec3& pos = positions[i];
+        tgt::ivec3 llb = tgt::clamp(tgt::ivec3(pos), tgt::ivec3(0), maxPos);
+        tgt::ivec3 urf = tgt::clamp(tgt::ivec3(tgt::ceil(pos)), tgt::ivec3(0), maxPos);
+
+        const size_t yl = llb.y * dimensions_.x, yu = urf.y * dimensions_.x;
+        const size_t zl = llb.z * sliceSize, zu = urf.z * sliceSize;
+        float v[8];
+        v[0] = static_cast<float>(VolumeElement<T>::getChannel(data_[llb.x + yl + zl], channel));
+        v[1] = static_cast<float>(VolumeElement<T>::getChannel(data_[urf.x + yl + zl], channel));
+        v[2] = static_cast<float>(VolumeElement<T>::getChannel(data_[urf.x + yu + zl], channel));
+        v[3] = static_cast<float>(VolumeElement<T>::getChannel(data_[llb.x + yu + zl], channel));
+        v[4] = static_cast<float>(VolumeElement<T>::getChannel(data_[llb.x + yl + zu], channel));
+        v[5] = static_cast<float>(VolumeElement<T>::getChannel(data_[urf.x + yl + zu], channel));
+        v[6] = static_cast<float>(VolumeElement<T>::getChannel(data_[urf.x + yu + zu], channel));
+        v[7] = static_cast<float>(VolumeElement<T>::getChannel(data_[llb.x + yu + zu], channel));
+        for (int c = 0; c < 8; ++c)
+            v[c] = (v[c] - elemRange.x) / range;
+
+        values[i] = interpolateLinear(v, pos - tgt::floor(pos));
+    }
+}
+
+template<class T>
+void VolumeAtomic<T>::getVoxelsFloatLinear(const tgt::vec3& start, const tgt::vec3& step, size_t count,
+                                           float* values, size_t channel) const
+{
+    if (step.y != 0.f || step.z != 0.f) {
+        std::vector<tgt::vec3> positions(count);
+        for (size_t i = 0; i < count; ++i)
+            positions[i] = start + static_cast<float>(i) * step;
+        getVoxelsFloatLinear(count ? &positions[0] : 0, count, values, channel);
+        return;
+    }
+
+    // row along the x axis: the four rows holding the corners are fixed
+    const tgt::vec2 elemRange = elementRange();
+    const float range = elemRange.y - elemRange.x;
+    const tgt::ivec3 maxPos = dimensions_ - 1;
+    const size_t sliceSize = static_cast<size_t>(dimensions_.x) * dimensions_.y;
+    tgt::ivec3 llb = tgt::clamp(tgt::ivec3(start), tgt::ivec3(0), maxPos);
+    tgt::ivec3 urf = tgt::clamp(tgt::ivec3(tgt::ceil(start)), tgt::ivec3(0), maxPos);
+    const T* rowLL = data_ + llb.y * dimensions_.x + llb.z * sliceSize;
+    const T* rowUL = data_ + urf.y * dimensions_.x + llb.z * sliceSize;
+    const T* rowLU = data_ + llb.y * dimensions_.x + urf.z * sliceSize;
+    const T* rowUU = data_ + urf.y * dimensions_.x + urf.z * sliceSize;
+    tgt::vec3 p = start - tgt::floor(start);
+
+    for (size_t i = 0; i < count; ++i) {
+        float x = start.x + static_cast<float>(i) * step.x;
+        int lx = std::min(std::max(static_cast<int>(x), 0), maxPos.x);
+        int ux = std::min(std::max(static_cast<int>(std::ceil(x)), 0), maxPos.x);
+        float v[8];
+        v[0] = static_cast<float>(VolumeElement<T>::getChannel(rowLL[lx], channel));
+        v[1] = static_cast<float>(VolumeElement<T>::getChannel(rowLL[ux], channel));
+        v[2] = static_cast<float>(VolumeElement<T>::getChannel(rowUL[ux], channel));
+        v[3] = static_cast<float>(VolumeElement<T>::getChannel(rowUL[lx], channel));
+        v[4] = static_cast<float>(VolumeElement<T>::getChannel(rowLU[lx], channel));
+        v[5] = static_cast<float>(VolumeElement<T>::getChannel(rowLU[ux], channel));
+        v[6] = static_cast<float>(VolumeElement<T>::getChannel(rowUU[ux], channel));
+        v[7] = static_cast<float>(VolumeElement<T>::getChannel(rowUU[lx], channel));
+        for (int c = 0; c < 8; ++c)
+            v[c] = (v[c] - elemRange.x) / range;
+
+        p.x = x - std::floor(x);
+        values[i] = interpolateLinear(v, p);
+    }
+}
 
 /*
  * getters and setters
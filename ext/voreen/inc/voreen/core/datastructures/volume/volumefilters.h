@@ -0,0 +1,750 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+#ifndef VRN_VOLUMEFILTERS_H
+#define VRN_VOLUMEFILTERS_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/datastructures/volume/volumeresampling.h"
+#include "voreen/core/io/progressbar.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace voreen {
+
+/**
+ * Minimum of two voxel values and its identity element, used for erosion.
+ */
+template<class T>
+struct MorphologyMin {
+    static T identity() { return std::numeric_limits<T>::max(); }
+    static T apply(T a, T b) { return b < a ? b : a; }
+};
+
+/**
+ * Maximum of two voxel values and its identity element, used for dilation.
+ */
+template<class T>
+struct MorphologyMax {
+    static T identity() {
+        return std::numeric_limits<T>::is_integer ? std::numeric_limits<T>::min()
+                                                  : -std::numeric_limits<T>::max();
+    }
+    static T apply(T a, T b) { return a < b ? b : a; }
+};
+
+/**
+ * Running minimum or maximum over a window of 2*radius+1 samples with the
+ * algorithm of van Herk and Gil-Werman: three comparisons per sample,
+ * independent of the window size.
+ *
+ * Each call filters a batch of adjacent lines ("lanes") at once, so that
+ * the y and z passes read whole cache lines of the volume. A batch is
+ * copied into the filter's buffers before it is written back, hence the
+ * lines are filtered in place. Windows are clipped at the borders.
+ */
+template<class T, class Op>
+class VanHerkFilter {
+public:
+    VanHerkFilter(int radius, int maxLength, int maxLanes)
+        : radius_(radius)
+        , window_(2 * radius + 1)
+    {
+        size_t samples = static_cast<size_t>(maxLength + 2 * radius + window_) * maxLanes;
+        f_.resize(samples);
+        g_.resize(samples);
+        r_.resize(samples);
+    }
+
+    /**
+     * Filters the lanes lines of length samples starting at first. Samples
+     * of a line are step elements apart, the lines themselves are adjacent.
+     */
+    void filter(T* first, int length, ptrdiff_t step, int lanes) {
+        const int w = window_;
+        // Padded with the identity, rounded up to whole blocks
+        const int padded = ((length + 2 * radius_ + w - 1) / w) * w;
+        const T identity = Op::identity();
+        T* f = &f_[0];
+        T* g = &g_[0];
+        T* r = &r_[0];
+
+        for (int i = 0; i < padded; i++) {
+            T* fi = f + i * lanes;
+            int t = i - radius_;
+            if (t < 0 || t >= length) {
+                for (int l = 0; l < lanes; l++)
+                    fi[l] = identity;
+            }
+            else {
+                const T* src = first + t * step;
+                for (int l = 0; l < lanes; l++)
+                    fi[l] = src[l];
+            }
+        }
+
+        // Prefix and suffix extrema within each block of w samples
+        for (int i = 0; i < padded; i++) {
+            const T* fi = f + i * lanes;
+            T* gi = g + i * lanes;
+            if (i % w == 0) {
+                for (int l = 0; l < lanes; l++)
+                    gi[l] = fi[l];
+            }
+            else {
+                const T* gp = gi - lanes;
+                for (int l = 0; l < lanes; l++)
+                    gi[l] = Op::apply(gp[l], fi[l]);
+            }
+        }
+        for (int i = padded - 1; i >= 0; i--) {
+            const T* fi = f + i * lanes;
+            T* ri = r + i * lanes;
+            if ((i + 1) % w == 0) {
+                for (int l = 0; l < lanes; l++)
+                    ri[l] = fi[l];
+            }
+            else {
+                const T* rn = ri + lanes;
+                for (int l = 0; l < lanes; l++)
+                    ri[l] = Op::apply(rn[l], fi[l]);
+            }
+        }
+
+        // The window [t, t+w-1] of the padded line spans at most two blocks
+        for (int t = 0; t < length; t++) {
+            T* dst = first + t * step;
+            const T* rt = r + t * lanes;
+            const T* gt = g + (t + w - 1) * lanes;
+            for (int l = 0; l < lanes; l++)
+                dst[l] = Op::apply(rt[l], gt[l]);
+        }
+    }
+
+private:
+    int radius_;
+    int window_;
+    std::vector<T> f_;
+    std::vector<T> g_;
+    std::vector<T> r_;
+};
+
+/**
+ * Separable morphology with a box of (2*radius+1)^3 voxels, clipped at the
+ * borders. Runs one in-place pass per axis, each parallelized with OpenMP.
+ *
+ * @tparam Op MorphologyMin for erosion, MorphologyMax for dilation
+ */
+template<class T, class Op>
+void morphologyFilter(VolumeAtomic<T>* volume, int radius, ProgressBar* progress = 0) {
+    if (radius <= 0) {
+        if (progress)
+            progress->setProgress(1.f);
+        return;
+    }
+
+    const tgt::ivec3 dims = volume->getDimensions();
+    const ptrdiff_t sliceSize = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    T* data = volume->voxel();
+    // Columns filtered together in the y and z passes: one batch of 64 uint8
+    // or 16 floats already fills a cache line
+    const int lanes = 64;
+
+    // x: rows one by one
+    const int rows = dims.y * dims.z;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        VanHerkFilter<T, Op> filter(radius, dims.x, 1);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int row = 0; row < rows; row++)
+            filter.filter(data + static_cast<ptrdiff_t>(row) * dims.x, dims.x, 1, 1);
+    }
+    if (progress)
+        progress->setProgress(1.f / 3.f);
+
+    // y: batches of adjacent columns within a slice
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        VanHerkFilter<T, Op> filter(radius, dims.y, lanes);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int z = 0; z < dims.z; z++) {
+            for (int x = 0; x < dims.x; x += lanes)
+                filter.filter(data + z * sliceSize + x, dims.y, dims.x, std::min(lanes, dims.x - x));
+        }
+    }
+    if (progress)
+        progress->setProgress(2.f / 3.f);
+
+    // z: batches of adjacent columns within a row
+    const int batches = (dims.x + lanes - 1) / lanes;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        VanHerkFilter<T, Op> filter(radius, dims.z, lanes);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int b = 0; b < dims.y * batches; b++) {
+            int y = b / batches;
+            int x = (b % batches) * lanes;
+            filter.filter(data + static_cast<ptrdiff_t>(y) * dims.x + x, dims.z, sliceSize,
+                          std::min(lanes, dims.x - x));
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f);
+}
+
+/**
+ * Sliding histogram median over (2*radius+1)^3 windows, clipped at the
+ * borders, of a volume of ranks below Bins. This is the constant time
+ * median of Perreault and Hebert extended to 3D:
+ *
+ * - every x position keeps the histogram of its y-z column of the window,
+ *   which is updated with one row of k voxels per slice when the window
+ *   moves along y,
+ * - the window histogram is the sum of k column histograms and moves along
+ *   x by adding one column and removing another,
+ * - histograms are split into coarse bins of 16 fine bins. Only the coarse
+ *   histogram is maintained eagerly, the fine bins of a coarse bin are
+ *   brought up to date when the median falls into it.
+ *
+ * The median is the element at index count/2 of the sorted window, as for
+ * the nth_element based filter.
+ */
+template<int Bins>
+class SlidingMedian {
+    enum { FINE = 16, COARSE = Bins / FINE };
+
+public:
+    SlidingMedian(const uint16_t* ranks, const tgt::ivec3& dims, int radius)
+        : ranks_(ranks)
+        , dims_(dims)
+        , radius_(radius)
+        , columnFine_(static_cast<size_t>(dims.x) * Bins)
+        , columnCoarse_(static_cast<size_t>(dims.x) * COARSE)
+    {}
+
+    /// Computes the median ranks of slice z, out holds dims.x * dims.y entries.
+    void slice(int z, uint16_t* out) {
+        const int h = radius_;
+        const int z0 = std::max(z - h, 0);
+        const int z1 = std::min(z + h, dims_.z - 1);
+
+        std::fill(columnFine_.begin(), columnFine_.end(), 0);
+        std::fill(columnCoarse_.begin(), columnCoarse_.end(), 0);
+        for (int y = 0; y <= std::min(h, dims_.y - 1); y++)
+            addRow(y, z0, z1);
+
+        for (int y = 0; y < dims_.y; y++) {
+            if (y > 0) {
+                if (y - h - 1 >= 0)
+                    removeRow(y - h - 1, z0, z1);
+                if (y + h < dims_.y)
+                    addRow(y + h, z0, z1);
+            }
+            const int columnCount = (std::min(y + h, dims_.y - 1) - std::max(y - h, 0) + 1) * (z1 - z0 + 1);
+
+            std::fill(coarse_, coarse_ + COARSE, 0);
+            for (int x = 0; x <= std::min(h, dims_.x - 1); x++)
+                addColumn(coarse_, &columnCoarse_[static_cast<size_t>(x) * COARSE], COARSE);
+            std::fill(fineX_, fineX_ + COARSE, -1);
+
+            uint16_t* outRow = out + static_cast<size_t>(y) * dims_.x;
+            for (int x = 0; x < dims_.x; x++) {
+                if (x > 0) {
+                    if (x + h < dims_.x)
+                        addColumn(coarse_, &columnCoarse_[static_cast<size_t>(x + h) * COARSE], COARSE);
+                    if (x - h - 1 >= 0)
+                        removeColumn(coarse_, &columnCoarse_[static_cast<size_t>(x - h - 1) * COARSE], COARSE);
+                }
+                const uint32_t target = static_cast<uint32_t>(
+                    (std::min(x + h, dims_.x - 1) - std::max(x - h, 0) + 1) * columnCount / 2);
+
+                uint32_t below = 0;
+                int c = 0;
+                while (below + coarse_[c] <= target)
+                    below += coarse_[c++];
+
+                syncFine(c, x);
+                int b = c * FINE;
+                while (below + fine_[b] <= target)
+                    below += fine_[b++];
+                outRow[x] = static_cast<uint16_t>(b);
+            }
+        }
+    }
+
+private:
+    void addRow(int y, int z0, int z1) {
+        for (int z = z0; z <= z1; z++) {
+            const uint16_t* row = ranks_ + (static_cast<size_t>(z) * dims_.y + y) * dims_.x;
+            for (int x = 0; x < dims_.x; x++) {
+                columnFine_[static_cast<size_t>(x) * Bins + row[x]]++;
+                columnCoarse_[static_cast<size_t>(x) * COARSE + row[x] / FINE]++;
+            }
+        }
+    }
+
+    void removeRow(int y, int z0, int z1) {
+        for (int z = z0; z <= z1; z++) {
+            const uint16_t* row = ranks_ + (static_cast<size_t>(z) * dims_.y + y) * dims_.x;
+            for (int x = 0; x < dims_.x; x++) {
+                columnFine_[static_cast<size_t>(x) * Bins + row[x]]--;
+                columnCoarse_[static_cast<size_t>(x) * COARSE + row[x] / FINE]--;
+            }
+        }
+    }
+
+    static void addColumn(uint32_t* hist, const uint16_t* column, int n) {
+        for (int i = 0; i < n; i++)
+            hist[i] += column[i];
+    }
+
+    static void removeColumn(uint32_t* hist, const uint16_t* column, int n) {
+        for (int i = 0; i < n; i++)
+            hist[i] -= column[i];
+    }
+
+    /// Brings the fine bins of coarse bin c up to the window centered at x.
+    void syncFine(int c, int x) {
+        const int h = radius_;
+        const int first = std::max(x - h, 0);
+        const int last = std::min(x + h, dims_.x - 1);
+        uint32_t* fine = fine_ + c * FINE;
+        const int previous = fineX_[c];
+        fineX_[c] = x;
+
+        const int previousLast = std::min(previous + h, dims_.x - 1);
+        if (previous < 0 || previousLast < first) {
+            std::fill(fine, fine + FINE, 0);
+            for (int i = first; i <= last; i++)
+                addColumn(fine, &columnFine_[static_cast<size_t>(i) * Bins + c * FINE], FINE);
+            return;
+        }
+        for (int i = std::max(previous - h, 0); i < first; i++)
+            removeColumn(fine, &columnFine_[static_cast<size_t>(i) * Bins + c * FINE], FINE);
+        for (int i = previousLast + 1; i <= last; i++)
+            addColumn(fine, &columnFine_[static_cast<size_t>(i) * Bins + c * FINE], FINE);
+    }
+
+    const uint16_t* ranks_;
+    tgt::ivec3 dims_;
+    int radius_;
+
+    /// y-z column histograms of every x position; counts stay below 2^16 for kernels up to 255
+    std::vector<uint16_t> columnFine_;
+    std::vector<uint16_t> columnCoarse_;
+
+    uint32_t coarse_[COARSE];
+    uint32_t fine_[Bins];
+    /// Window position the fine bins of each coarse bin belong to, -1 if none
+    int fineX_[COARSE];
+};
+
+/// Median filter of a rank volume with a SlidingMedian per thread, mapping ranks back to values.
+template<int Bins, class T>
+void slidingMedianFilter(const std::vector<uint16_t>& ranks, const std::vector<T>& values,
+                         VolumeAtomic<T>* volume, int radius, ProgressBar* progress)
+{
+    const tgt::ivec3 dims = volume->getDimensions();
+    const size_t sliceSize = static_cast<size_t>(dims.x) * dims.y;
+    T* data = volume->voxel();
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        SlidingMedian<Bins> median(&ranks[0], dims, radius);
+        std::vector<uint16_t> out(sliceSize);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int z = 0; z < dims.z; z++) {
+            median.slice(z, &out[0]);
+            T* slice = data + z * sliceSize;
+            for (size_t i = 0; i < sliceSize; i++)
+                slice[i] = values[out[i]];
+            setLoopProgress(progress, z, dims.z);
+        }
+    }
+}
+
+/**
+ * Histogram median of 8 and 16-bit volumes. The values present in the
+ * volume are replaced by their ranks, so 12-bit data stored in 16-bit
+ * voxels only needs 4096 bins.
+ *
+ * @return false if the volume has more than 4096 distinct values or the
+ *      kernel is too large for the column histograms; nothing is changed then.
+ */
+template<class T>
+bool rankMedianFilter(VolumeAtomic<T>* volume, int radius, ProgressBar* progress) {
+    if (2 * radius + 1 > 255)
+        return false;
+
+    const int offset = -static_cast<int>(std::numeric_limits<T>::min());
+    const int domain = static_cast<int>(std::numeric_limits<T>::max()) + offset + 1;
+    const size_t numVoxels = volume->getNumVoxels();
+    T* data = volume->voxel();
+
+    std::vector<uint8_t> present(domain, 0);
+    for (size_t i = 0; i < numVoxels; i++)
+        present[static_cast<int>(data[i]) + offset] = 1;
+
+    std::vector<T> values;
+    std::vector<uint16_t> rankOf(domain, 0);
+    for (int v = 0; v < domain; v++) {
+        if (present[v]) {
+            rankOf[v] = static_cast<uint16_t>(values.size());
+            values.push_back(static_cast<T>(v - offset));
+        }
+    }
+    if (values.size() > 4096)
+        return false;
+
+    std::vector<uint16_t> ranks(numVoxels);
+    const ptrdiff_t n = static_cast<ptrdiff_t>(numVoxels);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (ptrdiff_t i = 0; i < n; i++)
+        ranks[i] = rankOf[static_cast<int>(data[i]) + offset];
+
+    if (values.size() <= 256)
+        slidingMedianFilter<256>(ranks, values, volume, radius, progress);
+    else
+        slidingMedianFilter<4096>(ranks, values, volume, radius, progress);
+    return true;
+}
+
+/// Only 8 and 16-bit integers have a histogram median.
+template<class T>
+bool medianFilterByHistogram(VolumeAtomic<T>*, int, ProgressBar*) {
+    return false;
+}
+
+inline bool medianFilterByHistogram(VolumeAtomic<uint8_t>* volume, int radius, ProgressBar* progress) {
+    return rankMedianFilter(volume, radius, progress);
+}
+
+inline bool medianFilterByHistogram(VolumeAtomic<int8_t>* volume, int radius, ProgressBar* progress) {
+    return rankMedianFilter(volume, radius, progress);
+}
+
+inline bool medianFilterByHistogram(VolumeAtomic<uint16_t>* volume, int radius, ProgressBar* progress) {
+    return rankMedianFilter(volume, radius, progress);
+}
+
+inline bool medianFilterByHistogram(VolumeAtomic<int16_t>* volume, int radius, ProgressBar* progress) {
+    return rankMedianFilter(volume, radius, progress);
+}
+
+/**
+ * Median over (2*radius+1)^3 windows clipped at the borders. 8 and 16-bit
+ * volumes use the sliding histogram, everything else selects the median of
+ * every window with nth_element. Both are parallelized over slices.
+ */
+template<class T>
+void medianFilter(VolumeAtomic<T>* volume, int radius, ProgressBar* progress = 0) {
+    if (radius <= 0 || medianFilterByHistogram(volume, radius, progress)) {
+        if (progress)
+            progress->setProgress(1.f);
+        return;
+    }
+
+    const tgt::ivec3 dims = volume->getDimensions();
+    const size_t sliceSize = static_cast<size_t>(dims.x) * dims.y;
+    T* data = volume->voxel();
+    const std::vector<T> input(data, data + volume->getNumVoxels());
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        std::vector<T> window;
+        window.reserve((2 * radius + 1) * (2 * radius + 1) * (2 * radius + 1));
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int z = 0; z < dims.z; z++) {
+            const int zmin = std::max(z - radius, 0);
+            const int zmax = std::min(z + radius, dims.z - 1);
+            for (int y = 0; y < dims.y; y++) {
+                const int ymin = std::max(y - radius, 0);
+                const int ymax = std::min(y + radius, dims.y - 1);
+                for (int x = 0; x < dims.x; x++) {
+                    const int xmin = std::max(x - radius, 0);
+                    const int xmax = std::min(x + radius, dims.x - 1);
+
+                    window.clear();
+                    for (int k = zmin; k <= zmax; k++) {
+                        for (int j = ymin; j <= ymax; j++) {
+                            const T* row = &input[k * sliceSize + static_cast<size_t>(j) * dims.x];
+                            window.insert(window.end(), row + xmin, row + xmax + 1);
+                        }
+                    }
+                    std::nth_element(window.begin(), window.begin() + window.size() / 2, window.end());
+                    data[z * sliceSize + static_cast<size_t>(y) * dims.x + x] = window[window.size() / 2];
+                }
+            }
+            setLoopProgress(progress, z, dims.z);
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f);
+}
+
+/**
+ * Lower envelope of the parabolas w*(q-p)^2 + f(p) of a scanline, the one
+ * dimensional step of the exact Euclidean distance transform of Felzenszwalb
+ * and Huttenlocher. Infinite entries of f are no sites.
+ */
+class DistanceEnvelope {
+public:
+    explicit DistanceEnvelope(int maxLength)
+        : v_(maxLength)
+        , z_(maxLength + 1)
+    {}
+
+    /**
+     * Replaces f[q] by min_p(w*(q-p)^2 + f[p]) and, if feature is not null,
+     * feature[q] by feature[p] of the minimizing p. Scratch holds n values
+     * and n features.
+     */
+    void transform(double* f, uint32_t* feature, int n, double w, double* scratch, uint32_t* featureScratch) {
+        const double inf = std::numeric_limits<double>::infinity();
+        int k = -1;
+        for (int q = 0; q < n; q++) {
+            if (f[q] == inf)
+                continue;
+            const double fq = f[q] + w * q * q;
+            double s = -inf;
+            while (k >= 0) {
+                const int p = v_[k];
+                s = (fq - (f[p] + w * p * p)) / (2.0 * w * (q - p));
+                if (s > z_[k])
+                    break;
+                k--;
+            }
+            k++;
+            v_[k] = q;
+            z_[k] = (k == 0) ? -inf : s;
+        }
+        if (k < 0)
+            return;
+        z_[k + 1] = inf;
+
+        int j = 0;
+        for (int q = 0; q < n; q++) {
+            while (z_[j + 1] < q)
+                j++;
+            const int p = v_[j];
+            scratch[q] = w * (q - p) * (q - p) + f[p];
+            if (feature)
+                featureScratch[q] = feature[p];
+        }
+        std::copy(scratch, scratch + n, f);
+        if (feature)
+            std::copy(featureScratch, featureScratch + n, feature);
+    }
+
+private:
+    std::vector<int> v_;
+    std::vector<double> z_;
+};
+
+/**
+ * Runs DistanceEnvelope over batches of adjacent scanlines of a volume of
+ * squared distances, stored as D with std::numeric_limits<D>::max() for
+ * "no site reachable".
+ */
+template<class D>
+class DistancePass {
+public:
+    DistancePass(int maxLength, int maxLanes)
+        : envelope_(maxLength)
+        , f_(static_cast<size_t>(maxLength) * maxLanes)
+        , feature_(static_cast<size_t>(maxLength) * maxLanes)
+        , scratch_(maxLength)
+        , featureScratch_(maxLength)
+    {}
+
+    /// Same addressing as VanHerkFilter::filter(), features may be null
+    void transform(D* first, uint32_t* features, int length, ptrdiff_t step, int lanes, double w) {
+        const D none = std::numeric_limits<D>::max();
+        const double inf = std::numeric_limits<double>::infinity();
+        for (int t = 0; t < length; t++) {
+            const D* src = first + t * step;
+            for (int l = 0; l < lanes; l++)
+                f_[l * length + t] = (src[l] == none) ? inf : static_cast<double>(src[l]);
+            if (features) {
+                const uint32_t* srcFeatures = features + t * step;
+                for (int l = 0; l < lanes; l++)
+                    feature_[l * length + t] = srcFeatures[l];
+            }
+        }
+
+        for (int l = 0; l < lanes; l++)
+            envelope_.transform(&f_[l * length], features ? &feature_[l * length] : 0, length, w,
+                                &scratch_[0], &featureScratch_[0]);
+
+        for (int t = 0; t < length; t++) {
+            D* dst = first + t * step;
+            for (int l = 0; l < lanes; l++) {
+                const double d = f_[l * length + t];
+                dst[l] = (d == inf) ? none : static_cast<D>(d);
+            }
+            if (features) {
+                uint32_t* dstFeatures = features + t * step;
+                for (int l = 0; l < lanes; l++)
+                    dstFeatures[l] = feature_[l * length + t];
+            }
+        }
+    }
+
+private:
+    DistanceEnvelope envelope_;
+    std::vector<double> f_;
+    std::vector<uint32_t> feature_;
+    std::vector<double> scratch_;
+    std::vector<uint32_t> featureScratch_;
+};
+
+/**
+ * Exact squared Euclidean distance transform: every voxel of distances
+ * receives the squared distance to the nearest site, a voxel of volume
+ * whose value is not above siteThreshold. Separable in the style of
+ * Felzenszwalb/Meijster, linear in the number of voxels and parallelized
+ * over scanlines with OpenMP.
+ *
+ * @param distances squared distances, same dimensions as volume. Voxels
+ *      without any site get std::numeric_limits<D>::max().
+ * @param features if not null, receives the linear index of the nearest
+ *      site of every voxel, or 0xffffffff if there is none
+ * @param weights squared voxel extent along each axis, e.g. the squared
+ *      spacing. Should be integral if D is.
+ */
+template<class T, class D>
+void distanceTransform(const VolumeAtomic<T>* volume, double siteThreshold, D* distances,
+                       uint32_t* features = 0, tgt::dvec3 weights = tgt::dvec3(1.0),
+                       ProgressBar* progress = 0)
+{
+    const tgt::ivec3 dims = volume->getDimensions();
+    const ptrdiff_t sliceSize = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    const ptrdiff_t numVoxels = static_cast<ptrdiff_t>(volume->getNumVoxels());
+    const T* data = volume->voxel();
+    const int lanes = 16;
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (ptrdiff_t i = 0; i < numVoxels; i++) {
+        const bool site = static_cast<double>(data[i]) <= siteThreshold;
+        distances[i] = site ? D(0) : std::numeric_limits<D>::max();
+        if (features)
+            features[i] = site ? static_cast<uint32_t>(i) : 0xffffffffu;
+    }
+
+    // x: rows one by one
+    const int rows = dims.y * dims.z;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        DistancePass<D> pass(dims.x, 1);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int row = 0; row < rows; row++) {
+            const ptrdiff_t offset = static_cast<ptrdiff_t>(row) * dims.x;
+            pass.transform(distances + offset, features ? features + offset : 0, dims.x, 1, 1, weights.x);
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f / 3.f);
+
+    // y: batches of adjacent columns within a slice
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        DistancePass<D> pass(dims.y, lanes);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int z = 0; z < dims.z; z++) {
+            for (int x = 0; x < dims.x; x += lanes) {
+                const ptrdiff_t offset = z * sliceSize + x;
+                pass.transform(distances + offset, features ? features + offset : 0, dims.y, dims.x,
+                               std::min(lanes, dims.x - x), weights.y);
+            }
+        }
+    }
+    if (progress)
+        progress->setProgress(2.f / 3.f);
+
+    // z: batches of adjacent columns within a row
+    const int batches = (dims.x + lanes - 1) / lanes;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        DistancePass<D> pass(dims.z, lanes);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int b = 0; b < dims.y * batches; b++) {
+            const int y = b / batches;
+            const int x = (b % batches) * lanes;
+            const ptrdiff_t offset = static_cast<ptrdiff_t>(y) * dims.x + x;
+            pass.transform(distances + offset, features ? features + offset : 0, dims.z, sliceSize,
+                           std::min(lanes, dims.x - x), weights.z);
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f);
+}
+
+} // namespace voreen
+
+#endif // VRN_VOLUMEFILTERS_H
@@ -102,6 +102,16 @@ public:
      */
     void setFilter(tgt::Texture::Filter filter);
 
+    /**
+     * Re-uploads the voxels in [llf, urb) of the original volume, e.g. after
+     * they were modified in place. Uses a sub-texture update when the texture
+     * maps the volume directly and regenerates all textures otherwise.
+     *
+     * @param llf Lower left front voxel of the region (inclusive)
+     * @param urb Upper right back voxel of the region (exclusive)
+     */
+    void updateSubVolume(const tgt::ivec3& llf, const tgt::ivec3& urb);
+
 protected:
     /**
      * Used internally by the constructor.
@@ -0,0 +1,405 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+#ifndef VRN_VOLUMELABELING_H
+#define VRN_VOLUMELABELING_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/io/progressbar.h"
+#include "voreen/core/utils/exception.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace voreen {
+
+/**
+ * Size, extent and position of a connected component.
+ */
+struct ConnectedComponent {
+    uint32_t label;
+    double value;           ///< voxel value of the component's first voxel
+    uint64_t numVoxels;
+    tgt::ivec3 llf;         ///< lower left front of the bounding box
+    tgt::ivec3 urb;         ///< upper right back of the bounding box, inclusive
+    tgt::dvec3 centroid;    ///< in voxel coordinates
+};
+
+/**
+ * Block-parallel union-find labeling of the connected components of a volume.
+ *
+ * Voxels with value zero, or below an optional minimum value, are background
+ * and get label 0. In NONZERO mode all other voxels form components with
+ * their neighbors, in EQUAL_VALUE mode
+ * only neighbors of the same value are connected, so every class of a
+ * label map or CA lattice is segmented in a single run.
+ *
+ * The volume is split into one slab of slices per thread. Each slab is
+ * labeled with a union-find forest over voxel indices, stored in the output
+ * array itself; the slab boundaries are merged afterwards. Every tree is
+ * rooted at its first voxel, so the final labels 1..n are numbered in the
+ * order of each component's first voxel, independently of the number of
+ * threads. Component statistics are gathered while the labels are written.
+ */
+class ConnectedComponentLabeling {
+public:
+    enum Criterion {
+        NONZERO,        ///< all non-zero voxels are foreground
+        EQUAL_VALUE     ///< neighbors are connected if their values are equal
+    };
+
+    /**
+     * @param connectivity 6, 10 (8 in-plane and 2 along z), 18 or 26
+     * @param minValue voxels below this value are background as well
+     */
+    ConnectedComponentLabeling(int connectivity = 26, Criterion criterion = NONZERO,
+                               double minValue = -std::numeric_limits<double>::max())
+        : criterion_(criterion)
+        , minValue_(minValue)
+    {
+        for (int dz = -1; dz <= 0; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    // causal half of the neighborhood only
+                    if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0)))
+                        continue;
+                    const int manhattan = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                    bool use;
+                    if (connectivity == 6)
+                        use = (manhattan == 1);
+                    else if (connectivity == 10)
+                        use = (dz == 0 || manhattan == 1);
+                    else if (connectivity == 18)
+                        use = (manhattan <= 2);
+                    else
+                        use = true;
+                    if (use)
+                        neighbors_.push_back(tgt::ivec3(dx, dy, dz));
+                }
+            }
+        }
+    }
+
+    /**
+     * Checks that a volume of the given dimensions can be labeled,
+     * before any label array is allocated for it.
+     *
+     * @throw VoreenException if the volume has 2^31 voxels or more
+     */
+    static void checkDimensions(const tgt::ivec3& dims) {
+        if (tgt::hmul(tgt::Vector3<int64_t>(dims)) >= static_cast<int64_t>(ROOT_FLAG))
+            throw VoreenException("Volume too large for connected component labeling");
+    }
+
+    /**
+     * Labels a volume.
+     *
+     * @param labels numVoxels labels, receives 0 for background and 1..n otherwise
+     * @param components if not null, receives the statistics of the n
+     *      components, ordered by label
+     * @return the number of components n
+     *
+     * @throw VoreenException if the volume has 2^31 voxels or more
+     */
+    template<class T>
+    uint32_t label(const VolumeAtomic<T>* volume, uint32_t* labels,
+                   std::vector<ConnectedComponent>* components = 0, ProgressBar* progress = 0) const
+    {
+        return label(volume->voxel(), volume->getDimensions(), labels, components, progress);
+    }
+
+    /// Labels a raw array of dims voxels, e.g. a CA lattice.
+    template<class T>
+    uint32_t label(const T* data, const tgt::ivec3& dims, uint32_t* labels,
+                   std::vector<ConnectedComponent>* components = 0, ProgressBar* progress = 0) const;
+
+private:
+    /// Union-find entries of background voxels; flag of roots during renumbering
+    enum {
+        BACKGROUND = 0xffffffffu,
+        ROOT_FLAG = 0x80000000u
+    };
+
+    /// Gathered per slab, without the final division of the centroid
+    struct Accumulator {
+        double value;
+        uint64_t numVoxels;
+        tgt::ivec3 llf;
+        tgt::ivec3 urb;
+        tgt::dvec3 sum;
+
+        Accumulator()
+            : value(0.0)
+            , numVoxels(0)
+            , llf(std::numeric_limits<int>::max())
+            , urb(std::numeric_limits<int>::min())
+            , sum(0.0)
+        {}
+
+        void add(const Accumulator& a) {
+            if (!numVoxels)
+                value = a.value;
+            numVoxels += a.numVoxels;
+            llf = tgt::min(llf, a.llf);
+            urb = tgt::max(urb, a.urb);
+            sum += a.sum;
+        }
+    };
+
+    template<class T>
+    bool isBackground(T value) const {
+        return value == T(0) || static_cast<double>(value) < minValue_;
+    }
+
+    template<class T>
+    bool connected(T a, T b) const {
+        return criterion_ == NONZERO || a == b;
+    }
+
+    static uint32_t find(uint32_t* parent, uint32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    /// Unites every foreground voxel of slices [z0, z1) with its causal neighbors
+    /// in slices [zMin, z1).
+    template<class T>
+    void uniteSlices(const T* data, const tgt::ivec3& dims, uint32_t* parent, int z0, int z1, int zMin) const;
+
+    Criterion criterion_;
+    double minValue_;
+    std::vector<tgt::ivec3> neighbors_;
+};
+
+// ----------------------------------------------------------------------------
+
+template<class T>
+void ConnectedComponentLabeling::uniteSlices(const T* data, const tgt::ivec3& dims, uint32_t* parent,
+                                             int z0, int z1, int zMin) const
+{
+    const ptrdiff_t sliceSize = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    std::vector<ptrdiff_t> offsets(neighbors_.size());
+    for (size_t n = 0; n < neighbors_.size(); n++)
+        offsets[n] = neighbors_[n].z * sliceSize + neighbors_[n].y * dims.x + neighbors_[n].x;
+
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < dims.y; y++) {
+            const ptrdiff_t row = z * sliceSize + static_cast<ptrdiff_t>(y) * dims.x;
+            for (int x = 0; x < dims.x; x++) {
+                const uint32_t i = static_cast<uint32_t>(row + x);
+                if (parent[i] == BACKGROUND)
+                    continue;
+                const T value = data[i];
+                // Root of i, kept up to date instead of searched for every neighbor
+                uint32_t root = find(parent, i);
+                for (size_t n = 0; n < neighbors_.size(); n++) {
+                    const tgt::ivec3& d = neighbors_[n];
+                    if (x + d.x < 0 || x + d.x >= dims.x || y + d.y < 0 || y + d.y >= dims.y || z + d.z < zMin)
+                        continue;
+                    const uint32_t j = static_cast<uint32_t>(i + offsets[n]);
+                    if (parent[j] == BACKGROUND || parent[j] == root || !connected(value, data[j]))
+                        continue;
+                    const uint32_t other = find(parent, j);
+                    if (other < root) {
+                        parent[root] = other;
+                        root = other;
+                    }
+                    else if (root < other) {
+                        parent[other] = root;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<class T>
+uint32_t ConnectedComponentLabeling::label(const T* data, const tgt::ivec3& dims, uint32_t* labels,
+                                           std::vector<ConnectedComponent>* components,
+                                           ProgressBar* progress) const
+{
+    checkDimensions(dims);
+    const ptrdiff_t numVoxels = static_cast<ptrdiff_t>(tgt::hmul(tgt::Vector3<ptrdiff_t>(dims)));
+    const ptrdiff_t sliceSize = static_cast<ptrdiff_t>(dims.x) * dims.y;
+    uint32_t* parent = labels;
+
+#ifdef _OPENMP
+    const int numSlabs = std::max(std::min(omp_get_max_threads(), dims.z), 1);
+#else
+    const int numSlabs = 1;
+#endif
+    std::vector<int> slabBegin(numSlabs + 1);
+    for (int s = 0; s <= numSlabs; s++)
+        slabBegin[s] = static_cast<int>(static_cast<int64_t>(dims.z) * s / numSlabs);
+    std::vector<uint32_t> slabRoots(numSlabs + 1, 0);
+
+    // Forests of the slabs
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (int s = 0; s < numSlabs; s++) {
+        const ptrdiff_t first = slabBegin[s] * sliceSize;
+        const ptrdiff_t last = slabBegin[s + 1] * sliceSize;
+        for (ptrdiff_t i = first; i < last; i++)
+            parent[i] = isBackground(data[i]) ? static_cast<uint32_t>(BACKGROUND) : static_cast<uint32_t>(i);
+        uniteSlices(data, dims, parent, slabBegin[s], slabBegin[s + 1], slabBegin[s]);
+    }
+    if (progress)
+        progress->setProgress(0.4f);
+
+    // Slab boundaries, one slice each
+    for (int s = 1; s < numSlabs; s++)
+        uniteSlices(data, dims, parent, slabBegin[s], slabBegin[s] + 1, slabBegin[s] - 1);
+
+    // Flatten and count the roots of each slab. Concurrent finds only ever
+    // replace a parent by one of its ancestors.
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (int s = 0; s < numSlabs; s++) {
+        uint32_t roots = 0;
+        for (ptrdiff_t i = slabBegin[s] * sliceSize; i < slabBegin[s + 1] * sliceSize; i++) {
+            if (parent[i] == BACKGROUND)
+                continue;
+            uint32_t r = parent[i];
+            while (parent[r] != r)
+                r = parent[r];
+            parent[i] = r;
+            if (r == static_cast<uint32_t>(i))
+                roots++;
+        }
+        slabRoots[s + 1] = roots;
+    }
+    for (int s = 0; s < numSlabs; s++)
+        slabRoots[s + 1] += slabRoots[s];
+    const uint32_t numComponents = slabRoots[numSlabs];
+    if (progress)
+        progress->setProgress(0.6f);
+
+    // Number the roots in raster order
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (int s = 0; s < numSlabs; s++) {
+        uint32_t next = slabRoots[s] + 1;
+        for (ptrdiff_t i = slabBegin[s] * sliceSize; i < slabBegin[s + 1] * sliceSize; i++) {
+            if (parent[i] == static_cast<uint32_t>(i))
+                parent[i] = ROOT_FLAG | next++;
+        }
+    }
+    if (progress)
+        progress->setProgress(0.8f);
+
+    // Resolve the labels and gather the statistics. Components rooted in the
+    // slab are accumulated densely, those reaching in from earlier slabs in a map.
+    std::vector<std::vector<Accumulator> > own(components ? numSlabs : 0);
+    std::vector<std::map<uint32_t, Accumulator> > foreign(components ? numSlabs : 0);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (int s = 0; s < numSlabs; s++) {
+        if (components)
+            own[s].resize(slabRoots[s + 1] - slabRoots[s]);
+        for (int z = slabBegin[s]; z < slabBegin[s + 1]; z++) {
+            for (int y = 0; y < dims.y; y++) {
+                uint32_t* row = labels + z * sliceSize + static_cast<ptrdiff_t>(y) * dims.x;
+                // Runs of equal labels are accumulated before they are stored
+                Accumulator run;
+                uint32_t runLabel = 0;
+                for (int x = 0; x <= dims.x; x++) {
+                    uint32_t l = 0;
+                    if (x < dims.x) {
+                        const uint32_t p = row[x];
+                        if (p != BACKGROUND)
+                            l = (p & ROOT_FLAG) ? (p & ~ROOT_FLAG) : (labels[p] & ~ROOT_FLAG);
+                        row[x] = l;
+                    }
+                    if (!components)
+                        continue;
+
+                    if (l != runLabel || x == dims.x) {
+                        if (runLabel) {
+                            Accumulator& target = (runLabel > slabRoots[s]) ? own[s][runLabel - slabRoots[s] - 1]
+                                                                            : foreign[s][runLabel];
+                            target.add(run);
+                        }
+                        runLabel = l;
+                        run = Accumulator();
+                        if (l) {
+                            run.value = static_cast<double>(data[z * sliceSize + static_cast<ptrdiff_t>(y) * dims.x + x]);
+                            run.llf = tgt::ivec3(x, y, z);
+                        }
+                    }
+                    if (l) {
+                        run.numVoxels++;
+                        run.urb = tgt::ivec3(x, y, z);
+                        run.sum += tgt::dvec3(x, y, z);
+                    }
+                }
+            }
+        }
+    }
+
+    if (components) {
+        std::vector<Accumulator> total(numComponents);
+        for (int s = 0; s < numSlabs; s++) {
+            for (size_t c = 0; c < own[s].size(); c++)
+                total[slabRoots[s] + c].add(own[s][c]);
+            for (std::map<uint32_t, Accumulator>::const_iterator it = foreign[s].begin(); it != foreign[s].end(); ++it)
+                total[it->first - 1].add(it->second);
+        }
+
+        components->resize(numComponents);
+        for (uint32_t c = 0; c < numComponents; c++) {
+            ConnectedComponent& component = (*components)[c];
+            component.label = c + 1;
+            component.value = total[c].value;
+            component.numVoxels = total[c].numVoxels;
+            component.llf = total[c].llf;
+            component.urb = total[c].urb;
+            component.centroid = total[c].sum / static_cast<double>(total[c].numVoxels);
+        }
+    }
+    if (progress)
+        progress->setProgress(1.f);
+
+    return numComponents;
+}
+
+} // namespace voreen
+
+#endif // VRN_VOLUMELABELING_H
@@ -29,6 +29,10 @@
 #define VRN_VOLUMEOPERATOR_H
 
 #include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/datastructures/volume/volumefilters.h"
+#include "voreen/core/datastructures/volume/volumelabeling.h"
+#include "voreen/core/datastructures/volume/marchingcubes.h"
+#include "voreen/core/datastructures/volume/volumeresampling.h"
 #include "voreen/core/io/progressbar.h"
 #include "voreen/core/utils/exception.h"
 
@@ -38,9 +42,12 @@
 
 #include <vector>
 #include <limits>
+#include <typeinfo>
 
 namespace voreen {
 
+class VolumeCollection;
+
 /**
  * Thrown by a VolumeOperator is the type of the passed Volume is not supported.
  */
@@ -51,6 +58,51 @@ public:
     {}
 };
 
+/**
+ * Voxel formats the volume operators are instantiated for, as X(format id, voxel type)
+ * entries. Operators have to provide apply_internal overloads for all of them
+ * (typically a generic one plus throwing ones for the vector types).
+ *
+ * VolumeFlow3D is a Volume3xFloat and dispatched as such.
+ */
+#define VRN_VOLUME_OPERATOR_FORMATS(X) \
+    X(FORMAT_UINT8,    uint8_t) \
+    X(FORMAT_UINT16,   uint16_t) \
+    X(FORMAT_UINT32,   uint32_t) \
+    X(FORMAT_INT8,     int8_t) \
+    X(FORMAT_INT16,    int16_t) \
+    X(FORMAT_INT32,    int32_t) \
+    X(FORMAT_FLOAT,    float) \
+    X(FORMAT_DOUBLE,   double) \
+    X(FORMAT_3xFLOAT,  tgt::Vector3<float>) \
+    X(FORMAT_3xDOUBLE, tgt::Vector3<double>) \
+    X(FORMAT_4xFLOAT,  tgt::Vector4<float>) \
+    X(FORMAT_4xDOUBLE, tgt::Vector4<double>)
+
+/**
+ * Calls visitor.visit<T>() with the voxel type T of the passed volume and returns
+ * its result. The switch over Volume::getFormatId() compiles to a jump table, so
+ * the dispatch costs the same for every format and needs no RTTI.
+ *
+ * @throw VolumeOperatorUnsupportedTypeException if the volume is null or its format
+ *  is not listed in VRN_VOLUME_OPERATOR_FORMATS
+ */
+template<class Visitor>
+typename Visitor::ResultType dispatchVolumeFormat(const Volume* volume, const Visitor& visitor) {
+    if (!volume)
+        throw VolumeOperatorUnsupportedTypeException();
+
+    switch (volume->getFormatId()) {
+#define VRN_DISPATCH_VOLUME_FORMAT(ID, TYPE) \
+    case Volume::ID: \
+        return visitor.template visit<TYPE >();
+    VRN_VOLUME_OPERATOR_FORMATS(VRN_DISPATCH_VOLUME_FORMAT)
+#undef VRN_DISPATCH_VOLUME_FORMAT
+    default:
+        throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+    }
+}
+
 /**
  * Parent class of volume operators for one volume.
  */
@@ -72,6 +124,27 @@ public:
     template<typename ReturnValue>
     ReturnValue apply(Volume* volume) const;
 
+    /**
+     * Applies the operator to each of the passed volumes and appends the return
+     * values to \p results, in order. Consecutive volumes of the same voxel format
+     * share a single type dispatch, so a list of bricks costs one dispatch in total.
+     *
+     * @throw VolumeOperatorUnsupportedTypeException for null entries or unsupported
+     *  formats; results of the volumes before are kept
+     */
+    template<typename ReturnValue>
+    void applyBatch(const std::vector<Volume*>& volumes, std::vector<ReturnValue>& results) const;
+
+    /// Variant for operators without a return value or whose results are not needed.
+    void applyBatch(const std::vector<Volume*>& volumes) const;
+
+    /// Applies the operator to each volume of the collection, see above.
+    template<typename ReturnValue>
+    void applyBatch(const VolumeCollection* collection, std::vector<ReturnValue>& results) const;
+
+    /// Applies the operator to each volume of the collection, discarding return values.
+    void applyBatch(const VolumeCollection* collection) const;
+
     /**
      * Assigns a progress bar that should be used by the
      * operator for indicating progress.
@@ -83,8 +156,68 @@ public:
 protected:
     ProgressBar* progressBar_;  ///< to be used by concrete subclasses for indicating progress
 
+private:
+    /// Calls apply_internal for a volume of voxel type T
+    template<typename ReturnValue>
+    struct ApplyVisitor {
+        typedef ReturnValue ResultType;
+
+        ApplyVisitor(const Derived* op, Volume* volume) : op_(op), volume_(volume) {}
+
+        template<typename T>
+        ReturnValue visit() const {
+            return ReturnValue(op_->apply_internal(static_cast<VolumeAtomic<T>*>(volume_)));
+        }
+
+        const Derived* op_;
+        Volume* volume_;
+    };
+
+    /// Calls apply_internal for a run of volumes of voxel type T and collects the results
+    template<typename ReturnValue>
+    struct BatchVisitor {
+        typedef void ResultType;
+
+        BatchVisitor(const Derived* op, Volume* const* begin, Volume* const* end, std::vector<ReturnValue>* results)
+            : op_(op), begin_(begin), end_(end), results_(results) {}
+
+        template<typename T>
+        void visit() const {
+            for (Volume* const* v = begin_; v != end_; ++v)
+                results_->push_back(ReturnValue(op_->apply_internal(static_cast<VolumeAtomic<T>*>(*v))));
+        }
+
+        const Derived* op_;
+        Volume* const* begin_;
+        Volume* const* end_;
+        std::vector<ReturnValue>* results_;
+    };
+
+    /// Calls apply_internal for a run of volumes of voxel type T
+    struct DiscardingBatchVisitor {
+        typedef void ResultType;
+
+        DiscardingBatchVisitor(const Derived* op, Volume* const* begin, Volume* const* end)
+            : op_(op), begin_(begin), end_(end) {}
+
+        template<typename T>
+        void visit() const {
+            for (Volume* const* v = begin_; v != end_; ++v)
+                op_->apply_internal(static_cast<VolumeAtomic<T>*>(*v));
+        }
+
+        const Derived* op_;
+        Volume* const* begin_;
+        Volume* const* end_;
+    };
+
+    /// Index past the run of volumes starting at begin that share its format
+    static size_t endOfFormatRun(const std::vector<Volume*>& volumes, size_t begin);
 };
 
+/// Returns the volumes of all handles of \p collection in order, an empty list for a null collection.
+std::vector<Volume*> getCollectionVolumes(const VolumeCollection* collection);
+
 /**
  * Parent class of volume operators for two volumes.
  * Both volumes must have the same type.
@@ -118,6 +251,24 @@ public:
 protected:
     ProgressBar* progressBar_;  ///< to be used by concrete subclasses for indicating progress
 
+private:
+    /// Calls apply_internal for two volumes of voxel type T
+    template<typename ReturnValue>
+    struct ApplyVisitor {
+        typedef ReturnValue ResultType;
+
+        ApplyVisitor(const Derived* op, Volume* v1, Volume* v2) : op_(op), v1_(v1), v2_(v2) {}
+
+        template<typename T>
+        ReturnValue visit() const {
+            return ReturnValue(op_->apply_internal(static_cast<VolumeAtomic<T>*>(v1_),
+                                                   static_cast<VolumeAtomic<T>*>(v2_)));
+        }
+
+        const Derived* op_;
+        Volume* v1_;
+        Volume* v2_;
+    };
 };
 
 
@@ -184,6 +335,9 @@ private:
  * Returns a copy of the input volume that has been resampled to the specified dimensions
  * by using the given filtering mode.
  *
+ * The resampling is separable and runs in parallel over slabs of output slices,
+ * see resampleSeparable(). Integer voxels are rounded to the nearest value.
+ *
  * @return the resampled volume
  */
 class VolumeOperatorResample : public VolumeOperatorUnary<VolumeOperatorResample> {
@@ -207,6 +361,7 @@ private:
 /**
  * Reduces the Volumes resolution by half, by linearly downsampling 8 voxels
  * to 1 voxel. This does not necessarily happen when using the resample(..) function.
+ * Integer voxels are rounded to the nearest value.
  *
  * @return the resampled volume
  */
@@ -217,6 +372,33 @@ private:
     VolumeAtomic<T>* apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc);
 };
 
+/**
+ * Builds a mip pyramid of the input volume: level i + 1 is the halfsampled
+ * level i, as with VolumeOperatorHalfsample. All levels are computed in a single
+ * pass over the input, every finished slice immediately feeds the next level
+ * while it is still in the cache.
+ *
+ * @return the levels from the largest to the smallest, excluding the input
+ *  volume. The caller takes ownership. Use apply<std::vector<Volume*> >().
+ */
+class VolumeOperatorMipPyramid : public VolumeOperatorUnary<VolumeOperatorMipPyramid> {
+    friend class VolumeOperatorUnary<VolumeOperatorMipPyramid>;
+public:
+    /**
+     * @param maxLevels maximum number of levels to create, 0 for halving until
+     *  a dimension would drop below one voxel
+     */
+    VolumeOperatorMipPyramid(int maxLevels = 0) :
+        maxLevels_(maxLevels)
+    {}
+
+private:
+    int maxLevels_;
+
+    template<typename T>
+    std::vector<Volume*> apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc);
+};
+
 /**
  * Converts the source volume's data to the destination volume's data type
  * and writes the result to the dest volume.
@@ -428,9 +610,10 @@ private:
 // Some more specialized volume operators
 //
 
-/*
- * The morphologic operator erosion.
- * TODO: document
+/**
+ * The morphologic operator erosion: minimum over a cube of kernelSize^3
+ * voxels, clipped at the volume borders. Runs in place with the van
+ * Herk/Gil-Werman algorithm, so the cost does not depend on the kernel size.
  */
 class VolumeOperatorErosion : public VolumeOperatorUnary<VolumeOperatorErosion> {
     friend class VolumeOperatorUnary<VolumeOperatorErosion>;
@@ -459,8 +642,9 @@ private:
 };
 
 /**
- * The morphologic operator dilation.
- * TODO: document
+ * The morphologic operator dilation: maximum over a cube of kernelSize^3
+ * voxels, clipped at the volume borders. Runs in place with the van
+ * Herk/Gil-Werman algorithm, so the cost does not depend on the kernel size.
  */
 class VolumeOperatorDilation : public VolumeOperatorUnary<VolumeOperatorDilation> {
     friend class VolumeOperatorUnary<VolumeOperatorDilation>;
@@ -488,9 +672,12 @@ private:
     int kernelSize_;
 };
 
-/***
- * Median filter.
- * TODO: document
+/**
+ * Median filter over a cube of kernelSize^3 voxels, clipped at the volume
+ * borders. 8 and 16-bit volumes with at most 4096 distinct values use a
+ * sliding histogram whose cost barely depends on the kernel size.
+ *
+ * @see medianFilter
  */
 class VolumeOperatorMedian : public VolumeOperatorUnary<VolumeOperatorMedian> {
     friend class VolumeOperatorUnary<VolumeOperatorMedian>;
@@ -518,6 +705,146 @@ private:
     int kernelSize_;
 };
 
+/**
+ * Exact Euclidean distance transform. Every voxel receives its distance to
+ * the nearest site, i.e. the nearest voxel whose value is not above the site
+ * threshold; with the default threshold of 0 the foreground of a mask gets
+ * its distance to the background. Runs in linear time and in parallel.
+ *
+ * Returns a new volume with the input's spacing and transformation. Voxels
+ * without any site get the maximum value of the output type.
+ */
+class VolumeOperatorDistanceTransform : public VolumeOperatorUnary<VolumeOperatorDistanceTransform> {
+    friend class VolumeOperatorUnary<VolumeOperatorDistanceTransform>;
+public:
+    enum OutputFormat {
+        DISTANCE_FLOAT,         ///< VolumeFloat of distances
+        DISTANCE_SQUARED_UINT32 ///< VolumeUInt32 of exact squared distances in voxels
+    };
+
+    /**
+     * @param format type of the returned volume
+     * @param siteThreshold voxels with values up to this are sites
+     * @param useSpacing measure distances with the volume's spacing instead
+     *      of in voxels. Only available for DISTANCE_FLOAT.
+     * @param featureTransform if not null, receives a new VolumeUInt32 holding
+     *      the linear index of the nearest site of every voxel (0xffffffff
+     *      for none). The caller takes ownership.
+     */
+    VolumeOperatorDistanceTransform(OutputFormat format = DISTANCE_FLOAT, double siteThreshold = 0.0,
+                                    bool useSpacing = false, VolumeUInt32** featureTransform = 0)
+        : format_(format)
+        , siteThreshold_(siteThreshold)
+        , useSpacing_(useSpacing)
+        , featureTransform_(featureTransform)
+    {}
+
+private:
+    template<typename T>
+    Volume* apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc);
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const;
+
+    OutputFormat format_;
+    double siteThreshold_;
+    bool useSpacing_;
+    VolumeUInt32** featureTransform_;
+};
+
+/**
+ * Labels the connected components of a volume, returning a VolumeUInt32 of
+ * labels with the input's spacing and transformation: 0 for background
+ * (zero or below minValue) voxels, 1..n for the components in order of their first voxel.
+ *
+ * @see ConnectedComponentLabeling
+ */
+class VolumeOperatorConnectedComponents : public VolumeOperatorUnary<VolumeOperatorConnectedComponents> {
+    friend class VolumeOperatorUnary<VolumeOperatorConnectedComponents>;
+public:
+    /**
+     * @param connectivity 6, 10, 18 or 26
+     * @param criterion which neighboring voxels are connected
+     * @param components if not null, receives the statistics of every component
+     * @param minValue voxels below this value are background as well
+     */
+    VolumeOperatorConnectedComponents(int connectivity = 26,
+            ConnectedComponentLabeling::Criterion criterion = ConnectedComponentLabeling::NONZERO,
+            std::vector<ConnectedComponent>* components = 0,
+            double minValue = -std::numeric_limits<double>::max())
+        : labeling_(connectivity, criterion, minValue)
+        , components_(components)
+    {}
+
+private:
+    template<typename T>
+    Volume* apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc, VoreenException);
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    Volume* apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const;
+
+    ConnectedComponentLabeling labeling_;
+    std::vector<ConnectedComponent>* components_;
+};
+
+/**
+ * Extracts an isosurface as an indexed triangle mesh in voxel coordinates.
+ *
+ * @see MarchingCubes
+ */
+class VolumeOperatorIsosurface : public VolumeOperatorUnary<VolumeOperatorIsosurface> {
+    friend class VolumeOperatorUnary<VolumeOperatorIsosurface>;
+public:
+    /**
+     * @param isovalue voxels below this value are inside
+     * @param mesh receives the surface, must not be null
+     * @param computeNormals also compute per-vertex normals from the gradient
+     */
+    VolumeOperatorIsosurface(double isovalue, IsosurfaceMesh* mesh, bool computeNormals = false)
+        : isovalue_(isovalue)
+        , mesh_(mesh)
+        , computeNormals_(computeNormals)
+    {}
+
+private:
+    template<typename T>
+    void apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc);
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    void apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    void apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const;
+
+    /// unsupported volume format, throws exception
+    template<typename S>
+    void apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const;
+
+    double isovalue_;
+    IsosurfaceMesh* mesh_;
+    bool computeNormals_;
+};
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Implementation
@@ -532,93 +859,49 @@ template<class Derived> VolumeOperatorUnary<Derived>::~VolumeOperatorUnary() {}
 template<class Derived> template<typename ReturnValue>
 ReturnValue VolumeOperatorUnary<Derived>::apply(Volume* volume) const {
     const Derived* const d = static_cast<const Derived* const>(this);
+    return dispatchVolumeFormat(volume, ApplyVisitor<ReturnValue>(d, volume));
+}
 
-    // This is really ugly but there seems to be no other possibility due
-    // to lack of virtual template methods and the needs for a common
-    // non-template base class for all kinds of volume classes... (df)
-    //
-    // Made even uglier by gcc 4.4.0 requiring VolumeAtomic<uint8_t> instead of VolumeUInt8
-    // (yes, it is just a typedef!) when compiling with -O2, or linker errors will appear. joerg
-    if (VolumeUInt8* v = dynamic_cast<VolumeUInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<uint8_t>* v = dynamic_cast<VolumeAtomic<uint8_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeUInt16* v = dynamic_cast<VolumeUInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<uint16_t>* v = dynamic_cast<VolumeAtomic<uint16_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeUInt32* v = dynamic_cast<VolumeUInt32*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<uint32_t>* v = dynamic_cast<VolumeAtomic<uint32_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeInt8* v = dynamic_cast<VolumeInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<int8_t>* v = dynamic_cast<VolumeAtomic<int8_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeInt16* v = dynamic_cast<VolumeInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<int16_t>* v = dynamic_cast<VolumeAtomic<int16_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeInt32* v = dynamic_cast<VolumeInt32*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<int32_t>* v = dynamic_cast<VolumeAtomic<int32_t>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeFloat* v = dynamic_cast<VolumeFloat*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<float>* v = dynamic_cast<VolumeAtomic<float>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeDouble* v = dynamic_cast<VolumeDouble*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<double>* v = dynamic_cast<VolumeAtomic<double>*>(volume))
-        return ReturnValue(d->apply_internal(v));
-
-    /*else if (Volume2xUInt16* v = dynamic_cast<Volume2xUInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume2xInt16* v = dynamic_cast<Volume2xInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume3xUInt8* v = dynamic_cast<Volume3xUInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume3xInt8* v = dynamic_cast<Volume3xInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume3xUInt16* v = dynamic_cast<Volume3xUInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume3xInt16* v = dynamic_cast<Volume3xInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));*/
-
-    else if (Volume3xFloat* v = dynamic_cast<Volume3xFloat*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<tgt::Vector3<float> >* v = dynamic_cast<VolumeAtomic<tgt::Vector3<float> >*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume3xDouble* v = dynamic_cast<Volume3xDouble*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<tgt::Vector3<double> >* v = dynamic_cast<VolumeAtomic<tgt::Vector3<double> >*>(volume))
-        return ReturnValue(d->apply_internal(v));
-
-    /*else if (Volume4xUInt8* v = dynamic_cast<Volume4xUInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume4xInt8* v = dynamic_cast<Volume4xInt8*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume4xUInt16* v = dynamic_cast<Volume4xUInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume4xInt16* v = dynamic_cast<Volume4xInt16*>(volume))
-        return ReturnValue(d->apply_internal(v));*/
-
-    else if (Volume4xFloat* v = dynamic_cast<Volume4xFloat*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<tgt::Vector4<float> >* v = dynamic_cast<VolumeAtomic<tgt::Vector4<float> >*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (Volume4xDouble* v = dynamic_cast<Volume4xDouble*>(volume))
-        return ReturnValue(d->apply_internal(v));
-    else if (VolumeAtomic<tgt::Vector4<double> >* v = dynamic_cast<VolumeAtomic<tgt::Vector4<double> >*>(volume))
-        return ReturnValue(d->apply_internal(v));
-#ifdef VRN_MODULE_FLOWREEN
-    else if (VolumeFlow3D* v = dynamic_cast<VolumeFlow3D*>(volume))
-        return ReturnValue(d->apply_internal(v));
-#endif
-    else
-        throw VolumeOperatorUnsupportedTypeException(typeid(volume).name());
+template<class Derived> template<typename ReturnValue>
+void VolumeOperatorUnary<Derived>::applyBatch(const std::vector<Volume*>& volumes,
+                                              std::vector<ReturnValue>& results) const {
+    const Derived* const d = static_cast<const Derived* const>(this);
+    results.reserve(results.size() + volumes.size());
+    for (size_t begin = 0, end = 0; begin < volumes.size(); begin = end) {
+        end = endOfFormatRun(volumes, begin);
+        dispatchVolumeFormat(volumes[begin], BatchVisitor<ReturnValue>(d, &volumes[begin], &volumes[0] + end, &results));
+    }
+}
+
+template<class Derived>
+void VolumeOperatorUnary<Derived>::applyBatch(const std::vector<Volume*>& volumes) const {
+    const Derived* const d = static_cast<const Derived* const>(this);
+    for (size_t begin = 0, end = 0; begin < volumes.size(); begin = end) {
+        end = endOfFormatRun(volumes, begin);
+        dispatchVolumeFormat(volumes[begin], DiscardingBatchVisitor(d, &volumes[begin], &volumes[0] + end));
+    }
+}
+
+template<class Derived> template<typename ReturnValue>
+void VolumeOperatorUnary<Derived>::applyBatch(const VolumeCollection* collection,
+                                              std::vector<ReturnValue>& results) const {
+    applyBatch(getCollectionVolumes(collection), results);
+}
 
-    return ReturnValue(0);
+template<class Derived>
+void VolumeOperatorUnary<Derived>::applyBatch(const VolumeCollection* collection) const {
+    applyBatch(getCollectionVolumes(collection));
+}
+
+template<class Derived>
+size_t VolumeOperatorUnary<Derived>::endOfFormatRun(const std::vector<Volume*>& volumes, size_t begin) {
+    size_t end = begin + 1;
+    if (volumes[begin]) {
+        Volume::FormatId format = volumes[begin]->getFormatId();
+        while (end < volumes.size() && volumes[end] && volumes[end]->getFormatId() == format)
+            end++;
+    }
+    return end;
 }
 
 //
@@ -629,79 +912,17 @@ template<class Derived> VolumeOperatorBinary<Derived>::~VolumeOperatorBinary() {
 
 template<class Derived> template<typename ReturnValue>
 ReturnValue VolumeOperatorBinary<Derived>::apply(Volume* v1, Volume* v2) const {
-    if (typeid(*v1) != typeid(*v2))
+    if (v1 && v2 && v1->getFormatId() != v2->getFormatId())
         throw VoreenException("VolumeOperatorBinary expects identical volume types, got: '"
                               + std::string(typeid(*v1).name()) + "' and '"
                               + std::string(typeid(*v2).name()) + "'.");
+    if (!v2)
+        throw VolumeOperatorUnsupportedTypeException();
 
     const Derived* const d = static_cast<const Derived* const>(this);
-
-    // This is just an adaptation of VolumeOperatorUnary<Derived>::apply().
-    if (VolumeUInt8* v = dynamic_cast<VolumeUInt8*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeUInt8*>(v2)));
-    else if (VolumeAtomic<uint8_t>* v = dynamic_cast<VolumeAtomic<uint8_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<uint8_t>*>(v2)));
-    else if (VolumeUInt16* v = dynamic_cast<VolumeUInt16*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeUInt16*>(v2)));
-    else if (VolumeAtomic<uint16_t>* v = dynamic_cast<VolumeAtomic<uint16_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<uint16_t>*>(v2)));
-    else if (VolumeUInt32* v = dynamic_cast<VolumeUInt32*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeUInt32*>(v2)));
-    else if (VolumeAtomic<uint32_t>* v = dynamic_cast<VolumeAtomic<uint32_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<uint32_t>*>(v2)));
-    else if (VolumeInt8* v = dynamic_cast<VolumeInt8*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeInt8*>(v2)));
-    else if (VolumeAtomic<int8_t>* v = dynamic_cast<VolumeAtomic<int8_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<int8_t>*>(v2)));
-    else if (VolumeInt16* v = dynamic_cast<VolumeInt16*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeInt16*>(v2)));
-    else if (VolumeAtomic<int16_t>* v = dynamic_cast<VolumeAtomic<int16_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<int16_t>*>(v2)));
-    else if (VolumeInt32* v = dynamic_cast<VolumeInt32*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeInt32*>(v2)));
-    else if (VolumeAtomic<int32_t>* v = dynamic_cast<VolumeAtomic<int32_t>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<int32_t>*>(v2)));
-    else if (VolumeFloat* v = dynamic_cast<VolumeFloat*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeFloat*>(v2)));
-    else if (VolumeAtomic<float>* v = dynamic_cast<VolumeAtomic<float>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<float>*>(v2)));
-    else if (VolumeDouble* v = dynamic_cast<VolumeDouble*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeDouble*>(v2)));
-    else if (VolumeAtomic<double>* v = dynamic_cast<VolumeAtomic<double>*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<double>*>(v2)));
-
-    else if (Volume3xFloat* v = dynamic_cast<Volume3xFloat*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<Volume3xFloat*>(v2)));
-    else if (VolumeAtomic<tgt::Vector3<float> >* v = dynamic_cast<VolumeAtomic<tgt::Vector3<float> >*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<tgt::Vector3<float> >*>(v2)));
-    else if (Volume3xDouble* v = dynamic_cast<Volume3xDouble*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<Volume3xDouble*>(v2)));
-    else if (VolumeAtomic<tgt::Vector3<double> >* v = dynamic_cast<VolumeAtomic<tgt::Vector3<double> >*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<tgt::Vector3<double> >*>(v2)));
-
-    else if (Volume4xFloat* v = dynamic_cast<Volume4xFloat*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<Volume4xFloat*>(v2)));
-    else if (VolumeAtomic<tgt::Vector4<float> >* v = dynamic_cast<VolumeAtomic<tgt::Vector4<float> >*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<tgt::Vector4<float> >*>(v2)));
-    else if (Volume4xDouble* v = dynamic_cast<Volume4xDouble*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<Volume4xDouble*>(v2)));
-    else if (VolumeAtomic<tgt::Vector4<double> >* v = dynamic_cast<VolumeAtomic<tgt::Vector4<double> >*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeAtomic<tgt::Vector4<double> >*>(v2)));
-#ifdef VRN_MODULE_FLOWREEN
-    else if (VolumeFlow3D* v = dynamic_cast<VolumeFlow3D*>(v1))
-        return ReturnValue(d->apply_internal(v, dynamic_cast<VolumeFlow3D*>(v1)));
-#endif
-    else
-        throw VolumeOperatorUnsupportedTypeException(typeid(v1).name());
-
-    // we have a problem here, no cast was successfull
-    throw VolumeOperatorUnsupportedTypeException(typeid(v1).name());
-
-    return ReturnValue(0);
+    return dispatchVolumeFormat(v1, ApplyVisitor<ReturnValue>(d, v1, v2));
 }
 
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // Implementation of the operators
 ///////////////////////////////////////////////////////////////////////////////
@@ -766,11 +987,8 @@ VolumeAtomic<T>* VolumeOperatorResample::apply_internal(VolumeAtomic<T>* volume)
 
     LINFOC("voreen.VolumeOperatorResample", "Resampling from dimensions " << volume->getDimensions() << " to " << newDims_);
 
-    vec3 ratio = vec3(volume->getDimensions()) / vec3(newDims_);
-    vec3 invDims = 1.f / vec3(volume->getDimensions());
-
-    ivec3 pos = ivec3::zero; // iteration variable
-    vec3 nearest; // knows the new position of the target volume
+    ivec3 dims = volume->getDimensions();
+    vec3 ratio = vec3(dims) / vec3(newDims_);
 
     // build target volume
     VolumeAtomic<T>* v;
@@ -787,67 +1005,12 @@ VolumeAtomic<T>* VolumeOperatorResample::apply_internal(VolumeAtomic<T>* volume)
     if (progressBar_)
         progressBar_->setProgress(0.f);
 
-    /*
-        Filter from the source volume to the target volume.
-    */
-    switch (filter_) {
-    case Volume::NEAREST:
-        for (pos.z = 0; pos.z < newDims_.z; ++pos.z) {
-
-            if (progressBar_)
-                progressBar_->setProgress(static_cast<float>(pos.z) / static_cast<float>(newDims_.z));
-
-            nearest.z = static_cast<float>(pos.z) * ratio.z;
-
-            for (pos.y = 0; pos.y < newDims_.y; ++pos.y) {
-                nearest.y = static_cast<float>(pos.y) * ratio.y;
-
-                for (pos.x = 0; pos.x < newDims_.x; ++pos.x) {
-                    nearest.x = static_cast<float>(pos.x) * ratio.x;
-
-                    ivec3 index = tgt::clamp(ivec3(nearest + 0.5f), ivec3(0), volume->getDimensions() - 1);
-                    v->voxel(pos) = volume->voxel(index); // round and do the lookup
-                }
-            }
-        }
-        break;
-
-    case Volume::LINEAR:
-        for (pos.z = 0; pos.z < newDims_.z; ++pos.z) {
-
-            if (progressBar_)
-                progressBar_->setProgress(static_cast<float>(pos.z) / static_cast<float>(newDims_.z));
-
-            nearest.z = static_cast<float>(pos.z) * ratio.z;
-
-            for (pos.y = 0; pos.y < newDims_.y; ++pos.y) {
-                nearest.y = static_cast<float>(pos.y) * ratio.y;
-
-                for (pos.x = 0; pos.x < newDims_.x; ++pos.x) {
-                    nearest.x = static_cast<float>(pos.x) * ratio.x;
-                    vec3 p = nearest - floor(nearest); // get decimal part
-                    ivec3 llb = ivec3(nearest);
-                    ivec3 urf = ivec3(ceil(nearest));
-                    urf = tgt::min(urf, volume->getDimensions() - 1); // clamp so the lookups do not exceed the dimensions
-
-                    /*
-                      interpolate linearly
-                    */
-                    typedef typename VolumeElement<T>::DoubleType Double;
-                    v->voxel(pos) =
-                        T(  Double(volume->voxel(llb.x, llb.y, llb.z)) * static_cast<double>((1.f-p.x)*(1.f-p.y)*(1.f-p.z))  // llB
-                          + Double(volume->voxel(urf.x, llb.y, llb.z)) * static_cast<double>((    p.x)*(1.f-p.y)*(1.f-p.z))  // lrB
-                          + Double(volume->voxel(urf.x, urf.y, llb.z)) * static_cast<double>((    p.x)*(    p.y)*(1.f-p.z))  // urB
-                          + Double(volume->voxel(llb.x, urf.y, llb.z)) * static_cast<double>((1.f-p.x)*(    p.y)*(1.f-p.z))  // ulB
-                          + Double(volume->voxel(llb.x, llb.y, urf.z)) * static_cast<double>((1.f-p.x)*(1.f-p.y)*(    p.z))  // llF
-                          + Double(volume->voxel(urf.x, llb.y, urf.z)) * static_cast<double>((    p.x)*(1.f-p.y)*(    p.z))  // lrF
-                          + Double(volume->voxel(urf.x, urf.y, urf.z)) * static_cast<double>((    p.x)*(    p.y)*(    p.z))  // urF
-                          + Double(volume->voxel(llb.x, urf.y, urf.z)) * static_cast<double>((1.f-p.x)*(    p.y)*(    p.z)));// ulF
-                }
-            }
-        }
-        break;
-    }
+    // Sample positions and weights are the same for every row, so they are computed once per axis
+    resampleSeparable(volume, v,
+                      ResampleAxis::resample(dims.x, newDims_.x, filter_),
+                      ResampleAxis::resample(dims.y, newDims_.y, filter_),
+                      ResampleAxis::resample(dims.z, newDims_.z, filter_),
+                      progressBar_);
 
     if (progressBar_)
         progressBar_->setProgress(1.f);
@@ -859,24 +1022,17 @@ VolumeAtomic<T>* VolumeOperatorResample::apply_internal(VolumeAtomic<T>* volume)
 
 template<typename T>
 VolumeAtomic<T>* VolumeOperatorHalfsample::apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc) {
-    tgt::ivec3 dims = volume->getDimensions();
     tgt::ivec3 halfDims = volume->getDimensions() / 2;
 
     VolumeAtomic<T>* newVolume = new VolumeAtomic<T>(halfDims, volume->getSpacing()*2.f,
         volume->getTransformation(), volume->getBitsStored());
 
-    typedef typename VolumeElement<T>::DoubleType Double;
-    VRN_FOR_EACH_VOXEL_WITH_PROGRESS(index, tgt::ivec3(0), halfDims, progressBar_) {
-        tgt::ivec3 pos = index*2; // tgt::ivec3(2*x,2*y,2*z);
-        newVolume->voxel(index) =
-            T(  Double(volume->voxel(pos.x, pos.y, pos.z))          * (1.0/8.0) //LLF
-              + Double(volume->voxel(pos.x, pos.y, pos.z+1))        * (1.0/8.0) //LLB
-              + Double(volume->voxel(pos.x, pos.y+1, pos.z))        * (1.0/8.0) //ULF
-              + Double(volume->voxel(pos.x, pos.y+1, pos.z+1))      * (1.0/8.0) //ULB
-              + Double(volume->voxel(pos.x+1, pos.y, pos.z))        * (1.0/8.0) //LRF
-              + Double(volume->voxel(pos.x+1, pos.y, pos.z+1))      * (1.0/8.0) //LRB
-              + Double(volume->voxel(pos.x+1, pos.y+1, pos.z))      * (1.0/8.0) //URF
-              + Double(volume->voxel(pos.x+1, pos.y+1, pos.z+1))    * (1.0/8.0)); //URB
+    // Slabs of a few slices, each computed by all threads
+    const int slab = 8;
+    for (int z = 0; z < halfDims.z; z += slab) {
+        if (progressBar_)
+            progressBar_->setProgress(static_cast<float>(z) / static_cast<float>(halfDims.z));
+        halfsampleSlices(volume, newVolume, z, std::min(z + slab, halfDims.z));
     }
     if (progressBar_)
         progressBar_->setProgress(1.f);
@@ -886,6 +1042,48 @@ VolumeAtomic<T>* VolumeOperatorHalfsample::apply_internal(VolumeAtomic<T>* volum
 
 // ============================================================================
 
+template<typename T>
+std::vector<Volume*> VolumeOperatorMipPyramid::apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc) {
+    std::vector<VolumeAtomic<T>*> levels(1, volume);
+    tgt::ivec3 dims = volume->getDimensions() / 2;
+    try {
+        while (tgt::min(dims) >= 1 && (maxLevels_ <= 0 || static_cast<int>(levels.size()) <= maxLevels_)) {
+            const VolumeAtomic<T>* parent = levels.back();
+            levels.push_back(new VolumeAtomic<T>(dims, parent->getSpacing()*2.f,
+                                                 volume->getTransformation(), volume->getBitsStored()));
+            dims /= 2;
+        }
+    }
+    catch (std::bad_alloc) {
+        for (size_t l = 1; l < levels.size(); l++)
+            delete levels[l];
+        throw;
+    }
+
+    // A finished odd slice of level l completes the slice of level l + 1 built from it
+    // and its predecessor, so the input is read exactly once.
+    const int depth = (levels.size() > 1) ? levels[1]->getDimensions().z : 0;
+    for (int z = 0; z < depth; z++) {
+        if (progressBar_)
+            progressBar_->setProgress(static_cast<float>(z) / static_cast<float>(depth));
+
+        halfsampleSlices(levels[0], levels[1], z, z + 1);
+        int slice = z;
+        for (size_t l = 1; l + 1 < levels.size() && slice % 2 == 1; l++) {
+            slice /= 2;
+            if (slice >= levels[l + 1]->getDimensions().z)
+                break;
+            halfsampleSlices(levels[l], levels[l + 1], slice, slice + 1);
+        }
+    }
+    if (progressBar_)
+        progressBar_->setProgress(1.f);
+
+    return std::vector<Volume*>(levels.begin() + 1, levels.end());
+}
+
+// ============================================================================
+
 template<typename T>
 void VolumeOperatorConvert::apply_internal(VolumeAtomic<T>* destVolume) const {
 
@@ -1275,203 +1473,192 @@ size_t VolumeOperatorNumSignificant::apply_internal(VolumeAtomic<tgt::Vector4<S>
 
 template<typename T>
 void VolumeOperatorDilation::apply_internal(VolumeAtomic<T>* volume) const {
-    VolumeAtomic<T>* input = volume->clone();
-
-    int halfKernelDim = kernelSize_ / 2;
-    tgt::ivec3 volDim = input->getDimensions();
-
-    // kernel is separable => consecutively apply 1D kernel along each axis instead of a 3D kernel
-
-    // x-direction (inputVol -> outputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int xmin = std::max(pos.x-halfKernelDim, 0);
-        int xmax = std::min(pos.x+halfKernelDim, volDim.x-1);
-
-        T val = input->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.x=xmin; npos.x<=xmax; npos.x++) {
-            val = std::max(val, input->voxel(npos));
-        }
-        volume->voxel(pos) = val;
-    }
-
-    // y-direction (outputVol -> inputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int ymin = std::max(pos.y-halfKernelDim, 0);
-        int ymax = std::min(pos.y+halfKernelDim, volDim.y-1);
+    // kernel is separable => running maximum along each axis, in place
+    morphologyFilter<T, MorphologyMax<T> >(volume, kernelSize_ / 2, progressBar_);
+    volume->invalidate();
+}
 
-        T val = volume->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.y=ymin; npos.y<=ymax; npos.y++) {
-            val = std::max(val, volume->voxel(npos));
-        }
-        input->voxel(pos) = val;
-    }
+// specialized template version for tgt::VectorX classes which do no implement operator>().
 
-    // z-direction (inputVol -> outputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int zmin = std::max(pos.z-halfKernelDim, 0);
-        int zmax = std::min(pos.z+halfKernelDim, volDim.z-1);
+template<typename S>
+void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-        T val = input->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.z=zmin; npos.z<=zmax; npos.z++) {
-            val = std::max(val, input->voxel(npos));
-        }
-        volume->voxel(pos) = val;
-    }
+template<typename S>
+void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-    delete input;
+template<typename S>
+void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-    if (progressBar_)
-        progressBar_->setProgress(1.f);
+// ============================================================================
 
+template<typename T>
+void VolumeOperatorErosion::apply_internal(VolumeAtomic<T>* volume) const {
+    // kernel is separable => running minimum along each axis, in place
+    morphologyFilter<T, MorphologyMin<T> >(volume, kernelSize_ / 2, progressBar_);
     volume->invalidate();
 }
 
 // specialized template version for tgt::VectorX classes which do no implement operator>().
 
 template<typename S>
-void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorDilation::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 // ============================================================================
 
 template<typename T>
-void VolumeOperatorErosion::apply_internal(VolumeAtomic<T>* volume) const {
-    VolumeAtomic<T>* input = volume->clone();
+void VolumeOperatorMedian::apply_internal(VolumeAtomic<T>* volume) const {
+    medianFilter(volume, kernelSize_ / 2, progressBar_);
+    volume->invalidate();
+}
 
-    int halfKernelDim = kernelSize_ / 2;
-    tgt::ivec3 volDim = input->getDimensions();
+// specialized template version for tgt::VectorX classes which do no implement operator>().
 
-    // kernel is separable => consecutively apply 1D kernel along each axis instead of a 3D kernel
+template<typename S>
+void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-    // x-direction (inputVol -> outputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int xmin = std::max(pos.x-halfKernelDim, 0);
-        int xmax = std::min(pos.x+halfKernelDim, volDim.x-1);
+template<typename S>
+void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-        T val = input->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.x=xmin; npos.x<=xmax; npos.x++) {
-            val = std::min(val, input->voxel(npos));
-        }
-        volume->voxel(pos) = val;
-    }
+template<typename S>
+void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-    // y-direction (outputVol -> inputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int ymin = std::max(pos.y-halfKernelDim, 0);
-        int ymax = std::min(pos.y+halfKernelDim, volDim.y-1);
+// ============================================================================
 
-        T val = volume->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.y=ymin; npos.y<=ymax; npos.y++) {
-            val = std::min(val, volume->voxel(npos));
-        }
-        input->voxel(pos) = val;
+template<typename T>
+Volume* VolumeOperatorDistanceTransform::apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc) {
+    const tgt::ivec3 dims = volume->getDimensions();
+    VolumeUInt32* features = 0;
+    if (featureTransform_) {
+        features = new VolumeUInt32(dims, volume->getSpacing(), volume->getTransformation());
+        *featureTransform_ = features;
     }
+    uint32_t* featureData = features ? features->voxel() : 0;
 
-    // z-direction (inputVol -> outputVol)
-    VRN_FOR_EACH_VOXEL(pos, tgt::ivec3(0), volDim) {
-        int zmin = std::max(pos.z-halfKernelDim, 0);
-        int zmax = std::min(pos.z+halfKernelDim, volDim.z-1);
+    try {
+        if (format_ == DISTANCE_SQUARED_UINT32) {
+            VolumeUInt32* distances = new VolumeUInt32(dims, volume->getSpacing(), volume->getTransformation());
+            distanceTransform(volume, siteThreshold_, distances->voxel(), featureData, tgt::dvec3(1.0), progressBar_);
+            return distances;
+        }
 
-        T val = input->voxel(pos);
-        tgt::ivec3 npos = pos;
-        for (npos.z=zmin; npos.z<=zmax; npos.z++) {
-            val = std::min(val, input->voxel(npos));
+        tgt::dvec3 weights(1.0);
+        if (useSpacing_) {
+            tgt::dvec3 spacing(volume->getSpacing());
+            weights = spacing * spacing;
         }
-        volume->voxel(pos) = val;
+        VolumeFloat* distances = new VolumeFloat(dims, volume->getSpacing(), volume->getTransformation());
+        float* data = distances->voxel();
+        distanceTransform(volume, siteThreshold_, data, featureData, weights, progressBar_);
+
+        const ptrdiff_t numVoxels = static_cast<ptrdiff_t>(distances->getNumVoxels());
+        const float none = std::numeric_limits<float>::max();
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+        #endif
+        for (ptrdiff_t i = 0; i < numVoxels; i++) {
+            if (data[i] != none)
+                data[i] = std::sqrt(data[i]);
+        }
+        return distances;
+    }
+    catch (std::bad_alloc&) {
+        delete features;
+        if (featureTransform_)
+            *featureTransform_ = 0;
+        throw;
     }
-
-    delete input;
-
-    if (progressBar_)
-        progressBar_->setProgress(1.f);
-
-    volume->invalidate();
 }
 
-// specialized template version for tgt::VectorX classes which do no implement operator>().
-
 template<typename S>
-void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+Volume* VolumeOperatorDistanceTransform::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+Volume* VolumeOperatorDistanceTransform::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorErosion::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+Volume* VolumeOperatorDistanceTransform::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 // ============================================================================
 
 template<typename T>
-void VolumeOperatorMedian::apply_internal(VolumeAtomic<T>* volume) const {
-    VolumeAtomic<T>* input = volume->clone();
-
-    int halfKernelDim = kernelSize_ / 2;
-    tgt::ivec3 volDim = input->getDimensions();
-    VRN_FOR_EACH_VOXEL_WITH_PROGRESS(pos, tgt::ivec3(0), volDim, progressBar_) {
-        int zmin = std::max(pos.z-halfKernelDim, 0);
-        int zmax = std::min(pos.z+halfKernelDim, volDim.z-1);
-        int ymin = std::max(pos.y-halfKernelDim, 0);
-        int ymax = std::min(pos.y+halfKernelDim, volDim.y-1);
-        int xmin = std::max(pos.x-halfKernelDim, 0);
-        int xmax = std::min(pos.x+halfKernelDim, volDim.x-1);
-
-        tgt::ivec3 npos;
-        std::vector<T> values;
-        for (npos.z=zmin; npos.z<=zmax; npos.z++) {
-            for (npos.y=ymin; npos.y<=ymax; npos.y++) {
-                for (npos.x=xmin; npos.x<=xmax; npos.x++) {
-                    values.push_back(input->voxel(npos));
-                }
-            }
-        }
-        size_t len = values.size();
-        nth_element(values.begin(), values.begin()+(len/2), values.end());
-        volume->voxel(pos) = values[len / 2];
+Volume* VolumeOperatorConnectedComponents::apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc, VoreenException) {
+    ConnectedComponentLabeling::checkDimensions(volume->getDimensions());
+    VolumeUInt32* labels = new VolumeUInt32(volume->getDimensions(), volume->getSpacing(), volume->getTransformation());
+    try {
+        labeling_.label(volume, labels->voxel(), components_, progressBar_);
+    }
+    catch (...) {
+        delete labels;
+        throw;
     }
-    delete input;
+    return labels;
+}
 
-    if (progressBar_)
-        progressBar_->setProgress(1.f);
+template<typename S>
+Volume* VolumeOperatorConnectedComponents::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
 
-    volume->invalidate();
+template<typename S>
+Volume* VolumeOperatorConnectedComponents::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
-// specialized template version for tgt::VectorX classes which do no implement operator>().
+template<typename S>
+Volume* VolumeOperatorConnectedComponents::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
+
+// ============================================================================
+
+template<typename T>
+void VolumeOperatorIsosurface::apply_internal(VolumeAtomic<T>* volume) const throw (std::bad_alloc) {
+    tgtAssert(mesh_, "No mesh");
+    MarchingCubes::extract(volume, isovalue_, *mesh_, computeNormals_, progressBar_);
+}
 
 template<typename S>
-void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
+void VolumeOperatorIsosurface::apply_internal(VolumeAtomic<tgt::Vector2<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
+void VolumeOperatorIsosurface::apply_internal(VolumeAtomic<tgt::Vector3<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
 template<typename S>
-void VolumeOperatorMedian::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
+void VolumeOperatorIsosurface::apply_internal(VolumeAtomic<tgt::Vector4<S> >* volume) const {
     throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
 }
 
@@ -0,0 +1,500 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+#ifndef VRN_VOLUMERESAMPLING_H
+#define VRN_VOLUMERESAMPLING_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/io/progressbar.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace voreen {
+
+/**
+ * Arithmetic used by the resampling engine for a voxel type. 8 and 16-bit
+ * integers and floats are interpolated in single precision and integers are
+ * rounded to the nearest value; every other type uses the double precision
+ * VolumeElement<T>::DoubleType.
+ */
+template<class T>
+struct ResampleTraits {
+    typedef typename VolumeElement<T>::DoubleType Accum;
+    typedef double Weight;
+
+    static T store(const Accum& value) {
+        return T(value);
+    }
+};
+
+template<>
+struct ResampleTraits<uint8_t> {
+    typedef float Accum;
+    typedef float Weight;
+
+    static uint8_t store(float value) {
+        return static_cast<uint8_t>(std::min(std::max(value, 0.f), 255.f) + 0.5f);
+    }
+};
+
+template<>
+struct ResampleTraits<uint16_t> {
+    typedef float Accum;
+    typedef float Weight;
+
+    static uint16_t store(float value) {
+        return static_cast<uint16_t>(std::min(std::max(value, 0.f), 65535.f) + 0.5f);
+    }
+};
+
+template<>
+struct ResampleTraits<int8_t> {
+    typedef float Accum;
+    typedef float Weight;
+
+    static int8_t store(float value) {
+        return static_cast<int8_t>(std::floor(std::min(std::max(value, -128.f), 127.f) + 0.5f));
+    }
+};
+
+template<>
+struct ResampleTraits<int16_t> {
+    typedef float Accum;
+    typedef float Weight;
+
+    static int16_t store(float value) {
+        return static_cast<int16_t>(std::floor(std::min(std::max(value, -32768.f), 32767.f) + 0.5f));
+    }
+};
+
+template<>
+struct ResampleTraits<float> {
+    typedef float Accum;
+    typedef float Weight;
+
+    static float store(float value) {
+        return value;
+    }
+};
+
+/**
+ * Precomputed lookup for one axis of a separable resampling: output sample i
+ * is lo[i] * (1 - weight[i]) + hi[i] * weight[i] of the source samples.
+ */
+struct ResampleAxis {
+    std::vector<int> lo;
+    std::vector<int> hi;
+    std::vector<float> weight;
+    /// false if all weights are zero, i.e. the axis only picks samples
+    bool interpolating;
+
+    int size() const {
+        return static_cast<int>(lo.size());
+    }
+
+    /**
+     * Sampling of VolumeOperatorResample: output sample i is taken at source
+     * position i * srcDim / dstDim, rounded for NEAREST.
+     */
+    static ResampleAxis resample(int srcDim, int dstDim, Volume::Filter filter) {
+        ResampleAxis axis;
+        axis.interpolating = false;
+        float ratio = static_cast<float>(srcDim) / static_cast<float>(dstDim);
+        for (int i = 0; i < dstDim; i++) {
+            float pos = static_cast<float>(i) * ratio;
+            if (filter == Volume::NEAREST) {
+                int nearest = std::min(std::max(static_cast<int>(pos + 0.5f), 0), srcDim - 1);
+                axis.push(nearest, nearest, 0.f);
+            }
+            else {
+                int lower = std::min(static_cast<int>(pos), srcDim - 1);
+                int upper = std::min(static_cast<int>(std::ceil(pos)), srcDim - 1);
+                axis.push(lower, upper, pos - std::floor(pos));
+            }
+        }
+        return axis;
+    }
+
+    /// 2:1 box filter of VolumeOperatorHalfsample, a trailing odd sample is dropped
+    static ResampleAxis halfsample(int srcDim) {
+        ResampleAxis axis;
+        axis.interpolating = false;
+        for (int i = 0; i < srcDim / 2; i++)
+            axis.push(2*i, 2*i + 1, 0.5f);
+        return axis;
+    }
+
+private:
+    void push(int l, int h, float w) {
+        lo.push_back(l);
+        hi.push_back(h);
+        weight.push_back(w);
+        interpolating |= (w != 0.f && l != h);
+    }
+};
+
+/**
+ * Progress of iteration i of n of a statically scheduled OpenMP loop, reported
+ * by the master thread only since progress bars are not thread-safe.
+ */
+inline void setLoopProgress(ProgressBar* progress, int i, int n) {
+    if (!progress)
+        return;
+#ifdef _OPENMP
+    if (omp_get_thread_num() == 0)
+        progress->setProgress(std::min(static_cast<float>(i + 1) * omp_get_num_threads() / n, 1.f));
+#else
+    progress->setProgress(static_cast<float>(i + 1) / n);
+#endif
+}
+
+//
+// Row kernels. The float and 8/16-bit versions are vectorized.
+//
+
+/// out = a * (1 - w) + b * w
+template<typename Accum, typename Weight>
+inline void blendRows(const Accum* a, const Accum* b, Weight w, Accum* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = a[i] * (Weight(1) - w) + b[i] * w;
+}
+
+inline void blendRows(const float* a, const float* b, float w, float* out, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 wb = _mm_set1_ps(w);
+    const __m128 wa = _mm_set1_ps(1.f - w);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), wa), _mm_mul_ps(_mm_loadu_ps(b + i), wb)));
+#endif
+    for (; i < n; i++)
+        out[i] = a[i] * (1.f - w) + b[i] * w;
+}
+
+/// Converts interpolated values back to voxels
+template<typename T>
+inline void storeRow(const typename ResampleTraits<T>::Accum* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = ResampleTraits<T>::store(in[i]);
+}
+
+template<>
+inline void storeRow<uint8_t>(const float* in, uint8_t* out, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 lo = _mm_setzero_ps();
+    const __m128 hi = _mm_set1_ps(255.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi), half));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi), half));
+        __m128i words = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = ResampleTraits<uint8_t>::store(in[i]);
+}
+
+#ifdef __SSE2__
+/// Packs eight int32 in [0, 65535] to uint16 without SSE4.1's packus_epi32
+inline __m128i packUnsigned16(__m128i a, __m128i b) {
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32)), bias16);
+}
+#endif
+
+template<>
+inline void storeRow<uint16_t>(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 lo = _mm_setzero_ps();
+    const __m128 hi = _mm_set1_ps(65535.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi), half));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi), half));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packUnsigned16(a, b));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = ResampleTraits<uint16_t>::store(in[i]);
+}
+
+/**
+ * 2x2x2 box filter of two source slices into one output row: out[x] is the mean
+ * of the voxels (2x..2x+1, 2y..2y+1) of s0 and s1, n outputs.
+ */
+template<typename T>
+inline void halfsampleRow(const T* s0, const T* s1, size_t rowStride, T* out, size_t n) {
+    typedef typename ResampleTraits<T>::Accum Accum;
+    typedef typename ResampleTraits<T>::Weight Weight;
+    const T* rows[4] = { s0, s0 + rowStride, s1, s1 + rowStride };
+    for (size_t i = 0; i < n; i++) {
+        Accum sum = Accum(rows[0][2*i]);
+        sum = sum + Accum(rows[0][2*i + 1]);
+        for (int r = 1; r < 4; r++)
+            sum = sum + Accum(rows[r][2*i]) + Accum(rows[r][2*i + 1]);
+        out[i] = ResampleTraits<T>::store(sum * Weight(0.125));
+    }
+}
+
+template<>
+inline void halfsampleRow<uint8_t>(const uint8_t* s0, const uint8_t* s1, size_t rowStride, uint8_t* out, size_t n) {
+    const uint8_t* rows[4] = { s0, s0 + rowStride, s1, s1 + rowStride };
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi32(4);
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = zero;
+        __m128i hi = zero;
+        for (int r = 0; r < 4; r++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 2*i));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+        }
+        // Horizontal pairs, then the mean rounded up at .5
+        __m128i a = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(lo, ones), round), 3);
+        __m128i b = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(hi, ones), round), 3);
+        __m128i words = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+#endif
+    for (; i < n; i++) {
+        int sum = 0;
+        for (int r = 0; r < 4; r++)
+            sum += rows[r][2*i] + rows[r][2*i + 1];
+        out[i] = static_cast<uint8_t>((sum + 4) >> 3);
+    }
+}
+
+template<>
+inline void halfsampleRow<uint16_t>(const uint16_t* s0, const uint16_t* s1, size_t rowStride, uint16_t* out, size_t n) {
+    const uint16_t* rows[4] = { s0, s0 + rowStride, s1, s1 + rowStride };
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(4);
+    for (; i + 8 <= n; i += 8) {
+        __m128i sums[4];
+        for (int half = 0; half < 2; half++) {
+            __m128i lo = zero;
+            __m128i hi = zero;
+            for (int r = 0; r < 4; r++) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 2*i + 8*half));
+                lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(v, zero));
+                hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(v, zero));
+            }
+            // Add the horizontal pairs (0+1, 2+3 | 4+5, 6+7)
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i pairs = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+            sums[half] = _mm_srli_epi32(_mm_add_epi32(pairs, round), 3);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packUnsigned16(sums[0], sums[1]));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t sum = 0;
+        for (int r = 0; r < 4; r++)
+            sum += rows[r][2*i] + rows[r][2*i + 1];
+        out[i] = static_cast<uint16_t>((sum + 4) >> 3);
+    }
+}
+
+/**
+ * Per-thread working set of a separable resampling: source slices are
+ * resampled in x, then in y, into cached planes that are finally blended in z.
+ * Consecutive output slices reuse the cached planes.
+ */
+template<typename T>
+class SeparableResampler {
+public:
+    typedef typename ResampleTraits<T>::Accum Accum;
+    typedef typename ResampleTraits<T>::Weight Weight;
+
+    SeparableResampler(const VolumeAtomic<T>* source, const ResampleAxis& x, const ResampleAxis& y,
+                       const ResampleAxis& z)
+        : source_(source->voxel())
+        , srcDims_(source->getDimensions())
+        , x_(x), y_(y), z_(z)
+        , width_(x.size())
+        , planeSize_(static_cast<size_t>(x.size()) * y.size())
+        , rows_(2 * width_)
+        , planes_(2 * planeSize_)
+        , blended_(width_)
+    {
+        rowKeys_[0] = rowKeys_[1] = -1;
+        planeKeys_[0] = planeKeys_[1] = -1;
+    }
+
+    /// Computes output slice z into out
+    void slice(int z, T* out) {
+        const Accum* a = plane(z_.lo[z]);
+        if (!z_.interpolating || z_.lo[z] == z_.hi[z] || z_.weight[z] == 0.f) {
+            for (int y = 0; y < y_.size(); y++)
+                storeRow<T>(a + y * width_, out + y * width_, width_);
+            return;
+        }
+        const Accum* b = plane(z_.hi[z]);
+        for (int y = 0; y < y_.size(); y++) {
+            blendRows(a + y * width_, b + y * width_, Weight(z_.weight[z]), &blended_[0], width_);
+            storeRow<T>(&blended_[0], out + y * width_, width_);
+        }
+    }
+
+private:
+    /// Source slice sz resampled in x and y
+    const Accum* plane(int sz) {
+        for (int c = 0; c < 2; c++)
+            if (planeKeys_[c] == sz)
+                return &planes_[c * planeSize_];
+
+        // Replace the plane of the lower slice, output slices ascend
+        int c = (planeKeys_[0] <= planeKeys_[1]) ? 0 : 1;
+        planeKeys_[c] = sz;
+        Accum* p = &planes_[c * planeSize_];
+        rowKeys_[0] = rowKeys_[1] = -1;
+        for (int y = 0; y < y_.size(); y++) {
+            const Accum* a = row(sz, y_.lo[y]);
+            if (!y_.interpolating || y_.lo[y] == y_.hi[y] || y_.weight[y] == 0.f) {
+                std::copy(a, a + width_, p + y * width_);
+                continue;
+            }
+            const Accum* b = row(sz, y_.hi[y]);
+            blendRows(a, b, Weight(y_.weight[y]), p + y * width_, width_);
+        }
+        return p;
+    }
+
+    /// Source row (sy, sz) resampled in x
+    const Accum* row(int sz, int sy) {
+        for (int c = 0; c < 2; c++)
+            if (rowKeys_[c] == sy)
+                return &rows_[c * width_];
+
+        int c = (rowKeys_[0] <= rowKeys_[1]) ? 0 : 1;
+        rowKeys_[c] = sy;
+        Accum* r = &rows_[c * width_];
+        const T* src = source_ + (static_cast<size_t>(sz) * srcDims_.y + sy) * srcDims_.x;
+        if (!x_.interpolating) {
+            for (size_t i = 0; i < width_; i++)
+                r[i] = Accum(src[x_.lo[i]]);
+        }
+        else {
+            for (size_t i = 0; i < width_; i++) {
+                Weight w = Weight(x_.weight[i]);
+                r[i] = Accum(src[x_.lo[i]]) * (Weight(1) - w) + Accum(src[x_.hi[i]]) * w;
+            }
+        }
+        return r;
+    }
+
+    const T* source_;
+    tgt::ivec3 srcDims_;
+    const ResampleAxis& x_;
+    const ResampleAxis& y_;
+    const ResampleAxis& z_;
+    size_t width_;
+    size_t planeSize_;
+
+    std::vector<Accum> rows_;
+    int rowKeys_[2];
+    std::vector<Accum> planes_;
+    int planeKeys_[2];
+    std::vector<Accum> blended_;
+};
+
+/**
+ * Resamples source into dest, whose dimensions must match the axis tables.
+ * Output slices are distributed over the OpenMP threads in contiguous slabs.
+ */
+template<typename T>
+void resampleSeparable(const VolumeAtomic<T>* source, VolumeAtomic<T>* dest, const ResampleAxis& x,
+                       const ResampleAxis& y, const ResampleAxis& z, ProgressBar* progress = 0)
+{
+    tgtAssert(dest->getDimensions() == tgt::ivec3(x.size(), y.size(), z.size()), "Axis tables do not match the destination");
+    const size_t sliceSize = static_cast<size_t>(x.size()) * y.size();
+    const int depth = z.size();
+    T* out = dest->voxel();
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        SeparableResampler<T> resampler(source, x, y, z);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int k = 0; k < depth; k++) {
+            resampler.slice(k, out + k * sliceSize);
+            setLoopProgress(progress, k, depth);
+        }
+    }
+}
+
+/**
+ * 2x2x2 box filter of source into dest (dimensions source / 2) for output
+ * slices [zBegin, zEnd). Rows are distributed over the OpenMP threads.
+ */
+template<typename T>
+void halfsampleSlices(const VolumeAtomic<T>* source, VolumeAtomic<T>* dest, int zBegin, int zEnd) {
+    const tgt::ivec3 srcDims = source->getDimensions();
+    const tgt::ivec3 dims = dest->getDimensions();
+    const size_t srcSlice = static_cast<size_t>(srcDims.x) * srcDims.y;
+    const T* in = source->voxel();
+    T* out = dest->voxel();
+    const int rows = (zEnd - zBegin) * dims.y;
+
+    // Small pyramid levels are not worth waking the threads for
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (static_cast<size_t>(rows) * dims.x >= 16384)
+#endif
+    for (int r = 0; r < rows; r++) {
+        int k = zBegin + r / dims.y;
+        int j = r % dims.y;
+        const T* s0 = in + 2 * k * srcSlice + 2 * static_cast<size_t>(j) * srcDims.x;
+        halfsampleRow(s0, s0 + srcSlice, srcDims.x, out + (static_cast<size_t>(k) * dims.y + j) * dims.x, dims.x);
+    }
+}
+
+} // namespace voreen
+
+#endif // VRN_VOLUMERESAMPLING_H
@@ -0,0 +1,142 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#ifndef VRN_VOXELEXPRESSION_H
+#define VRN_VOXELEXPRESSION_H
+
+#include "voreen/core/utils/exception.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace voreen {
+
+/**
+ * An arithmetic expression over the voxel values of several volumes, such as
+ * "max(A, B*C) - d", compiled to a short register program.
+ *
+ * The program is evaluated for a whole scanline at a time: every instruction
+ * is a simple loop over the row, which stays in the cache, instead of
+ * interpreting the expression for each voxel.
+ *
+ * Syntax, from lowest to highest precedence:
+ * - cond ? x : y
+ * - ||, &&
+ * - ==, !=, <, <=, >, >=
+ * - +, -
+ * - *, /
+ * - unary -, !
+ * - numbers, variables, parentheses and the functions min, max (two or
+ *   more arguments), abs, sqrt, exp, log, pow, floor, ceil and clamp(x, lo, hi)
+ *
+ * Comparisons and logical operators yield 1 or 0; a value counts as true if
+ * it is not 0. Subexpressions without inputs are folded into constants.
+ */
+class VoxelExpression {
+public:
+    VoxelExpression();
+
+    /**
+     * Compiles the expression, replacing the current program.
+     *
+     * @param inputs names of the rows passed to evaluate(), in this order
+     * @param constants further variables with fixed values
+     *
+     * @throw VoreenException on syntax errors and unknown names
+     */
+    void compile(const std::string& expression, const std::vector<std::string>& inputs,
+                 const std::map<std::string, float>& constants = std::map<std::string, float>())
+        throw (VoreenException);
+
+    const std::string& getExpression() const { return expression_; }
+
+    /// Returns whether the compiled expression refers to input i.
+    bool usesInput(size_t i) const;
+
+    /// Number of floats evaluate() needs as scratch space for count voxels.
+    size_t getScratchSize(size_t count) const;
+
+    /**
+     * Evaluates the expression for count voxels. Can be called by several
+     * threads at once, each with its own scratch space.
+     *
+     * @param inputs count values for each input, must not overlap result
+     * @param result receives count values
+     * @param scratch getScratchSize(count) floats
+     */
+    void evaluate(const float* const* inputs, size_t count, float* result, float* scratch) const;
+
+private:
+    enum OpCode {
+        OP_COPY,
+        OP_NEG, OP_NOT, OP_ABS, OP_SQRT, OP_EXP, OP_LOG, OP_FLOOR, OP_CEIL,
+        OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MIN, OP_MAX, OP_POW,
+        OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL, OP_EQUAL, OP_NOT_EQUAL,
+        OP_AND, OP_OR,
+        OP_SELECT
+    };
+
+    /// An input row, a constant or a register holding an intermediate row.
+    struct Operand {
+        enum Kind {
+            INPUT,
+            CONSTANT,
+            REGISTER
+        };
+        Kind kind;
+        int index;      ///< of the input, the constant row or the register
+        float value;    ///< of a constant
+    };
+
+    struct Instruction {
+        OpCode op;
+        int dst;        ///< register, 0 is the result
+        int numArgs;
+        Operand args[3];
+    };
+
+    class Parser;
+    friend class Parser;
+
+    /// Folds the operation if all arguments are constant, otherwise appends an instruction.
+    Operand emit(OpCode op, Operand* args, int numArgs);
+
+    static float apply(OpCode op, float a, float b, float c);
+
+    std::string expression_;
+    std::vector<Instruction> program_;
+    std::vector<float> constants_;      ///< values of the constant rows
+    std::vector<bool> usedInputs_;
+    int numLiveRegisters_;
+    int numRegisters_;
+};
+
+} // namespace voreen
+
+#endif // VRN_VOXELEXPRESSION_H
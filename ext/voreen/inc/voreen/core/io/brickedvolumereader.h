@@ -52,6 +52,7 @@ namespace voreen {
 
         /**
         * Reads a brick from the file, indicated by the bricks position and its lod.
+        * Can be called from several threads at once, except on Windows.
         */
         void readBrick(Brick* brick, char* volumeData, int numBytes, size_t lod);
 
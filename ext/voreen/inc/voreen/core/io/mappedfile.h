@@ -0,0 +1,111 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#ifndef VRN_MAPPEDFILE_H
+#define VRN_MAPPEDFILE_H
+
+#include <string>
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+
+namespace voreen {
+
+/**
+ * A byte range of a file mapped into memory. The mapping is private: it may be
+ * written to, but modified pages are copied and never written back. Pages are
+ * only loaded from disk when they are touched.
+ */
+class MappedFile {
+public:
+    /**
+     * Maps @p length bytes of the file starting at byte @p offset.
+     *
+     * @return the mapping, or 0 if the file can not be opened, is shorter than
+     *      offset + length or memory mapping is not supported on this platform.
+     */
+    static MappedFile* map(const std::string& fileName, uint64_t offset, uint64_t length);
+
+    ~MappedFile();
+
+    /// Returns the first byte of the mapped range.
+    char* getData() const;
+
+    /// Returns the number of bytes in the mapped range.
+    uint64_t getSize() const;
+
+    /**
+     * Tells the kernel the range is going to be read front to back, so it reads
+     * ahead aggressively.
+     */
+    void adviseSequential() const;
+
+private:
+    MappedFile(void* base, size_t baseLength, char* data, uint64_t size);
+
+    // not copyable
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    void* base_;          ///< page aligned start of the mapping
+    size_t baseLength_;   ///< length of the mapping from base_
+    char* data_;
+    uint64_t size_;
+};
+
+/**
+ * VolumeAtomic using a mapped file range as voxel storage. The volume owns the
+ * mapping and unmaps it on destruction instead of freeing the data.
+ *
+ * The mapped range has to hold exactly the voxels in the volume's format and
+ * has to be aligned to the element size.
+ */
+template<class T>
+class MappedVolume : public VolumeAtomic<T> {
+public:
+    MappedVolume(MappedFile* file,
+                 const tgt::ivec3& dimensions,
+                 const tgt::vec3& spacing = tgt::vec3(1.f),
+                 const tgt::mat4& transformation = tgt::mat4::identity,
+                 int bitsStored = VolumeAtomic<T>::BITS_PER_VOXEL)
+        : VolumeAtomic<T>(reinterpret_cast<T*>(file->getData()), dimensions, spacing, transformation, bitsStored)
+        , file_(file)
+    {}
+
+    virtual ~MappedVolume() {
+        // the voxels belong to the mapping
+        this->data_ = 0;
+        delete file_;
+    }
+
+private:
+    MappedFile* file_;
+};
+
+} // namespace voreen
+
+#endif // VRN_MAPPEDFILE_H
@@ -39,6 +39,7 @@
 namespace voreen {
 
 class ProgressBar;
+template<class T> class VolumeAtomic;
 
 /**
  * Reads a raw volume dataset. This requires information hints about dimension, format, etc.,
@@ -130,6 +131,19 @@ public:
         throw(tgt::FileException, std::bad_alloc);
 
 private:
+    /**
+     * Loads the voxels described by the read hints, stored as elements of type S
+     * in the file, into a volume of type T. Byte order swapping, conversion and
+     * normalization are done in a single pass. If none of them is needed, the
+     * returned volume uses the mapped file as storage.
+     *
+     * @param bitsStored bits stored per voxel, 0 for the default of T
+     */
+    template<class S, class T>
+    VolumeAtomic<T>* readVoxels(const std::string& fileName, size_t firstSlice, size_t lastSlice,
+                                int bitsStored = 0)
+        throw (tgt::CorruptedFileException, tgt::IOException, std::bad_alloc);
+
     ReadHints hints_;
 
     static const std::string loggerCat_;
@@ -33,6 +33,8 @@
 
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
 
 namespace voreen {
 
@@ -46,9 +48,14 @@ class PlotRowImplicit;
 /**
  * \brief   A PlotData stores rows which can be sorted by key columns. Insert and find calls should be fast.
  *
- * \note    As we are handling pointers in private member highlightedCells_, it is crucial to
- *          pay attention on implementing new member functions. Especially if you plan to
- *          modify rows_ make sure all pointers in this set remain valid or are removed!
+ * The cells are stored column by column: number columns as contiguous plot_t arrays, string
+ * columns as indices into a dictionary of their distinct tags. Rows are ordered by a sorted
+ * index over the key columns instead of being moved. select(), groupBy() and aggregate() scan
+ * the columns. Plot code reads single cells with getValueAt() and friends or whole columns with
+ * getColumnValues(); the PlotRowValues returned by getRow() and the row iterators are only built
+ * when they are asked for.
+ *
+ * \note    The row numbers of the public interface always refer to the rows sorted by key columns.
  *
  **/
 class PlotData : public PlotBase {
@@ -133,6 +140,14 @@ public:
      **/
     plot_t aggregate(int column, const AggregationFunction* function) const;
 
+    /**
+     * \brief  Copies the values of column \a column in row order into \a values.
+     *
+     * \param column       column to copy
+     * \param values       receives getRowsCount() values, NaN for null cells and tags
+     **/
+    void getColumnValues(int column, std::vector<plot_t>& values) const;
+
     /**
      * \brief  Inserts a new PlotRowValue into PlotData with the values given in \a values. Assumes
      *         that the values are given in ascending column order (first key columns, then data columns)
@@ -360,10 +375,20 @@ public:
     std::vector<PlotRowImplicit>::const_iterator getImplicitRowsEnd() const;
 
     /// Returns the PlotRowValue in row \a row.
+    /// Remember:   The reference is valid until this PlotData is modified.
     const PlotRowValue& getRow(int row) const;
     /// Returns the PlotRowImplicit in row \a row.
     const PlotRowImplicit& getImplicitRow(int row) const;
 
+    /// Returns the cell in row \a row and column \a column without building the row view.
+    PlotCellValue getCellAt(int row, int column) const;
+    /// Returns the value in row \a row and column \a column, NaN for null cells and tags.
+    plot_t getValueAt(int row, int column) const;
+    /// Returns the tag in row \a row and column \a column, an empty string for null cells and values.
+    std::string getTagAt(int row, int column) const;
+    /// Returns whether the cell in row \a row and column \a column is null.
+    bool isNullAt(int row, int column) const;
+
     /// Returns the number of PlotRowValues in this PlotData.
     int getRowsCount() const;
     /// Returns the number of PlotRowImplicits in this PlotData.
@@ -414,7 +439,7 @@ public:
      **/
     void reset(int keyColumnCount, int dataColumnCount);
 
-    /// ensures that rows_ is sorted lexicographically by key columns
+    /// ensures that the index sorting the rows lexicographically by key columns is up to date
     void sortRows() const;
 
     /// returns whether the data is sorted
@@ -431,46 +456,85 @@ public:
     static bool isIndexColumn(const PlotData& pData, int column);
 
 private:
-    /// updateIntervals
-    void updateIntervals(const PlotRowValue& row);
-    /// delete implicit rows and their values
-    void deleteImplicitRows();
-
     /**
-     * \brief   Removes all pointers to cells of PlotRow \a row from highlightedCells_.
+     * \brief   storage of one column
      *
-     * \note    Make sure to call this function before removing \a row from rows_. If not
-     *          sooner or later everything here will explode!
+     * The type of the cells is given by the column type: NUMBER and EMPTY columns use \a values,
+     * STRING columns use \a tags.
      **/
-    void removePointersToCellsOfRow(PlotRowValue& row);
+    struct Column {
+        std::vector<plot_t> values;                 ///< values of the cells, NaN for null cells
+        std::vector<int> tags;                      ///< indices of the tags in dictionary, -1 for null cells
+        std::vector<std::string> dictionary;        ///< distinct tags of this column
+        std::map<std::string, int> dictionaryIndex; ///< index of each tag in dictionary
+        std::vector<bool> highlighted;              ///< highlighted-flags of the cells
+    };
+
+    /// compares physical rows lexicographically by the key columns like PlotRowValue::operator<()
+    class KeyLess;
+    friend class KeyLess;
+
+    /// appends a row of cells which fit the column types, missing cells will be null
+    void appendRow(const std::vector<PlotCellValue>& cells);
+
+    /// returns the index of \a tag in the dictionary of \a column, adds it if necessary
+    int getTagIndex(int column, const std::string& tag);
+
+    /// returns the cell in physical row \a row and column \a column
+    PlotCellValue getCell(int row, int column) const;
+
+    /// returns the physical row of the \a row-th row in key order
+    int getPhysicalRow(int row) const;
 
     /**
-     * \brief   all value rows of this PlotData
+     * \brief   Checks \a predicates for all physical rows.
      *
-     * \note    As we might hold pointers to cells in entries of this vector it is crucial
-     *          to use only member functions to modify this vector.
+     * \param   all       whether all predicates have to match or at least one
+     * \param   matches   receives for each physical row whether it matches
+     **/
+    void checkPredicates(const std::vector<std::pair<int, PlotPredicate*> >& predicates, bool all,
+        std::vector<char>& matches) const;
+
+    /**
+     * \brief   Appends physical rows \a rows restricted to \a columns to \a target, which has to be
+     *          reset with columns.size() columns before.
      **/
-    std::vector<PlotRowValue> rows_;
+    void copyRows(const std::vector<int>& rows, const std::vector<int>& columns, PlotData& target) const;
+
+    /// sets the highlighted-flag of the cell in row \a row (in key order) and column \a column
+    void setCellHighlight(int row, int column, bool value);
+
+    /// marks the sorted index and the row view as outdated
+    void invalidateRows();
+
+    /// builds rows_ if it is outdated
+    void updateRows() const;
+
+    /// delete implicit rows and their values
+    void deleteImplicitRows();
+
+    std::vector<Column> columns_;   ///< cells of this PlotData, column by column
+    int rowCount_;                  ///< number of value rows
+
+    /// PlotRowValues of the rows in key order, built on demand
+    mutable std::vector<PlotRowValue> rows_;
+    /// flag whether rows_ is up to date
+    mutable bool rowsValid_;
 
     std::vector<PlotRowImplicit> implicitRows_; ///< all implicit rows of this PlotData
     std::vector< Interval<plot_t> > intervals_; ///< cached intervals of each column_
 
     /**
-     * \brief List of pointers to all highlighted cells.
+     * \brief List of (physical row, column) of all highlighted cells.
      *
      * This set is needed to be able to clear the highlight-flags of all PlotCellValues
      * without iterating over all existing cells.
-     *
-     * \note    As we are handling pointers here, it is crucial to maintain this set via
-     *          the corresponding accessors to ensure nothing explodes! Also all changes
-     *          in rows_, especially removing entries must done using member functions
-     *          or with extreme caution!
-     *          On implementing new member functions make sure all pointers in this list
-     *          remain valid or are removed.
      **/
-    std::set<PlotCellValue*> highlightedCells_;
+    std::set<std::pair<int, int> > highlightedCells_;
 
-    /// flag whether rows_ is sorted lexicographically by key columns or not
+    /// physical row of each row in key order, empty if the physical order is sorted
+    mutable std::vector<int> sortedIndex_;
+    /// flag whether sortedIndex_ is up to date
     mutable bool sorted_;
 
 };
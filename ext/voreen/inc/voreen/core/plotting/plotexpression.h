@@ -62,7 +62,23 @@ public:
      * \return         plot_t result of the evaluation
      *                 if the result defined result ist std::numeric_limits<plot_t>::quiet_NaN()
      */
-    plot_t evaluateAt(const std::vector<plot_t>& value);
+    plot_t evaluateAt(const std::vector<plot_t>& value) const;
+
+    /**
+     * \brief  Evaluates the expression of one variable at n points.
+     *
+     * \param xs       the n values of the variable
+     * \param out      receives the n results, NaN where the expression is undefined
+     */
+    void evaluateBatch(const plot_t* xs, size_t n, plot_t* out) const;
+
+    /**
+     * \brief  Evaluates the expression at n points.
+     *
+     * \param values   for each variable the pointer to its n values
+     * \param out      receives the n results, NaN where the expression is undefined
+     */
+    void evaluateBatch(const std::vector<const plot_t*>& values, size_t n, plot_t* out) const;
 
     /// returns the number of variables of the expression
     int numberOfVariables() const;
@@ -91,19 +107,60 @@ private:
         int numberOfVariable;
     };
 
+    /// instruction of the stack program a function is compiled to
+    struct Instruction {
+        enum OpCode {
+            PUSH_CONSTANT,
+            PUSH_VARIABLE,
+            CALL,               ///< replaces the top of the stack by function(top)
+            NEG,
+            ADD,
+            SUB,
+            MUL,
+            DIV,
+            POW
+        };
+        OpCode op;
+        plot_t value;                   ///< constant of PUSH_CONSTANT
+        int variable;                   ///< index of the variable of PUSH_VARIABLE
+        plot_t (*function)(plot_t);     ///< function of CALL
+    };
+
+    /// compiled stack program
+    struct Program {
+        Program() : stackSize(0) {}
+        std::vector<Instruction> instructions;
+        int stackSize;
+    };
+
     struct TokenFunction {
         std::vector<glslparser::Token*> function;
         std::vector<glslparser::Token*> interval;
         std::vector<Interval<plot_t> > domain;
+        Program program;
     };
 
 
     void initialize();
     int calculateNumberOfVariables();
     void calculateDomain();
-    void evaluateDomain(std::stack<glslparser::Token*>& tokens, int index, int& number);
+    void evaluateDomain(const std::vector<glslparser::Token*>& tokens, size_t& position, int index, int& number);
+
+    /// compiles the term starting at tokens[position] and appends it to program, position is moved behind the term
+    void compile(const std::vector<glslparser::Token*>& tokens, size_t& position, Program& program, int& depth) const;
+    /// appends instruction to program and keeps track of the stack depth
+    void emit(Program& program, const Instruction& instruction, int& depth) const;
 
-    plot_t evaluate(std::stack<glslparser::Token*>& tokens, const std::vector<plot_t>& value);
+    /// returns the index of the partial function whose domain contains the i-th point, or -1
+    int findPartialFunction(const plot_t* const* values, size_t numValues, size_t i) const;
+
+    /**
+     * Runs program for count points.
+     *
+     * \param values   for each variable the pointer to its count values
+     * \param stack    (program.stackSize - 1) * count values
+     */
+    void run(const Program& program, const plot_t* const* values, size_t count, plot_t* result, plot_t* stack) const;
 
     /// string represantion of the expression
     std::string representation_;
@@ -116,6 +173,8 @@ private:
     /// domain of the function
     std::vector<std::vector<Interval<plot_t> > > domain_;
     std::vector<TokenFunction> functionVector_;
+    /// largest stack size of the programs of the partial functions
+    int stackSize_;
 
     static const int charOffset_;
     static const std::string loggerCat_;
@@ -29,9 +29,7 @@
 #define VRN_CPURAYCASTER_H
 
 #include "voreen/core/processors/volumeraycaster.h"
-#include "voreen/core/datastructures/transfunc/transfuncintensitygradient.h"
-#include "voreen/core/datastructures/volume/volumeatomic.h"
-#include "voreen/core/datastructures/volume/gradient.h"
+#include "voreen/core/datastructures/volume/softwareraycaster.h"
 #include "voreen/core/properties/transfuncproperty.h"
 
 #include "voreen/core/ports/volumeport.h"
@@ -40,6 +38,9 @@ namespace voreen {
 
 /**
  * Performs a simple raycasting on the CPU.
+ *
+ * The rays are traced by a SoftwareRaycaster on all cores. Only intensity
+ * transfer functions are supported.
  */
 class CPURaycaster : public VolumeRaycaster {
 public:
@@ -60,30 +61,15 @@ public:
 protected:
     virtual void process();
 
-    unsigned long long sampling_count;
-    unsigned long long sampling_last_same;
-
     VolumePort volumePort_;
-    VolumePort gradientVolumePort_;
+    VolumePort gradientVolumePort_;   ///< not used
     RenderPort entryPort_;
     RenderPort exitPort_;
     RenderPort outport_;
 
     TransFuncProperty transferFunc_;  ///< the property that controls the transfer-function
 
-    float textureLookup3D(VolumeUInt8* vol, const tgt::vec3& p);
-    tgt::vec4 apply1DTF(float intensity);
-    tgt::vec4 apply2DTF(float intensity, float gradientMagnitude);
-    virtual tgt::vec4 directRendering(const tgt::vec3& first, const tgt::vec3& last);
-
-    float* entry;
-    float* exit;
-    float* output;
-    bool gradientVolume_;
-    VolumeUInt8* vol8;
-    VolumeUInt8* volumeGradientMagnitudes_;
-    bool intensityGradientTF_;
-    tgt::Texture* tf_tex;
+    SoftwareRaycaster raycaster_;
 };
 
 
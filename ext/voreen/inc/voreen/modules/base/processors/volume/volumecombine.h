@@ -32,6 +32,10 @@
 #include "voreen/core/properties/boolproperty.h"
 #include "voreen/core/properties/floatproperty.h"
 #include "voreen/core/properties/optionproperty.h"
+#include "voreen/core/properties/stringproperty.h"
+#include "voreen/core/datastructures/volume/voxelexpression.h"
+
+#include <vector>
 
 namespace voreen {
 
@@ -47,6 +51,9 @@ public:
     virtual bool usesExpensiveComputation() const { return true; }
     virtual std::string getProcessorInfo() const;
 
+    /// The optional third and fourth volume need not be connected.
+    virtual bool isReady() const;
+
 protected:
     virtual void process();
     virtual void deinitialize() throw (VoreenException);
@@ -68,23 +75,45 @@ private:
         OP_PRIORITY_FIRST,
         OP_PRIORITY_SECOND,
         OP_TAKE_FIRST,
-        OP_TAKE_SECOND
+        OP_TAKE_SECOND,
+        OP_EXPRESSION
+    };
+
+    /// How an input volume is sampled in the voxel grid of the combined volume.
+    struct InputSampling {
+        enum Mode {
+            COMMON_GRID,    ///< same grid, the voxels are read directly
+            AXIS_ALIGNED,   ///< rows of the combined volume are rows of the input
+            TRANSFORMED     ///< each voxel position is transformed
+        };
+        const Volume* volume;
+        Mode mode;
+        tgt::mat4 combinedToInput;
+        tgt::vec3 maxPos;   ///< largest voxel position inside the input
     };
 
+    /// Returns the expression computing operation, or an empty string for OP_EXPRESSION.
+    std::string getOperationExpression(CombineOperation operation) const;
+
     /**
-     * Combines the input volumes and writes the result to combinedVolume (which is assumed to be already created),
-     * by transforming the input volume's coordinates systems to the coordinates system of the combined volume.
+     * Evaluates expression for each voxel of combinedVolume (which is assumed to be already created)
+     * and writes the results clamped to [0,1]. The input volumes, whose order matches the inputs the
+     * expression has been compiled with, are sampled by transforming the combined volume's coordinate
+     * system to theirs, or read directly if they share its grid. Inputs the expression does not use may be 0.
      */
-    void combineVolumes(Volume* combinedVolume, const Volume* firstVolume,
-        const Volume* secondVolume, CombineOperation operation) const;
+    void combineVolumes(Volume* combinedVolume, const std::vector<const Volume*>& inputs,
+        const VoxelExpression& expression) const;
+
+    /// Determines how volume is sampled for combinedVolume.
+    InputSampling createInputSampling(const Volume* combinedVolume, const Volume* volume) const;
 
     /**
-     * Combines the input volumes and writes the result to combinedVolume (which is assumed to be already created),
-     * without coordinate transformation. This is much faster than the transformation-based combination,
-     * but only possible for volumes that share a common grid in world space.
+     * Samples row (y,z) of the combined volume from an input, zeroing positions outside of it.
+     *
+     * @param positions buffer for count positions
      */
-    void combineVolumesOnCommonGrid(Volume* combinedVolume, const Volume* firstVolume,
-        const Volume* secondVolume, CombineOperation operation) const;
+    void sampleRow(const InputSampling& input, int y, int z, int count, float* values,
+        tgt::vec3* positions) const;
 
     /// Creates a combined (empty) volume from the two input volumes in world space,
     /// or 0 in case the combined volume could not be created due to bad allocation.
@@ -95,6 +124,8 @@ private:
 
     VolumePort inportFirst_;
     VolumePort inportSecond_;
+    VolumePort inportThird_;
+    VolumePort inportFourth_;
     VolumePort outport_;
 
     BoolProperty disableOptimization_;
@@ -102,6 +133,7 @@ private:
     OptionProperty<CombineOperation> combineFunction_;
     FloatProperty factorC_;
     FloatProperty factorD_;
+    StringProperty expression_;
     StringOptionProperty referenceVolume_;
 
     bool volumeOwner_;
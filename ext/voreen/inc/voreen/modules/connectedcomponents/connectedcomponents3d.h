@@ -37,8 +37,9 @@
 namespace voreen {
 
 /**
- * Detects connected components in a volume data set and intensity-codes the assigned labels
- * in a 16 bit output volume of the same dimensions.
+ * Detects connected components in a volume data set and puts out the assigned labels
+ * in a 32 bit volume of the same dimensions. Stretched or binarized labels are
+ * intensity-coded in a 16 bit volume instead.
  *
  * @see ConnectedComponents2D
  */
@@ -14,6 +14,7 @@
 
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/allocators/node_allocator.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "ipc_volume.hpp"
 
@@ -30,6 +31,25 @@ namespace voreen
 
 class VolumeHandle;
 
+/**
+ * VolumeUInt16 wrapping a frame of the shared ring in place. It holds a
+ * reader lease on the frame for its whole lifetime, so the simulator does not
+ * overwrite the voxels while the network uses them. The shared data is not
+ * freed on destruction, only the lease is given back.
+ */
+class IPCFrameVolume : public VolumeUInt16
+{
+public:
+    /// Wraps a frame the caller already holds a lease on
+    IPCFrameVolume(ipc_volume_info* info, uint32_t slot, const tgt::ivec3& dimensions);
+
+    virtual ~IPCFrameVolume();
+
+private:
+    ipc_volume_info* _info;
+    uint32_t _slot;
+};
+
 class IPCVolumeSource : public VolumeProcessor
 {
 public:
@@ -58,6 +78,19 @@ public:
 
     virtual void timerEvent(tgt::TimeEvent* te);
 
+    /// Frames published by the simulator so far
+    uint32_t getFramesPublished() const;
+
+    /// Published frames the viewer never picked up
+    uint32_t getFramesDropped() const;
+
+    /**
+     * Latency from the simulator publishing a step to this processor
+     * invalidating its output, as counts per power-of-two bucket of
+     * microseconds (see IPC_VOLUME_LATENCY_BUCKETS).
+     */
+    std::vector<uint32_t> getLatencyHistogram() const;
+
 protected:
     virtual void process();
 
@@ -73,7 +106,37 @@ protected:
 
     void toggleIPCRead();
 
-    void toggleDoubleBuffer();
+    void changeRingFrames();
+
+    void toggleEventDriven();
+
+    /// Starts the thread waiting for published frames, if event driven
+    void startWaiter();
+
+    /// Stops the waiting thread, must be called before the segment goes away
+    void stopWaiter();
+
+    /// Body of the waiting thread: turns publish signals into timer wakeups
+    void waitForFrames();
+
+    /**
+     * Brings the output volume up to the latest frame by copy. Only the
+     * bricks the simulator changed since the last frame are copied and
+     * re-uploaded to the hardware volume; the whole frame is taken the first
+     * time, after the simulator restarted or when most bricks changed.
+     * Returns false if there is no new complete frame.
+     */
+    bool copyLatestFrame(uint32_t& step);
+
+    /// Merges dirty bricks into boxes (in voxels) to be updated separately
+    void collectDirtyRegions(const std::vector<uint8_t>& dirty,
+                             std::vector<std::pair<tgt::ivec3, tgt::ivec3> >& regions) const;
+
+    /// Takes the latest frame in place under a reader lease, returns 0 if there is none
+    VolumeUInt16* leaseLatestFrame(uint32_t& step);
+
+    /// Creates the shared segment and the frame ring for the current properties
+    void createSharedSegment();
 
 private:
     VolumePort _outport;
@@ -88,16 +151,25 @@ private:
     //! Enable/disable IPC reading
     BoolProperty _toggle_ipc;
     bool _enable_ipc;
-    //! Enable/disable double buffer creation
-    BoolProperty _create_double_buffer;
-    bool _double_buffer;
-    //! Timer
+    //! Number of frames in the shared ring
+    IntProperty _ring_frames;
+    //! Export frames in place instead of copying them
+    BoolProperty _zero_copy;
+    //! Wake up as soon as a frame is published instead of on the next tick
+    BoolProperty _event_driven;
+    //! Timer, also the fallback when not event driven
     IntProperty _timer_interval;
     static const uint _default_timer_interval;
 	//! Timer object
     tgt::Timer* _timer;
 	//! A local eventhanlde which is added to the timer
     tgt::EventHandler _eventHandler;
+    //! Thread blocked on the publish signal of the shared segment
+    boost::thread* _waiter;
+    volatile uint32_t _stop_waiter;
+    //! Set while a timer wakeup is queued, so a fast simulator cannot flood
+    //! the event loop
+    volatile uint32_t _wakeup_pending;
 
     //! Shared memory name
     StringProperty _shared_memory_name;
@@ -111,6 +183,16 @@ private:
     ipc_volume_info *_volumeinfo;
     //! Place in shared memory where data is stored
     uint16_t *_volumedata;
+    //! Step of the last frame taken from the ring
+    uint32_t _last_step;
+    bool _received_frame;
+    //! Publish time of the frame taken last
+    uint64_t _frame_publish_time;
+    //! Simulator run the last frame came from
+    uint32_t _writer_epoch;
+    //! Whether the copied output volume matches the frame of _last_step up
+    //! to the bricks changed since (false after a torn full copy)
+    bool _target_consistent;
 	//! Structure for interpreting the shared data for visualization
     VolumeUInt16 *_target;
 };
@@ -34,5 +34,14 @@ namespace voreen {
     {
     }
 
+    const std::vector<Brick*>& BrickLodSelector::getSelectionOrder() const {
+        return selectionOrder_;
+    }
+
+    void BrickLodSelector::assignLod(Brick* brick, size_t lod) {
+        brick->setCurrentLevelOfDetail(lod);
+        selectionOrder_.push_back(brick);
+    }
+
 } //namespace
 
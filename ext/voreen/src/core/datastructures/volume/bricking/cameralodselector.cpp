@@ -42,6 +42,7 @@ namespace voreen {
     void CameraLodSelector::selectLods() {
         bricksWithoutLod_.clear();
         bricksWithoutLod_ = std::vector<Brick*>(brickingInformation_.volumeBricks);
+        selectionOrder_.clear();
 
         int currentLevelOfDetail = 0;               // The lod we are currently assigning to bricks.
         int maxNumberOfCurrentLODBlocks = 0;        // The number of bricks that can be given that lod.
@@ -127,7 +128,7 @@ namespace voreen {
                     if (!bricks.at(it->second)->getAllVoxelsEqual()) {
 
                         //The brick isn't empty, so we assign the correct lod.
-                        bricks.at(it->second)->setCurrentLevelOfDetail(currentLevelOfDetail);
+                        assignLod(bricks.at(it->second), currentLevelOfDetail);
                         numberOfBlocksOfCurrentLODAssigned++;    //Keep track of how many bricks have that lod.
 
                         //Check if we have assigned this lod to as many bricks as we were allowed to.
@@ -148,7 +149,7 @@ namespace voreen {
                         //The volume brick has an "empty" volume, meaning all voxels have the same value, and
                         //therefore we can assign the lowest lod possible.
                         size_t lowestLod = brickingInformation_.brickResolutions.size()-1;
-                        bricks.at(it->second)->setCurrentLevelOfDetail(lowestLod);
+                        assignLod(bricks.at(it->second), lowestLod);
                     }
                 }
 
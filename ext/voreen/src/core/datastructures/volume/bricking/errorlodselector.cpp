@@ -47,6 +47,7 @@ namespace voreen {
 
     void ErrorLodSelector::selectLods() {
 
+        selectionOrder_.clear();
         initializeErrorSet();
         bool finished = false;
 
@@ -80,7 +81,7 @@ namespace voreen {
                 currentErrorStruct.numVoxels = static_cast<int>(
                     currentErrorStruct.numVoxels * pow(8.0,currentLod-newLod));
 
-                currentErrorStruct.brick->setCurrentLevelOfDetail(newLod);
+                assignLod(currentErrorStruct.brick, newLod);
 
                 calculateNextImprovement(currentErrorStruct);
             }
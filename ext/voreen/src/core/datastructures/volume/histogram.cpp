@@ -28,112 +28,169 @@
 #include "voreen/core/datastructures/volume/histogram.h"
 #include "voreen/core/datastructures/volume/bricking/brickedvolume.h"
 
-namespace voreen {
+#include <algorithm>
 
-HistogramIntensity::HistogramIntensity(const Volume* volume, int bucketCount) {
-    tgtAssert(volume, "HistogramIntensity: No volume");
-    tgtAssert(bucketCount > 0, "HistogramIntensity: Invalid bucket count");
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-    // Limit to 16 bit
-    if (bucketCount > 65536)
-        bucketCount = 65536;
+namespace voreen {
 
-    // set all buckets to zero
-    hist_.assign(bucketCount, 0);
+namespace {
 
-    maxValue_ = 0;
-    significantRange_ = tgt::ivec2(bucketCount, -1);
+typedef std::vector<std::pair<size_t, size_t> > VoxelRanges;
 
-    const Volume* currentVolume = volume;
+/// Voxels per range counted by one thread at a time
+const size_t CHUNK_SIZE = 1 << 16;
 
-    const BrickedVolume* brickedVolume = dynamic_cast<const BrickedVolume*>(volume);
-    if (brickedVolume) {
-        currentVolume = brickedVolume->getPackedVolume();
+/**
+ * Maps the voxels of 8 and 16 bit intensity volumes to buckets through a
+ * table over all values, -1 for values beyond the last bucket.
+ */
+class TableBuckets {
+public:
+    TableBuckets(int bucketCount, float maxValue, size_t numValues)
+        : table_(numValues, -1)
+    {
+        float m = (bucketCount - 1.f) / maxValue;
+        for (size_t v = 0; v < numValues; ++v) {
+            int bucket = static_cast<int>(floor(static_cast<float>(v) * m));
+            if (bucket < bucketCount)
+                table_[v] = bucket;
+        }
     }
 
-    const VolumeUInt8* sourceDataset8Bit = dynamic_cast<const VolumeUInt8*>(currentVolume);
-    if (sourceDataset8Bit) {
-        int bucket;
-        float m = (bucketCount - 1.f) / 255.f;
-
-        for (size_t i=0; i < sourceDataset8Bit->getNumVoxels(); ++i) {
-            bucket = static_cast<int>(floor(sourceDataset8Bit->voxel(i) * m));
-            int value = hist_[bucket] + 1;
-            hist_[bucket] = value;
+    int operator()(uint8_t v) const { return table_[v]; }
+    int operator()(uint16_t v) const { return table_[v]; }
+    int operator()(const tgt::col4& v) const { return table_[v.a]; }
+
+private:
+    std::vector<int> table_;
+};
+
+/// Maps float voxels in [0, 1] to buckets, -1 outside
+class FloatBuckets {
+public:
+    FloatBuckets(int bucketCount)
+        : m_(bucketCount - 1.f)
+        , count_(bucketCount)
+    {}
+
+    int operator()(float v) const {
+        int bucket = static_cast<int>(floor(v * m_));
+        return (bucket < count_ && bucket >= 0) ? bucket : -1;
+    }
 
-            if (value > maxValue_)
-                maxValue_ = value;
+private:
+    float m_;
+    int count_;
+};
+
+/**
+ * Counts the voxels of all ranges into private buckets per thread and adds
+ * the counts to hist.
+ */
+template<class T, class Buckets>
+void countRanges(const T* data, const VoxelRanges& ranges, const Buckets& buckets,
+                 std::vector<int>& hist)
+{
+    const int numRanges = static_cast<int>(ranges.size());
+    #ifdef _OPENMP
+    #pragma omp parallel if (numRanges > 1)
+    #endif
+    {
+        std::vector<int> local(hist.size(), 0);
+
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 4)
+        #endif
+        for (int r = 0; r < numRanges; ++r) {
+            const T* end = data + ranges[r].second;
+            for (const T* v = data + ranges[r].first; v != end; ++v) {
+                int bucket = buckets(*v);
+                if (bucket >= 0)
+                    local[bucket]++;
+            }
+        }
 
-            if (bucket < significantRange_.x)
-                significantRange_.x = bucket;
-            if (bucket > significantRange_.y)
-                significantRange_.y = bucket;
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        {
+            for (size_t i = 0; i < hist.size(); ++i)
+                hist[i] += local[i];
         }
     }
+}
 
-    const Volume4xUInt8* sourceDataset32Bit = dynamic_cast<const Volume4xUInt8*>(currentVolume);
-    if (sourceDataset32Bit) {
-        int bucket;
-        float m = (bucketCount - 1.f) / 255.f;
+/// The volume holding the voxels of a possibly bricked volume
+const Volume* voxelVolume(const Volume* volume) {
+    const BrickedVolume* brickedVolume = dynamic_cast<const BrickedVolume*>(volume);
+    if (brickedVolume)
+        return brickedVolume->getPackedVolume();
+    return volume;
+}
 
-        for (size_t i=0; i < sourceDataset32Bit->getNumVoxels(); ++i) {
-            bucket = static_cast<int>(floor(sourceDataset32Bit->voxel(i)[3] * m));
-            int value = hist_[bucket] + 1;
-            hist_[bucket] = value;
+} // namespace
 
-            if (value > maxValue_)
-                maxValue_ = value;
+HistogramIntensity::HistogramIntensity(const Volume* volume, int bucketCount) {
+    tgtAssert(volume, "HistogramIntensity: No volume");
+    tgtAssert(bucketCount > 0, "HistogramIntensity: Invalid bucket count");
 
-            if (bucket < significantRange_.x)
-                significantRange_.x = bucket;
-            if (bucket > significantRange_.y)
-                significantRange_.y = bucket;
-        }
-    }
+    // Limit to 16 bit
+    if (bucketCount > 65536)
+        bucketCount = 65536;
 
-    const VolumeUInt16* sourceDataset16Bit = dynamic_cast<const VolumeUInt16*>(currentVolume);
-    if (sourceDataset16Bit) {
-        int bucket;
-        float maxValue = (sourceDataset16Bit->getBitsStored() == 12) ? 4095.f : 65535.f;
-        float m = (bucketCount - 1.f) / maxValue;
+    // set all buckets to zero
+    hist_.assign(bucketCount, 0);
 
-        for (size_t i=0; i < sourceDataset16Bit->getNumVoxels(); ++i) {
-            bucket = static_cast<int>(floor(sourceDataset16Bit->voxel(i) * m));
-            if (bucket < static_cast<int>(hist_.size())) {
-                int value = hist_[bucket] + 1;
-                hist_[bucket] = value;
+    const Volume* currentVolume = voxelVolume(volume);
+    VoxelRanges ranges;
+    for (size_t i = 0; i < currentVolume->getNumVoxels(); i += CHUNK_SIZE)
+        ranges.push_back(std::make_pair(i, std::min(i + CHUNK_SIZE, currentVolume->getNumVoxels())));
 
-                if (value > maxValue_)
-                    maxValue_ = value;
+    accumulate(currentVolume, ranges);
+    updateStatistics();
+}
 
-                if (bucket < significantRange_.x)
-                    significantRange_.x = bucket;
-                if (bucket > significantRange_.y)
-                    significantRange_.y = bucket;
-            }
+void HistogramIntensity::accumulate(const Volume* volume, const VoxelRanges& ranges) {
+    const int bucketCount = static_cast<int>(hist_.size());
+
+    switch (volume->getFormatId()) {
+        case Volume::FORMAT_UINT8:
+            countRanges(static_cast<const VolumeUInt8*>(volume)->voxel(), ranges,
+                        TableBuckets(bucketCount, 255.f, 256), hist_);
+            break;
+        case Volume::FORMAT_4xUINT8:
+            countRanges(static_cast<const Volume4xUInt8*>(volume)->voxel(), ranges,
+                        TableBuckets(bucketCount, 255.f, 256), hist_);
+            break;
+        case Volume::FORMAT_UINT16: {
+            const VolumeUInt16* volume16 = static_cast<const VolumeUInt16*>(volume);
+            float maxValue = (volume16->getBitsStored() == 12) ? 4095.f : 65535.f;
+            countRanges(volume16->voxel(), ranges, TableBuckets(bucketCount, maxValue, 65536), hist_);
+            break;
         }
+        case Volume::FORMAT_FLOAT:
+            countRanges(static_cast<const VolumeFloat*>(volume)->voxel(), ranges,
+                        FloatBuckets(bucketCount), hist_);
+            break;
+        default:
+            break;
     }
+}
 
-    const VolumeFloat* sourceDatasetFloat = dynamic_cast<const VolumeFloat*>(currentVolume);
-    if (sourceDatasetFloat) {
-        float m = (bucketCount - 1.f);
-        int count = static_cast<int>(hist_.size());
-
-        for (size_t i=0; i < sourceDatasetFloat->getNumVoxels(); ++i) {
-            int bucket = static_cast<int>(floor(sourceDatasetFloat->voxel(i) * m));
-            if (bucket < count && bucket >= 0) {
-                int value = hist_[bucket] + 1;
-                hist_[bucket] = value;
-
-                if (value > maxValue_)
-                    maxValue_ = value;
-
-                if (bucket < significantRange_.x)
-                    significantRange_.x = bucket;
-                if (bucket > significantRange_.y)
-                    significantRange_.y = bucket;
-            }
-        }
+void HistogramIntensity::updateStatistics() {
+    maxValue_ = 0;
+    significantRange_ = tgt::ivec2(static_cast<int>(hist_.size()), -1);
+    for (int i = 0; i < static_cast<int>(hist_.size()); ++i) {
+        if (hist_[i] <= 0)
+            continue;
+        if (hist_[i] > maxValue_)
+            maxValue_ = hist_[i];
+        if (i < significantRange_.x)
+            significantRange_.x = i;
+        significantRange_.y = i;
     }
 }
 
@@ -249,79 +306,112 @@ void HistogramIntensityGradient::calcHG(const VolumeAtomic<U>* volumeGrad, const
     int bitsG = volumeGrad->getBitsStored() / volumeGrad->getNumChannels();
     float halfMax = (pow(2.f, bitsG) - 1.f) / 2.f;
     const tgt::ivec3 gradDim = volumeGrad->getDimensions();
-
-    std::vector<float> gradientLengths;
-    float maxGradientLength = 0.f;
-
-    // calculate length of all gradients
-    for (int z = 0; z < gradDim.z; ++z) {
-        for (int y = 0; y < gradDim.y; ++y) {
-            for (int x = 0; x < gradDim.x; ++x) {
-                float gx = volumeGrad->voxel(x,y,z).r - halfMax;
-                float gy = volumeGrad->voxel(x,y,z).g - halfMax;
-                float gz = volumeGrad->voxel(x,y,z).b - halfMax;
-
-                float nlength = tgt::length(tgt::vec3(gx, gy, gz));
-
-                if (nlength > maxGradientLength)
-                    maxGradientLength = nlength;
-
-                gradientLengths.push_back(nlength);
-            }
-        }
-    }
+    const int numSlices = gradDim.z;
 
     // maximum length of a gradient
-    float maxLength;
+    float maxLength = halfMax * sqrt(3.f);
     if (scale) {
+        // the lengths are cheaper to compute twice than to store
+        float maxGradientLength = 0.f;
+        #ifdef _OPENMP
+        #pragma omp parallel
+        #endif
+        {
+            float localMax = 0.f;
+            #ifdef _OPENMP
+            #pragma omp for schedule(static)
+            #endif
+            for (int z = 0; z < numSlices; ++z) {
+                for (int y = 0; y < gradDim.y; ++y) {
+                    for (int x = 0; x < gradDim.x; ++x) {
+                        const U& g = volumeGrad->voxel(x,y,z);
+                        float nlength = tgt::length(tgt::vec3(g.r - halfMax, g.g - halfMax, g.b - halfMax));
+                        if (nlength > localMax)
+                            localMax = nlength;
+                    }
+                }
+            }
+            #ifdef _OPENMP
+            #pragma omp critical
+            #endif
+            {
+                if (localMax > maxGradientLength)
+                    maxGradientLength = localMax;
+            }
+        }
         maxLength = maxGradientLength;
         scaleFactor_ = maxLength / (halfMax * sqrt(3.f));
     }
-    else
-        maxLength = halfMax * sqrt(3.f);
 
     // init histogram with 0 values
-    for (int j = 0; j < bucketCounti; j++)
-        hist_.push_back(std::vector<int>(bucketCountg));
-
-
-    int bucketg, bucketi;
-    maxValue_ = 0;
-    significantRangeIntensity_ = tgt::ivec2(bucketCounti, -1);
-    significantRangeGradient_ = tgt::ivec2(bucketCountg, -1);
-
-    for (int z = 0; z < gradDim.z; ++z) {
-        for (int y = 0; y < gradDim.y; ++y) {
-            for (int x = 0; x < gradDim.x; ++x) {
-                float intensity;
+    hist_.assign(bucketCounti, std::vector<int>(bucketCountg, 0));
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        // private buckets, intensity major
+        std::vector<int> local(static_cast<size_t>(bucketCounti) * bucketCountg, 0);
+        std::vector<float> intensities(gradDim.x);
+
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int z = 0; z < numSlices; ++z) {
+            for (int y = 0; y < gradDim.y; ++y) {
+                // fetch the intensities of the whole row at once
+                size_t rowIndex = static_cast<size_t>(gradDim.x) * (y + static_cast<size_t>(gradDim.y) * z);
                 if (volumeIntensity)
-                    intensity = volumeIntensity->getVoxelFloat(x,y,z);
+                    volumeIntensity->getVoxelsFloat(rowIndex, gradDim.x, &intensities[0]);
                 else
-                    intensity = volumeGrad->getVoxelFloat(x,y,z,volumeGrad->getNumChannels()-1);
-
-                if (intensity > 1.f)
-                    intensity = 1.f;
+                    volumeGrad->getVoxelsFloat(rowIndex, gradDim.x, &intensities[0], volumeGrad->getNumChannels()-1);
 
-                int pos = z * gradDim.y * gradDim.x + y * gradDim.x + x;
+                for (int x = 0; x < gradDim.x; ++x) {
+                    float intensity = intensities[x];
+                    if (intensity > 1.f)
+                        intensity = 1.f;
 
-                bucketi = tgt::ifloor(intensity * (bucketCounti - 1));
-                bucketg = tgt::ifloor((gradientLengths[pos] / maxLength) * (bucketCountg - 1));
+                    const U& g = volumeGrad->voxel(x,y,z);
+                    float nlength = tgt::length(tgt::vec3(g.r - halfMax, g.g - halfMax, g.b - halfMax));
 
-                hist_[bucketi][bucketg]++;
-                if ((hist_[bucketi][bucketg]) > maxValue_)
-                    maxValue_ = hist_[bucketi][bucketg];
+                    int bucketi = tgt::ifloor(intensity * (bucketCounti - 1));
+                    int bucketg = tgt::ifloor((nlength / maxLength) * (bucketCountg - 1));
+                    local[static_cast<size_t>(bucketi) * bucketCountg + bucketg]++;
+                }
+            }
+        }
 
-                if (bucketi < significantRangeIntensity_.x)
-                    significantRangeIntensity_.x = bucketi;
-                if (bucketi > significantRangeIntensity_.y)
-                    significantRangeIntensity_.y = bucketi;
-                if (bucketg < significantRangeGradient_.x)
-                    significantRangeGradient_.x = bucketg;
-                if (bucketg > significantRangeGradient_.y)
-                    significantRangeGradient_.y = bucketg;
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        {
+            for (int i = 0; i < bucketCounti; ++i) {
+                for (int j = 0; j < bucketCountg; ++j)
+                    hist_[i][j] += local[static_cast<size_t>(i) * bucketCountg + j];
             }
         }
     }
+
+    maxValue_ = 0;
+    significantRangeIntensity_ = tgt::ivec2(bucketCounti, -1);
+    significantRangeGradient_ = tgt::ivec2(bucketCountg, -1);
+    for (int i = 0; i < bucketCounti; ++i) {
+        for (int j = 0; j < bucketCountg; ++j) {
+            if (hist_[i][j] == 0)
+                continue;
+            if (hist_[i][j] > maxValue_)
+                maxValue_ = hist_[i][j];
+
+            if (i < significantRangeIntensity_.x)
+                significantRangeIntensity_.x = i;
+            if (i > significantRangeIntensity_.y)
+                significantRangeIntensity_.y = i;
+            if (j < significantRangeGradient_.x)
+                significantRangeGradient_.x = j;
+            if (j > significantRangeGradient_.y)
+                significantRangeGradient_.y = j;
+        }
+    }
 }
 
 } // namespace voreen
@@ -0,0 +1,596 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#include "voreen/core/datastructures/volume/softwareraycaster.h"
+#include "voreen/core/datastructures/transfunc/transfuncintensity.h"
+
+#include "tgt/camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace voreen {
+
+using tgt::ivec2;
+using tgt::ivec3;
+using tgt::vec2;
+using tgt::vec3;
+using tgt::vec4;
+
+struct SoftwareRaycaster::RayPacket {
+    vec3 start[4];      ///< first sample
+    vec3 step[4];       ///< offset between two samples
+    int numSteps[4];    ///< number of samples, 0 for background pixels
+    vec4 color[4];
+};
+
+namespace {
+
+/**
+ * Interpolates data at four positions given in voxel coordinates, which are
+ * clamped to the volume.
+ */
+template<class T>
+inline void sampleTrilinear4(const T* data, const ivec3& dims, const float* px, const float* py,
+                             const float* pz, float* out)
+{
+    const size_t sx = (dims.x > 1) ? 1 : 0;
+    const size_t sy = (dims.y > 1) ? static_cast<size_t>(dims.x) : 0;
+    const size_t sz = (dims.z > 1) ? static_cast<size_t>(dims.x) * dims.y : 0;
+
+    float c[8][4];
+#ifdef __SSE2__
+    const __m128 zero = _mm_setzero_ps();
+    __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(px), zero), _mm_set1_ps(static_cast<float>(dims.x - 1)));
+    __m128 y = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(py), zero), _mm_set1_ps(static_cast<float>(dims.y - 1)));
+    __m128 z = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pz), zero), _mm_set1_ps(static_cast<float>(dims.z - 1)));
+    // lower corner, at most dims - 2 so that the upper corner is inside
+    __m128 x0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(x)), _mm_set1_ps(static_cast<float>(std::max(dims.x - 2, 0))));
+    __m128 y0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(y)), _mm_set1_ps(static_cast<float>(std::max(dims.y - 2, 0))));
+    __m128 z0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(z)), _mm_set1_ps(static_cast<float>(std::max(dims.z - 2, 0))));
+    __m128 fx = _mm_sub_ps(x, x0);
+    __m128 fy = _mm_sub_ps(y, y0);
+    __m128 fz = _mm_sub_ps(z, z0);
+
+    int ix[4], iy[4], iz[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ix), _mm_cvttps_epi32(x0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iy), _mm_cvttps_epi32(y0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iz), _mm_cvttps_epi32(z0));
+    for (int i = 0; i < 4; ++i) {
+        const T* v = data + ix[i] + iy[i] * sy + iz[i] * sz;
+        c[0][i] = static_cast<float>(v[0]);
+        c[1][i] = static_cast<float>(v[sx]);
+        c[2][i] = static_cast<float>(v[sy]);
+        c[3][i] = static_cast<float>(v[sx + sy]);
+        c[4][i] = static_cast<float>(v[sz]);
+        c[5][i] = static_cast<float>(v[sx + sz]);
+        c[6][i] = static_cast<float>(v[sy + sz]);
+        c[7][i] = static_cast<float>(v[sx + sy + sz]);
+    }
+
+    __m128 c0 = _mm_loadu_ps(c[0]);
+    __m128 c1 = _mm_loadu_ps(c[2]);
+    __m128 c2 = _mm_loadu_ps(c[4]);
+    __m128 c3 = _mm_loadu_ps(c[6]);
+    c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(c[1]), c0), fx));
+    c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(c[3]), c1), fx));
+    c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(c[5]), c2), fx));
+    c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(c[7]), c3), fx));
+    c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), fy));
+    c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_sub_ps(c3, c2), fy));
+    _mm_storeu_ps(out, _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c2, c0), fz)));
+#else
+    for (int i = 0; i < 4; ++i) {
+        float x = std::min(std::max(px[i], 0.f), static_cast<float>(dims.x - 1));
+        float y = std::min(std::max(py[i], 0.f), static_cast<float>(dims.y - 1));
+        float z = std::min(std::max(pz[i], 0.f), static_cast<float>(dims.z - 1));
+        int ix = std::min(static_cast<int>(x), std::max(dims.x - 2, 0));
+        int iy = std::min(static_cast<int>(y), std::max(dims.y - 2, 0));
+        int iz = std::min(static_cast<int>(z), std::max(dims.z - 2, 0));
+        float fx = x - ix;
+        float fy = y - iy;
+        float fz = z - iz;
+
+        const T* v = data + ix + iy * sy + iz * sz;
+        for (int j = 0; j < 8; ++j)
+            c[j][0] = static_cast<float>(v[((j & 1) ? sx : 0) + ((j & 2) ? sy : 0) + ((j & 4) ? sz : 0)]);
+        float c0 = c[0][0] + (c[1][0] - c[0][0]) * fx;
+        float c1 = c[2][0] + (c[3][0] - c[2][0]) * fx;
+        float c2 = c[4][0] + (c[5][0] - c[4][0]) * fx;
+        float c3 = c[6][0] + (c[7][0] - c[6][0]) * fx;
+        c0 += (c1 - c0) * fy;
+        c2 += (c3 - c2) * fy;
+        out[i] = c0 + (c2 - c0) * fz;
+    }
+#endif
+}
+
+/**
+ * Intersects the ray origin + t * direction with the unit cube.
+ *
+ * @return false if the ray misses the cube or it lies behind t = tMin
+ */
+bool intersectUnitCube(const vec3& origin, const vec3& direction, float tMin, float tMax,
+                       float& tNear, float& tFar)
+{
+    tNear = tMin;
+    tFar = tMax;
+    for (int i = 0; i < 3; ++i) {
+        if (std::fabs(direction[i]) < 1e-12f) {
+            if (origin[i] < 0.f || origin[i] > 1.f)
+                return false;
+            continue;
+        }
+        float t0 = -origin[i] / direction[i];
+        float t1 = (1.f - origin[i]) / direction[i];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tNear = std::max(tNear, t0);
+        tFar = std::min(tFar, t1);
+    }
+    return tNear < tFar;
+}
+
+} // namespace
+
+SoftwareRaycaster::SoftwareRaycaster()
+    : volume_(0)
+    , dims_(0)
+    , intensityScale_(1.f)
+    , intensityOffset_(0.f)
+    , samplingRate_(2.f)
+    , terminationThreshold_(0.99f)
+    , macroCellSize_(8)
+    , cellDims_(0)
+    , cellsInvalid_(true)
+    , numSamples_(0)
+    , numSkippedSamples_(0)
+{}
+
+bool SoftwareRaycaster::setVolume(const Volume* volume) {
+    volume_ = 0;
+    cellRanges_.clear();
+    cellsInvalid_ = true;
+    if (!volume)
+        return false;
+
+    Volume::FormatId format = volume->getFormatId();
+    if (format != Volume::FORMAT_UINT8 && format != Volume::FORMAT_UINT16 && format != Volume::FORMAT_FLOAT)
+        return false;
+
+    volume_ = volume;
+    dims_ = volume->getDimensions();
+    vec2 range = volume->elementRange();
+    intensityScale_ = (range.y > range.x) ? 1.f / (range.y - range.x) : 1.f;
+    intensityOffset_ = -range.x * intensityScale_;
+
+    // getData() is not const, but only read here
+    void* data = const_cast<Volume*>(volume)->getData();
+    if (format == Volume::FORMAT_UINT8)
+        buildMacroCells(static_cast<const uint8_t*>(data));
+    else if (format == Volume::FORMAT_UINT16)
+        buildMacroCells(static_cast<const uint16_t*>(data));
+    else
+        buildMacroCells(static_cast<const float*>(data));
+    return true;
+}
+
+void SoftwareRaycaster::setTransferFunction(const std::vector<vec4>& table) {
+    transferFunction_ = table;
+    setSamplingRate(samplingRate_);
+}
+
+void SoftwareRaycaster::setTransferFunction(const TransFuncIntensity* transferFunction, int tableSize) {
+    std::vector<vec4> table;
+    if (transferFunction) {
+        table.resize(std::max(tableSize, 2));
+        for (size_t i = 0; i < table.size(); ++i) {
+            float intensity = static_cast<float>(i) / (table.size() - 1);
+            table[i] = vec4(transferFunction->getMappingForValue(intensity)) / 255.f;
+        }
+    }
+    setTransferFunction(table);
+}
+
+void SoftwareRaycaster::setSamplingRate(float samplingRate) {
+    samplingRate_ = std::max(samplingRate, 0.01f);
+
+    // opacity correction: a segment of 1 / samplingRate voxels has to be as
+    // opaque as the samplingRate segments making up one voxel length
+    correctedTable_ = transferFunction_;
+    for (size_t i = 0; i < correctedTable_.size(); ++i) {
+        float alpha = std::min(std::max(correctedTable_[i].a, 0.f), 1.f);
+        correctedTable_[i].a = (alpha < 1.f) ? 1.f - std::pow(1.f - alpha, 1.f / samplingRate_) : 1.f;
+    }
+    cellsInvalid_ = true;
+}
+
+void SoftwareRaycaster::setMacroCellSize(int size) {
+    if (size == macroCellSize_)
+        return;
+    macroCellSize_ = std::max(size, 0);
+    setVolume(volume_);
+}
+
+template<class T>
+void SoftwareRaycaster::buildMacroCells(const T* data) {
+    if (macroCellSize_ <= 0) {
+        cellDims_ = ivec3(0);
+        return;
+    }
+
+    // cell c contains the positions [c * size, (c + 1) * size), which are
+    // interpolated from the voxels [c * size, (c + 1) * size]; one more voxel
+    // on either side covers rounding errors in the positions
+    const int size = macroCellSize_;
+    cellDims_ = (dims_ - 1) / size + 1;
+    cellRanges_.resize(tgt::hmul(cellDims_));
+
+    const size_t sliceSize = static_cast<size_t>(dims_.x) * dims_.y;
+    const int numRows = cellDims_.y * cellDims_.z;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int row = 0; row < numRows; ++row) {
+        const int cy = row % cellDims_.y;
+        const int cz = row / cellDims_.y;
+        const int y0 = std::max(cy * size - 1, 0), y1 = std::min((cy + 1) * size + 1, dims_.y - 1);
+        const int z0 = std::max(cz * size - 1, 0), z1 = std::min((cz + 1) * size + 1, dims_.z - 1);
+        for (int cx = 0; cx < cellDims_.x; ++cx) {
+            const int x0 = std::max(cx * size - 1, 0), x1 = std::min((cx + 1) * size + 1, dims_.x - 1);
+            T minValue = data[x0 + y0 * dims_.x + z0 * sliceSize];
+            T maxValue = minValue;
+            for (int z = z0; z <= z1; ++z) {
+                for (int y = y0; y <= y1; ++y) {
+                    const T* v = data + y * dims_.x + z * sliceSize;
+                    for (int x = x0; x <= x1; ++x) {
+                        minValue = std::min(minValue, v[x]);
+                        maxValue = std::max(maxValue, v[x]);
+                    }
+                }
+            }
+            cellRanges_[cx + cellDims_.x * row] =
+                vec2(static_cast<float>(minValue) * intensityScale_ + intensityOffset_,
+                     static_cast<float>(maxValue) * intensityScale_ + intensityOffset_);
+        }
+    }
+}
+
+void SoftwareRaycaster::classifyMacroCells() {
+    cellsInvalid_ = false;
+    transparentCells_.assign(cellRanges_.size(), 0);
+    const int tableSize = static_cast<int>(correctedTable_.size());
+    if (tableSize == 0) {
+        transparentCells_.assign(cellRanges_.size(), 1);
+        return;
+    }
+
+    // visible[i] = number of table entries below i with non-zero opacity
+    std::vector<int> visible(tableSize + 1, 0);
+    for (int i = 0; i < tableSize; ++i)
+        visible[i + 1] = visible[i] + (correctedTable_[i].a > 0.f ? 1 : 0);
+
+    // the entries a cell can look up, rounded like in tracePacket()
+    const float maxIndex = static_cast<float>(tableSize - 1);
+    for (size_t i = 0; i < cellRanges_.size(); ++i) {
+        int first = static_cast<int>(std::min(std::max(cellRanges_[i].x, 0.f), 1.f) * maxIndex + 0.5f);
+        int last = static_cast<int>(std::min(std::max(cellRanges_[i].y, 0.f), 1.f) * maxIndex + 0.5f);
+        transparentCells_[i] = (visible[last + 1] == visible[first]) ? 1 : 0;
+    }
+}
+
+size_t SoftwareRaycaster::cellIndex(const vec3& position) const {
+    const float size = static_cast<float>(macroCellSize_);
+    int cx = std::min(static_cast<int>(std::max(position.x, 0.f) / size), cellDims_.x - 1);
+    int cy = std::min(static_cast<int>(std::max(position.y, 0.f) / size), cellDims_.y - 1);
+    int cz = std::min(static_cast<int>(std::max(position.z, 0.f) / size), cellDims_.z - 1);
+    return cx + cellDims_.x * (cy + static_cast<size_t>(cellDims_.y) * cz);
+}
+
+int SoftwareRaycaster::stepsToCellExit(const vec3& position, const vec3& step) const {
+    const float size = static_cast<float>(macroCellSize_);
+    float tExit = std::numeric_limits<float>::max();
+    for (int i = 0; i < 3; ++i) {
+        if (std::fabs(step[i]) < 1e-6f)
+            continue;
+        int cell = std::min(static_cast<int>(std::max(position[i], 0.f) / size), cellDims_[i] - 1);
+        float bound = (step[i] > 0.f) ? (cell + 1) * size : cell * size;
+        tExit = std::min(tExit, (bound - position[i]) / step[i]);
+    }
+    // all samples strictly before the boundary are inside the cell
+    if (tExit >= static_cast<float>(std::numeric_limits<int>::max()))
+        return std::numeric_limits<int>::max();
+    return std::max(static_cast<int>(std::ceil(tExit)), 1);
+}
+
+template<class T>
+void SoftwareRaycaster::tracePacket(const T* data, RayPacket& packet, size_t& numSamples,
+                                    size_t& numSkipped) const
+{
+    const bool skipping = !cellRanges_.empty();
+    const int tableSize = static_cast<int>(correctedTable_.size());
+    const float maxIndex = static_cast<float>(tableSize - 1);
+
+    bool active[4];
+    for (int i = 0; i < 4; ++i) {
+        active[i] = packet.numSteps[i] > 0;
+        packet.color[i] = vec4(0.f);
+    }
+
+    float px[4], py[4], pz[4], intensity[4];
+    int k = 0;
+    for (;;) {
+        int numActive = 0;
+        int minSkip = std::numeric_limits<int>::max();
+        for (int i = 0; i < 4; ++i) {
+            if (!active[i])
+                continue;
+            ++numActive;
+            vec3 p = packet.start[i] + static_cast<float>(k) * packet.step[i];
+            px[i] = p.x;
+            py[i] = p.y;
+            pz[i] = p.z;
+            if (skipping && minSkip > 0)
+                minSkip = transparentCells_[cellIndex(p)] ? std::min(minSkip, stepsToCellExit(p, packet.step[i])) : 0;
+        }
+        if (numActive == 0)
+            break;
+
+        if (skipping && minSkip > 0) {
+            // all rays are in empty space
+            for (int i = 0; i < 4; ++i) {
+                if (!active[i])
+                    continue;
+                int remaining = packet.numSteps[i] - k;
+                numSkipped += std::min(minSkip, remaining);
+                if (minSkip >= remaining)
+                    active[i] = false;
+            }
+            k += std::min(minSkip, std::numeric_limits<int>::max() - k);
+            continue;
+        }
+
+        // inactive lanes sample the position of an active one
+        int firstActive = 0;
+        while (!active[firstActive])
+            ++firstActive;
+        for (int i = 0; i < 4; ++i) {
+            if (!active[i]) {
+                px[i] = px[firstActive];
+                py[i] = py[firstActive];
+                pz[i] = pz[firstActive];
+            }
+        }
+        sampleTrilinear4(data, dims_, px, py, pz, intensity);
+        numSamples += numActive;
+
+        ++k;
+        for (int i = 0; i < 4; ++i) {
+            if (!active[i])
+                continue;
+            float value = std::min(std::max(intensity[i] * intensityScale_ + intensityOffset_, 0.f), 1.f);
+            const vec4& sample = correctedTable_[static_cast<int>(value * maxIndex + 0.5f)];
+            vec4& result = packet.color[i];
+            if (sample.a > 0.f) {
+                float weight = (1.f - result.a) * sample.a;
+                result.r += weight * sample.r;
+                result.g += weight * sample.g;
+                result.b += weight * sample.b;
+                result.a += weight;
+            }
+            if (result.a >= terminationThreshold_ || k >= packet.numSteps[i])
+                active[i] = false;
+        }
+    }
+}
+
+template<class T>
+void SoftwareRaycaster::renderPackets(const T* data, const float* entryPoints, const float* exitPoints,
+                                      const ivec2& size, float* output)
+{
+    const vec3 maxCoord = vec3(dims_ - 1);
+    const float stepLength = 1.f / samplingRate_;
+    const int packetsX = (size.x + 1) / 2;
+    const int packetRows = (size.y + 1) / 2;
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        size_t numSamples = 0;
+        size_t numSkipped = 0;
+        RayPacket packet;
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int row = 0; row < packetRows; ++row) {
+            for (int column = 0; column < packetsX; ++column) {
+                for (int i = 0; i < 4; ++i) {
+                    int x = 2 * column + (i & 1);
+                    int y = 2 * row + (i >> 1);
+                    packet.numSteps[i] = 0;
+                    packet.start[i] = vec3(0.f);
+                    packet.step[i] = vec3(0.f);
+                    if (x >= size.x || y >= size.y)
+                        continue;
+
+                    size_t p = 4 * (static_cast<size_t>(y) * size.x + x);
+                    vec3 front(&entryPoints[p]);
+                    vec3 back(&exitPoints[p]);
+                    if (front == vec3(0.f) && back == vec3(0.f))
+                        continue;
+
+                    packet.start[i] = front * maxCoord;
+                    vec3 direction = back * maxCoord - packet.start[i];
+                    float rayLength = length(direction);
+                    if (rayLength < 1e-6f) {
+                        packet.numSteps[i] = 1;
+                    }
+                    else {
+                        packet.numSteps[i] = static_cast<int>(rayLength / stepLength) + 1;
+                        packet.step[i] = direction * (stepLength / rayLength);
+                    }
+                }
+
+                tracePacket(data, packet, numSamples, numSkipped);
+
+                for (int i = 0; i < 4; ++i) {
+                    int x = 2 * column + (i & 1);
+                    int y = 2 * row + (i >> 1);
+                    if (x < size.x && y < size.y) {
+                        float* out = output + 4 * (static_cast<size_t>(y) * size.x + x);
+                        for (int c = 0; c < 4; ++c)
+                            out[c] = packet.color[i][c];
+                    }
+                }
+            }
+        }
+
+#ifdef _OPENMP
+        #pragma omp critical
+#endif
+        {
+            numSamples_ += numSamples;
+            numSkippedSamples_ += numSkipped;
+        }
+    }
+}
+
+void SoftwareRaycaster::render(const float* entryPoints, const float* exitPoints, const ivec2& size,
+                               float* output)
+{
+    numSamples_ = 0;
+    numSkippedSamples_ = 0;
+    if (!volume_ || correctedTable_.empty()) {
+        std::fill(output, output + 4 * static_cast<size_t>(tgt::hmul(size)), 0.f);
+        return;
+    }
+    if (cellsInvalid_)
+        classifyMacroCells();
+
+    const void* data = const_cast<Volume*>(volume_)->getData();
+    switch (volume_->getFormatId()) {
+    case Volume::FORMAT_UINT8:
+        renderPackets(static_cast<const uint8_t*>(data), entryPoints, exitPoints, size, output);
+        break;
+    case Volume::FORMAT_UINT16:
+        renderPackets(static_cast<const uint16_t*>(data), entryPoints, exitPoints, size, output);
+        break;
+    default:
+        renderPackets(static_cast<const float*>(data), entryPoints, exitPoints, size, output);
+        break;
+    }
+}
+
+void SoftwareRaycaster::render(const tgt::Camera& camera, const ivec2& size, float* output) {
+    if (!volume_) {
+        render(0, 0, size, output);
+        return;
+    }
+
+    // from normalized device coordinates to texture coordinates
+    tgt::mat4 ndcToWorld = tgt::mat4::identity;
+    (camera.getProjectionMatrix() * camera.getViewMatrix()).invert(ndcToWorld);
+    const tgt::mat4 ndcToTexture = volume_->getWorldToTextureMatrix() * ndcToWorld;
+
+    const size_t numPixels = static_cast<size_t>(tgt::hmul(size));
+    std::vector<float> entryPoints(4 * numPixels, 0.f);
+    std::vector<float> exitPoints(4 * numPixels, 0.f);
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            vec2 ndc((x + 0.5f) / size.x * 2.f - 1.f, (y + 0.5f) / size.y * 2.f - 1.f);
+            vec4 nearPoint = ndcToTexture * vec4(ndc.x, ndc.y, -1.f, 1.f);
+            vec4 farPoint = ndcToTexture * vec4(ndc.x, ndc.y, 1.f, 1.f);
+            vec3 origin = nearPoint.xyz() / nearPoint.w;
+            vec3 direction = farPoint.xyz() / farPoint.w - origin;
+
+            float tNear, tFar;
+            if (!intersectUnitCube(origin, direction, 0.f, 1.f, tNear, tFar))
+                continue;
+
+            size_t p = 4 * (static_cast<size_t>(y) * size.x + x);
+            vec3 front = tgt::clamp(origin + tNear * direction, vec3(0.f), vec3(1.f));
+            vec3 back = tgt::clamp(origin + tFar * direction, vec3(0.f), vec3(1.f));
+            for (int c = 0; c < 3; ++c) {
+                entryPoints[p + c] = front[c];
+                exitPoints[p + c] = back[c];
+            }
+            entryPoints[p + 3] = 1.f;
+            exitPoints[p + 3] = 1.f;
+        }
+    }
+
+    render(&entryPoints[0], &exitPoints[0], size, output);
+}
+
+bool SoftwareRaycaster::writeImage(const std::string& fileName, const float* image, const ivec2& size) {
+    std::ofstream file(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!file.good())
+        return false;
+
+    const bool alpha = fileName.size() >= 4 && fileName.substr(fileName.size() - 4) == ".pam";
+    const int channels = alpha ? 4 : 3;
+    if (alpha) {
+        file << "P7\nWIDTH " << size.x << "\nHEIGHT " << size.y
+             << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    }
+    else
+        file << "P6\n" << size.x << " " << size.y << "\n255\n";
+
+    std::vector<unsigned char> row(channels * size.x);
+    for (int y = size.y - 1; y >= 0; --y) {
+        const float* in = image + 4 * static_cast<size_t>(y) * size.x;
+        for (int x = 0; x < size.x; ++x, in += 4) {
+            // PAM stores straight alpha, PPM the colors composited onto black
+            float scale = (alpha && in[3] > 0.f) ? 1.f / in[3] : 1.f;
+            for (int c = 0; c < channels; ++c) {
+                float value = (c < 3) ? in[c] * scale : in[c];
+                row[channels * x + c] = static_cast<unsigned char>(std::min(std::max(value, 0.f), 1.f) * 255.f + 0.5f);
+            }
+        }
+        file.write(reinterpret_cast<const char*>(&row[0]), row.size());
+    }
+    return file.good();
+}
+
+} // namespace voreen
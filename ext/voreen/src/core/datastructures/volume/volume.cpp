@@ -43,6 +43,7 @@ Volume::Volume(const ivec3& dimensions, int bitsStored, const vec3& spacing, con
     , bitsStored_(bitsStored)
     , spacing_(spacing)
     , transformationMatrix_(transformation)
+    , formatId_(FORMAT_UNKNOWN)
 {
     calculateProperties();
 }
@@ -184,6 +185,39 @@ float Volume::getVoxelFloatLinear(const vec3& pos, size_t channel /*= 0*/) const
           + getVoxelFloat(llb.x, urf.y, urf.z, channel) * (1.f-p.x)*(    p.y)*(    p.z);// ulF
 }
 
+void Volume::getVoxelsFloat(size_t index, size_t count, float* values, size_t channel /*= 0*/) const {
+    for (size_t i = 0; i < count; ++i)
+        values[i] = getVoxelFloat(index + i, channel);
+}
+
+void Volume::setVoxelsFloat(const float* values, size_t index, size_t count, size_t channel /*= 0*/) {
+    for (size_t i = 0; i < count; ++i)
+        setVoxelFloat(values[i], index + i, channel);
+}
+
+void Volume::getVoxelsFloatNearest(const vec3* positions, size_t count, float* values,
+                                   size_t channel /*= 0*/) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        ivec3 pos = ivec3(floor(positions[i] + vec3(0.5f)));
+        values[i] = getVoxelFloat(max(min(pos, dimensions_ - 1), ivec3(0)), channel);
+    }
+}
+
+void Volume::getVoxelsFloatLinear(const vec3* positions, size_t count, float* values,
+                                  size_t channel /*= 0*/) const
+{
+    for (size_t i = 0; i < count; ++i)
+        values[i] = getVoxelFloatLinear(positions[i], channel);
+}
+
+void Volume::getVoxelsFloatLinear(const vec3& start, const vec3& step, size_t count, float* values,
+                                  size_t channel /*= 0*/) const
+{
+    for (size_t i = 0; i < count; ++i)
+        values[i] = getVoxelFloatLinear(start + static_cast<float>(i) * step, channel);
+}
+
 void Volume::calculateProperties() {
     //numVoxels_ = hmul(dimensions_); << does not work for very large volumes!
     numVoxels_ = (size_t)dimensions_.x * (size_t)dimensions_.y * (size_t)dimensions_.z;
@@ -279,6 +279,50 @@ void VolumeGL::setFilter(tgt::Texture::Filter filter) {
     filter_ = filter;
 }
 
+void VolumeGL::updateSubVolume(const ivec3& llf, const ivec3& urb) {
+    ivec3 dims = origVolume_->getDimensions();
+    ivec3 first = tgt::clamp(llf, ivec3(0), dims);
+    ivec3 last = tgt::clamp(urb, first, dims);
+    if (tgt::hor(tgt::equal(first, last)))
+        return;
+
+    // Textures built from a resized or converted copy cannot be patched
+    bool direct = (volume_ == origVolume_) && (textures_.size() == 1) && origVolume_->getData();
+#ifdef VRN_MODULE_FLOWREEN
+    direct = direct && !dynamic_cast<VolumeFlow3D*>(origVolume_);
+#endif
+    if (!direct) {
+        for (size_t i = 0; i < textures_.size(); ++i)
+            delete textures_[i];
+        textures_.clear();
+        if (volume_ != origVolume_)
+            delete volume_;
+        volume_ = origVolume_;
+        generateTextures();
+        return;
+    }
+
+    ivec3 size = last - first;
+    textures_[0]->bind();
+
+    // Address the region inside the full volume in main memory, restoring
+    // the pixel store state of later uploads afterwards
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, dims.x);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, dims.y);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, first.x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, first.y);
+    glPixelStorei(GL_UNPACK_SKIP_IMAGES, first.z);
+
+    glTexSubImage3D(GL_TEXTURE_3D, 0, first.x, first.y, first.z, size.x, size.y, size.z,
+                    format_, dataType_, origVolume_->getData());
+
+    glPopClientAttrib();
+
+    LGL_ERROR;
+}
+
 void VolumeGL::generateTextures() throw (std::bad_alloc) {
 
     if (!GpuCaps.is3DTexturingSupported()) {
@@ -0,0 +1,573 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#include "voreen/core/datastructures/volume/voxelexpression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace voreen {
+
+/**
+ * Recursive descent parser emitting the program while it reads the expression.
+ */
+class VoxelExpression::Parser {
+public:
+    Parser(VoxelExpression& expression, const std::string& text, const std::vector<std::string>& inputs,
+           const std::map<std::string, float>& constants)
+        : expression_(expression)
+        , text_(text)
+        , inputs_(inputs)
+        , constants_(constants)
+        , pos_(0)
+    {}
+
+    Operand parse() {
+        Operand result = parseConditional();
+        skipSpace();
+        if (pos_ < text_.size())
+            error("unexpected '" + text_.substr(pos_, 1) + "'");
+        return result;
+    }
+
+private:
+    void error(const std::string& message) const {
+        std::ostringstream msg;
+        msg << "VoxelExpression: " << message << " at position " << pos_ + 1 << " of \"" << text_ << "\"";
+        throw VoreenException(msg.str());
+    }
+
+    void skipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+            ++pos_;
+    }
+
+    /// Consumes token if it comes next.
+    bool accept(const char* token) {
+        skipSpace();
+        size_t length = std::string(token).size();
+        if (text_.compare(pos_, length, token) != 0)
+            return false;
+        // do not split "<=" into "<" and "=", or "||" into "|" and "|"
+        if (length == 1 && pos_ + 1 < text_.size() && text_[pos_ + 1] == '=' && std::string("<>=!").find(token[0]) != std::string::npos)
+            return false;
+        pos_ += length;
+        return true;
+    }
+
+    void expect(const char* token) {
+        if (!accept(token))
+            error(std::string("expected '") + token + "'");
+    }
+
+    Operand parseConditional() {
+        Operand condition = parseOr();
+        if (!accept("?"))
+            return condition;
+        Operand args[3];
+        args[0] = condition;
+        args[1] = parseConditional();
+        expect(":");
+        args[2] = parseConditional();
+        return expression_.emit(OP_SELECT, args, 3);
+    }
+
+    Operand parseOr() {
+        Operand args[2];
+        args[0] = parseAnd();
+        while (accept("||")) {
+            args[1] = parseAnd();
+            args[0] = expression_.emit(OP_OR, args, 2);
+        }
+        return args[0];
+    }
+
+    Operand parseAnd() {
+        Operand args[2];
+        args[0] = parseComparison();
+        while (accept("&&")) {
+            args[1] = parseComparison();
+            args[0] = expression_.emit(OP_AND, args, 2);
+        }
+        return args[0];
+    }
+
+    Operand parseComparison() {
+        Operand args[2];
+        args[0] = parseSum();
+        for (;;) {
+            OpCode op;
+            if (accept("=="))
+                op = OP_EQUAL;
+            else if (accept("!="))
+                op = OP_NOT_EQUAL;
+            else if (accept("<="))
+                op = OP_LESS_EQUAL;
+            else if (accept(">="))
+                op = OP_GREATER_EQUAL;
+            else if (accept("<"))
+                op = OP_LESS;
+            else if (accept(">"))
+                op = OP_GREATER;
+            else
+                return args[0];
+            args[1] = parseSum();
+            args[0] = expression_.emit(op, args, 2);
+        }
+    }
+
+    Operand parseSum() {
+        Operand args[2];
+        args[0] = parseProduct();
+        for (;;) {
+            OpCode op;
+            if (accept("+"))
+                op = OP_ADD;
+            else if (accept("-"))
+                op = OP_SUB;
+            else
+                return args[0];
+            args[1] = parseProduct();
+            args[0] = expression_.emit(op, args, 2);
+        }
+    }
+
+    Operand parseProduct() {
+        Operand args[2];
+        args[0] = parseUnary();
+        for (;;) {
+            OpCode op;
+            if (accept("*"))
+                op = OP_MUL;
+            else if (accept("/"))
+                op = OP_DIV;
+            else
+                return args[0];
+            args[1] = parseUnary();
+            args[0] = expression_.emit(op, args, 2);
+        }
+    }
+
+    Operand parseUnary() {
+        if (accept("-")) {
+            Operand arg = parseUnary();
+            return expression_.emit(OP_NEG, &arg, 1);
+        }
+        if (accept("!")) {
+            Operand arg = parseUnary();
+            return expression_.emit(OP_NOT, &arg, 1);
+        }
+        if (accept("+"))
+            return parseUnary();
+        return parsePrimary();
+    }
+
+    Operand parsePrimary() {
+        skipSpace();
+        if (pos_ >= text_.size())
+            error("unexpected end");
+
+        if (accept("(")) {
+            Operand result = parseConditional();
+            expect(")");
+            return result;
+        }
+
+        char c = text_[pos_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = text_.c_str() + pos_;
+            char* end = 0;
+            double value = std::strtod(begin, &end);
+            if (end == begin)
+                error("invalid number");
+            pos_ += end - begin;
+            Operand result;
+            result.kind = Operand::CONSTANT;
+            result.index = -1;
+            result.value = static_cast<float>(value);
+            return result;
+        }
+
+        if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_')
+            error("unexpected '" + text_.substr(pos_, 1) + "'");
+        size_t start = pos_;
+        while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_'))
+            ++pos_;
+        std::string name = text_.substr(start, pos_ - start);
+
+        if (accept("("))
+            return parseFunction(name, start);
+
+        for (size_t i = 0; i < inputs_.size(); ++i) {
+            if (inputs_[i] == name) {
+                Operand result;
+                result.kind = Operand::INPUT;
+                result.index = static_cast<int>(i);
+                result.value = 0.f;
+                return result;
+            }
+        }
+        std::map<std::string, float>::const_iterator constant = constants_.find(name);
+        if (constant != constants_.end()) {
+            Operand result;
+            result.kind = Operand::CONSTANT;
+            result.index = -1;
+            result.value = constant->second;
+            return result;
+        }
+        pos_ = start;
+        error("unknown variable '" + name + "'");
+        return Operand();
+    }
+
+    Operand parseFunction(const std::string& name, size_t start) {
+        // min and max take any number of arguments, the others a fixed one
+        if (name == "min" || name == "max") {
+            OpCode op = (name == "min") ? OP_MIN : OP_MAX;
+            Operand args[2];
+            args[0] = parseConditional();
+            expect(",");
+            args[1] = parseConditional();
+            args[0] = expression_.emit(op, args, 2);
+            while (accept(",")) {
+                args[1] = parseConditional();
+                args[0] = expression_.emit(op, args, 2);
+            }
+            expect(")");
+            return args[0];
+        }
+        if (name == "clamp") {
+            // clamp(x, lo, hi) = min(max(x, lo), hi)
+            Operand args[2];
+            args[0] = parseConditional();
+            expect(",");
+            args[1] = parseConditional();
+            args[0] = expression_.emit(OP_MAX, args, 2);
+            expect(",");
+            args[1] = parseConditional();
+            args[0] = expression_.emit(OP_MIN, args, 2);
+            expect(")");
+            return args[0];
+        }
+        if (name == "pow") {
+            Operand args[2];
+            args[0] = parseConditional();
+            expect(",");
+            args[1] = parseConditional();
+            expect(")");
+            return expression_.emit(OP_POW, args, 2);
+        }
+
+        OpCode op;
+        if (name == "abs")
+            op = OP_ABS;
+        else if (name == "sqrt")
+            op = OP_SQRT;
+        else if (name == "exp")
+            op = OP_EXP;
+        else if (name == "log")
+            op = OP_LOG;
+        else if (name == "floor")
+            op = OP_FLOOR;
+        else if (name == "ceil")
+            op = OP_CEIL;
+        else {
+            pos_ = start;
+            error("unknown function '" + name + "'");
+            return Operand();
+        }
+        Operand arg = parseConditional();
+        expect(")");
+        return expression_.emit(op, &arg, 1);
+    }
+
+    VoxelExpression& expression_;
+    const std::string& text_;
+    const std::vector<std::string>& inputs_;
+    const std::map<std::string, float>& constants_;
+    size_t pos_;
+};
+
+VoxelExpression::VoxelExpression()
+    : numLiveRegisters_(0)
+    , numRegisters_(0)
+{}
+
+void VoxelExpression::compile(const std::string& expression, const std::vector<std::string>& inputs,
+                              const std::map<std::string, float>& constants)
+    throw (VoreenException)
+{
+    expression_.clear();
+    program_.clear();
+    constants_.clear();
+    usedInputs_.assign(inputs.size(), false);
+    numLiveRegisters_ = 0;
+    numRegisters_ = 0;
+
+    Operand result;
+    try {
+        result = Parser(*this, expression, inputs, constants).parse();
+    }
+    catch (...) {
+        program_.clear();
+        constants_.clear();
+        usedInputs_.assign(inputs.size(), false);
+        throw;
+    }
+
+    // the final value always ends up in register 0, unless it is an input or a constant
+    if (result.kind != Operand::REGISTER) {
+        Instruction copy;
+        copy.op = OP_COPY;
+        copy.dst = 0;
+        copy.numArgs = 1;
+        copy.args[0] = result;
+        if (result.kind == Operand::CONSTANT) {
+            copy.args[0].index = static_cast<int>(constants_.size());
+            constants_.push_back(result.value);
+        }
+        else
+            usedInputs_[result.index] = true;
+        program_.push_back(copy);
+        numRegisters_ = std::max(numRegisters_, 1);
+    }
+    expression_ = expression;
+}
+
+bool VoxelExpression::usesInput(size_t i) const {
+    return i < usedInputs_.size() && usedInputs_[i];
+}
+
+size_t VoxelExpression::getScratchSize(size_t count) const {
+    // register 0 is the result
+    return (std::max(numRegisters_ - 1, 0) + constants_.size()) * count;
+}
+
+VoxelExpression::Operand VoxelExpression::emit(OpCode op, Operand* args, int numArgs) {
+    bool constant = true;
+    for (int i = 0; i < numArgs; ++i)
+        constant = constant && (args[i].kind == Operand::CONSTANT);
+    if (constant) {
+        Operand result;
+        result.kind = Operand::CONSTANT;
+        result.index = -1;
+        result.value = apply(op, args[0].value, numArgs > 1 ? args[1].value : 0.f, numArgs > 2 ? args[2].value : 0.f);
+        return result;
+    }
+
+    Instruction instruction;
+    instruction.op = op;
+    instruction.numArgs = numArgs;
+    for (int i = 0; i < numArgs; ++i) {
+        instruction.args[i] = args[i];
+        if (args[i].kind == Operand::REGISTER) {
+            // the registers of the arguments are the topmost ones, free them
+            --numLiveRegisters_;
+        }
+        else if (args[i].kind == Operand::CONSTANT) {
+            instruction.args[i].index = static_cast<int>(constants_.size());
+            constants_.push_back(args[i].value);
+        }
+        else
+            usedInputs_[args[i].index] = true;
+    }
+    instruction.dst = numLiveRegisters_++;
+    numRegisters_ = std::max(numRegisters_, numLiveRegisters_);
+    program_.push_back(instruction);
+
+    Operand result;
+    result.kind = Operand::REGISTER;
+    result.index = instruction.dst;
+    result.value = 0.f;
+    return result;
+}
+
+float VoxelExpression::apply(OpCode op, float a, float b, float c) {
+    switch (op) {
+        case OP_COPY:           return a;
+        case OP_NEG:            return -a;
+        case OP_NOT:            return (a == 0.f) ? 1.f : 0.f;
+        case OP_ABS:            return std::fabs(a);
+        case OP_SQRT:           return std::sqrt(a);
+        case OP_EXP:            return std::exp(a);
+        case OP_LOG:            return std::log(a);
+        case OP_FLOOR:          return std::floor(a);
+        case OP_CEIL:           return std::ceil(a);
+        case OP_ADD:            return a + b;
+        case OP_SUB:            return a - b;
+        case OP_MUL:            return a * b;
+        case OP_DIV:            return a / b;
+        case OP_MIN:            return std::min(a, b);
+        case OP_MAX:            return std::max(a, b);
+        case OP_POW:            return std::pow(a, b);
+        case OP_LESS:           return (a < b) ? 1.f : 0.f;
+        case OP_LESS_EQUAL:     return (a <= b) ? 1.f : 0.f;
+        case OP_GREATER:        return (a > b) ? 1.f : 0.f;
+        case OP_GREATER_EQUAL:  return (a >= b) ? 1.f : 0.f;
+        case OP_EQUAL:          return (a == b) ? 1.f : 0.f;
+        case OP_NOT_EQUAL:      return (a != b) ? 1.f : 0.f;
+        case OP_AND:            return (a != 0.f && b != 0.f) ? 1.f : 0.f;
+        case OP_OR:             return (a != 0.f || b != 0.f) ? 1.f : 0.f;
+        case OP_SELECT:         return (a != 0.f) ? b : c;
+    }
+    return 0.f;
+}
+
+void VoxelExpression::evaluate(const float* const* inputs, size_t count, float* result, float* scratch) const {
+    // scratch holds the registers 1..n-1, then the constant rows
+    float* constantRows = scratch + std::max(numRegisters_ - 1, 0) * count;
+    for (size_t i = 0; i < constants_.size(); ++i)
+        std::fill(constantRows + i * count, constantRows + (i + 1) * count, constants_[i]);
+
+    for (size_t n = 0; n < program_.size(); ++n) {
+        const Instruction& instruction = program_[n];
+        float* r = (instruction.dst == 0) ? result : scratch + (instruction.dst - 1) * count;
+
+        const float* args[3] = { 0, 0, 0 };
+        for (int i = 0; i < instruction.numArgs; ++i) {
+            const Operand& arg = instruction.args[i];
+            if (arg.kind == Operand::INPUT)
+                args[i] = inputs[arg.index];
+            else if (arg.kind == Operand::CONSTANT)
+                args[i] = constantRows + arg.index * count;
+            else
+                args[i] = (arg.index == 0) ? result : scratch + (arg.index - 1) * count;
+        }
+        const float* a = args[0];
+        const float* b = args[1];
+        const float* c = args[2];
+
+        // one loop per operation, the same formulas as in apply()
+        switch (instruction.op) {
+            case OP_COPY:
+                std::copy(a, a + count, r);
+                break;
+            case OP_NEG:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = -a[i];
+                break;
+            case OP_NOT:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] == 0.f) ? 1.f : 0.f;
+                break;
+            case OP_ABS:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::fabs(a[i]);
+                break;
+            case OP_SQRT:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::sqrt(a[i]);
+                break;
+            case OP_EXP:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::exp(a[i]);
+                break;
+            case OP_LOG:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::log(a[i]);
+                break;
+            case OP_FLOOR:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::floor(a[i]);
+                break;
+            case OP_CEIL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::ceil(a[i]);
+                break;
+            case OP_ADD:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = a[i] + b[i];
+                break;
+            case OP_SUB:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = a[i] - b[i];
+                break;
+            case OP_MUL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = a[i] * b[i];
+                break;
+            case OP_DIV:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = a[i] / b[i];
+                break;
+            case OP_MIN:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::min(a[i], b[i]);
+                break;
+            case OP_MAX:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::max(a[i], b[i]);
+                break;
+            case OP_POW:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = std::pow(a[i], b[i]);
+                break;
+            case OP_LESS:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] < b[i]) ? 1.f : 0.f;
+                break;
+            case OP_LESS_EQUAL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] <= b[i]) ? 1.f : 0.f;
+                break;
+            case OP_GREATER:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] > b[i]) ? 1.f : 0.f;
+                break;
+            case OP_GREATER_EQUAL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] >= b[i]) ? 1.f : 0.f;
+                break;
+            case OP_EQUAL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] == b[i]) ? 1.f : 0.f;
+                break;
+            case OP_NOT_EQUAL:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] != b[i]) ? 1.f : 0.f;
+                break;
+            case OP_AND:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] != 0.f && b[i] != 0.f) ? 1.f : 0.f;
+                break;
+            case OP_OR:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] != 0.f || b[i] != 0.f) ? 1.f : 0.f;
+                break;
+            case OP_SELECT:
+                for (size_t i = 0; i < count; ++i)
+                    r[i] = (a[i] != 0.f) ? b[i] : c[i];
+                break;
+        }
+    }
+}
+
+} // namespace voreen
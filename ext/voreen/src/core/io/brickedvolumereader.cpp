@@ -32,6 +32,10 @@
 #include <iostream>
 #include <stdio.h>
 
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
 #include "tgt/exception.h"
 #include "tgt/vector.h"
 
@@ -269,13 +273,23 @@ void BrickedVolumeReader::readBrick(Brick *brick, char* volumeData, int numBytes
 
     #ifdef _MSC_VER
         _fseeki64(bvFile_,positionInFile,SEEK_SET);
+
+        if (fread(volumeData, 1, numBytes, bvFile_) == 0)
+            LWARNING("fread() failed");
     #else
-        fseek(bvFile_,positionInFile,SEEK_SET);
+        // positioned reads leave the file offset alone, so several threads can read bricks at once
+        int fd = fileno(bvFile_);
+        size_t bytesRead = 0;
+        while (bytesRead < static_cast<size_t>(numBytes)) {
+            ssize_t result = pread(fd, volumeData + bytesRead, numBytes - bytesRead,
+                                   static_cast<off_t>(positionInFile + bytesRead));
+            if (result <= 0) {
+                LWARNING("pread() failed");
+                break;
+            }
+            bytesRead += static_cast<size_t>(result);
+        }
     #endif
-
-
-    if (fread(volumeData, 1, numBytes, bvFile_) == 0)
-        LWARNING("fread() failed");
 }
 
 
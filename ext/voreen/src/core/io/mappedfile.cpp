@@ -0,0 +1,113 @@
+/**********************************************************************
+ *                                                                    *
+ * Voreen - The Volume Rendering Engine                               *
+ *                                                                    *
+ * Copyright (C) 2005-2010 The Voreen Team. <http://www.voreen.org>   *
+ *                                                                    *
+ * This file is part of the Voreen software package. Voreen is free   *
+ * software: you can redistribute it and/or modify it under the terms *
+ * of the GNU General Public License version 2 as published by the    *
+ * Free Software Foundation.                                          *
+ *                                                                    *
+ * Voreen is distributed in the hope that it will be useful,          *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the       *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * in the file "LICENSE.txt" along with this program.                 *
+ * If not, see <http://www.gnu.org/licenses/>.                        *
+ *                                                                    *
+ * The authors reserve all rights not expressly granted herein. For   *
+ * non-commercial academic use see the license exception specified in *
+ * the file "LICENSE-academic.txt". To get information about          *
+ * commercial licensing please contact the authors.                   *
+ *                                                                    *
+ **********************************************************************/
+
+
+#include "voreen/core/io/mappedfile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace voreen {
+
+MappedFile::MappedFile(void* base, size_t baseLength, char* data, uint64_t size)
+    : base_(base)
+    , baseLength_(baseLength)
+    , data_(data)
+    , size_(size)
+{}
+
+MappedFile::~MappedFile() {
+#ifndef WIN32
+    munmap(base_, baseLength_);
+#endif
+}
+
+#ifndef WIN32
+
+MappedFile* MappedFile::map(const std::string& fileName, uint64_t offset, uint64_t length) {
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t pageOffset = offset % pageSize;
+    const uint64_t baseLength = pageOffset + length;
+
+    // the mapping has to fit into the address space and the file offset into off_t
+    if (length == 0 || baseLength != static_cast<size_t>(baseLength)
+        || offset - pageOffset != static_cast<uint64_t>(static_cast<off_t>(offset - pageOffset)))
+    {
+        return 0;
+    }
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < offset + length) {
+        close(fd);
+        return 0;
+    }
+
+    void* base = mmap(0, static_cast<size_t>(baseLength), PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      fd, static_cast<off_t>(offset - pageOffset));
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    return new MappedFile(base, static_cast<size_t>(baseLength),
+                          static_cast<char*>(base) + pageOffset, length);
+}
+
+void MappedFile::adviseSequential() const {
+    madvise(base_, baseLength_, MADV_SEQUENTIAL);
+    madvise(base_, baseLength_, MADV_WILLNEED);
+}
+
+#else
+
+MappedFile* MappedFile::map(const std::string& /*fileName*/, uint64_t /*offset*/, uint64_t /*length*/) {
+    // not supported, the readers fall back to reading the file
+    return 0;
+}
+
+void MappedFile::adviseSequential() const {
+}
+
+#endif
+
+char* MappedFile::getData() const {
+    return data_;
+}
+
+uint64_t MappedFile::getSize() const {
+    return size_;
+}
+
+} // namespace voreen
@@ -32,10 +32,14 @@
 #include <iostream>
 #include <sstream>
 #include <limits>
+#include <typeinfo>
+#include <cstring>
+#include <cstddef>
 
 #include "tgt/exception.h"
 #include "tgt/filesystem.h"
 
+#include "voreen/core/io/mappedfile.h"
 #include "voreen/core/io/progressbar.h"
 #include "voreen/core/datastructures/volume/volumeatomic.h"
 #include "voreen/core/datastructures/volume/volumeoperator.h"
@@ -137,19 +141,253 @@ VolumeHandle* RawVolumeReader::read(const VolumeOrigin& origin)
 
 namespace {
 
-inline void endian_swap(uint32_t& x) {
-    x = (x>>24) |
-        ((x<<8) & 0x00FF0000) |
-        ((x>>8) & 0x0000FF00) |
-        (x<<24);
+/**
+ * Loads the element of type S at @p p, which does not need to be aligned,
+ * reversing its byte order if Swap is set.
+ */
+template<bool Swap, class S>
+inline S loadElement(const char* p) {
+    S v;
+    if (Swap) {
+        char bytes[sizeof(S)];
+        for (size_t k = 0; k < sizeof(S); ++k)
+            bytes[k] = p[sizeof(S) - 1 - k];
+        memcpy(&v, bytes, sizeof(S));
+    }
+    else
+        memcpy(&v, p, sizeof(S));
+    return v;
+}
+
+/// Stores the elements unchanged.
+template<class D>
+struct CopyElement {
+    template<class S>
+    D operator()(S v) const {
+        return static_cast<D>(v);
+    }
+};
+
+/**
+ * Maps the elements linearly from a source range to a destination range, the same
+ * way VolumeAtomic::getVoxelFloat() and setVoxelFloat() do.
+ */
+template<class D>
+struct MapElementRange {
+    MapElementRange(tgt::vec2 srcRange, tgt::vec2 destRange)
+        : srcMin_(srcRange.x), srcRange_(srcRange.y - srcRange.x)
+        , destMin_(destRange.x), destRange_(destRange.y - destRange.x)
+    {}
+
+    template<class S>
+    D operator()(S v) const {
+        float value = (static_cast<float>(v) - srcMin_) / srcRange_;
+        return static_cast<D>(destMin_ + value*destRange_);
+    }
+
+    float srcMin_, srcRange_;
+    float destMin_, destRange_;
+};
+
+/**
+ * Converts the raw elements of type S at @p src into @p dest in one parallel
+ * pass. @p src and @p dest may be the same memory if S and D have the same size.
+ */
+template<bool Swap, class S, class D, class Op>
+void convertElements(const char* src, D* dest, size_t numElements, const Op& op) {
+    const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(numElements);
+    #ifdef _OPENMP
+    #pragma omp parallel for
+    #endif
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        dest[i] = op(loadElement<Swap, S>(src + i*sizeof(S)));
+}
+
+template<class S, class D, class Op>
+void convertElements(const char* src, D* dest, size_t numElements, bool swap, const Op& op) {
+    if (swap)
+        convertElements<true, S>(src, dest, numElements, op);
+    else
+        convertElements<false, S>(src, dest, numElements, op);
 }
 
-inline void endian_swap(uint16_t& x) {
-    x = (x>>8) | (x<<8);
+/**
+ * Returns the minimum and maximum of the raw elements of type S at @p src.
+ */
+template<class S>
+tgt::vec2 elementMinMax(const char* src, size_t numElements, bool swap) {
+    const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(numElements);
+    if (n == 0)
+        return tgt::vec2(0.f);
+
+    S min = swap ? loadElement<true, S>(src) : loadElement<false, S>(src);
+    S max = min;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        S localMin = min;
+        S localMax = max;
+
+        #ifdef _OPENMP
+        #pragma omp for
+        #endif
+        for (std::ptrdiff_t i = 1; i < n; ++i) {
+            S v = swap ? loadElement<true, S>(src + i*sizeof(S)) : loadElement<false, S>(src + i*sizeof(S));
+            if (v < localMin)
+                localMin = v;
+            if (localMax < v)
+                localMax = v;
+        }
+
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        {
+            if (localMin < min)
+                min = localMin;
+            if (max < localMax)
+                max = localMax;
+        }
+    }
+    return tgt::vec2(static_cast<float>(min), static_cast<float>(max));
 }
 
 }
 
+template<class S, class T>
+VolumeAtomic<T>* RawVolumeReader::readVoxels(const std::string& fileName, size_t firstSlice, size_t lastSlice,
+                                             int bitsStored)
+    throw (tgt::CorruptedFileException, tgt::IOException, std::bad_alloc)
+{
+    typedef typename VolumeElement<T>::BaseType Base;
+    const ReadHints& h = hints_;
+
+    if (bitsStored == 0)
+        bitsStored = VolumeAtomic<T>::BITS_PER_VOXEL;
+
+    const size_t elementsPerVoxel = static_cast<size_t>(VolumeElement<T>::getNumChannels());
+    const size_t numElements = static_cast<size_t>(h.dimensions_.x) * static_cast<size_t>(h.dimensions_.y)
+        * static_cast<size_t>(h.dimensions_.z) * elementsPerVoxel;
+
+    //If we only have to read slices, skip to the position we have to read the first
+    //slice from
+    uint64_t skip = (uint64_t)h.dimensions_.x * (uint64_t)h.dimensions_.y * (uint64_t)firstSlice *
+        (uint64_t)(elementsPerVoxel * sizeof(S));
+
+    // now add that to the headerskip we might have received
+    uint64_t offset = h.headerskip_ + skip;
+
+    // need to swap endianess?
+    const bool swap = h.bigEndianByteOrder_ && sizeof(S) > 1 &&
+        (h.format_ == "FLOAT" || h.format_ == "USHORT" || h.format_ == "SHORT" || h.format_ == "USHORT_12" ||
+         h.format_ == "UINT" || h.format_ == "INT");
+    if (swap)
+        LWARNING("Swapping byte order of " << sizeof(S) * 8 << "-bit volume");
+
+    // convert if neccessary, normalize float data to [0.0; 1.0] if spread values are given
+    const bool convert = typeid(S) != typeid(Base);
+    const bool spread = typeid(T) == typeid(float) && h.format_ == "FLOAT" && h.spreadMin_ != h.spreadMax_;
+
+    if (getProgressBar()) {
+        getProgressBar()->setTitle("Loading Volume");
+        getProgressBar()->setMessage("Loading volume: " + fileName);
+    }
+
+    // Voxels already stored in the volume's format are used in place: the pages are
+    // only read from disk when the voxels are accessed.
+    MappedFile* mapping = MappedFile::map(fileName, offset, numElements * sizeof(S));
+    if (mapping && !swap && !convert && !spread && offset % sizeof(S) == 0) {
+        LINFO("Mapping voxels from " << fileName);
+        return new MappedVolume<T>(mapping, h.dimensions_, h.spacing_, h.transformation_, bitsStored);
+    }
+
+    VolumeAtomic<T>* volume = 0;
+    VolumeAtomic<S>* raw = 0;
+    try {
+        volume = new VolumeAtomic<T>(h.dimensions_, h.spacing_, h.transformation_, bitsStored);
+        if (!mapping && convert)
+            raw = new VolumeAtomic<S>(h.dimensions_, h.spacing_);
+    }
+    catch (std::bad_alloc&) {
+        delete volume;
+        delete mapping;
+        throw;
+    }
+
+    const char* src;
+    if (mapping) {
+        mapping->adviseSequential();
+        src = mapping->getData();
+    }
+    else {
+        // read the file, into the volume itself if no conversion is needed
+        Volume* target = raw ? static_cast<Volume*>(raw) : static_cast<Volume*>(volume);
+
+        FILE* fin = fopen(fileName.c_str(), "rb");
+        if (fin == 0) {
+            delete volume;
+            delete raw;
+            throw tgt::IOException("Unable to open raw file for reading", fileName);
+        }
+
+        #ifdef _MSC_VER
+            _fseeki64(fin, offset, SEEK_SET);
+        #else
+            fseek(fin, offset, SEEK_SET);
+        #endif
+
+        target->clear();
+        VolumeReader::read(target, fin);
+
+        if (lastSlice == 0) {
+            if (feof(fin)) {
+                fclose(fin);
+                delete volume;
+                delete raw;
+                // throw exception
+                throw tgt::CorruptedFileException("unexpected EOF: raw file truncated or ObjectModel '" +
+                                                  h.objectModel_ + "' invalid", fileName);
+            }
+        }
+
+        fclose(fin);
+        src = reinterpret_cast<const char*>(target->getData());
+    }
+
+    // swap, convert and normalize in a single pass
+    Base* dest = reinterpret_cast<Base*>(volume->getData());
+    if (convert) {
+        tgt::vec2 srcRange;
+        if (std::numeric_limits<S>::is_integer) {
+            srcRange = tgt::vec2(VolumeElement<S>::rangeMinElement(), VolumeElement<S>::rangeMaxElement());
+        }
+        else {
+            srcRange = elementMinMax<S>(src, numElements, swap);
+            LINFO("Converting float volume with data range [" << srcRange.x << "; " << srcRange.y << "] to "
+                  << volume->getBitsAllocated() << " bit (normalized).");
+        }
+        convertElements<S>(src, dest, numElements, swap, MapElementRange<Base>(srcRange, volume->elementRange()));
+    }
+    else if (spread) {
+        LINFO("Normalizing float volume using spread " << tgt::vec2(h.spreadMin_, h.spreadMax_));
+        convertElements<S>(src, dest, numElements, swap,
+                           MapElementRange<Base>(tgt::vec2(h.spreadMin_, h.spreadMax_), tgt::vec2(0.f, 1.f)));
+    }
+    else if (swap || mapping) {
+        convertElements<S>(src, dest, numElements, swap, CopyElement<Base>());
+    }
+
+    delete mapping;
+    delete raw;
+
+    if (getProgressBar())
+        getProgressBar()->setProgress(1.f);
+
+    return volume;
+}
+
 VolumeCollection* RawVolumeReader::readSlices(const std::string &url, size_t firstSlice, size_t lastSlice )
     throw (tgt::CorruptedFileException, tgt::IOException, std::bad_alloc)
 {
@@ -179,222 +417,90 @@ VolumeCollection* RawVolumeReader::readSlices(const std::string &url, size_t fir
     if (h.dimensions_ == tgt::ivec3::zero)
         throw tgt::CorruptedFileException("No readHints set.", fileName);
 
-    FILE* fin;
-    fin = fopen(fileName.c_str(),"rb");
-
-    if (fin == 0)
-        throw tgt::IOException("Unable to open raw file for reading", fileName);
-
     Volume* volume;
 
     if (h.objectModel_ == "I") {
         if (h.format_ == "UCHAR") {
             LINFO(info << "(8 bit dataset)");
-            VolumeUInt8* v = new VolumeUInt8(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint8_t, uint8_t>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "CHAR") {
             LWARNING(info << "(8 bit signed dataset, converting to 8 bit unsigned)");
-            VolumeInt8* v = new VolumeInt8(h.dimensions_, h.spacing_);
-            volume = v;
+            volume = readVoxels<int8_t, uint8_t>(fileName, firstSlice, lastSlice);
         }
         else if ((h.format_ == "USHORT" && h.bitsStored_ == 12) || h.format_ == "USHORT_12") {
             LINFO(info << "(12 bit dataset)");
-            VolumeUInt16* v = new VolumeUInt16(h.dimensions_, h.spacing_, h.transformation_, 12);
-            volume = v;
+            volume = readVoxels<uint16_t, uint16_t>(fileName, firstSlice, lastSlice, 12);
         }
         else if (h.format_ == "USHORT") {
             LINFO(info << "(16 bit dataset)");
-            VolumeUInt16* v = new VolumeUInt16(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint16_t, uint16_t>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "SHORT") {
             LWARNING(info << "(16 bit signed dataset, converting to 16 bit unsigned)");
-            VolumeInt16* v = new VolumeInt16(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<int16_t, uint16_t>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "UINT") {
             LWARNING(info << "(32 bit dataset, converting to 16 bit)");
-            VolumeUInt32* v = new VolumeUInt32(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint32_t, uint16_t>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "INT") {
             LWARNING(info << "(32 bit signed dataset, converting to 16 bit unsigned)");
-            VolumeInt32* v = new VolumeInt32(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<int32_t, uint16_t>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "FLOAT") {
             LINFO(info << "(32 bit float dataset)");
-            VolumeFloat* v = new VolumeFloat(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<float, float>(fileName, firstSlice, lastSlice);
         }
-        else if (h.format_ == "FLOAT8" || h.format_ == "FLOAT16") {
-            LWARNING(info << "(32 bit float dataset, converting to 8 or 16 bit unsigned int)");
-            VolumeFloat* v = new VolumeFloat(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+        else if (h.format_ == "FLOAT8") {
+            LWARNING(info << "(32 bit float dataset, converting to 8 bit unsigned int)");
+            volume = readVoxels<float, uint8_t>(fileName, firstSlice, lastSlice);
+        }
+        else if (h.format_ == "FLOAT16") {
+            LWARNING(info << "(32 bit float dataset, converting to 16 bit unsigned int)");
+            volume = readVoxels<float, uint16_t>(fileName, firstSlice, lastSlice);
         }
         else {
-            fclose(fin);
             throw tgt::CorruptedFileException("Format '" + h.format_ + "' not supported", fileName);
         }
     }
     else if (h.objectModel_ == "RGBA") {
         if (h.format_ == "UCHAR") {
             LINFO(info << "(4x8 bit dataset)");
-            Volume4xUInt8* v = new Volume4xUInt8(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint8_t, tgt::col4>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "USHORT") {
             LINFO(info << "(4x16 bit dataset)");
-            Volume4xUInt16* v = new Volume4xUInt16(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint16_t, tgt::Vector4<uint16_t> >(fileName, firstSlice, lastSlice);
         }
         else {
-            fclose(fin);
             throw tgt::CorruptedFileException("Format '" + h.format_ + "' not supported for object model RGBA", fileName);
         }
     }
     else if (h.objectModel_ == "RGB") {
         if (h.format_ == "UCHAR") {
             LINFO(info << "(3x8 bit dataset)");
-            Volume3xUInt8* v = new Volume3xUInt8(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint8_t, tgt::col3>(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "USHORT") {
             LINFO(info << "(3x16 bit dataset)");
-            Volume3xUInt16* v = new Volume3xUInt16(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<uint16_t, tgt::Vector3<uint16_t> >(fileName, firstSlice, lastSlice);
         }
         else if (h.format_ == "FLOAT") {
             LINFO(info << "(3x32 bit dataset)");
-            Volume3xFloat* v = new Volume3xFloat(h.dimensions_, h.spacing_, h.transformation_);
-            volume = v;
+            volume = readVoxels<float, tgt::vec3>(fileName, firstSlice, lastSlice);
         } else {
-            fclose(fin);
             throw tgt::CorruptedFileException("Format '" + h.format_ + "' not supported for object model RGB", fileName);
         }
     }
     else if (h.objectModel_ == "LA") { // luminance alpha
         LINFO(info << "(luminance16 alpha16 dataset)");
-        Volume4xUInt8* v = new Volume4xUInt8(h.dimensions_, h.spacing_, h.transformation_);
-        volume = v;
+        volume = readVoxels<uint8_t, tgt::col4>(fileName, firstSlice, lastSlice);
     }
     else {
-        fclose(fin);
         throw tgt::CorruptedFileException("unsupported ObjectModel '" + h.objectModel_ + "'", fileName);
     }
 
-    //If we only have to read slices, skip to the position we have to read the first
-    //slice from
-    uint64_t skip = (uint64_t)h.dimensions_.x * (uint64_t)h.dimensions_.y * (uint64_t)firstSlice*
-        (uint64_t) (volume->getBitsAllocated() / 8);
-
-    // now add that to the headerskip we might have received
-    uint64_t offset = h.headerskip_ + skip;
-
-    #ifdef _MSC_VER
-        _fseeki64(fin, offset, SEEK_SET);
-    #else
-        fseek(fin, offset, SEEK_SET);
-    #endif
-
-    volume->clear();
-
-    if (getProgressBar()) {
-        getProgressBar()->setTitle("Loading Volume");
-        // getProgress()->setMessage("Loading volume: " + tgt::FileSystem::fileName(fileName));
-        getProgressBar()->setMessage("Loading volume: " + fileName);
-    }
-    VolumeReader::read(volume, fin);
-
-    if (lastSlice == 0) {
-        if (feof(fin) ) {
-            delete volume;
-            // throw exception
-            throw tgt::CorruptedFileException("unexpected EOF: raw file truncated or ObjectModel '" +
-                                              h.objectModel_ + "' invalid", fileName);
-        }
-    }
-
-    fclose(fin);
-
-    // need to swap endianess?
-    if (h.bigEndianByteOrder_) {
-        if (h.format_ == "FLOAT") {
-            LWARNING("Swapping byte order of 32-bit float volume");
-            uint32_t* data = reinterpret_cast<uint32_t*>(volume->getData());
-            int numElements = volume->getNumVoxels()*volume->getNumChannels();
-            for (int i=0; i<numElements; i++) {
-                endian_swap(data[i]);
-            }
-            VolumeFloat* vf = dynamic_cast<VolumeFloat*>(volume);
-            if (vf)
-                vf->invalidate();
-        }
-        else if (h.format_ == "USHORT" || h.format_ == "SHORT" || h.format_ == "USHORT_12") {
-            LWARNING("Swapping byte order of 16-bit volume");
-            uint16_t* data = reinterpret_cast<uint16_t*>(volume->getData());
-            int numElements = volume->getNumVoxels()*volume->getNumChannels();
-            for (int i=0; i<numElements; i++) {
-                endian_swap(data[i]);
-            }
-        }
-        else if (h.format_ == "UINT" || h.format_ == "INT") {
-            LWARNING("Swapping byte order of 32-bit volume");
-            uint32_t* data = reinterpret_cast<uint32_t*>(volume->getData());
-            int numElements = volume->getNumVoxels()*volume->getNumChannels();
-            for (int i=0; i<numElements; i++) {
-                endian_swap(data[i]);
-            }
-        }
-    }
-
-    // convert if neccessary
-    Volume* conv = 0;
-
-    if (h.format_ == "FLOAT8")
-        conv = new VolumeUInt8(h.dimensions_, h.spacing_);
-    else if (h.format_ == "FLOAT16")
-        conv = new VolumeUInt16(h.dimensions_, h.spacing_);
-    else if (h.format_ == "CHAR")
-        conv = new VolumeUInt8(h.dimensions_, h.spacing_);
-    else if (h.format_ == "SHORT" || h.format_ == "UINT" || h.format_ == "INT")
-        conv = new VolumeUInt16(h.dimensions_, h.spacing_);
-
-    if (conv) {
-        VolumeOperatorConvert voConvert(volume);
-        voConvert.apply<void>(conv);
-        std::swap(conv, volume);
-        delete conv;
-    }
-
-    // normalize float data to [0.0; 1.0]
-    if (h.format_ == "FLOAT") {
-        VolumeFloat* vf = dynamic_cast<VolumeFloat*>(volume);
-
-        if (vf && h.spreadMin_ != h.spreadMax_) {
-            LINFO("Normalizing float volume with min/max: " << tgt::vec2(vf->min(), vf->max()));
-            const size_t n = vf->getNumVoxels();
-
-            // use spread values  if available
-            if (h.spreadMin_ != h.spreadMax_) {
-                LINFO("Using spread " << tgt::vec2(h.spreadMin_, h.spreadMax_));
-
-                const float d = h.spreadMax_ - h.spreadMin_;
-                float* voxel = vf->voxel();
-                for (size_t i = 0; i < n; ++i)
-                    voxel[i] = (voxel[i] - h.spreadMin_) / d;
-            } else {
-                const float d = vf->max() - vf->min();
-                const float p = vf->min();
-                float* voxel = vf->voxel();
-                for (size_t i = 0; i < n; ++i)
-                    voxel[i] = (voxel[i] - p) / d;
-            }
-            vf->invalidate();
-        }
-    }
-
     if (h.sliceOrder_ == "-x") {
         LINFO("slice order is -x, reversing order to +x...\n");
         reverseXSliceOrder(volume);
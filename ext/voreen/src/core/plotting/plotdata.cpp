@@ -38,29 +38,88 @@
 #include <algorithm>
 #include <limits>
 #include <sstream>
+#include <math.h>
 
 namespace voreen {
 
+// compares physical rows by the key columns, tags are compared by their rank in the sorted dictionary
+class PlotData::KeyLess {
+public:
+    KeyLess(const PlotData& data)
+        : data_(data)
+        , ranks_(data.getKeyColumnCount())
+    {
+        for (int i = 0; i < data_.getKeyColumnCount(); ++i) {
+            if (data_.getColumnType(i) != STRING)
+                continue;
+            const std::vector<std::string>& dictionary = data_.columns_[i].dictionary;
+            std::map<std::string, int> sortedTags;
+            for (size_t t = 0; t < dictionary.size(); ++t)
+                sortedTags.insert(std::make_pair(dictionary[t], static_cast<int>(t)));
+            ranks_[i].resize(dictionary.size());
+            int rank = 0;
+            for (std::map<std::string, int>::const_iterator it = sortedTags.begin(); it != sortedTags.end(); ++it)
+                ranks_[i][it->second] = rank++;
+        }
+    }
+
+    bool operator()(int lhs, int rhs) const {
+        for (int i = 0; i < data_.getKeyColumnCount(); ++i) {
+            const Column& column = data_.columns_[i];
+            // null cells are smaller than all other cells
+            if (data_.getColumnType(i) == STRING) {
+                int l = column.tags[lhs];
+                int r = column.tags[rhs];
+                if (l == r)
+                    continue;
+                if (l < 0 || r < 0)
+                    return l < 0;
+                return ranks_[i][l] < ranks_[i][r];
+            }
+            else {
+                plot_t l = column.values[lhs];
+                plot_t r = column.values[rhs];
+                bool lNull = (l != l);
+                bool rNull = (r != r);
+                if (lNull || rNull) {
+                    if (lNull && rNull)
+                        continue;
+                    return lNull;
+                }
+                if (l < r)
+                    return true;
+                if (l > r)
+                    return false;
+            }
+        }
+        return false;
+    }
+
+private:
+    const PlotData& data_;
+    std::vector<std::vector<int> > ranks_;    ///< rank of each tag of the string key columns
+};
+
 PlotData::PlotData(int keyColumnCount, int dataColumnCount)
     : PlotBase(keyColumnCount, dataColumnCount)
+    , rowCount_(0)
+    , rowsValid_(false)
+    , sorted_(false)
 {
+    columns_.resize(keyColumnCount_ + dataColumnCount_);
     intervals_.resize(keyColumnCount_ + dataColumnCount_);
 }
 
 PlotData::PlotData(const PlotData& rhs)
     : PlotBase(rhs)
-    , rows_(rhs.rows_)
+    , columns_(rhs.columns_)
+    , rowCount_(rhs.rowCount_)
+    , rowsValid_(false)
     , intervals_(rhs.intervals_)
+    , highlightedCells_(rhs.highlightedCells_)
+    , sortedIndex_(rhs.sortedIndex_)
     , sorted_(rhs.sorted_)
 {
-    for (std::vector<PlotRowValue>::iterator it = rows_.begin(); it < rows_.end(); ++it) {
-        it->parent_ = this;
-        for (std::vector<PlotCellValue>::iterator cit = it->cells_.begin(); cit != it->cells_.end(); ++cit) {
-            if (cit->isHighlighted())
-                highlightedCells_.insert(&(*cit));
-        }
-    }
-
     std::vector<PlotRowImplicit>::const_iterator imit;
     for (imit = rhs.implicitRows_.begin(); imit < rhs.implicitRows_.end(); ++imit) {
         insertImplicit(imit->getCells());
@@ -78,21 +137,16 @@ PlotData& PlotData::operator=(const PlotData& rhs) {
 
     PlotBase::operator=(rhs);
 
-    // we do not use the copy-and-swap pattern here for performance reasons (avoid walking through all cells twice)
     // if an exception raises, this object will be empty but valid
     try {
-        rows_ = rhs.rows_;
+        columns_ = rhs.columns_;
+        rowCount_ = rhs.rowCount_;
+        rows_.clear();
+        rowsValid_ = false;
         intervals_ = rhs.intervals_;
+        highlightedCells_ = rhs.highlightedCells_;
+        sortedIndex_ = rhs.sortedIndex_;
         sorted_ = rhs.sorted_;
-        highlightedCells_.clear();
-
-        for (std::vector<PlotRowValue>::iterator it = rows_.begin(); it < rows_.end(); ++it) {
-            it->parent_ = this;
-            for (std::vector<PlotCellValue>::iterator cit = it->cells_.begin(); cit != it->cells_.end(); ++cit) {
-                if (cit->isHighlighted())
-                    highlightedCells_.insert(&(*cit));
-            }
-        }
 
         std::vector<PlotRowImplicit>::const_iterator imit;
         for (imit = rhs.implicitRows_.begin(); imit < rhs.implicitRows_.end(); ++imit) {
@@ -102,7 +156,10 @@ PlotData& PlotData::operator=(const PlotData& rhs) {
     catch (std::bad_alloc&) {
         // something bad happened, we can't be sure about the current state
         // clear everything to have at least a valid state.
-        rows_.clear();
+        columns_.clear();
+        columns_.resize(getColumnCount());
+        rowCount_ = 0;
+        invalidateRows();
         implicitRows_.clear();
         intervals_.clear();
         highlightedCells_.clear();
@@ -112,7 +169,10 @@ PlotData& PlotData::operator=(const PlotData& rhs) {
     catch (...) {
         // something bad happened, we can't be sure about the current state
         // clear everything to have at least a valid state.
-        rows_.clear();
+        columns_.clear();
+        columns_.resize(getColumnCount());
+        rowCount_ = 0;
+        invalidateRows();
         implicitRows_.clear();
         intervals_.clear();
         highlightedCells_.clear();
@@ -126,20 +186,18 @@ PlotData& PlotData::operator=(const PlotData& rhs) {
 void PlotData::select(const std::vector< std::pair< int, PlotPredicate*> >& predicates, PlotData& target) const {
     target.reset(keyColumnCount_, dataColumnCount_);
 
-    std::vector<PlotRowValue>::const_iterator rit;
-    bool matches;
-    for (rit = rows_.begin(); rit < rows_.end(); ++rit) {
-        matches = true;
-        for (size_t i = 0; i < predicates.size(); ++i) {
-            if (!predicates.at(i).second->check(rit->getCellAt(predicates.at(i).first))) {
-                matches = false;
-                break;
-            }
-        }
-        if (matches) {
-            target.insert(rit->getCells());
-        }
+    std::vector<char> matches;
+    checkPredicates(predicates, true, matches);
+    std::vector<int> rows;
+    for (int i = 0; i < rowCount_; ++i) {
+        if (matches[i])
+            rows.push_back(i);
     }
+    std::vector<int> columns;
+    for (int i = 0; i < getColumnCount(); ++i)
+        columns.push_back(i);
+    copyRows(rows, columns, target);
+
     for (int i = 0; i < getColumnCount(); ++i) {
         target.setColumnLabel(i,getColumnLabel(i));
     }
@@ -150,34 +208,7 @@ void PlotData::select(const std::vector< std::pair< int, PlotPredicate*> >& pred
 }
 
 void PlotData::select(const std::vector<int>& columns, int keyColumnCount, int dataColumnCount, PlotData& target) const {
-    target.reset(keyColumnCount, dataColumnCount);
-    int columnCount = 0;
-    if (columns.size() != 0) {
-        columnCount = keyColumnCount + dataColumnCount;
-
-        std::vector<PlotRowValue>::const_iterator it;
-        int i;
-        for (it = rows_.begin(); it < rows_.end(); ++it) {
-            std::vector<PlotCellValue> cellsToInsert;
-
-            for (i=0; i< columnCount; ++i) {
-                cellsToInsert.push_back(it->getCellAt(columns[i]));
-            }
-
-            target.insert(cellsToInsert);
-        }
-        for (i = 0; i < columnCount; ++i) {
-            target.setColumnLabel(i,getColumnLabel(columns[i]));
-        }
-        std::vector<PlotRowImplicit>::const_iterator imit;
-        for (imit = implicitRows_.begin(); imit < implicitRows_.end(); ++imit) {
-            std::vector<PlotCellImplicit> implicitcellsToInsert;
-            for (i=0; i< columnCount; ++i) {
-                implicitcellsToInsert.push_back(imit->getCellAt(columns[i]));
-            }
-            target.insertImplicit(implicitcellsToInsert);
-        }
-    }
+    select(columns, keyColumnCount, dataColumnCount, std::vector<std::pair<int, PlotPredicate*> >(), target);
 }
 
 void PlotData::select(const std::vector< int >& columns, int keyColumnCount, int dataColumnCount,
@@ -187,26 +218,16 @@ void PlotData::select(const std::vector< int >& columns, int keyColumnCount, int
     if (columns.size() != 0) {
         columnCount = keyColumnCount + dataColumnCount;
 
-        std::vector<PlotRowValue>::const_iterator it;
-        std::vector<std::pair<int, PlotPredicate*> >::const_iterator pit;
-        bool matches;
-        int i;
-        for (it = rows_.begin(); it < rows_.end(); ++it) {
-            std::vector<PlotCellValue> cellsToInsert;
-            matches = true;
-            for (pit = predicates.begin(); pit < predicates.end(); ++pit) {
-                if (! pit->second->check(it->getCellAt(pit->first))) {
-                    matches = false;
-                    break;
-                }
-            }
-            if (matches) {
-                for (i=0; i< columnCount; ++i) {
-                    cellsToInsert.push_back(it->getCellAt(columns[i]));
-                }
-                target.insert(cellsToInsert);
-            }
+        std::vector<char> matches;
+        checkPredicates(predicates, true, matches);
+        std::vector<int> rows;
+        for (int i = 0; i < rowCount_; ++i) {
+            if (matches[i])
+                rows.push_back(i);
         }
+        copyRows(rows, std::vector<int>(columns.begin(), columns.begin() + columnCount), target);
+
+        int i;
         for (i = 0; i < columnCount; ++i) {
             target.setColumnLabel(i,getColumnLabel(columns[i]));
         }
@@ -228,29 +249,20 @@ void PlotData::select(const std::vector<int>& columns, const std::vector<int>& r
     if (columns.size() != 0) {
         columnCount = keyColumnCount + dataColumnCount;
 
-        std::vector<PlotRowValue>::const_iterator it;
-        int i;
-        int zaehler = 0;
-        bool match;
-        for (it = rows_.begin(); it < rows_.end(); ++it) {
-            match = false;
-            for (size_t j = 0; j < rows.size(); ++j) {
-                if (zaehler == rows.at(j)) {
-                    match = true;
-                    break;
-                }
-            }
-            ++zaehler;
-            if (!match)
-                continue;
-            std::vector<PlotCellValue> cellsToInsert;
-
-            for (i=0; i< columnCount; ++i) {
-                cellsToInsert.push_back(it->getCellAt(columns[i]));
-            }
-
-            target.insert(cellsToInsert);
+        // mark the selected rows and copy them in key order
+        std::vector<char> selected(rowCount_, 0);
+        for (size_t j = 0; j < rows.size(); ++j) {
+            if (rows[j] >= 0 && rows[j] < rowCount_)
+                selected[rows[j]] = 1;
         }
+        std::vector<int> physicalRows;
+        for (int j = 0; j < rowCount_; ++j) {
+            if (selected[j])
+                physicalRows.push_back(getPhysicalRow(j));
+        }
+        copyRows(physicalRows, std::vector<int>(columns.begin(), columns.begin() + columnCount), target);
+
+        int i;
         for (i = 0; i < columnCount; ++i) {
             target.setColumnLabel(i,getColumnLabel(columns[i]));
         }
@@ -266,16 +278,32 @@ void PlotData::select(const std::vector<int>& columns, const std::vector<int>& r
 }
 
 plot_t PlotData::aggregate(int column, const AggregationFunction* function) const {
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::aggregate(): column out of bounds");
     std::vector<plot_t> values;
-    std::vector<PlotRowValue>::const_iterator it;
-    for (it = rows_.begin(); it < rows_.end(); ++it) {
-        values.push_back(it->getValueAt(column));
-    }
+    if (getColumnType(column) == STRING)
+        values.resize(rowCount_, std::numeric_limits<plot_t>::quiet_NaN());
+    else
+        values = columns_[column].values;
 
     plot_t toReturn = function->evaluate(values);
     return toReturn;
 }
 
+void PlotData::getColumnValues(int column, std::vector<plot_t>& values) const {
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::getColumnValues(): column out of bounds");
+    sortRows();
+    if (getColumnType(column) == STRING)
+        values.assign(rowCount_, std::numeric_limits<plot_t>::quiet_NaN());
+    else if (sortedIndex_.empty())
+        values = columns_[column].values;
+    else {
+        values.resize(rowCount_);
+        const std::vector<plot_t>& columnValues = columns_[column].values;
+        for (int i = 0; i < rowCount_; ++i)
+            values[i] = columnValues[sortedIndex_[i]];
+    }
+}
+
 bool PlotData::insert(const std::vector<plot_t>& values) {
     if (static_cast<int>(values.size()) <= getColumnCount()) {
         std::vector<plot_t>::const_iterator it;
@@ -308,9 +336,7 @@ bool PlotData::insert(const std::vector<plot_t>& values) {
             ++i;
         }
 
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, cellsToInsert));
-        updateIntervals(rows_.back());
+        appendRow(cellsToInsert);
         return true;
     }
     return false;
@@ -350,9 +376,7 @@ bool PlotData::insert(std::vector<std::pair<int, plot_t> >& values) {
 
             }
         }
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, cellsToInsert));
-        updateIntervals(rows_.back());
+        appendRow(cellsToInsert);
         return true;
     }
     return false;
@@ -384,9 +408,7 @@ bool PlotData::insert(const std::vector<std::string>& tags) {
             ++i;
         }
 
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, cellsToInsert));
-        updateIntervals(rows_.back());
+        appendRow(cellsToInsert);
         return true;
     }
     return false;
@@ -420,9 +442,7 @@ bool PlotData::insert(const std::vector<std::pair<int, std::string> >& tags) {
             }
         }
 
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, cellsToInsert));
-        updateIntervals(rows_.back());
+        appendRow(cellsToInsert);
         return true;
     }
     return false;
@@ -464,9 +484,7 @@ bool PlotData::insert(const std::vector< PlotCellValue >& cells) {
                 newcells.push_back(PlotCellValue());
             }
         }
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, newcells));
-        updateIntervals(rows_.back());
+        appendRow(newcells);
         return true;
     }
     return false;
@@ -504,9 +522,7 @@ bool PlotData::insert(std::vector< PlotCellValue >& cells) {
             }
             // elsewise everything should be fine
         }
-        sorted_ = false;
-        rows_.push_back(PlotRowValue(this, cells));
-        updateIntervals(rows_.back());
+        appendRow(cells);
         return true;
     }
     return false;
@@ -550,45 +566,71 @@ bool PlotData::insert(const std::vector< std::pair<int, PlotCellValue > >& cells
                 cellsToInsert[it->first] = PlotCellValue(ss.str());
             }
         }
-    sorted_ = false;
-    rows_.push_back(PlotRowValue(this, cellsToInsert));
-    updateIntervals(rows_.back());
+        appendRow(cellsToInsert);
     return true;
     }
     return false;
 }
 
 int PlotData::remove(const std::vector<std::pair<int, PlotPredicate*> >& predicates) {
-    std::vector<PlotRowValue>::iterator rit;
-    std::vector<std::pair<int, PlotPredicate*> >::const_iterator pit;
+    std::vector<char> matches;
+    checkPredicates(predicates, false, matches);
 
+    // new position of each physical row, -1 for removed rows
+    std::vector<int> newRows(rowCount_, -1);
     int count = 0;
-    bool matched;
-    rit = rows_.begin();
-    while (rit < rows_.end()) {
-        matched = false;
-        for (pit = predicates.begin(); pit < predicates.end(); ++pit)
-            if (pit->second->check(rit->getCellAt(pit->first))) {
-                matched = true;
-                break;
-            }
-        if (matched) {
-            removePointersToCellsOfRow(*rit);
-            rit = rows_.erase(rit);
+    for (int i = 0; i < rowCount_; ++i) {
+        if (matches[i])
             ++count;
+        else
+            newRows[i] = i - count;
+    }
+    if (count == 0)
+        return 0;
+
+    for (std::vector<Column>::iterator cit = columns_.begin(); cit < columns_.end(); ++cit) {
+        for (int i = 0; i < rowCount_; ++i) {
+            if (newRows[i] < 0)
+                continue;
+            if (! cit->values.empty())
+                cit->values[newRows[i]] = cit->values[i];
+            if (! cit->tags.empty())
+                cit->tags[newRows[i]] = cit->tags[i];
+            cit->highlighted[newRows[i]] = cit->highlighted[i];
         }
-        else {
-            ++rit;
-        }
+        if (! cit->values.empty())
+            cit->values.resize(rowCount_ - count);
+        if (! cit->tags.empty())
+            cit->tags.resize(rowCount_ - count);
+        cit->highlighted.resize(rowCount_ - count);
     }
 
+    std::set<std::pair<int, int> > highlightedCells;
+    std::set<std::pair<int, int> >::const_iterator hit;
+    for (hit = highlightedCells_.begin(); hit != highlightedCells_.end(); ++hit) {
+        if (newRows[hit->first] >= 0)
+            highlightedCells.insert(std::make_pair(newRows[hit->first], hit->second));
+    }
+    highlightedCells_.swap(highlightedCells);
+
+    // removing rows keeps the remaining ones sorted
+    bool sorted = sorted_;
+    std::vector<int> sortedIndex;
+    for (std::vector<int>::const_iterator it = sortedIndex_.begin(); it < sortedIndex_.end(); ++it) {
+        if (newRows[*it] >= 0)
+            sortedIndex.push_back(newRows[*it]);
+    }
+    sortedIndex_.swap(sortedIndex);
+
+    rowCount_ -= count;
+    invalidateRows();
+    sorted_ = sorted;
     return count;
 }
 
 bool PlotData::rearrangeColumns(std::vector<int>& newKeyColumns, std::vector<int>& newDataColumns, PlotData& target) const {
     target.reset(newKeyColumns.size(), newDataColumns.size());
 
-    std::vector<PlotRowValue>::const_iterator rit;     // iterator for PlotRowValues
     std::vector<PlotRowImplicit>::const_iterator irit; // iterator for PlotRowValues
     std::vector<int>::const_iterator kit;              // iterator for key column indexs
     std::vector<int>::const_iterator dit;              // iterator for data column indexs
@@ -601,13 +643,13 @@ bool PlotData::rearrangeColumns(std::vector<int>& newKeyColumns, std::vector<int
         if (*dit < 0 || *dit >= getColumnCount())
             return false;
 
-    for (rit = rows_.begin(); rit < rows_.end(); ++rit) {
+    for (int row = 0; row < rowCount_; ++row) {
         std::vector<PlotCellValue> cellsToInsert;
         for (kit = newKeyColumns.begin(); kit < newKeyColumns.end(); ++kit) {
-            cellsToInsert.push_back(rit->getCellAt(*kit));
+            cellsToInsert.push_back(getCell(row, *kit));
         }
         for (dit = newKeyColumns.begin(); dit < newKeyColumns.end(); ++dit) {
-            cellsToInsert.push_back(rit->getCellAt(*dit));
+            cellsToInsert.push_back(getCell(row, *dit));
         }
         target.insert(cellsToInsert);
     }
@@ -634,155 +676,103 @@ bool PlotData::groupBy(int groupColumn, const std::vector<std::pair<int, Aggrega
 
     target.reset(1, functions.size());
 
-    // we will sort and group the data into hashmaps before applying the AggregationFunctions to them
-    std::map<plot_t, std::vector<plot_t>*> groupedByValues;
-    std::map<std::string, std::vector<plot_t>*> groupedByTags;
-    std::map<bool, std::vector<plot_t>*> groupedByNulls;
-
-    std::map<plot_t, std::vector<plot_t>*>::iterator gbvIt;
-    std::map<std::string, std::vector<plot_t>*>::iterator gbtIt;
-    std::map<bool, std::vector<plot_t>*>::iterator gbnIt;
-    // alright, we will start with grouping the data in our hashmaps
-    int funcCount = functions.size();
-    std::vector<PlotRowValue>::const_iterator rowIt;
-    for (rowIt = rows_.begin(); rowIt != rows_.end(); ++rowIt) {
-        const PlotCellValue& groupedCell = rowIt->getCellAt(groupColumn);
-
-        // check whether to group by value or by tag - here we group by value
-        if (groupedCell.isValue()) {
-            // check if the data in this cell is already in the hashmap -> a group for it already exists
-            gbvIt = groupedByValues.find(groupedCell.getValue());
-
-            // it is not in the hashmap -> create new group
-            if (gbvIt == groupedByValues.end()) {
-                // first we create an array of vector of plot_t where we will store the data which shall be aggregated:
-                std::vector<plot_t>* temp = new std::vector<plot_t>[funcCount]();
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
-                groupedByValues.insert(std::pair<plot_t, std::vector<plot_t>*>(groupedCell.getValue(), temp));
-            }
-            // there is already an entry in the hashmap, so just push the values into the vector which shall be aggregated
-            else {
-                std::vector<plot_t>* temp = gbvIt->second;
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
-            }
-        }
-        else if(groupedCell.isNull()) {
-            gbnIt = groupedByNulls.find(groupedCell.isNull());
-            if (gbnIt == groupedByNulls.end()) {
-                // first we create an array of vector of plot_t where we will store the data which shall be aggregated:
-                std::vector<plot_t>* temp = new std::vector<plot_t>[funcCount];
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
-                groupedByNulls.insert(std::pair<bool, std::vector<plot_t>*>(groupedCell.isNull(), temp));
-            }
-            // there is already an entry in the hashmap, so just push the values into the vector which shall be aggregated
-            else {
-                std::vector<plot_t>* temp = gbnIt->second;
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
-            }
+    // first we assign a group to each row: values are grouped by a map, tags by their index in
+    // the dictionary of the column and all null cells form one group
+    const Column& grouped = columns_[groupColumn];
+    bool groupByTags = (getColumnType(groupColumn) == STRING);
+    std::vector<int> groups(rowCount_);
+    std::map<plot_t, int> valueGroups;
+    std::vector<int> tagGroups(grouped.dictionary.size(), -1);
+    int nullGroup = -1;
+    int groupCount = 0;
+
+    std::map<plot_t, int>::iterator lastGroup = valueGroups.end();
+    for (int row = 0; row < rowCount_; ++row) {
+        int* group = 0;
+        if (groupByTags) {
+            if (grouped.tags[row] >= 0)
+                group = &tagGroups[grouped.tags[row]];
+            else
+                group = &nullGroup;
         }
-        // ok, we group by tag
         else {
-            // check if the data in this cell is already in the hashmap -> a group for it already exists
-            gbtIt = groupedByTags.find(groupedCell.getTag());
-
-            // it is not in the hashmap -> create new group
-            if (gbtIt == groupedByTags.end()) {
-                // first we create an array of vector of plot_t where we will store the data which shall be aggregated:
-                std::vector<plot_t>* temp = new std::vector<plot_t>[funcCount];
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
-                groupedByTags.insert(std::pair<std::string, std::vector<plot_t>*>(groupedCell.getTag(), temp));
-            }
-            // there is already an entry in the hashmap, so just push the values into the vector which shall be aggregated
+            plot_t value = grouped.values[row];
+            if (value != value)
+                group = &nullGroup;
+            // grouped columns are often sorted, so try the group of the last row first
+            else if (lastGroup != valueGroups.end() && lastGroup->first == value)
+                group = &lastGroup->second;
             else {
-                std::vector<plot_t>* temp = gbtIt->second;
-                for (int i=0; i< funcCount; ++i) {
-                    temp[i].push_back(rowIt->getValueAt(functions[i].first));
-                }
+                lastGroup = valueGroups.insert(std::make_pair(value, -1)).first;
+                group = &lastGroup->second;
             }
         }
+        if (*group < 0)
+            *group = groupCount++;
+        groups[row] = *group;
     }
 
-    // grouping is done, now, we will insert the grouped data into the target PlotData
-    // first insert all groupedByValues rows
-    for (gbvIt = groupedByValues.begin(); gbvIt != groupedByValues.end(); ++gbvIt) {
-        std::vector<PlotCellValue> cells;
-        cells.push_back(PlotCellValue(gbvIt->first));
-
-        for (int i=0; i<funcCount; ++i) {
-            plot_t val = functions[i].second->evaluate(gbvIt->second[i]);
-            if (val != val){
-                cells.push_back(PlotCellValue());
-            }
-            else {
-                cells.push_back(PlotCellValue(functions[i].second->evaluate(gbvIt->second[i])));
+    // sort the rows by group, so that the values of each group are contiguous
+    std::vector<int> groupBegin(groupCount + 1, 0);
+    for (int row = 0; row < rowCount_; ++row)
+        ++groupBegin[groups[row] + 1];
+    for (int i = 0; i < groupCount; ++i)
+        groupBegin[i + 1] += groupBegin[i];
+    std::vector<int> groupedRows(rowCount_);
+    std::vector<int> position(groupBegin.begin(), groupBegin.end() - 1);
+    for (int row = 0; row < rowCount_; ++row)
+        groupedRows[position[groups[row]]++] = row;
+
+    // now apply the AggregationFunctions to each group
+    int funcCount = functions.size();
+    std::vector<std::vector<plot_t> > results(funcCount, std::vector<plot_t>(groupCount));
+    std::vector<plot_t> values;
+    for (int i = 0; i < funcCount; ++i) {
+        const Column& column = columns_[functions[i].first];
+        bool isNumberColumn = (getColumnType(functions[i].first) != STRING);
+        for (int group = 0; group < groupCount; ++group) {
+            values.clear();
+            for (int j = groupBegin[group]; j < groupBegin[group + 1]; ++j) {
+                if (isNumberColumn)
+                    values.push_back(column.values[groupedRows[j]]);
+                else
+                    values.push_back(std::numeric_limits<plot_t>::quiet_NaN());
             }
+            results[i][group] = functions[i].second->evaluate(values);
         }
-
-        target.insert(cells);
     }
 
-    // now insert all groupedByTags rows
-    for (gbtIt = groupedByTags.begin(); gbtIt != groupedByTags.end(); ++gbtIt) {
-        std::vector<PlotCellValue> cells;
-        cells.push_back(PlotCellValue(gbtIt->first));
-
-        for (int i=0; i<funcCount; ++i) {
-            plot_t val = functions[i].second->evaluate(gbtIt->second[i]);
-            if (val != val){
-                cells.push_back(PlotCellValue());
-            }
-            else {
-                cells.push_back(PlotCellValue(functions[i].second->evaluate(gbtIt->second[i])));
-            }
-        }
-
-        target.insert(cells);
+    // insert the grouped data into the target PlotData: first values, then tags, then nulls
+    std::vector<std::pair<PlotCellValue, int> > keys;
+    for (std::map<plot_t, int>::const_iterator it = valueGroups.begin(); it != valueGroups.end(); ++it)
+        keys.push_back(std::make_pair(PlotCellValue(it->first), it->second));
+    std::map<std::string, int> sortedTags;
+    for (size_t t = 0; t < tagGroups.size(); ++t) {
+        if (tagGroups[t] >= 0)
+            sortedTags.insert(std::make_pair(grouped.dictionary[t], tagGroups[t]));
     }
-        // now insert all groupedByNulls rows
-    for (gbnIt = groupedByNulls.begin(); gbnIt != groupedByNulls.end(); ++gbnIt) {
+    for (std::map<std::string, int>::const_iterator it = sortedTags.begin(); it != sortedTags.end(); ++it)
+        keys.push_back(std::make_pair(PlotCellValue(it->first), it->second));
+    if (nullGroup >= 0)
+        keys.push_back(std::make_pair(PlotCellValue(), nullGroup));
+
+    for (std::vector<std::pair<PlotCellValue, int> >::const_iterator kit = keys.begin(); kit < keys.end(); ++kit) {
         std::vector<PlotCellValue> cells;
-        cells.push_back(PlotCellValue());
+        cells.push_back(kit->first);
 
         for (int i=0; i<funcCount; ++i) {
-            plot_t val = functions[i].second->evaluate(gbnIt->second[i]);
+            plot_t val = results[i][kit->second];
             if (val != val){
                 cells.push_back(PlotCellValue());
             }
             else {
-                cells.push_back(PlotCellValue(functions[i].second->evaluate(gbnIt->second[i])));
+                cells.push_back(PlotCellValue(val));
             }
         }
 
         target.insert(cells);
     }
 
-    // finally free all data which is not necessary anymore:
-    while (groupedByValues.size() > 0) {
-        gbvIt = groupedByValues.begin();
-        delete [] gbvIt->second;
-        groupedByValues.erase(gbvIt);
-    }
-    while (groupedByTags.size() > 0) {
-        gbtIt = groupedByTags.begin();
-        delete [] gbtIt->second;
-        groupedByTags.erase(gbtIt);
-    }
-    while (groupedByNulls.size() > 0) {
-        gbnIt = groupedByNulls.begin();
-        delete [] gbnIt->second;
-        groupedByNulls.erase(gbnIt);
-    }
-
     for (size_t i = 0; i < functions.size(); ++i) {
         target.setColumnLabel(i+1,getColumnLabel(functions.at(i).first));
     }
@@ -798,19 +788,18 @@ bool PlotData::mergeWith(
 
     target.reset(keyColumns.size(), dataColumns.size());
 
-    std::vector<PlotRowValue>::const_iterator rit;
     std::vector<PlotRowImplicit>::const_iterator irit;
     std::vector<std::pair<int, int> >::const_iterator kit;
     std::vector<std::pair<int, int> >::const_iterator dit;
 
     // first insert all rows from *this into target
-    for (rit = rows_.begin(); rit < rows_.end(); ++rit) {
+    for (int row = 0; row < rowCount_; ++row) {
         std::vector<PlotCellValue> cellsToInsert;
         for (kit = keyColumns.begin(); kit < keyColumns.end(); ++kit)
-            cellsToInsert.push_back(rit->getCellAt(kit->first));
+            cellsToInsert.push_back(getCell(row, kit->first));
 
         for (dit = dataColumns.begin(); dit < dataColumns.end(); ++dit)
-            cellsToInsert.push_back(rit->getCellAt(dit->first));
+            cellsToInsert.push_back(getCell(row, dit->first));
 
         target.insert(cellsToInsert);
     }
@@ -826,13 +815,13 @@ bool PlotData::mergeWith(
     }
 
     // now insert alls rows from otherPlotData into target
-    for (rit = otherPlotData.rows_.begin(); rit < otherPlotData.rows_.end(); ++rit) {
+    for (int row = 0; row < otherPlotData.rowCount_; ++row) {
         std::vector<PlotCellValue> cellsToInsert;
         for (kit = keyColumns.begin(); kit < keyColumns.end(); ++kit)
-            cellsToInsert.push_back(rit->getCellAt(kit->second));
+            cellsToInsert.push_back(otherPlotData.getCell(row, kit->second));
 
         for (dit = dataColumns.begin(); dit < dataColumns.end(); ++dit)
-            cellsToInsert.push_back(rit->getCellAt(dit->second));
+            cellsToInsert.push_back(otherPlotData.getCell(row, dit->second));
 
         target.insert(cellsToInsert);
     }
@@ -903,13 +892,13 @@ bool PlotData::mergeWith(const PlotData& otherPlotData, PlotData& target, MergeT
                 cells.resize(getColumnCount() + otherPlotData.getDataColumnCount());
                 for (int i = 0; i < getKeyColumnCount(); ++i) {
                     if (selfcounter < getRowsCount())
-                        row[i] = rows_[selfcounter].cells_[i];
+                        row[i] = getRow(selfcounter).cells_[i];
                     if (othercounter < otherPlotData.getRowsCount())
                         otherrow[i] = otherPlotData.getRow(othercounter).cells_[i];
                 }
                 if (row == otherrow) {
                     for (int i = 0; i < getColumnCount(); ++i) {
-                        cells[i] = rows_[selfcounter].cells_[i];
+                        cells[i] = getRow(selfcounter).cells_[i];
                     }
                     for (int i = 0; i < otherPlotData.getDataColumnCount(); ++i) {
                         cells[i+getColumnCount()] = otherPlotData.getRow(othercounter).cells_[i+getKeyColumnCount()];
@@ -930,7 +919,7 @@ bool PlotData::mergeWith(const PlotData& otherPlotData, PlotData& target, MergeT
                 }
                 else if ((row < otherrow && selfcounter < getRowsCount()) || (othercounter >= otherPlotData.getRowsCount())) {
                     for (int i = 0; i < getColumnCount(); ++i) {
-                        cells[i] = rows_[selfcounter].cells_[i];
+                        cells[i] = getRow(selfcounter).cells_[i];
                     }
                     target.insert(cells);
                     ++selfcounter;
@@ -1038,7 +1027,7 @@ bool PlotData::insertImplicit(const std::vector<PlotCellImplicit> &implicitrow)
 }
 
 Interval<plot_t> PlotData::getInterval(int column) const {
-    if (getColumnCount() <= column || rows_.empty() || columnTypes_[column] == EMPTY) {
+    if (getColumnCount() <= column || rowCount_ == 0 || columnTypes_[column] == EMPTY) {
         Interval<plot_t> toReturn(0, 0, true, true);
         return toReturn;
     }
@@ -1046,7 +1035,7 @@ Interval<plot_t> PlotData::getInterval(int column) const {
 }
 
 Interval<plot_t> PlotData::getSumInterval(const std::vector< int >& column) const {
-    if (rows_.empty()) {
+    if (rowCount_ == 0) {
         return Interval<plot_t>(0, 0, true, true);
     }
 
@@ -1058,25 +1047,28 @@ Interval<plot_t> PlotData::getSumInterval(const std::vector< int >& column) cons
             numberColumn.push_back(*colIt);
     }
 
-    std::vector<PlotRowValue>::const_iterator rowIt = rows_.begin();
+    // sum up the absolute values column by column
+    std::vector<plot_t> sums(rowCount_, 0);
+    for (colIt = numberColumn.begin(); colIt < numberColumn.end(); ++colIt) {
+        const std::vector<plot_t>& values = columns_[*colIt].values;
+        for (int i = 0; i < rowCount_; ++i) {
+            if (values[i] == values[i])
+                sums[i] += fabs(values[i]);
+        }
+    }
+
     plot_t min = 0;
     plot_t max = 0;
-
-    for ( ; rowIt < rows_.end(); ++rowIt) {
-        plot_t temp = 0;
-        for (colIt = numberColumn.begin(); colIt < numberColumn.end(); ++colIt) {
-            if (!rowIt->getCellAt(*colIt).isNull())
-                temp += fabs(rowIt->getValueAt(*colIt));
-        }
-        if (temp > max)
-            max = temp;
+    for (int i = 0; i < rowCount_; ++i) {
+        if (sums[i] > max)
+            max = sums[i];
     }
 
     return Interval<plot_t>(min, max);
 }
 
 std::vector<PlotRowValue>::const_iterator  PlotData::getRowsBegin() const {
-    sortRows();
+    updateRows();
     return rows_.begin();
 }
 
@@ -1085,7 +1077,7 @@ std::vector<PlotRowImplicit>::const_iterator PlotData::getImplicitRowsBegin() co
 }
 
 std::vector<PlotRowValue>::const_iterator  PlotData::getRowsEnd() const {
-    sortRows();
+    updateRows();
     return rows_.end();
 }
 
@@ -1094,18 +1086,51 @@ std::vector<PlotRowImplicit>::const_iterator PlotData::getImplicitRowsEnd() cons
 }
 
 const PlotRowValue& PlotData::getRow(int row) const {
-    tgtAssert((row >= 0 && row < static_cast<int>(rows_.size())), "PlotData::getRow(): row out of bounds");
-    sortRows();
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::getRow(): row out of bounds");
+    updateRows();
     return rows_[row];
 }
 
 const PlotRowImplicit& PlotData::getImplicitRow(int row) const {
-    tgtAssert((row >= 0 && row < static_cast<int>(rows_.size())), "PlotData::getImplicitRow(): row out of bounds");
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::getImplicitRow(): row out of bounds");
     return implicitRows_[row];
 }
 
+PlotCellValue PlotData::getCellAt(int row, int column) const {
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::getCellAt(): row out of bounds");
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::getCellAt(): column out of bounds");
+    return getCell(getPhysicalRow(row), column);
+}
+
+plot_t PlotData::getValueAt(int row, int column) const {
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::getValueAt(): row out of bounds");
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::getValueAt(): column out of bounds");
+    if (columnTypes_[column] == STRING)
+        return std::numeric_limits<plot_t>::quiet_NaN();
+    return columns_[column].values[getPhysicalRow(row)];
+}
+
+std::string PlotData::getTagAt(int row, int column) const {
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::getTagAt(): row out of bounds");
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::getTagAt(): column out of bounds");
+    if (columnTypes_[column] != STRING)
+        return "";
+    int tag = columns_[column].tags[getPhysicalRow(row)];
+    return (tag >= 0 ? columns_[column].dictionary[tag] : "");
+}
+
+bool PlotData::isNullAt(int row, int column) const {
+    tgtAssert((row >= 0 && row < rowCount_), "PlotData::isNullAt(): row out of bounds");
+    tgtAssert((column >= 0 && column < getColumnCount()), "PlotData::isNullAt(): column out of bounds");
+    const Column& c = columns_[column];
+    int physicalRow = getPhysicalRow(row);
+    if (columnTypes_[column] == STRING)
+        return c.tags[physicalRow] < 0;
+    return c.values[physicalRow] != c.values[physicalRow];
+}
+
 int PlotData::getRowsCount() const {
-    return rows_.size();
+    return rowCount_;
 }
 
 int PlotData::getImplicitRowsCount() const {
@@ -1113,11 +1138,11 @@ int PlotData::getImplicitRowsCount() const {
 }
 
 bool PlotData::rowsEmpty() const {
-    return rows_.empty();
+    return rowCount_ == 0;
 }
 
 bool PlotData::implicitRowsEmpty() const {
-    return rows_.empty();
+    return rowCount_ == 0;
 }
 
 bool PlotData::isHighlighted(const tgt::ivec2& cellPosition) const {
@@ -1128,25 +1153,20 @@ bool PlotData::isHighlighted(const tgt::ivec2& cellPosition) const {
             return false;
         // check the highlight_state in one cell
         else if (cellPosition.x != -1 && cellPosition.y != -1)
-            return rows_[cellPosition.x].getCellAt(cellPosition.y).isHighlighted();
+            return columns_[cellPosition.y].highlighted[getPhysicalRow(cellPosition.x)];
         // check the highlight_state in all cells from that column
         else if (cellPosition.x == -1) {
-            bool highlighted = true;
             // the column is highlighted if all cells are highlighted
-            for (std::vector<PlotRowValue>::const_iterator it = rows_.begin(); it < rows_.end(); ++it) {
-                if (!it->getCellAt(cellPosition.y).isHighlighted()) {
-                    highlighted = false;
-                    break;
-                }
-            }
-            return highlighted;
+            const std::vector<bool>& highlighted = columns_[cellPosition.y].highlighted;
+            return std::find(highlighted.begin(), highlighted.end(), false) == highlighted.end();
         }
         // check the highlight_state in all cells from that row
         else {  // if (cellPosition.y == -1) {
             bool highlighted = true;
+            int row = getPhysicalRow(cellPosition.x);
             // the row is highlighted if all cells are highlighted
             for (int i = 0; i < getColumnCount(); ++i) {
-                if (!rows_[cellPosition.x].getCellAt(i).isHighlighted()) {
+                if (!columns_[i].highlighted[row]) {
                     highlighted = false;
                     break;
                 }
@@ -1163,8 +1183,20 @@ void PlotData::toggleHighlight(const tgt::ivec2& cellPosition, bool additive) {
 }
 
 void PlotData::clearHighlights() {
-    for (std::set<PlotCellValue*>::iterator it = highlightedCells_.begin(); it != highlightedCells_.end(); ++it) {
-        (*it)->setHighlighted(false);
+    if (highlightedCells_.empty())
+        return;
+
+    // the rows_ view is updated in place, so that iterators to it stay valid
+    std::vector<int> viewRows;
+    if (rowsValid_ && !sortedIndex_.empty()) {
+        viewRows.resize(rowCount_);
+        for (int i = 0; i < rowCount_; ++i)
+            viewRows[sortedIndex_[i]] = i;
+    }
+    for (std::set<std::pair<int, int> >::const_iterator it = highlightedCells_.begin(); it != highlightedCells_.end(); ++it) {
+        columns_[it->second].highlighted[it->first] = false;
+        if (rowsValid_)
+            rows_[viewRows.empty() ? it->first : viewRows[it->first]].setHighlighted(it->second, false);
     }
     highlightedCells_.clear();
 }
@@ -1180,42 +1212,37 @@ void PlotData::setHighlight(const tgt::ivec2& cellPosition, bool value, bool add
         if (value != isHighlighted(cellPosition)) {
             // single cell
             if (cellPosition.x != -1 && cellPosition.y != -1) {
-                rows_[cellPosition.x].setHighlighted(cellPosition.y, value);
-                if (value)
-                    highlightedCells_.insert(&(rows_[cellPosition.x].cells_[cellPosition.y]));
-                else
-                    highlightedCells_.erase(&(rows_[cellPosition.x].cells_[cellPosition.y]));
+                setCellHighlight(cellPosition.x, cellPosition.y, value);
             }
             // entire column
             else if (cellPosition.x == -1) {
-                for (std::vector<PlotRowValue>::iterator it = rows_.begin(); it < rows_.end(); ++it) {
-                    // check if we have to change the state of single cell
-                    if (it->getCellAt(cellPosition.y).isHighlighted() != value) {
-                        it->setHighlighted(cellPosition.y, value);
-                        if (value)
-                            highlightedCells_.insert(&(it->cells_[cellPosition.y]));
-                        else
-                            highlightedCells_.erase(&(it->cells_[cellPosition.y]));
-                    }
-                }
+                for (int i = 0; i < rowCount_; ++i)
+                    setCellHighlight(i, cellPosition.y, value);
             }
             // entire row
             else if (cellPosition.y == -1) {
-                for (int i = 0; i < getColumnCount(); ++i) {
-                    // check if we have to change the state of single cell
-                    if (rows_[cellPosition.x].getCellAt(i).isHighlighted() != value) {
-                        rows_[cellPosition.x].setHighlighted(i, value);
-                        if (value)
-                            highlightedCells_.insert(&(rows_[cellPosition.x].cells_[i]));
-                        else
-                            highlightedCells_.erase(&(rows_[cellPosition.x].cells_[i]));
-                    }
-                }
+                for (int i = 0; i < getColumnCount(); ++i)
+                    setCellHighlight(cellPosition.x, i, value);
             }
         }
     }
 }
 
+void PlotData::setCellHighlight(int row, int column, bool value) {
+    int physicalRow = getPhysicalRow(row);
+    std::vector<bool>::reference highlighted = columns_[column].highlighted[physicalRow];
+    // check if we have to change the state of single cell
+    if (highlighted == value)
+        return;
+    highlighted = value;
+    if (value)
+        highlightedCells_.insert(std::make_pair(physicalRow, column));
+    else
+        highlightedCells_.erase(std::make_pair(physicalRow, column));
+    if (rowsValid_)
+        rows_[row].setHighlighted(column, value);
+}
+
 void PlotData::deleteImplicitRows() {
     std::vector<PlotRowImplicit>::const_iterator imit;
     std::vector<PlotCellImplicit> implicitCells;
@@ -1229,59 +1256,236 @@ void PlotData::deleteImplicitRows() {
     }
 }
 
-void PlotData::removePointersToCellsOfRow(PlotRowValue& row) {
-    for (std::vector<PlotCellValue>::iterator cit = row.cells_.begin(); cit < row.cells_.end(); ++cit) {
-        PlotCellValue* pCell = &(*cit);
-        highlightedCells_.erase(pCell);
-    }
-}
-
 void PlotData::reset(int keyColumnCount, int dataColumnCount) {
     highlightedCells_.clear();
-    rows_.clear();
+    columns_.clear();
+    rowCount_ = 0;
+    invalidateRows();
+    sortedIndex_.clear();
     deleteImplicitRows();
     implicitRows_.clear();
     intervals_.clear();
-    sorted_ = false;
     PlotBase::reset(keyColumnCount, dataColumnCount);
+    columns_.resize(getColumnCount());
     intervals_.resize(getColumnCount());
 }
 
-void PlotData::updateIntervals(const PlotRowValue& row) {
-    std::vector< Interval<plot_t> >::iterator iit = intervals_.begin();
-    std::vector< PlotCellValue >::const_iterator rit = row.getCells().begin();
-    int column = 0;
-    for (; rit < row.getCells().end() && iit < intervals_.end(); ++iit, ++rit, ++column) {
-        if (columnTypes_[column] == PlotBase::STRING)
-            *iit = Interval<plot_t>(0, rows_.size() - 1, false, false);
-        else if (rit->isValue()) {
-            const plot_t& value = rit->getValue();
-            iit->nibble(value);
+void PlotData::appendRow(const std::vector<PlotCellValue>& cells) {
+    for (int i = 0; i < getColumnCount(); ++i) {
+        Column& column = columns_[i];
+        const PlotCellValue* cell = (i < static_cast<int>(cells.size()) ? &cells[i] : 0);
+
+        if (columnTypes_[i] == STRING) {
+            // the column may have got its type after null cells have been inserted as values
+            if (static_cast<int>(column.tags.size()) < rowCount_) {
+                column.tags.assign(rowCount_, -1);
+                std::vector<plot_t>().swap(column.values);
+            }
+            if (cell && cell->isTag())
+                column.tags.push_back(getTagIndex(i, cell->getTag()));
+            else if (cell && cell->isValue()) {
+                std::stringstream ss;
+                ss << cell->getValue();
+                column.tags.push_back(getTagIndex(i, ss.str()));
+            }
+            else
+                column.tags.push_back(-1);
+            intervals_[i] = Interval<plot_t>(0, rowCount_, false, false);
+        }
+        else {
+            if (cell && cell->isValue() && cell->getValue() == cell->getValue()) {
+                column.values.push_back(cell->getValue());
+                intervals_[i].nibble(cell->getValue());
+            }
+            else
+                column.values.push_back(std::numeric_limits<plot_t>::quiet_NaN());
+        }
+
+        bool highlighted = (cell && cell->isHighlighted());
+        column.highlighted.push_back(highlighted);
+        if (highlighted)
+            highlightedCells_.insert(std::make_pair(rowCount_, i));
+    }
+    ++rowCount_;
+    invalidateRows();
+}
+
+int PlotData::getTagIndex(int column, const std::string& tag) {
+    Column& c = columns_[column];
+    std::map<std::string, int>::const_iterator it = c.dictionaryIndex.find(tag);
+    if (it != c.dictionaryIndex.end())
+        return it->second;
+    int index = static_cast<int>(c.dictionary.size());
+    c.dictionary.push_back(tag);
+    c.dictionaryIndex.insert(std::make_pair(tag, index));
+    return index;
+}
+
+PlotCellValue PlotData::getCell(int row, int column) const {
+    const Column& c = columns_[column];
+    PlotCellValue cell;
+    if (columnTypes_[column] == STRING) {
+        if (c.tags[row] >= 0)
+            cell.setTag(c.dictionary[c.tags[row]]);
+    }
+    else if (c.values[row] == c.values[row])
+        cell.setValue(c.values[row]);
+    cell.setHighlighted(c.highlighted[row]);
+    return cell;
+}
+
+int PlotData::getPhysicalRow(int row) const {
+    sortRows();
+    return (sortedIndex_.empty() ? row : sortedIndex_[row]);
+}
+
+void PlotData::checkPredicates(const std::vector<std::pair<int, PlotPredicate*> >& predicates, bool all,
+                               std::vector<char>& matches) const {
+    matches.assign(rowCount_, all ? 1 : 0);
+    if (predicates.empty())
+        return;
+
+    std::vector<std::pair<int, PlotPredicate*> >::const_iterator pit;
+    for (pit = predicates.begin(); pit < predicates.end(); ++pit) {
+        const Column& column = columns_[pit->first];
+        PlotPredicate* predicate = pit->second;
+        char nullMatch = (predicate->check(PlotCellValue()) ? 1 : 0);
+
+        if (getColumnType(pit->first) == STRING) {
+            // each distinct tag has to be checked only once
+            std::vector<char> tagMatches(column.dictionary.size());
+            for (size_t t = 0; t < column.dictionary.size(); ++t)
+                tagMatches[t] = (predicate->check(PlotCellValue(column.dictionary[t])) ? 1 : 0);
+            for (int i = 0; i < rowCount_; ++i) {
+                if (matches[i] != all)
+                    continue;
+                int tag = column.tags[i];
+                matches[i] = (tag >= 0 ? tagMatches[tag] : nullMatch);
+            }
+        }
+        else {
+            PlotCellValue cell(static_cast<plot_t>(0));
+            for (int i = 0; i < rowCount_; ++i) {
+                if (matches[i] != all)
+                    continue;
+                plot_t value = column.values[i];
+                if (value != value)
+                    matches[i] = nullMatch;
+                else {
+                    cell.setValue(value);
+                    matches[i] = (predicate->check(cell) ? 1 : 0);
+                }
+            }
+        }
+    }
+}
+
+void PlotData::copyRows(const std::vector<int>& rows, const std::vector<int>& columns, PlotData& target) const {
+    tgtAssert(target.rowCount_ == 0, "PlotData::copyRows(): target is not empty");
+    tgtAssert(static_cast<int>(columns.size()) == target.getColumnCount(), "PlotData::copyRows(): column count mismatch");
+    int rowCount = static_cast<int>(rows.size());
+
+    for (size_t j = 0; j < columns.size(); ++j) {
+        const Column& source = columns_[columns[j]];
+        Column& column = target.columns_[j];
+        bool isNull = true;
+
+        if (getColumnType(columns[j]) == STRING) {
+            // only the tags which are used by the rows end up in the new dictionary
+            std::vector<int> tagIndices(source.dictionary.size(), -1);
+            column.tags.resize(rowCount);
+            for (int i = 0; i < rowCount; ++i) {
+                int tag = source.tags[rows[i]];
+                if (tag >= 0) {
+                    if (tagIndices[tag] < 0)
+                        tagIndices[tag] = target.getTagIndex(j, source.dictionary[tag]);
+                    tag = tagIndices[tag];
+                    isNull = false;
+                }
+                column.tags[i] = tag;
+            }
+            if (isNull) {
+                std::vector<int>().swap(column.tags);
+                column.values.assign(rowCount, std::numeric_limits<plot_t>::quiet_NaN());
+            }
+            else {
+                target.setColumnType(j, STRING);
+                target.intervals_[j] = Interval<plot_t>(0, rowCount - 1, false, false);
+            }
+        }
+        else {
+            column.values.resize(rowCount);
+            for (int i = 0; i < rowCount; ++i) {
+                plot_t value = source.values[rows[i]];
+                column.values[i] = value;
+                if (value == value) {
+                    target.intervals_[j].nibble(value);
+                    isNull = false;
+                }
+            }
+            if (!isNull)
+                target.setColumnType(j, getColumnType(columns[j]));
+        }
+
+        column.highlighted.resize(rowCount);
+        for (int i = 0; i < rowCount; ++i) {
+            column.highlighted[i] = source.highlighted[rows[i]];
+            if (column.highlighted[i])
+                target.highlightedCells_.insert(std::make_pair(i, static_cast<int>(j)));
         }
     }
+
+    target.rowCount_ = rowCount;
+    target.invalidateRows();
+}
+
+void PlotData::invalidateRows() {
+    sorted_ = false;
+    rowsValid_ = false;
+    rows_.clear();
+}
+
+void PlotData::updateRows() const {
+    if (rowsValid_)
+        return;
+    sortRows();
+    rows_.clear();
+    rows_.reserve(rowCount_);
+    for (int i = 0; i < rowCount_; ++i) {
+        int row = (sortedIndex_.empty() ? i : sortedIndex_[i]);
+        // a fresh vector for each row, PlotCellValue::operator= leaks a tag overwritten by a null cell
+        std::vector<PlotCellValue> cells;
+        cells.reserve(getColumnCount());
+        for (int j = 0; j < getColumnCount(); ++j)
+            cells.push_back(getCell(row, j));
+        rows_.push_back(PlotRowValue(this, cells));
+    }
+    rowsValid_ = true;
 }
 
 void PlotData::sortRows() const {
-    if (! sorted_ && rows_.size() > 0) {
+    if (! sorted_ && rowCount_ > 0) {
+        KeyLess less(*this);
         // in many cases the data is sorted by construction, so we check that
         bool sorted = true;
-        for (std::vector< PlotRowValue >::const_iterator it = rows_.begin(); it+1 < rows_.end(); ++it) {
-            if ( *(it+1) < *it ) {
+        for (int i = 0; i + 1 < rowCount_; ++i) {
+            if (less(i + 1, i)) {
                 sorted = false;
                 break;
             }
         }
         if (sorted)
-            sorted_ = true;
+            sortedIndex_.clear();
         else {
-            // sortRows() shall be callable by const member functions so it has to be const itself
-            // Unfortunately std::sort does not offer bitwise-constness but in the semantic way of constness
-            // (the items of this plot data are still the same) sortRows() is const. So we do a const cast
-            // here to be allowed to call std::sort
-            PlotData* foo = const_cast<PlotData*>(this);
-            std::sort(foo->rows_.begin(), foo->rows_.end());
-            sorted_ = true;
+            // the rows themselves are not moved, only the index sorting them
+            sortedIndex_.resize(rowCount_);
+            for (int i = 0; i < rowCount_; ++i)
+                sortedIndex_[i] = i;
+            std::stable_sort(sortedIndex_.begin(), sortedIndex_.end(), less);
         }
+        sorted_ = true;
+        rows_.clear();
+        rowsValid_ = false;
     }
 }
 
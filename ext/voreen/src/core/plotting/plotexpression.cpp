@@ -38,10 +38,65 @@
 #include "tgt/logmanager.h"
 #include <ctype.h>
 #include <math.h>
+#include <cstring>
 
 
 namespace voreen {
 
+namespace {
+
+// the functions of the expression language, resolved once at compile time
+
+plot_t plotAbs(plot_t x)    { return std::fabs(x); }
+plot_t plotSqrt(plot_t x)   { return std::sqrt(x); }
+plot_t plotSin(plot_t x)    { return std::sin(x); }
+plot_t plotCos(plot_t x)    { return std::cos(x); }
+plot_t plotTan(plot_t x)    { return std::tan(x); }
+plot_t plotAsin(plot_t x)   { return std::asin(x); }
+plot_t plotAcos(plot_t x)   { return std::acos(x); }
+plot_t plotAtan(plot_t x)   { return std::atan(x); }
+plot_t plotSinh(plot_t x)   { return std::sinh(x); }
+plot_t plotCosh(plot_t x)   { return std::cosh(x); }
+plot_t plotTanh(plot_t x)   { return std::tanh(x); }
+plot_t plotLn(plot_t x)     { return std::log(x); }
+plot_t plotExp(plot_t x)    { return std::exp(x); }
+plot_t plotLog(plot_t x)    { return std::log10(x); }
+plot_t plotInt(plot_t x)    { return int(x); }
+plot_t plotFloor(plot_t x)  { return std::floor(x); }
+plot_t plotCeil(plot_t x)   { return std::ceil(x); }
+plot_t plotRnd(plot_t x)    { return std::floor(x+0.5); }
+plot_t plotSgn(plot_t x)    { return x > 0 ? 1 : (x == 0 ? 0 : -1); }
+plot_t plotSgx(plot_t x)    { return x >= 0 ? 1 : 0; }
+plot_t plotUndefined(plot_t) { return std::numeric_limits<plot_t>::quiet_NaN(); }
+
+plot_t plotFac(plot_t x) {
+    plot_t result = x;
+    while (x -1 > 0) {
+        x -= 1;
+        result *= x;
+    }
+    return result;
+}
+
+struct PlotFunctionEntry {
+    const char* name;
+    plot_t (*function)(plot_t);
+};
+
+const PlotFunctionEntry plotFunctions[] = {
+    { "abs", plotAbs },       { "sqrt", plotSqrt },     { "sin", plotSin },       { "cos", plotCos },
+    { "tan", plotTan },       { "arcsin", plotAsin },   { "arccos", plotAcos },   { "arctan", plotAtan },
+    { "sinh", plotSinh },     { "cosh", plotCosh },     { "tanh", plotTanh },     { "ln", plotLn },
+    { "exp", plotExp },       { "log", plotLog },       { "fac", plotFac },       { "int", plotInt },
+    { "floor", plotFloor },   { "ceil", plotCeil },     { "rnd", plotRnd },       { "sgn", plotSgn },
+    { "sgx", plotSgx }
+};
+
+/// number of points evaluated at once by evaluateBatch
+const size_t batchSize = 256;
+
+} // namespace
+
 
 const std::string PlotExpression::loggerCat_("voreen.plotting.PlotExpression");
 
@@ -105,6 +160,13 @@ PlotExpression::PlotExpression(const std::string& value, const std::string& expr
         }
     }
     numberOfVariables_ = calculateNumberOfVariables();
+    for (size_t j = 0; j < functionVector_.size(); ++j) {
+        Program& program = functionVector_[j].program;
+        size_t position = 0;
+        int depth = 0;
+        compile(functionVector_[j].function, position, program, depth);
+        stackSize_ = std::max(stackSize_, program.stackSize);
+    }
     calculateDomain();
 #ifdef VRN_PLOTEXPRESSION_DEBUG
     elog_ << "\nDomain:";
@@ -140,6 +202,7 @@ void PlotExpression::initialize() {
     representation_ = "";
     expressionName_ = "f";
     numberOfVariables_ = 0;
+    stackSize_ = 1;
     domain_.clear();
     variables_.resize(26);
 }
@@ -155,23 +218,31 @@ int PlotExpression::calculateNumberOfVariables() {
     return z;
 }
 
-void PlotExpression::evaluateDomain(std::stack<glslparser::Token*>& tokens, int index, int& number) {
-    if (tokens.size() == 0)
+void PlotExpression::evaluateDomain(const std::vector<glslparser::Token*>& tokens, size_t& position, int index, int& number) {
+    if (position >= tokens.size())
         return;
 
-    glslparser::Token* token = tokens.top();
-    tokens.pop();
+    glslparser::Token* token = tokens[position++];
     if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_COLON) { // ":"
     }
     else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_COMMA) {  // ","
-        glslparser::BracketToken* const leftbracket = dynamic_cast<glslparser::BracketToken* const>(tokens.top());
-        tokens.pop();
-        plot_t leftrange = evaluate(tokens,std::vector<plot_t>());
-        glslparser::BracketToken* const rightbracket = dynamic_cast<glslparser::BracketToken* const>(tokens.top());
-        tokens.pop();
-        plot_t rightrange = evaluate(tokens,std::vector<plot_t>());
-        bool leftopen = leftbracket->getTokenID() == glslparser::PlotFunctionTerminals::ID_LPAREN;
-        bool rightopen = rightbracket->getTokenID() == glslparser::PlotFunctionTerminals::ID_RPAREN;
+        // each bound is a bracket followed by the term of its value
+        bool leftopen = tokens.at(position++)->getTokenID() == glslparser::PlotFunctionTerminals::ID_LPAREN;
+        Program program;
+        int depth = 0;
+        compile(tokens, position, program, depth);
+        plot_t leftrange;
+        std::vector<plot_t> stack(program.stackSize);
+        run(program, 0, 1, &leftrange, &stack[0]);
+
+        bool rightopen = tokens.at(position++)->getTokenID() == glslparser::PlotFunctionTerminals::ID_RPAREN;
+        program = Program();
+        depth = 0;
+        compile(tokens, position, program, depth);
+        plot_t rightrange;
+        stack.resize(program.stackSize);
+        run(program, 0, 1, &rightrange, &stack[0]);
+
         Interval<plot_t> interval = Interval<plot_t>(leftrange,rightrange,leftopen,rightopen);
         functionVector_[index].domain[number] = interval;
         ++number;
@@ -192,13 +263,11 @@ void PlotExpression::calculateDomain() {
             functionVector_[i].domain[j] = Interval<plot_t>(-std::numeric_limits<plot_t>::infinity(),
                     std::numeric_limits<plot_t>::infinity(),true,true);
         }
-        std::stack<glslparser::Token*> token;
-        for (size_t j = functionVector_.at(i).interval.size(); j > 0; --j) {
-            token.push(functionVector_.at(i).interval[j-1]);
-        }
+        const std::vector<glslparser::Token*>& token = functionVector_.at(i).interval;
+        size_t position = 0;
         int number = 0;
-        while (token.size() > 0 && number < count) {
-            evaluateDomain(token,i,number);
+        while (position < token.size() && number < count) {
+            evaluateDomain(token,position,i,number);
         }
     }
     domain_.clear();
@@ -223,165 +292,238 @@ std::string PlotExpression::getVariable(int number) const {
     return result;
 }
 
-plot_t PlotExpression::evaluateAt(const std::vector<plot_t>& value) {
+plot_t PlotExpression::evaluateAt(const std::vector<plot_t>& value) const {
     if (static_cast<int>(value.size()) < numberOfVariables())
         return std::numeric_limits<plot_t>::quiet_NaN();
-    else {
-        int k = -1;
-        for (size_t i = 0; i < functionVector_.size(); ++i) {
-            k = i;
-            for (size_t j = 0; j < functionVector_[i].domain.size(); ++j) {
-                if (!functionVector_[i].domain[j].contains(value[j]))
-                    k = -1;
+
+    // there are at most 26 variables, and most functions need only a short stack
+    const plot_t* values[26];
+    size_t numValues = std::min<size_t>(value.size(), 26);
+    for (size_t i = 0; i < numValues; ++i)
+        values[i] = &value[i];
+    int k = findPartialFunction(values, numValues, 0);
+    if (k < 0)
+        return std::numeric_limits<plot_t>::quiet_NaN();
+
+    const Program& program = functionVector_[k].program;
+    plot_t result;
+    plot_t localStack[16];
+    std::vector<plot_t> stack;
+    if (program.stackSize > 16)
+        stack.resize(program.stackSize);
+    run(program, values, 1, &result, stack.empty() ? localStack : &stack[0]);
+    return result;
+}
+
+void PlotExpression::evaluateBatch(const plot_t* xs, size_t n, plot_t* out) const {
+    std::vector<const plot_t*> values(1, xs);
+    evaluateBatch(values, n, out);
+}
+
+void PlotExpression::evaluateBatch(const std::vector<const plot_t*>& values, size_t n, plot_t* out) const {
+    if (static_cast<int>(values.size()) < numberOfVariables()) {
+        std::fill(out, out + n, std::numeric_limits<plot_t>::quiet_NaN());
+        return;
+    }
+
+    // the points are evaluated in blocks, which keep the stack of the programs in the cache
+    std::vector<const plot_t*> blockValues(values.size() + 1);
+    std::vector<int> partialFunction(batchSize);
+    std::vector<plot_t> stack(stackSize_ * batchSize);
+    // points of a single partial function, gathered from a block that mixes several
+    std::vector<size_t> partialIndices(batchSize);
+    std::vector<plot_t> partialValues(values.size() * batchSize);
+    std::vector<const plot_t*> partialValuePointers(values.size() + 1);
+    std::vector<plot_t> partialResult(batchSize);
+    for (size_t start = 0; start < n; start += batchSize) {
+        const size_t count = std::min(batchSize, n - start);
+        for (size_t v = 0; v < values.size(); ++v)
+            blockValues[v] = values[v] + start;
+
+        // sort the points to the partial functions
+        for (size_t i = 0; i < count; ++i)
+            partialFunction[i] = findPartialFunction(&blockValues[0], values.size(), i);
+
+        plot_t* result = out + start;
+        std::fill(result, result + count, std::numeric_limits<plot_t>::quiet_NaN());
+        for (size_t k = 0; k < functionVector_.size(); ++k) {
+            size_t numPoints = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (partialFunction[i] == static_cast<int>(k))
+                    partialIndices[numPoints++] = i;
             }
-            if (k != -1)
+            if (numPoints == count) {
+                run(functionVector_[k].program, &blockValues[0], count, result, &stack[0]);
                 break;
-        }
-        if (k >= 0) {
-            std::stack<glslparser::Token*> token;
-            for (size_t i = functionVector_.at(k).function.size(); i > 0; --i)
-                token.push(functionVector_.at(k).function[i-1]);
-            return evaluate(token,value);
+            }
+            else if (numPoints > 0) {
+                // run the program only on the points of its domain, outside of it e.g. fac() need not terminate
+                for (size_t v = 0; v < values.size(); ++v) {
+                    plot_t* gathered = &partialValues[v * batchSize];
+                    for (size_t p = 0; p < numPoints; ++p)
+                        gathered[p] = blockValues[v][partialIndices[p]];
+                    partialValuePointers[v] = gathered;
+                }
+                run(functionVector_[k].program, &partialValuePointers[0], numPoints, &partialResult[0], &stack[0]);
+                for (size_t p = 0; p < numPoints; ++p)
+                    result[partialIndices[p]] = partialResult[p];
+            }
         }
     }
-    return std::numeric_limits<plot_t>::quiet_NaN();
 }
 
-plot_t PlotExpression::evaluate(std::stack<glslparser::Token*>& tokens, const std::vector<plot_t>& value) {
-    if (tokens.size() == 0)
-        return std::numeric_limits<plot_t>::quiet_NaN();
-    glslparser::Token* token = tokens.top();
-    tokens.pop();
-    if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_INTCONST ||
-        token->getTokenID() == glslparser::PlotFunctionTerminals::ID_FLOATCONST) {
-        return dynamic_cast<glslparser::ConstantToken* const>(token)->convert<plot_t>();
+int PlotExpression::findPartialFunction(const plot_t* const* values, size_t numValues, size_t i) const {
+    for (size_t k = 0; k < functionVector_.size(); ++k) {
+        const std::vector<Interval<plot_t> >& domain = functionVector_[k].domain;
+        bool contained = true;
+        for (size_t j = 0; j < domain.size() && j < numValues && contained; ++j)
+            contained = domain[j].contains(values[j][i]);
+        if (contained)
+            return static_cast<int>(k);
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_VARIABLE) {
-        char var = dynamic_cast<glslparser::IdentifierToken* const>(token)->getValue()[0];
-        int number = variables_.at(var-PlotExpression::charOffset_).numberOfVariable-1;
-        return value.at(number);
+    return -1;
+}
+
+void PlotExpression::emit(Program& program, const Instruction& instruction, int& depth) const {
+    program.instructions.push_back(instruction);
+    if (instruction.op == Instruction::PUSH_CONSTANT || instruction.op == Instruction::PUSH_VARIABLE)
+        ++depth;
+    else if (instruction.op != Instruction::CALL && instruction.op != Instruction::NEG)
+        --depth;
+    program.stackSize = std::max(program.stackSize, depth);
+}
+
+void PlotExpression::compile(const std::vector<glslparser::Token*>& tokens, size_t& position, Program& program,
+                             int& depth) const
+{
+    // the tokens are in prefix order, the program is the postfix order of the same tree
+    Instruction instruction;
+    instruction.op = Instruction::PUSH_CONSTANT;
+    instruction.value = std::numeric_limits<plot_t>::quiet_NaN();
+    instruction.variable = 0;
+    instruction.function = 0;
+    if (position >= tokens.size()) {
+        emit(program, instruction, depth);
+        return;
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_FUNCTION_TERM) {
-        return evaluate(tokens,value);
+
+    glslparser::Token* token = tokens[position++];
+    const int id = token->getTokenID();
+    if (id == glslparser::PlotFunctionTerminals::ID_INTCONST ||
+        id == glslparser::PlotFunctionTerminals::ID_FLOATCONST) {
+        instruction.value = dynamic_cast<glslparser::ConstantToken* const>(token)->convert<plot_t>();
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_FUNCTION) {
-        glslparser::FunctionToken* const function = dynamic_cast<glslparser::FunctionToken* const>(token);
-        std::string stringFunction = function->getValue();
-        plot_t plotvalue = evaluate(tokens,value);
-        if (stringFunction == "abs") {
-            return abs(plotvalue);
-        }
-        else if (stringFunction == "sqrt") {
-            return std::sqrt(plotvalue);
-        }
-        else if (stringFunction == "sin") {
-            return std::sin(plotvalue);
-        }
-        else if (stringFunction == "cos") {
-            return std::cos(plotvalue);
-        }
-        else if (stringFunction == "tan") {
-            return std::tan(plotvalue);
-        }
-        else if (stringFunction == "arcsin") {
-            return std::asin(plotvalue);
-        }
-        else if (stringFunction == "arccos") {
-            return std::acos(plotvalue);
-        }
-        else if (stringFunction == "arctan") {
-            return std::atan(plotvalue);
-        }
-        else if (stringFunction == "sinh") {
-            return std::sinh(plotvalue);
-        }
-        else if (stringFunction == "cosh") {
-            return std::cosh(plotvalue);
-        }
-        else if (stringFunction == "tanh") {
-            return std::tanh(plotvalue);
-        }
-        else if (stringFunction == "ln") {
-            return std::log(plotvalue);
-        }
-        else if (stringFunction == "exp") {
-            return std::exp(plotvalue);
-        }
-        else if (stringFunction == "log") {
-            return std::log10(plotvalue);
-        }
-        else if (stringFunction == "fac") {
-            plot_t result = plotvalue;
-            while (plotvalue -1 > 0) {
-                plotvalue -= 1;
-                result *= plotvalue;
-            }
-            return result;
-        }
-        else if (stringFunction == "int") {
-            return int(plotvalue);
-        }
-        else if (stringFunction == "floor") {
-            return std::floor(plotvalue);
-        }
-        else if (stringFunction == "ceil") {
-            return std::ceil(plotvalue);
-        }
-        else if (stringFunction == "rnd") {
-            return std::floor(plotvalue+0.5);
-        }
-        else if (stringFunction == "sgn") {
-            return plotvalue > 0 ? 1 : (plotvalue == 0 ? 0 : -1);
-        }
-        else if (stringFunction == "sgx") {
-            return plotvalue >= 0 ? 1 : 0;
-        }
+    else if (id == glslparser::PlotFunctionTerminals::ID_VARIABLE) {
+        char var = dynamic_cast<glslparser::IdentifierToken* const>(token)->getValue()[0];
+        instruction.op = Instruction::PUSH_VARIABLE;
+        instruction.variable = variables_.at(var-PlotExpression::charOffset_).numberOfVariable-1;
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_PLUS) {
-        glslparser::OperatorToken* const op = dynamic_cast<glslparser::OperatorToken* const>(token);
-        if (op->getParameter() == 1)
-            return evaluate(tokens,value);
-        else if (op->getParameter() == 2) {
-            plot_t value1 = evaluate(tokens,value);
-            plot_t value2 = evaluate(tokens,value);
-            return value1 + value2;
-        }
+    else if (id == glslparser::PlotFunctionTerminals::ID_FUNCTION_TERM) {
+        compile(tokens, position, program, depth);
+        return;
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_DASH) {
-        glslparser::OperatorToken* const op  = dynamic_cast<glslparser::OperatorToken* const>(token);
-        if (op->getParameter() == 1)
-            return -evaluate(tokens,value);
-        else if (op->getParameter() == 2) {
-            plot_t value1 = evaluate(tokens,value);
-            plot_t value2 = evaluate(tokens,value);
-            return value1 - value2;
+    else if (id == glslparser::PlotFunctionTerminals::ID_FUNCTION) {
+        std::string name = dynamic_cast<glslparser::FunctionToken* const>(token)->getValue();
+        compile(tokens, position, program, depth);
+        instruction.op = Instruction::CALL;
+        instruction.function = plotUndefined;
+        for (size_t i = 0; i < sizeof(plotFunctions) / sizeof(plotFunctions[0]); ++i) {
+            if (name == plotFunctions[i].name)
+                instruction.function = plotFunctions[i].function;
         }
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_STAR) {
-        glslparser::OperatorToken* const op = dynamic_cast<glslparser::OperatorToken* const>(token);
-        if (op->getParameter() == 2) {
-            plot_t value1 = evaluate(tokens,value);
-            plot_t value2 = evaluate(tokens,value);
-            return value1 * value2;
+    else if (id == glslparser::PlotFunctionTerminals::ID_PLUS  || id == glslparser::PlotFunctionTerminals::ID_DASH  ||
+             id == glslparser::PlotFunctionTerminals::ID_STAR  || id == glslparser::PlotFunctionTerminals::ID_SLASH ||
+             id == glslparser::PlotFunctionTerminals::ID_CARET) {
+        int parameter = dynamic_cast<glslparser::OperatorToken* const>(token)->getParameter();
+        if (parameter == 1 && id == glslparser::PlotFunctionTerminals::ID_PLUS) {
+            compile(tokens, position, program, depth);
+            return;
+        }
+        else if (parameter == 1 && id == glslparser::PlotFunctionTerminals::ID_DASH) {
+            compile(tokens, position, program, depth);
+            instruction.op = Instruction::NEG;
+        }
+        else if (parameter == 2) {
+            compile(tokens, position, program, depth);
+            compile(tokens, position, program, depth);
+            if (id == glslparser::PlotFunctionTerminals::ID_PLUS)
+                instruction.op = Instruction::ADD;
+            else if (id == glslparser::PlotFunctionTerminals::ID_DASH)
+                instruction.op = Instruction::SUB;
+            else if (id == glslparser::PlotFunctionTerminals::ID_STAR)
+                instruction.op = Instruction::MUL;
+            else if (id == glslparser::PlotFunctionTerminals::ID_SLASH)
+                instruction.op = Instruction::DIV;
+            else
+                instruction.op = Instruction::POW;
         }
     }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_SLASH) {
-        glslparser::OperatorToken* const op = dynamic_cast<glslparser::OperatorToken* const>(token);
-        if (op->getParameter() == 2) {
-            plot_t value1 = evaluate(tokens,value);
-            plot_t value2 = evaluate(tokens,value);
-            return value1 / value2;
+    emit(program, instruction, depth);
+}
+
+void PlotExpression::run(const Program& program, const plot_t* const* values, size_t count, plot_t* result,
+                         plot_t* stack) const
+{
+    // the bottom of the stack is the result, the other levels are rows of count values in stack
+    int top = 0;
+    for (size_t p = 0; p < program.instructions.size(); ++p) {
+        const Instruction& instruction = program.instructions[p];
+        if (instruction.op == Instruction::PUSH_CONSTANT || instruction.op == Instruction::PUSH_VARIABLE) {
+            plot_t* r = (top == 0 ? result : stack + (top-1) * count);
+            if (instruction.op == Instruction::PUSH_VARIABLE && values)
+                std::memcpy(r, values[instruction.variable], count * sizeof(plot_t));
+            else if (instruction.op == Instruction::PUSH_VARIABLE)
+                std::fill(r, r + count, std::numeric_limits<plot_t>::quiet_NaN());
+            else
+                std::fill(r, r + count, instruction.value);
+            ++top;
+            continue;
         }
-    }
-    else if (token->getTokenID() == glslparser::PlotFunctionTerminals::ID_CARET) {
-        glslparser::OperatorToken* const op = dynamic_cast<glslparser::OperatorToken* const>(token);
-        if (op->getParameter() == 2) {
-            plot_t value1 = evaluate(tokens,value);
-            plot_t value2 = evaluate(tokens,value);
-            return pow(value1,value2);
+
+        plot_t* a = (top == 1 ? result : stack + (top-2) * count);
+        if (instruction.op == Instruction::CALL) {
+            plot_t (*function)(plot_t) = instruction.function;
+            for (size_t i = 0; i < count; ++i)
+                a[i] = function(a[i]);
+            continue;
+        }
+        else if (instruction.op == Instruction::NEG) {
+            for (size_t i = 0; i < count; ++i)
+                a[i] = -a[i];
+            continue;
+        }
+
+        a = (top == 2 ? result : stack + (top-3) * count);
+        const plot_t* b = stack + (top-2) * count;
+        switch (instruction.op) {
+            case Instruction::ADD:
+                for (size_t i = 0; i < count; ++i)
+                    a[i] += b[i];
+                break;
+            case Instruction::SUB:
+                for (size_t i = 0; i < count; ++i)
+                    a[i] -= b[i];
+                break;
+            case Instruction::MUL:
+                for (size_t i = 0; i < count; ++i)
+                    a[i] *= b[i];
+                break;
+            case Instruction::DIV:
+                for (size_t i = 0; i < count; ++i)
+                    a[i] /= b[i];
+                break;
+            case Instruction::POW:
+                for (size_t i = 0; i < count; ++i)
+                    a[i] = pow(a[i], b[i]);
+                break;
+            default:
+                break;
         }
+        --top;
     }
-    return std::numeric_limits<plot_t>::quiet_NaN();
+    if (program.instructions.empty())
+        std::fill(result, result + count, std::numeric_limits<plot_t>::quiet_NaN());
 }
 
 int PlotExpression::numberOfVariables() const {
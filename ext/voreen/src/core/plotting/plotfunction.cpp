@@ -103,17 +103,13 @@ std::vector<std::vector<plot_t> > PlotFunction::evaluateAt(const std::vector<Int
         }
     }
     x = start;
-    plot_t y;
-    std::vector<plot_t> partVector;
+    // collect the grid points first, so that the expression is evaluated for all of them at once
+    std::vector<std::vector<plot_t> > points(step.size());
     size_t j = interval.size()-1;
     while (interval.at(0).contains(x.at(0))) {
-        partVector.clear();
-        y = evaluateAt(x);
         for (size_t i = 0; i < step.size(); ++i) {
-            partVector.push_back(x[i]);
+            points[i].push_back(x[i]);
         }
-        partVector.push_back(y);
-        result.push_back(partVector);
         x[j] += step.at(j);
         for (size_t k = 1; k < interval.size(); ++k) {
             if (!interval.at(k).contains(x[k])) {
@@ -122,6 +118,23 @@ std::vector<std::vector<plot_t> > PlotFunction::evaluateAt(const std::vector<Int
             }
         }
     }
+
+    size_t count = points.at(0).size();
+    if (count == 0)
+        return result;
+    std::vector<const plot_t*> values;
+    for (size_t i = 0; i < points.size(); ++i)
+        values.push_back(&points[i][0]);
+    std::vector<plot_t> y(count);
+    expr_.evaluateBatch(values, count, &y[0]);
+
+    result.resize(count);
+    for (size_t p = 0; p < count; ++p) {
+        result[p].reserve(step.size()+1);
+        for (size_t i = 0; i < step.size(); ++i)
+            result[p].push_back(points[i][p]);
+        result[p].push_back(y[p]);
+    }
     return result;
 }
 
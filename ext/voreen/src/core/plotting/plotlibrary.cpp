@@ -198,8 +198,7 @@ bool PlotLibrary::setOpenGLStatus() {
 }
 
 void PlotLibrary::renderLine(const PlotData& data, int indexX, int indexY) const {
-    //row iterator
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin();
+    int rowCount = data.getRowsCount();
     // check if only values or only tags in given cells
     bool tagsInX = (data.getColumnType(indexX) == PlotBase::STRING);
     //set up some opengl settings
@@ -220,28 +219,27 @@ void PlotLibrary::renderLine(const PlotData& data, int indexX, int indexY) const
     int i = 0;
     double x = 0.0; double y = 0.0; //they are set in the loop
     //go to the first row with non null entries
-    while (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
-        ++it; ++i;
-    }
-    if (it == data.getRowsEnd() || it == --data.getRowsEnd())
+    while (i < rowCount && (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)))
+        ++i;
+    if (i >= rowCount - 1)
         return;
 
     // draw the line
-    double oldX = tagsInX ? i : it->getValueAt(indexX);
-    double oldY = it->getValueAt(indexY);
+    double oldX = tagsInX ? i : data.getValueAt(i, indexX);
+    double oldY = data.getValueAt(i, indexY);
     if (usePlotPickingManager_)
         ppm_->setGLColor(-1, indexY);
     else if (lineIsHighlighted)
         glColor4fv(highlightColor_.elem);
     else
         glColor4fv(drawingColor_.elem);
-    for (++it, ++i; it != data.getRowsEnd(); ++it, ++i) {
+    for (++i; i < rowCount; ++i) {
         //we ignore rows with null entries
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)) {
             continue;
         }
-        x = tagsInX ? i : it->getValueAt(indexX);
-        y = it->getValueAt(indexY);
+        x = tagsInX ? i : data.getValueAt(i, indexX);
+        y = data.getValueAt(i, indexY);
         glBegin(GL_LINES);
             logGlVertex2d(oldX, oldY);
             logGlVertex2d(x, y);
@@ -256,16 +254,16 @@ void PlotLibrary::renderLine(const PlotData& data, int indexX, int indexY) const
     // render the points
     glPointSize(maxGlyphSize_);
     glBegin(GL_POINTS);
-    for (it = data.getRowsBegin(), i = 0; it != data.getRowsEnd(); ++it, ++i) {
+    for (i = 0; i < rowCount; ++i) {
         //we ignore rows with null entries
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)) {
             continue;
         }
-        x = tagsInX ? i : it->getValueAt(indexX);
-        y = it->getValueAt(indexY);
+        x = tagsInX ? i : data.getValueAt(i, indexX);
+        y = data.getValueAt(i, indexY);
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, indexY);
-        else if (it->getCellAt(indexY).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, indexY)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(drawingColor_.elem);
@@ -280,7 +278,7 @@ void PlotLibrary::renderLine(const PlotData& data, int indexX, int indexY) const
 }
 
 void PlotLibrary::renderSpline(const PlotData& data, int indexX, int indexY) const {
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin(); // row iterator
+    int rowCount = data.getRowsCount();
     tgt::Spline spline;
     // check if only values or only tags in given cells
     bool tagsInX = (data.getColumnType(indexX) == PlotBase::STRING);
@@ -298,23 +296,22 @@ void PlotLibrary::renderSpline(const PlotData& data, int indexX, int indexY) con
     }
     int i = 0;
     //go to the first row with non null entrys
-    while (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
-        ++it; ++i;
-    }
-    if (it == data.getRowsEnd())
+    while (i < rowCount && (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)))
+        ++i;
+    if (i == rowCount)
         return;
 
     // add the control points
-    double x = tagsInX ? i : it->getValueAt(indexX);
-    double y = it->getValueAt(indexY);
+    double x = tagsInX ? i : data.getValueAt(i, indexX);
+    double y = data.getValueAt(i, indexY);
     spline.addControlPoint(tgt::dvec3(x,y,0));
-    for (; it != data.getRowsEnd(); ++it, ++i) {
+    for (; i < rowCount; ++i) {
         //we ignore rows with null entries
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)) {
             continue;
         }
-        x = tagsInX ? i : it->getValueAt(indexX);
-        y = it->getValueAt(indexY);
+        x = tagsInX ? i : data.getValueAt(i, indexX);
+        y = data.getValueAt(i, indexY);
         spline.addControlPoint(tgt::dvec3(x,y,0));
     }
     spline.addControlPoint(tgt::dvec3(x,y,0));
@@ -340,16 +337,16 @@ void PlotLibrary::renderSpline(const PlotData& data, int indexX, int indexY) con
     // render the points
     glPointSize(maxGlyphSize_);
     glBegin(GL_POINTS);
-    for (it = data.getRowsBegin(), i = 0; it != data.getRowsEnd(); ++it, ++i) {
+    for (i = 0; i < rowCount; ++i) {
         //we ignore rows with null entries
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)) {
             continue;
         }
-        x = tagsInX ? i : it->getValueAt(indexX);
-        y = it->getValueAt(indexY);
+        x = tagsInX ? i : data.getValueAt(i, indexX);
+        y = data.getValueAt(i, indexY);
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, indexY);
-        else if (it->getCellAt(indexY).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, indexY)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(drawingColor_.elem);
@@ -364,7 +361,7 @@ void PlotLibrary::renderSpline(const PlotData& data, int indexX, int indexY) con
 }
 
 void PlotLibrary::renderErrorline(const PlotData& data, int indexX, int indexY, int indexError) const {
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin();
+    int rowCount = data.getRowsCount();
     // check if only values or only tags in given cells
     bool tagsInX = (data.getColumnType(indexX) == PlotBase::STRING);
     glDisable(GL_DEPTH_TEST);
@@ -373,31 +370,29 @@ void PlotLibrary::renderErrorline(const PlotData& data, int indexX, int indexY,
 
     int i = 0;
     //go to the first row with non null entrys
-    while (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
-        ++it; ++i;
-    }
-    if (it == data.getRowsEnd())
+    while (i < rowCount && (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)))
+        ++i;
+    if (i == rowCount)
         return;
 
-    double x             = tagsInX ? i : it->getValueAt(indexX);
-    double errorTop      = it->getValueAt(indexY) + std::abs(it->getValueAt(indexError));
-    double errorBottom   = it->getValueAt(indexY) - std::abs(it->getValueAt(indexError));
+    double x             = tagsInX ? i : data.getValueAt(i, indexX);
+    double errorTop      = data.getValueAt(i, indexY) + std::abs(data.getValueAt(i, indexError));
+    double errorBottom   = data.getValueAt(i, indexY) - std::abs(data.getValueAt(i, indexError));
     if (usePlotPickingManager_)
         ppm_->setGLColor(-1, indexY);
     else
         glColor4fv(fillColor_.elem);
     // draw the errorline
-    ++i;
     glBegin(GL_QUAD_STRIP);
-        for (it = (++it); it != data.getRowsEnd(); ++it, ++i) {
-            if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull())
+        for (++i; i < rowCount; ++i) {
+            if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY))
                 continue;
             logGlVertex2d(x, errorBottom);
             logGlVertex2d(x, errorTop);
 
-            x = tagsInX ? i : it->getValueAt(indexX);
-            errorTop = it->getValueAt(indexY) + std::abs(it->getValueAt(indexError));
-            errorBottom = it->getValueAt(indexY) - std::abs(it->getValueAt(indexError));
+            x = tagsInX ? i : data.getValueAt(i, indexX);
+            errorTop = data.getValueAt(i, indexY) + std::abs(data.getValueAt(i, indexError));
+            errorBottom = data.getValueAt(i, indexY) - std::abs(data.getValueAt(i, indexError));
         }
         logGlVertex2d(x, errorBottom);
         logGlVertex2d(x, errorTop);
@@ -408,7 +403,7 @@ void PlotLibrary::renderErrorline(const PlotData& data, int indexX, int indexY,
 }
 
 void PlotLibrary::renderErrorspline(const PlotData& data, int indexX, int indexY, int indexError) const {
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin();
+    int rowCount = data.getRowsCount();
     tgt::Spline splineTop, splineBottom;
 
     // check if only values or only tags in given cells
@@ -423,30 +418,29 @@ void PlotLibrary::renderErrorspline(const PlotData& data, int indexX, int indexY
     glEnable (GL_CLIP_PLANE2); glEnable (GL_CLIP_PLANE3);
     int i = 0;
     //go to the first row with non null entrys
-    while (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
-        ++it; ++i;
-    }
-    if (it == data.getRowsEnd())
+    while (i < rowCount && (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)))
+        ++i;
+    if (i == rowCount)
         return;
 
     //fill the splines
 
-    double x             = tagsInX ? i : it->getValueAt(indexX);
-    double errorTop      = it->getValueAt(indexY) + std::abs(it->getValueAt(indexError));
-    double errorBottom   = it->getValueAt(indexY) - std::abs(it->getValueAt(indexError));
+    double x             = tagsInX ? i : data.getValueAt(i, indexX);
+    double errorTop      = data.getValueAt(i, indexY) + std::abs(data.getValueAt(i, indexError));
+    double errorBottom   = data.getValueAt(i, indexY) - std::abs(data.getValueAt(i, indexError));
     splineTop.addControlPoint(tgt::dvec3(x,errorTop,0));
     splineBottom.addControlPoint(tgt::dvec3(x,errorBottom,0));
-    for (; it != data.getRowsEnd(); ++it, ++i) {
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull())
+    for (; i < rowCount; ++i) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY))
             continue;
 
-        x = tagsInX ? i : it->getValueAt(indexX);
-        if (it->getCellAt(indexError).isNull()){
-            errorTop = it->getValueAt(indexY);
-            errorBottom = it->getValueAt(indexY);
+        x = tagsInX ? i : data.getValueAt(i, indexX);
+        if (data.isNullAt(i, indexError)){
+            errorTop = data.getValueAt(i, indexY);
+            errorBottom = data.getValueAt(i, indexY);
         } else {
-            errorTop = it->getValueAt(indexY) + std::abs(it->getValueAt(indexError));
-            errorBottom = it->getValueAt(indexY) - std::abs(it->getValueAt(indexError));
+            errorTop = data.getValueAt(i, indexY) + std::abs(data.getValueAt(i, indexError));
+            errorBottom = data.getValueAt(i, indexY) - std::abs(data.getValueAt(i, indexError));
         }
         splineTop.addControlPoint(tgt::dvec3(x,errorTop,0));
         splineBottom.addControlPoint(tgt::dvec3(x,errorBottom,0));
@@ -468,7 +462,6 @@ void PlotLibrary::renderErrorspline(const PlotData& data, int indexX, int indexY
 }
 
 void PlotLibrary::renderErrorbars(const PlotData& data, int indexX, int indexY, int indexError) const{
-    std::vector<PlotRowValue>::const_iterator it;
     // check if only values or only tags in given cells
     bool tagsInX = (data.getColumnType(indexX) == PlotBase::STRING);
     glLineWidth(lineWidth_);
@@ -480,26 +473,25 @@ void PlotLibrary::renderErrorbars(const PlotData& data, int indexX, int indexY,
     float aspectRatio = static_cast<float>(windowSize_.x)/static_cast<float>(windowSize_.y)*
         static_cast<float>(domain_[Y_AXIS].size() / domain_[X_AXIS].size());
 
-    int i = 0;
     // draw the errorbars
-    for (it = data.getRowsBegin(); it != data.getRowsEnd(); ++it, ++i) {
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull() || it->getCellAt(indexError).isNull()) {
+    for (int i = 0; i < data.getRowsCount(); ++i) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY) || data.isNullAt(i, indexError)) {
             continue;
         }
-        double x = tagsInX ? i : it->getValueAt(indexX);
+        double x = tagsInX ? i : data.getValueAt(i, indexX);
         if (!domain_[X_AXIS].contains(x))
             continue;
 
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, indexError);
-        else if (it->getCellAt(indexError).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, indexError)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(drawingColor_.elem);
 
-        double y = it->getValueAt(indexY);
-        double yTop = it->getValueAt(indexY) + it->getValueAt(indexError);
-        double yBottom = it->getValueAt(indexY) - it->getValueAt(indexError);
+        double y = data.getValueAt(i, indexY);
+        double yTop = y + data.getValueAt(i, indexError);
+        double yBottom = y - data.getValueAt(i, indexError);
         x = logarithmicAxisFlags_[X_AXIS] ? convertToLogCoordinates(x, X_AXIS) : x;
         y = logarithmicAxisFlags_[Y_AXIS] ? convertToLogCoordinates(y, Y_AXIS) : y;
         yTop = logarithmicAxisFlags_[Y_AXIS] ? convertToLogCoordinates(yTop, Y_AXIS) : yTop;
@@ -528,8 +520,6 @@ void PlotLibrary::renderErrorbars(const PlotData& data, int indexX, int indexY,
 
 void PlotLibrary::renderCandlesticks(const PlotData& data, int indexX, int stickTop,
                                      int stickBottom, int candleTop, int candleBottom) const {
-    std::vector<PlotRowValue>::const_iterator it;
-
     // check if only values or only tags in given cells
     bool tagsInX = (data.getColumnType(indexX) == PlotBase::STRING);
     // openGL settings
@@ -541,28 +531,27 @@ void PlotLibrary::renderCandlesticks(const PlotData& data, int indexX, int stick
     float width = static_cast<float>(domain_[X_AXIS].size()/(4.f*data.getRowsCount()));
 
     // draw the candlestick
-    int i=0;
     double yStickTop     = 0.0;
     double yStickBottom  = 0.0;
     double yCandleTop    = 0.0;
     double yCandleBottom = 0.0;
 
-    for (it = data.getRowsBegin(); it != data.getRowsEnd(); ++it, ++i) {
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(stickTop).isNull() || it->getCellAt(stickBottom).isNull()
-            || it->getCellAt(candleTop).isNull() || it->getCellAt(candleBottom).isNull()) {
+    for (int i = 0; i < data.getRowsCount(); ++i) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, stickTop) || data.isNullAt(i, stickBottom)
+            || data.isNullAt(i, candleTop) || data.isNullAt(i, candleBottom)) {
             continue;
         }
-        double x = tagsInX ? i : it->getValueAt(indexX);
-        yStickTop     = it->getValueAt(stickTop);
-        yStickBottom  = it->getValueAt(stickBottom);
-        yCandleTop    = it->getValueAt(candleTop);
-        yCandleBottom = it->getValueAt(candleBottom);
+        double x = tagsInX ? i : data.getValueAt(i, indexX);
+        yStickTop     = data.getValueAt(i, stickTop);
+        yStickBottom  = data.getValueAt(i, stickBottom);
+        yCandleTop    = data.getValueAt(i, candleTop);
+        yCandleBottom = data.getValueAt(i, candleBottom);
 
         // we divide the stick and the candle in top and bottom half
         // draw stick
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, stickTop);
-        else if (it->getCellAt(stickTop).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, stickTop)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(drawingColor_.elem);
@@ -572,7 +561,7 @@ void PlotLibrary::renderCandlesticks(const PlotData& data, int indexX, int stick
         glEnd();
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, stickBottom);
-        else if (it->getCellAt(stickBottom).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, stickBottom)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(drawingColor_.elem);
@@ -583,7 +572,7 @@ void PlotLibrary::renderCandlesticks(const PlotData& data, int indexX, int stick
         //draw candle
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, candleTop);
-        else if (it->getCellAt(candleTop).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, candleTop)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(fillColor_.elem);
@@ -595,7 +584,7 @@ void PlotLibrary::renderCandlesticks(const PlotData& data, int indexX, int stick
         glEnd();
         if (usePlotPickingManager_)
             ppm_->setGLColor(i, candleBottom);
-        else if (it->getCellAt(candleBottom).isHighlighted())
+        else if (data.isHighlighted(tgt::ivec2(i, candleBottom)))
             glColor4fv(highlightColor_.elem);
         else
             glColor4fv(fillColor_.elem);
@@ -645,13 +634,13 @@ void PlotLibrary::renderSurface(const PlotData& data, const std::vector<int>& tr
         if (usePlotPickingManager_) {
             // to write out the PlotCell information to the ppm, we subdivide our triangle into three
             // quads, and render each with the according encoded color
-            const PlotRowValue& rowA = data.getRow(*it);
-            const PlotRowValue& rowB = data.getRow(*(it+1));
-            const PlotRowValue& rowC = data.getRow(*(it+2));
+            int rowA = *it;
+            int rowB = *(it+1);
+            int rowC = *(it+2);
 
-            tgt::dvec3 a(rowA.getValueAt(indexX), rowA.getValueAt(indexY), rowA.getValueAt(indexZ));
-            tgt::dvec3 b(rowB.getValueAt(indexX), rowB.getValueAt(indexY), rowB.getValueAt(indexZ));
-            tgt::dvec3 c(rowC.getValueAt(indexX), rowC.getValueAt(indexY), rowC.getValueAt(indexZ));
+            tgt::dvec3 a(data.getValueAt(rowA, indexX), data.getValueAt(rowA, indexY), data.getValueAt(rowA, indexZ));
+            tgt::dvec3 b(data.getValueAt(rowB, indexX), data.getValueAt(rowB, indexY), data.getValueAt(rowB, indexZ));
+            tgt::dvec3 c(data.getValueAt(rowC, indexX), data.getValueAt(rowC, indexY), data.getValueAt(rowC, indexZ));
 
             // 3 linear interpolations
             tgt::dvec3 ab = a + 0.5*(b-a);
@@ -690,20 +679,20 @@ void PlotLibrary::renderSurface(const PlotData& data, const std::vector<int>& tr
             // render triangle first
             glBegin(GL_POLYGON);
             for (int i=0; i<3; ++i) {
-                const PlotRowValue& row = data.getRow(*(it+i));
+                int row = *(it+i);
 
                 if (indexCM != -1 ) {
-                    float c = static_cast<float>((row.getValueAt(indexCM) - colInterval.getLeft()) / colInterval.size());
+                    float c = static_cast<float>((data.getValueAt(row, indexCM) - colInterval.getLeft()) / colInterval.size());
                     tgt::Color cc = colorMap_.getColorAtPosition(c);
                     glColor4fv(cc.elem);
                 }
-                if (!wire && row.getCellAt(indexZ).isHighlighted()) {
+                if (!wire && data.isHighlighted(tgt::ivec2(row, indexZ))) {
                     glColor4fv(highlightColor_.elem);
-                    glVertex3d(row.getValueAt(indexX), row.getValueAt(indexY), row.getValueAt(indexZ));
+                    glVertex3d(data.getValueAt(row, indexX), data.getValueAt(row, indexY), data.getValueAt(row, indexZ));
                     glColor4fv(drawingColor_.elem);
                 }
                 else
-                    glVertex3d(row.getValueAt(indexX), row.getValueAt(indexY), row.getValueAt(indexZ));
+                    glVertex3d(data.getValueAt(row, indexX), data.getValueAt(row, indexY), data.getValueAt(row, indexZ));
             }
             glEnd();
         }
@@ -736,23 +725,22 @@ void PlotLibrary::renderHeightmap(const voreen::PlotData& data, const std::vecto
 
     int row = 0;
     std::vector< std::list< tgt::dvec2 > >::const_iterator rit = voronoiRegions.begin();
-    std::vector<PlotRowValue>::const_iterator pit = data.getRowsBegin();
-    for (; rit < voronoiRegions.end(); ++rit, ++pit, ++row){
+    for (; rit < voronoiRegions.end(); ++rit, ++row){
         if (rit->empty())
             continue;
 
         if (usePlotPickingManager_)
             ppm_->setGLColor(row, indexZ);
-        else if (!wire && pit->getCellAt(indexZ).isHighlighted())
+        else if (!wire && data.isHighlighted(tgt::ivec2(row, indexZ)))
             glColor4fv(highlightColor_.elem);
         else if (indexCM != -1 ) {
-            float c = static_cast<float>((pit->getValueAt(indexCM) - colInterval.getLeft()) / colInterval.size());
+            float c = static_cast<float>((data.getValueAt(row, indexCM) - colInterval.getLeft()) / colInterval.size());
             glColor4fv(colorMap_.getColorAtPosition(c).elem);
         }
         else
             glColor4fv(drawingColor_.elem);
 
-        plot_t height = pit->getValueAt(indexZ);
+        plot_t height = data.getValueAt(row, indexZ);
         //clip it:
         if (height > domain_[Z_AXIS].getRight())
             height = domain_[Z_AXIS].getRight();
@@ -787,7 +775,6 @@ void PlotLibrary::renderHeightmap(const voreen::PlotData& data, const std::vecto
 }
 
 void PlotLibrary::renderBars(const PlotData& data, std::vector<int> indicesY) const {
-    std::vector<PlotRowValue>::const_iterator rowIt = data.getRowsBegin();
     //stores y values and indices of a merged bar group, the indices are used to get the right color
     std::vector<std::pair<plot_t, tgt::Color> > mergedBars;
     //stores last y value, used for stacked bars
@@ -795,19 +782,19 @@ void PlotLibrary::renderBars(const PlotData& data, std::vector<int> indicesY) co
     tgt::Color c;
     //rowcounter
     plot_t row = 0;
-    for (; rowIt < data.getRowsEnd(); ++rowIt) {
+    for (int rowIndex = 0; rowIndex < data.getRowsCount(); ++rowIndex) {
         lastY = 0;
         mergedBars.clear();
         // we do not use the iterator because we also iterate through the colormap
         for (size_t i = 0; i < indicesY.size(); ++i) {
-            if (rowIt->getCellAt(indicesY.at(i)).isHighlighted())
+            if (data.isHighlighted(tgt::ivec2(rowIndex, indicesY.at(i))))
                 c = highlightColor_;
             else
                 c = colorMap_.getColorAtIndex(i);
             if (barMode_ == STACKED) {
-                if (rowIt->getCellAt(indicesY.at(i)).isNull() )
+                if (data.isNullAt(rowIndex, indicesY.at(i)))
                     continue;
-                plot_t newY = lastY+rowIt->getValueAt(indicesY.at(i));
+                plot_t newY = lastY+data.getValueAt(rowIndex, indicesY.at(i));
                 //negative stacked bars do not make any sense and are ignored
                 if (newY < lastY)
                     continue;
@@ -817,23 +804,23 @@ void PlotLibrary::renderBars(const PlotData& data, std::vector<int> indicesY) co
                 lastY = newY;
             }
             else if (barMode_ == GROUPED) {
-                if (rowIt->getCellAt(indicesY.at(i)).isNull())
+                if (data.isNullAt(rowIndex, indicesY.at(i)))
                     continue;
                 double singleBarWidth = barWidth_/(1.0*static_cast<double>(indicesY.size()));
                 if (usePlotPickingManager_)
                     ppm_->setGLColor(static_cast<int>(row), indicesY.at(i));
                 renderSingleBar(row-barWidth_/2.0+static_cast<double>(i)*singleBarWidth,
-                    row-barWidth_/2.0+static_cast<double>(i+1)*singleBarWidth, 0, rowIt->getValueAt(indicesY.at(i)), c);
+                    row-barWidth_/2.0+static_cast<double>(i+1)*singleBarWidth, 0, data.getValueAt(rowIndex, indicesY.at(i)), c);
             }
 
             else { // MERGED
                 // we can't skip null entries, so we set them 0
                 if (usePlotPickingManager_)
                     c = ppm_->convertColor(ppm_->getColorFromCell(static_cast<int>(row), indicesY.at(i)));
-                if (rowIt->getCellAt(indicesY.at(i)).isNull())
+                if (data.isNullAt(rowIndex, indicesY.at(i)))
                     mergedBars.push_back(std::pair<plot_t, tgt::Color>(0, c));
                 // push the y value and the color index
-                mergedBars.push_back(std::pair<plot_t, tgt::Color>(rowIt->getValueAt(indicesY.at(i)), c));
+                mergedBars.push_back(std::pair<plot_t, tgt::Color>(data.getValueAt(rowIndex, indicesY.at(i)), c));
             }
         }
         if (barMode_ == MERGED) {
@@ -852,38 +839,44 @@ void PlotLibrary::renderBars(const PlotData& data, std::vector<int> indicesY) co
 }
 
 void PlotLibrary::renderNodeGraph(const PlotData& nodeData, const PlotData& connectionData, int indexX, int indexY, int indexDx, int indexDy) const {
-    std::vector<PlotRowValue>::const_iterator it;
+    std::vector<plot_t> x, y, dx, dy;
+    nodeData.getColumnValues(indexX, x);
+    nodeData.getColumnValues(indexY, y);
+    nodeData.getColumnValues(indexDx, dx);
+    nodeData.getColumnValues(indexDy, dy);
 
     // render nodes
     plot_t glyphSize = (maxGlyphSize_ + minGlyphSize_)/2;
-    int i = 0;
-    for (it = nodeData.getRowsBegin(); it != nodeData.getRowsEnd(); ++it, ++i) {
+    for (size_t i = 0; i < x.size(); ++i) {
         // render node
         glColor4fv(drawingColor_.elem);
-        renderGlyph(it->getValueAt(indexX), it->getValueAt(indexY), 0, glyphSize);
+        renderGlyph(x[i], y[i], 0, glyphSize);
 
         // render force vector
         glColor4fv(fillColor_.elem);
         glBegin(GL_LINE_STRIP);
-            logGlVertex2d(it->getValueAt(indexX), it->getValueAt(indexY));
-            logGlVertex2d(it->getValueAt(indexX) + it->getValueAt(indexDx), it->getValueAt(indexY) + it->getValueAt(indexDy));
+            logGlVertex2d(x[i], y[i]);
+            logGlVertex2d(x[i] + dx[i], y[i] + dy[i]);
         glEnd();
 
         // render node label
         std::stringstream ss;
         ss << i;
-        renderLabel(tgt::dvec3(it->getValueAt(indexX), it->getValueAt(indexY), 0), SmartLabel::CENTERED, ss.str(), false, 0);
+        renderLabel(tgt::dvec3(x[i], y[i], 0), SmartLabel::CENTERED, ss.str(), false, 0);
     }
 
     // render connections
     glLineWidth(lineWidth_);
     glColor4fv(drawingColor_.elem);
-    for (it = connectionData.getRowsBegin(); it != connectionData.getRowsEnd(); ++it) {
-        const PlotRowValue& first = nodeData.getRow(static_cast<int>(it->getValueAt(0)));
-        const PlotRowValue& second = nodeData.getRow(static_cast<int>(it->getValueAt(1)));
+    std::vector<plot_t> first, second;
+    connectionData.getColumnValues(0, first);
+    connectionData.getColumnValues(1, second);
+    for (size_t i = 0; i < first.size(); ++i) {
+        int a = static_cast<int>(first[i]);
+        int b = static_cast<int>(second[i]);
         glBegin(GL_LINE_STRIP);
-            logGlVertex2d(first.getValueAt(indexX), first.getValueAt(indexY));
-            logGlVertex2d(second.getValueAt(indexX), second.getValueAt(indexY));
+            logGlVertex2d(x[a], y[a]);
+            logGlVertex2d(x[b], y[b]);
         glEnd();
     }
 }
@@ -984,26 +977,21 @@ void PlotLibrary::renderScatter(const PlotData& data, int indexX, int indexY, in
         if (sizeInterval.size() == 0)
             indexSize = -1;
     }
-    //row iterator
-    int i = 0;
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin();
-
-    for (; it != data.getRowsEnd(); ++it, ++i) {
+    for (int i = 0; i < data.getRowsCount(); ++i) {
         //we ignore rows with null entries
-        if (it->getCellAt(indexX).isNull() || it->getCellAt(indexY).isNull()) {
+        if (data.isNullAt(i, indexX) || data.isNullAt(i, indexY)) {
             continue;
         }
-        x = it->getValueAt(indexX); y = it->getValueAt(indexY); z = (indexZ == -1 ? 0 : it->getValueAt(indexZ));
+        x = data.getValueAt(i, indexX); y = data.getValueAt(i, indexY); z = (indexZ == -1 ? 0 : data.getValueAt(i, indexZ));
         //check if the point is inside the domains
         if (domain_[X_AXIS].contains(x) && domain_[Y_AXIS].contains(y) && (dimension_ == TWO || domain_[Z_AXIS].contains(z))) {
             // set color
             if (usePlotPickingManager_)
                 ppm_->setGLColor(i,indexZ == -1 ? indexY : indexZ);
-            else if ((indexZ != -1 && it->getCellAt(indexZ).isHighlighted())
-                    || (indexZ == -1 && it->getCellAt(indexY).isHighlighted()))
+            else if (data.isHighlighted(tgt::ivec2(i, indexZ == -1 ? indexY : indexZ)))
                 glColor4fv(highlightColor_.elem);
             else if (indexCM != -1 ) {
-                float c = static_cast<float>((it->getValueAt(indexCM) - colInterval.getLeft()) / colInterval.size());
+                float c = static_cast<float>((data.getValueAt(i, indexCM) - colInterval.getLeft()) / colInterval.size());
                 tgt::Color cc = colorMap_.getColorAtPosition(c);
                 glColor4fv(cc.elem);
             }
@@ -1012,7 +1000,7 @@ void PlotLibrary::renderScatter(const PlotData& data, int indexX, int indexY, in
             // set size
             if (indexSize != -1 ) {
                 size = minGlyphSize_ + (maxGlyphSize_ - minGlyphSize_) *
-                            (it->getValueAt(indexSize) - sizeInterval.getLeft()) / sizeInterval.size();
+                            (data.getValueAt(i, indexSize) - sizeInterval.getLeft()) / sizeInterval.size();
             }
             renderGlyph(x, y, z, size);
         }
@@ -1348,20 +1336,19 @@ void PlotLibrary::renderAxisLabelScales(const PlotData& data, int indexLabel, bo
     std::string label;
     xAxisLabelGroup_.reset();
     xAxisLabelGroup_.setBounds(getBoundsBelowPlot());
-    std::vector<PlotRowValue>::const_iterator it = data.getRowsBegin();
     plot_t x = 0;
     glLineWidth(axesWidth_/2.f);
     glColor4fv(drawingColor_.elem);
-    for (;it!=data.getRowsEnd();++it) {
-        if (!domain_[X_AXIS].contains(x) || it->getCellAt(indexLabel).isNull()){
+    for (int i = 0; i < data.getRowsCount(); ++i) {
+        if (!domain_[X_AXIS].contains(x) || data.isNullAt(i, indexLabel)){
             x += 1;
             continue;
         }
         if (data.getColumnType(indexLabel) == PlotBase::STRING)
-            label = it->getTagAt(indexLabel);
+            label = data.getTagAt(i, indexLabel);
         else {
             std::ostringstream stream;
-            stream << it->getValueAt(indexLabel);
+            stream << data.getValueAt(i, indexLabel);
             label = stream.str();
         }
         xAxisLabelGroup_.addLabel(label,
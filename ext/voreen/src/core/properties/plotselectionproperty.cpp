@@ -447,8 +447,6 @@ void PlotSelectionProperty::applyHighlights() {
 
     // walk through PlotData and check for each row if one of the outer predicates match
     for (int row = 0; row < plotData_->getRowsCount(); ++row) {
-        const PlotRowValue& plotRow = plotData_->getRow(row);
-
         // now walk through our previously generated predicates
         for (outerIt = predicateSelections.begin(); outerIt != predicateSelections.end(); ++outerIt) {
             // aggregated matched state
@@ -457,7 +455,7 @@ void PlotSelectionProperty::applyHighlights() {
             // check each inner predicate
             for (innerIt = outerIt->begin(); matched && innerIt != outerIt->end(); ++innerIt) {
                 if (innerIt->second != 0)
-                    matched &= innerIt->second->check(plotRow.getCellAt(innerIt->first));
+                    matched &= innerIt->second->check(plotData_->getCellAt(row, innerIt->first));
             }
 
             // if all predicates matched => highlight all cells referenced in inner predicates
@@ -522,22 +520,21 @@ void PlotSelectionProperty::updateZoomState() {
                         end = pos.x+1;
                     }
                     for (int i = start; i < end; ++i) {
-                        const PlotRowValue& row = plotData_->getRow(i);
                         // check if table position encodes a data column
                         if (std::find(dataColumns.begin(), dataColumns.end(), pos.y) != dataColumns.end()) {
-                            currentZoomState_.xZoom_.nibble(row.getValueAt(entitiesProp_.getXColumnIndex()));
+                            currentZoomState_.xZoom_.nibble(plotData_->getValueAt(i, entitiesProp_.getXColumnIndex()));
                             if (! threeDimensional_) {
-                                currentZoomState_.yZoom_.nibble(row.getValueAt(pos.y));
+                                currentZoomState_.yZoom_.nibble(plotData_->getValueAt(i, pos.y));
                             }
                             else {
-                                currentZoomState_.yZoom_.nibble(row.getValueAt(entitiesProp_.getYColumnIndex()));
-                                currentZoomState_.zZoom_.nibble(row.getValueAt(pos.y));
+                                currentZoomState_.yZoom_.nibble(plotData_->getValueAt(i, entitiesProp_.getYColumnIndex()));
+                                currentZoomState_.zZoom_.nibble(plotData_->getValueAt(i, pos.y));
                             }
                         }
                         else if (pos.y == entitiesProp_.getXColumnIndex())
-                            currentZoomState_.xZoom_.nibble(row.getValueAt(pos.y));
+                            currentZoomState_.xZoom_.nibble(plotData_->getValueAt(i, pos.y));
                         else if (threeDimensional_ && pos.y == entitiesProp_.getYColumnIndex())
-                            currentZoomState_.yZoom_.nibble(row.getValueAt(pos.y));
+                            currentZoomState_.yZoom_.nibble(plotData_->getValueAt(i, pos.y));
                     }
                 }
             }
@@ -240,7 +240,7 @@ void BarPlot::createPlotLabels() {
                 ++currentEntityIndex;
             if (currentEntityIndex < plotEntitiesProp_.get().size()) { // the cell is rendered
                 if (cell.x >= 0 && cell.x < data_.getRowsCount() && cell.y >= 0 && cell.y < data_.getColumnCount()) {
-                    plot_t value = data_.getRow(cell.x).getValueAt(cell.y);
+                    plot_t value = data_.getValueAt(cell.x, cell.y);
                     tgt::dvec3 viewportCoords;
                     if (barMode_.getValue() == PlotLibrary::GROUPED) {
                         viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(
@@ -252,7 +252,7 @@ void BarPlot::createPlotLabels() {
                     else { //STACKED
                         plot_t yPos = value / 2;
                         for (size_t i = 0; i < currentEntityIndex; ++i) {
-                            yPos += data_.getRow(cell.x).getValueAt(plotEntitiesProp_.get().at(i).getMainColumnIndex());
+                            yPos += data_.getValueAt(cell.x, plotEntitiesProp_.get().at(i).getMainColumnIndex());
                         }
                         viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(cell.x, yPos, 1.0));
                     }
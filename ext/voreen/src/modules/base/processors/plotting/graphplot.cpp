@@ -73,13 +73,21 @@ void GraphPlot::convertPlotDataToNodeGraph(const PlotData* nodes, const PlotData
     const int conn2Col = 1;
 
     // first convert nodes
-    for (std::vector<PlotRowValue>::const_iterator it = nodes->getRowsBegin(); it != nodes->getRowsEnd(); ++it) {
-        nodeGraph_.addNode(static_cast<int>(it->getValueAt(idCol)), it->getValueAt(xCol), it->getValueAt(yCol), it->getValueAt(massCol));
+    std::vector<plot_t> ids, xs, ys, masses;
+    nodes->getColumnValues(idCol, ids);
+    nodes->getColumnValues(xCol, xs);
+    nodes->getColumnValues(yCol, ys);
+    nodes->getColumnValues(massCol, masses);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        nodeGraph_.addNode(static_cast<int>(ids[i]), xs[i], ys[i], masses[i]);
     }
 
     // then convert connections
-    for (std::vector<PlotRowValue>::const_iterator it = connections->getRowsBegin(); it != connections->getRowsEnd(); ++it) {
-        nodeGraph_.connectNodes(static_cast<int>(it->getValueAt(conn1Col)), static_cast<int>(it->getValueAt(conn2Col)));
+    std::vector<plot_t> firsts, seconds;
+    connections->getColumnValues(conn1Col, firsts);
+    connections->getColumnValues(conn2Col, seconds);
+    for (size_t i = 0; i < firsts.size(); ++i) {
+        nodeGraph_.connectNodes(static_cast<int>(firsts[i]), static_cast<int>(seconds[i]));
     }
 }
 
@@ -320,7 +320,7 @@ void LinePlot::createLineLabels() {
     if (xAxisIsString)
         row = static_cast<int>(floor(xr));
     else {
-        while(row > 0 && data_.getRow(row - 1).getValueAt(plotEntitiesProp_.getXColumnIndex()) > xr)
+        while(row > 0 && data_.getValueAt(row - 1, plotEntitiesProp_.getXColumnIndex()) > xr)
             --row;
     }
     if (row < 1)
@@ -328,10 +328,10 @@ void LinePlot::createLineLabels() {
     for (std::vector<PlotEntitySettings>::const_iterator it = plotEntitiesProp_.get().begin();
             it < plotEntitiesProp_.get().end(); ++it) {
         if (it->getCandleStickFlag()) {
-            plot_t stickTop = data_.getRow(row).getValueAt(it->getStickTopColumnIndex());
-            plot_t stickBottom = data_.getRow(row).getValueAt(it->getStickBottomColumnIndex());
-            plot_t candleTop = data_.getRow(row).getValueAt(it->getCandleTopColumnIndex());
-            plot_t candleBottom = data_.getRow(row).getValueAt(it->getCandleBottomColumnIndex());
+            plot_t stickTop = data_.getValueAt(row, it->getStickTopColumnIndex());
+            plot_t stickBottom = data_.getValueAt(row, it->getStickBottomColumnIndex());
+            plot_t candleTop = data_.getValueAt(row, it->getCandleTopColumnIndex());
+            plot_t candleBottom = data_.getValueAt(row, it->getCandleBottomColumnIndex());
             if (selectionProp_.getZoom().yZoom_.contains(stickTop))
                 plotLib_.addLineLabel(data_.getColumnLabel(it->getStickTopColumnIndex()),
                                          tgt::dvec3(10, 0, 0) + plotLib_.convertPlotCoordinatesToViewport3(
@@ -355,11 +355,11 @@ void LinePlot::createLineLabels() {
         }
         else {
             tgt::dvec2 last(xAxisIsString ? static_cast<double>(row) :
-                                            data_.getRow(row).getValueAt(plotEntitiesProp_.getXColumnIndex()),
-                                            data_.getRow(row).getValueAt(it->getMainColumnIndex()));
+                                            data_.getValueAt(row, plotEntitiesProp_.getXColumnIndex()),
+                                            data_.getValueAt(row, it->getMainColumnIndex()));
             tgt::dvec2 lastButOne(xAxisIsString ? static_cast<double>(row) - 1 :
-                                                  data_.getRow(row-1).getValueAt(plotEntitiesProp_.getXColumnIndex()),
-                                 data_.getRow(row-1).getValueAt(it->getMainColumnIndex()));
+                                                  data_.getValueAt(row-1, plotEntitiesProp_.getXColumnIndex()),
+                                 data_.getValueAt(row-1, it->getMainColumnIndex()));
             double dydx = (last.y-lastButOne.y)/(last.x-lastButOne.x);
             last.y = dydx * (xr-last.x) + last.y;
             if (selectionProp_.getZoom().yZoom_.contains(last.y)) {
@@ -398,10 +398,9 @@ void LinePlot::createPlotLabels() {
                             || eit->getCandleBottomColumnIndex() == lit->getTablePosition().y
                             || eit->getCandleTopColumnIndex() == lit->getTablePosition().y
                             || eit->getStickBottomColumnIndex() == lit->getTablePosition().y) {
-                            const PlotRowValue& row = data_.getRow(i);
                             plot_t x = (data_.getColumnType(plotEntitiesProp_.getXColumnIndex()) == PlotBase::STRING ?
-                                            i : row.getValueAt(plotEntitiesProp_.getXColumnIndex()));
-                            plot_t y = row.getValueAt(lit->getTablePosition().y);
+                                            i : data_.getValueAt(i, plotEntitiesProp_.getXColumnIndex()));
+                            plot_t y = data_.getValueAt(i, lit->getTablePosition().y);
                             if (selectionProp_.getZoom().xZoom_.contains(x) && selectionProp_.getZoom().yZoom_.contains(y)) {
                                 tgt::dvec3 viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(x, y, 0));
                                 ss.str("");
@@ -411,10 +410,9 @@ void LinePlot::createPlotLabels() {
                             }
                         }
                         else if (eit->getOptionalColumnIndex() == lit->getTablePosition().y && eit->getErrorbarFlag()) {
-                            const PlotRowValue& row = data_.getRow(i);
-                            plot_t x = row.getValueAt(plotEntitiesProp_.getXColumnIndex());
-                            plot_t y = row.getValueAt(eit->getMainColumnIndex());
-                            plot_t error = row.getValueAt(lit->getTablePosition().y);
+                            plot_t x = data_.getValueAt(i, plotEntitiesProp_.getXColumnIndex());
+                            plot_t y = data_.getValueAt(i, eit->getMainColumnIndex());
+                            plot_t error = data_.getValueAt(i, lit->getTablePosition().y);
                             if (selectionProp_.getZoom().xZoom_.contains(x) && selectionProp_.getZoom().yZoom_.contains(y)) {
                                 tgt::dvec3 viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(x, y, 0));
                                 ss.str("");
@@ -140,19 +140,18 @@ void PlotDataExport::exportFile() {
                     else
                         exportfile << "\n";
                 }
-                std::vector<PlotCellValue> row;
                 for (int i = 0; i < pData_->getRowsCount(); ++i) {
-                    row = pData_->getRow(i).getCells();
-                    for (size_t j = 0; j < row.size(); ++j) {
+                    for (int j = 0; j < pData_->getColumnCount(); ++j) {
+                        PlotCellValue cell = pData_->getCellAt(i, j);
                         if (invertedComma)
                             exportfile << "\"";
-                        if (row[j].isValue())
-                            exportfile << row.at(j).getValue();
+                        if (cell.isValue())
+                            exportfile << cell.getValue();
                         else
-                            exportfile << row.at(j).getTag();
+                            exportfile << cell.getTag();
                         if (invertedComma)
                             exportfile << "\"";
-                        if (j < row.size()-1)
+                        if (j < pData_->getColumnCount()-1)
                             exportfile << separator;
                         else if (i < pData_->getRowsCount()-1)
                             exportfile << "\n";
@@ -172,16 +171,15 @@ void PlotDataExport::exportFile() {
                     exportfile << "</plotcellvalue>";
                 }
                 exportfile << "\n</plotrowvalue>\n";
-                std::vector<PlotCellValue> row;
                 for (int i = 0; i < pData_->getRowsCount(); ++i) {
-                    row = pData_->getRow(i).getCells();
                     exportfile << "<plotrowvalue>";
-                    for (size_t j = 0; j < row.size(); ++j) {
+                    for (int j = 0; j < pData_->getColumnCount(); ++j) {
+                        PlotCellValue cell = pData_->getCellAt(i, j);
                         exportfile << "<plotcellvalue>";
-                        if (row[j].isValue())
-                            exportfile << row.at(j).getValue();
+                        if (cell.isValue())
+                            exportfile << cell.getValue();
                         else
-                            exportfile << row.at(j).getTag();
+                            exportfile << cell.getTag();
                         exportfile << "</plotcellvalue>";
                     }
                     exportfile << "</plotrowvalue>\n";
@@ -235,16 +233,15 @@ void PlotDataExport::exportFile() {
                     exportfile << "</td>";
                 }
                 exportfile << "</tr></thead>\n";
-                std::vector<PlotCellValue> row;
                 for (int i = 0; i < pData_->getRowsCount(); ++i) {
-                    row = pData_->getRow(i).getCells();
                     exportfile << "<tr>";
-                    for (size_t j = 0; j < row.size(); ++j) {
+                    for (int j = 0; j < pData_->getColumnCount(); ++j) {
+                        PlotCellValue cell = pData_->getCellAt(i, j);
                         exportfile << "<td>";
-                        if (row[j].isValue())
-                            exportfile << row.at(j).getValue();
+                        if (cell.isValue())
+                            exportfile << cell.getValue();
                         else
-                            exportfile << row.at(j).getTag();
+                            exportfile << cell.getTag();
                         exportfile << "</td>";
                     }
                     exportfile << "</tr>\n";
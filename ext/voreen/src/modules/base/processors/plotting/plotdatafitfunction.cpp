@@ -347,9 +347,8 @@ void PlotDataFitFunction::linearRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -377,9 +376,8 @@ void PlotDataFitFunction::sqrtRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y && x >= 0))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -407,9 +405,8 @@ void PlotDataFitFunction::squareRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -437,9 +434,8 @@ void PlotDataFitFunction::cubicRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -466,9 +462,8 @@ void PlotDataFitFunction::multiRegression(int dimension,int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -501,9 +496,8 @@ void PlotDataFitFunction::constantSpline(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -530,9 +524,8 @@ void PlotDataFitFunction::simpleSplineRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -559,9 +552,8 @@ void PlotDataFitFunction::bSplineRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -588,9 +580,8 @@ void PlotDataFitFunction::squareSplineRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -617,9 +608,8 @@ void PlotDataFitFunction::cubicSplineRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -646,9 +636,8 @@ void PlotDataFitFunction::logarithmicRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y && x > 0))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -675,9 +664,8 @@ void PlotDataFitFunction::powerRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y && x > 0 && y > 0))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -704,9 +692,8 @@ void PlotDataFitFunction::exponentialRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y && y > 0))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -733,9 +720,8 @@ void PlotDataFitFunction::sinRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -762,9 +748,8 @@ void PlotDataFitFunction::cosRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
@@ -791,9 +776,8 @@ void PlotDataFitFunction::interpolRegression(int column) {
         plot_t x;
         plot_t y;
         for (int i = 0; i < pData_->getRowsCount(); ++i) {
-            PlotRowValue row = pData_->getRow(i);
-            x = row.getCellAt(0).getValue();
-            y = row.getCellAt(column).getValue();
+            x = pData_->getValueAt(i, 0);
+            y = pData_->getValueAt(i, column);
             if (!ignoreFalseValues || (x == x && y == y))
                 points.push_back(std::pair<plot_t,plot_t>(x,y));
         }
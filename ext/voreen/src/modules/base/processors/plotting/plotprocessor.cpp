@@ -673,11 +673,10 @@ void PlotProcessor::createPlotLabels() {
                     end = cell.x+1;
                 }
                 for (int i = start; i < end; ++i) {
-                    const PlotRowValue& row = data_.getRow(i);
-                    plot_t x = row.getValueAt(plotEntitiesProp_.getXColumnIndex());
+                    plot_t x = data_.getValueAt(i, plotEntitiesProp_.getXColumnIndex());
                     if (threeDimensional_) {
-                        plot_t y = row.getValueAt(plotEntitiesProp_.getYColumnIndex());
-                        plot_t z = row.getValueAt(lit->getTablePosition().y);
+                        plot_t y = data_.getValueAt(i, plotEntitiesProp_.getYColumnIndex());
+                        plot_t z = data_.getValueAt(i, lit->getTablePosition().y);
                         if (selectionProp_.getZoom().xZoom_.contains(x) && selectionProp_.getZoom().yZoom_.contains(y)
                             && selectionProp_.getZoom().zZoom_.contains(z)) {
                             tgt::dvec3 viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(x, y, z));
@@ -688,7 +687,7 @@ void PlotProcessor::createPlotLabels() {
                         }
                     }
                     else {
-                        plot_t y = row.getValueAt(lit->getTablePosition().y);
+                        plot_t y = data_.getValueAt(i, lit->getTablePosition().y);
                         if (selectionProp_.getZoom().xZoom_.contains(x) && selectionProp_.getZoom().yZoom_.contains(y)) {
                             tgt::dvec3 viewportCoords = plotLib_.convertPlotCoordinatesToViewport3(tgt::dvec3(x, y, 0));
                             ss.str("");
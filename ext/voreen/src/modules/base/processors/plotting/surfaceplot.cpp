@@ -111,13 +111,17 @@ void SurfacePlot::generateDelaunay() {
         if (plotEntitiesProp_.getXColumnIndex() != currentIndexX_ ||plotEntitiesProp_.getYColumnIndex() != currentIndexY_) {
             currentIndexX_ = plotEntitiesProp_.getXColumnIndex();
             currentIndexY_ = plotEntitiesProp_.getYColumnIndex();
+            std::vector<plot_t> x, y;
+            data_.getColumnValues(currentIndexX_, x);
+            data_.getColumnValues(currentIndexY_, y);
 
 #ifdef VRN_MODULE_TRIANGLE
             delete delaunay_;
 
             std::vector<tpp::Delaunay::Point> points;
-            for (std::vector<PlotRowValue>::const_iterator it = data_.getRowsBegin(); it < data_.getRowsEnd(); ++it) {
-                points.push_back(tpp::Delaunay::Point(it->getValueAt(plotEntitiesProp_.getXColumnIndex()), it->getValueAt(plotEntitiesProp_.getYColumnIndex())));
+            points.reserve(x.size());
+            for (size_t i = 0; i < x.size(); ++i) {
+                points.push_back(tpp::Delaunay::Point(x[i], y[i]));
             }
 
             delaunay_ = new tpp::Delaunay(points);
@@ -137,8 +141,7 @@ void SurfacePlot::generateDelaunay() {
 #else
             // we assume we have an uniform rectliniar grid, calculate the number of rows per column:
             int numRowsPerColumn = 1;
-            plot_t xValue = data_.getRowsBegin()->getValueAt(currentIndexX_);
-            for (std::vector<PlotRowValue>::const_iterator it = ++data_.getRowsBegin(); it < data_.getRowsEnd() && xValue == it->getValueAt(currentIndexX_); ++it) {
+            while (numRowsPerColumn < static_cast<int>(x.size()) && x[numRowsPerColumn] == x[0]) {
                 ++numRowsPerColumn;
             }
 
@@ -170,23 +173,23 @@ void SurfacePlot::generateDelaunay() {
                     int indexLeft = (col-1)*numRowsPerColumn + row;
                     int indexRight = (col+1)*numRowsPerColumn + row;
 
-                    const PlotRowValue& current = data_.getRow(indexCurrent);
-                    const PlotRowValue& below   = (row < numRowsPerColumn-1) ? data_.getRow(indexBelow) : current;
-                    const PlotRowValue& above   = (row > 0) ? data_.getRow(indexAbove) : current;
-                    const PlotRowValue& left    = (col > 0) ? data_.getRow(indexLeft) : current;
-                    const PlotRowValue& right   = (col < numCols-1) ? data_.getRow(indexRight) : current;
+                    int current = indexCurrent;
+                    int below   = (row < numRowsPerColumn-1) ? indexBelow : current;
+                    int above   = (row > 0) ? indexAbove : current;
+                    int left    = (col > 0) ? indexLeft : current;
+                    int right   = (col < numCols-1) ? indexRight : current;
 
-                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(right.getValueAt(currentIndexX_) + 0.5*(current.getValueAt(currentIndexX_) - right.getValueAt(currentIndexX_)),
-                                                                       above.getValueAt(currentIndexY_) + 0.5*(current.getValueAt(currentIndexY_) - above.getValueAt(currentIndexY_))));
+                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(x[right] + 0.5*(x[current] - x[right]),
+                                                                       y[above] + 0.5*(y[current] - y[above])));
 
-                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(left.getValueAt(currentIndexX_) + 0.5*(current.getValueAt(currentIndexX_) - left.getValueAt(currentIndexX_)),
-                                                                       above.getValueAt(currentIndexY_) + 0.5*(current.getValueAt(currentIndexY_) - above.getValueAt(currentIndexY_))));
+                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(x[left] + 0.5*(x[current] - x[left]),
+                                                                       y[above] + 0.5*(y[current] - y[above])));
 
-                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(left.getValueAt(currentIndexX_) + 0.5*(current.getValueAt(currentIndexX_) - left.getValueAt(currentIndexX_)),
-                                                                       below.getValueAt(currentIndexY_) + 0.5*(current.getValueAt(currentIndexY_) - below.getValueAt(currentIndexY_))));
+                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(x[left] + 0.5*(x[current] - x[left]),
+                                                                       y[below] + 0.5*(y[current] - y[below])));
 
-                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(right.getValueAt(currentIndexX_) + 0.5*(current.getValueAt(currentIndexX_) - right.getValueAt(currentIndexX_)),
-                                                                       below.getValueAt(currentIndexY_) + 0.5*(current.getValueAt(currentIndexY_) - below.getValueAt(currentIndexY_))));
+                    voronoiRegions_[indexCurrent].push_back(tgt::dvec2(x[right] + 0.5*(x[current] - x[right]),
+                                                                       y[below] + 0.5*(y[current] - y[below])));
                 }
             }
 #endif
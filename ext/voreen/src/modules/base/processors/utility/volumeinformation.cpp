@@ -140,11 +140,15 @@ void VolumeInformation::computeInformation() {
     maxValue_.setMaxValue(intensityRange.y);
     maxValue_.set(static_cast<float>(histogram.getSignificantRange().y));
 
-    // mean value
+    // mean value, converting the voxels slice by slice
+    const size_t sliceSize = static_cast<size_t>(volume->getDimensions().x) * volume->getDimensions().y;
+    std::vector<float> values(sliceSize);
     double mean = 0.0;
-    for (size_t i = 0; i < numVoxels; ++i) {
-        float value = volume->getVoxelFloat(i);
-        mean += value;
+    for (size_t first = 0; first < numVoxels; first += sliceSize) {
+        size_t count = std::min(sliceSize, numVoxels - first);
+        volume->getVoxelsFloat(first, count, &values[0]);
+        for (size_t i = 0; i < count; ++i)
+            mean += values[i];
     }
     mean /= numVoxels;
     meanValue_.setMinValue(intensityRange.x);
@@ -153,9 +157,13 @@ void VolumeInformation::computeInformation() {
 
     // variance
     double variance = 0.0;
-    for (size_t i = 0; i < numVoxels; ++i) {
-        float value = volume->getVoxelFloat(i);
-        variance += pow(static_cast<double>(value) - mean, 2.0);
+    for (size_t first = 0; first < numVoxels; first += sliceSize) {
+        size_t count = std::min(sliceSize, numVoxels - first);
+        volume->getVoxelsFloat(first, count, &values[0]);
+        for (size_t i = 0; i < count; ++i) {
+            double deviation = static_cast<double>(values[i]) - mean;
+            variance += deviation * deviation;
+        }
     }
     variance /= numVoxels;
     standardDeviation_.setMaxValue(intensityRange.y);
@@ -31,6 +31,14 @@
 #include "voreen/core/datastructures/volume/volumeoperator.h"
 #include "voreen/core/datastructures/geometry/meshlistgeometry.h"
 
+#include <vector>
+#include <algorithm>
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using tgt::ivec3;
 using tgt::vec3;
 
@@ -42,17 +50,22 @@ VolumeCombine::VolumeCombine()
     : VolumeProcessor()
     , inportFirst_(Port::INPORT, "volume.first")
     , inportSecond_(Port::INPORT, "volume.second")
+    , inportThird_(Port::INPORT, "volume.third")
+    , inportFourth_(Port::INPORT, "volume.fourth")
     , outport_(Port::OUTPORT, "outport", true)
     , disableOptimization_("opti", "Optimization", false)
     , enableProcessing_("enabled", "Enable", true)
     , combineFunction_("combineFunction", "Combine Function")
     , factorC_("factorC", "Factor c", 0.5f, -2.f, 2.f)
     , factorD_("factorD", "Factor d", 0.5f, -2.f, 2.f)
+    , expression_("expression", "Expression", "max(A, B)")
     , referenceVolume_("referenceVolume", "Reference Volume")
     , volumeOwner_(false)
 {
     addPort(inportFirst_);
     addPort(inportSecond_);
+    addPort(inportThird_);
+    addPort(inportFourth_);
     addPort(outport_);
 
     combineFunction_.addOption("max",              "Max (max(A,B))",             OP_MAX);
@@ -70,6 +83,7 @@ VolumeCombine::VolumeCombine()
     combineFunction_.addOption("prioritySecond",   "Priority Second (B?B:A)",    OP_PRIORITY_SECOND);
     combineFunction_.addOption("takeFirst",        "Take First (A)",             OP_TAKE_FIRST);
     combineFunction_.addOption("takeSecond",       "Take Second (B)",            OP_TAKE_SECOND);
+    combineFunction_.addOption("expression",       "Expression",                 OP_EXPRESSION);
     combineFunction_.select("max");
 
     referenceVolume_.addOption("first", "First");
@@ -84,6 +98,7 @@ VolumeCombine::VolumeCombine()
     addProperty(combineFunction_);
     addProperty(factorC_);
     addProperty(factorD_);
+    addProperty(expression_);
     addProperty(referenceVolume_);
     addProperty(disableOptimization_);
 
@@ -97,7 +112,15 @@ Processor* VolumeCombine::create() const {
 }
 
 std::string VolumeCombine::getProcessorInfo() const {
-    return "Combines two volumes based on a selectable function.";
+    return "Combines two volumes based on a selectable function. The function 'Expression' evaluates a "
+           "user-defined expression over the volumes A, B and the optional C and D, e.g. 'max(A, B*C) - d', "
+           "with the factors c and d. It supports + - * /, comparisons, && || !, cond ? x : y and the "
+           "functions min, max, abs, sqrt, exp, log, pow, floor, ceil and clamp. "
+           "The combined volume covers the first and the second volume.";
+}
+
+bool VolumeCombine::isReady() const {
+    return isInitialized() && inportFirst_.isReady() && inportSecond_.isReady() && outport_.isReady();
 }
 
 void VolumeCombine::process() {
@@ -114,14 +137,57 @@ void VolumeCombine::process() {
         volumeOwner_ = false;
         return;
     }
-    else if (firstVolume->getNumChannels() > 1 || secondVolume->getNumChannels() > 1) {
-        LWARNING("Combination of multi-channel volumes currently not supported.");
+
+    // compile the selected operation
+    std::vector<std::string> names;
+    names.push_back("A");
+    names.push_back("B");
+    names.push_back("C");
+    names.push_back("D");
+    std::map<std::string, float> factors;
+    factors["c"] = factorC_.get();
+    factors["d"] = factorD_.get();
+    VoxelExpression expression;
+    bool valid = true;
+    try {
+        if (combineFunction_.getValue() == OP_EXPRESSION)
+            expression.compile(expression_.get(), names, factors);
+        else
+            expression.compile(getOperationExpression(combineFunction_.getValue()), names, factors);
+    }
+    catch (const VoreenException& e) {
+        LERROR(e.what());
+        valid = false;
+    }
+
+    // collect the input volumes used by the expression
+    std::vector<const Volume*> inputs(names.size(), static_cast<const Volume*>(0));
+    inputs[0] = firstVolume;
+    inputs[1] = secondVolume;
+    if (inportThird_.isReady())
+        inputs[2] = inportThird_.getData()->getVolume();
+    if (inportFourth_.isReady())
+        inputs[3] = inportFourth_.getData()->getVolume();
+    for (size_t i = 0; i < inputs.size() && valid; ++i) {
+        if (!expression.usesInput(i))
+            continue;
+        if (!inputs[i]) {
+            LERROR("No volume connected for " << names[i]);
+            valid = false;
+        }
+        else if (inputs[i]->getNumChannels() > 1) {
+            LWARNING("Combination of multi-channel volumes currently not supported.");
+            valid = false;
+        }
+    }
+
+    if (!valid) {
         outport_.setData(inportFirst_.getData(), volumeOwner_);
         volumeOwner_ = false;
         return;
     }
 
-    // optimized combination for volumes that share a common grid in world-space
+    // the first and the second volume share a common grid in world-space
     if (firstVolume->getDimensions() == secondVolume->getDimensions() &&
         firstVolume->getCubeSize() == secondVolume->getCubeSize()     &&
         firstVolume->getTransformation() == secondVolume->getTransformation() &&
@@ -142,7 +208,7 @@ void VolumeCombine::process() {
         if (combinedVolume) {
             LINFO("Performing optimized combination on common grid with dimensions "
                 << firstVolume->getDimensions() << "...");
-            combineVolumesOnCommonGrid(combinedVolume, firstVolume, secondVolume, combineFunction_.getValue());
+            combineVolumes(combinedVolume, inputs, expression);
         }
     }
     // standard combination with resampling
@@ -154,7 +220,7 @@ void VolumeCombine::process() {
 
         if (combinedVolume) {
             LINFO("Creating combined volume with dimensions " << combinedVolume->getDimensions() << " ...");
-            combineVolumes(combinedVolume, firstVolume, secondVolume, combineFunction_.getValue());
+            combineVolumes(combinedVolume, inputs, expression);
         }
     }
 
@@ -187,171 +253,168 @@ inline bool withinRange(const tgt::vec3& pos, const tgt::vec3& llf, const tgt::v
            tgt::hand(tgt::lessThanEqual(   pos, urb));
 }
 
-void VolumeCombine::combineVolumes(Volume* combinedVolume, const Volume* firstVolume,
-                                   const Volume* secondVolume, CombineOperation operation) const {
+std::string VolumeCombine::getOperationExpression(CombineOperation operation) const {
+    switch (operation) {
+        case OP_MAX:
+            return "max(A, B)";
+        case OP_MIN:
+            return "min(A, B)";
+        case OP_ADD:
+            return "A + B";
+        case OP_A_MINUS_B:
+            return "A - B";
+        case OP_B_MINUS_A:
+            return "B - A";
+        case OP_AVG:
+            return "(A + B) / 2";
+        case OP_WEIGHTED_SUM:
+            return "c*A + (1-c)*B";
+        case OP_WEIGHTED_SUM_2P:
+            return "c*A + d*B";
+        case OP_BLEND:
+            return "A + B*(1 - A)";
+        case OP_MASK_A_BY_B:
+            return "B > 0 ? A : 0";
+        case OP_MASK_B_BY_A:
+            return "A > 0 ? B : 0";
+        case OP_PRIORITY_FIRST:
+            return "A > 0 ? A : B";
+        case OP_PRIORITY_SECOND:
+            return "B > 0 ? B : A";
+        case OP_TAKE_FIRST:
+            return "A";
+        case OP_TAKE_SECOND:
+            return "B";
+        default:
+            return "";
+    }
+}
 
-    tgtAssert(combinedVolume && firstVolume && secondVolume, "Null pointer passed");
+void VolumeCombine::combineVolumes(Volume* combinedVolume, const std::vector<const Volume*>& inputs,
+                                   const VoxelExpression& expression) const {
 
-    //
-    // compute transformation from voxel coordinates of combined volume
-    // to voxel coords of input volumes
-    //
-    tgt::mat4 combinedToFirst = computeConversionMatrix(firstVolume, combinedVolume);
-    tgt::mat4 combinedToSecond = computeConversionMatrix(secondVolume, combinedVolume);
+    tgtAssert(combinedVolume, "Null pointer passed");
 
-    LDEBUG("Voxel-to-world (First): " << combinedToFirst);
-    LDEBUG("Voxel-to-world (Second) " << combinedToSecond);
+    // decide once per input how its rows are sampled
+    std::vector<InputSampling> sampling(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!expression.usesInput(i))
+            continue;
+        tgtAssert(inputs[i], "Null pointer passed");
+        sampling[i] = createInputSampling(combinedVolume, inputs[i]);
+        LDEBUG("Voxel-to-voxel (" << i << "): " << sampling[i].combinedToInput);
+    }
 
     //
-    // voxel-wise combination
+    // scanline-wise combination: the inputs are sampled and the expression is evaluated
+    // for a row at a time. The slices are distributed dynamically over the threads,
+    // in slabs between which the progress is updated.
     //
-    tgt::vec3 dimFirst(firstVolume->getDimensions()-1);
-    tgt::vec3 dimSecond(secondVolume->getDimensions()-1);
-    const float c = factorC_.get();
-    const float d = factorD_.get();
-    VRN_FOR_EACH_VOXEL_WITH_PROGRESS(pos, tgt::ivec3(0), combinedVolume->getDimensions(), progressBar_) {
-
-        // transform sampling pos to coordinate systems of input volumes
-        tgt::vec3 posFirst = combinedToFirst*tgt::vec3(pos);
-        tgt::vec3 posSecond = combinedToSecond*tgt::vec3(pos);
-
-        // sample input volumes, if transformed voxel position lies inside respective volume
-        float valFirst = 0.f;
-        float valSecond = 0.f;
-        if (withinRange(posFirst, tgt::vec3::zero, dimFirst))
-            valFirst = firstVolume->getVoxelFloatLinear(posFirst);
-        if (withinRange(posSecond, tgt::vec3::zero, dimSecond))
-            valSecond = secondVolume->getVoxelFloatLinear(posSecond);
-
-        // apply operation to sampled values (note: a switch-block within a volume traversal loop
-        // should normally be avoided, however in this case the main operations are way more expensive)
-        float result = 0.f;
-        switch (operation) {
-            case OP_MAX:
-                result = std::max(valFirst, valSecond);
-                break;
-            case OP_MIN:
-                result = std::min(valFirst, valSecond);
-                break;
-            case OP_ADD:
-                result = valFirst + valSecond;
-                break;
-            case OP_A_MINUS_B:
-                result = valFirst - valSecond;
-                break;
-            case OP_B_MINUS_A:
-                result = valSecond - valFirst;
-                break;
-            case OP_AVG:
-                result = (valFirst + valSecond) / 2.f;
-                break;
-            case OP_WEIGHTED_SUM:
-                result = c*valFirst + (1.f-c)*valSecond;
-                break;
-            case OP_WEIGHTED_SUM_2P:
-                result = c*valFirst + d*valSecond;
-                break;
-            case OP_BLEND:
-                result = valFirst + valSecond*(1.f - valFirst);
-                break;
-            case OP_MASK_A_BY_B:
-                result = (valSecond > 0.f) ? valFirst : 0.f;
-                break;
-            case OP_MASK_B_BY_A:
-                result = (valFirst > 0.f) ? valSecond : 0.f;
-                break;
-            case OP_PRIORITY_FIRST:
-                result = (valFirst > 0.f) ? valFirst : valSecond;
-                break;
-            case OP_PRIORITY_SECOND:
-                result = (valSecond > 0.f) ? valSecond : valFirst;
-                break;
-            case OP_TAKE_FIRST:
-                result = valFirst;
-                break;
-            case OP_TAKE_SECOND:
-                result = valSecond;
-                break;
-            default:
-                LERROR("Unknown operation: " << combineFunction_.get());
-                return;
+    const tgt::ivec3 dim = combinedVolume->getDimensions();
+    const size_t numInputs = inputs.size();
+    int slabSize = 1;
+#ifdef _OPENMP
+    slabSize = 4 * omp_get_max_threads();
+#endif
+    for (int slabStart = 0; slabStart < dim.z; slabStart += slabSize) {
+        if (progressBar_)
+            progressBar_->setProgress(static_cast<float>(slabStart) / static_cast<float>(dim.z));
+        const int slabEnd = std::min(slabStart + slabSize, dim.z);
+
+#ifdef _OPENMP
+        #pragma omp parallel
+#endif
+        {
+            std::vector<float> values(numInputs * dim.x);
+            std::vector<float*> rows(numInputs, static_cast<float*>(0));
+            for (size_t i = 0; i < numInputs; ++i) {
+                if (expression.usesInput(i))
+                    rows[i] = &values[i * dim.x];
+            }
+            std::vector<vec3> positions(dim.x);
+            std::vector<float> scratch(expression.getScratchSize(dim.x));
+            std::vector<float> result(dim.x);
+
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+            for (int z = slabStart; z < slabEnd; ++z) {
+                for (int y = 0; y < dim.y; ++y) {
+                    for (size_t i = 0; i < numInputs; ++i) {
+                        if (rows[i])
+                            sampleRow(sampling[i], y, z, dim.x, rows[i], &positions[0]);
+                    }
+
+                    expression.evaluate(&rows[0], dim.x, &result[0], scratch.empty() ? 0 : &scratch[0]);
+
+                    // clamp results to the range of the combined volume
+                    for (int x = 0; x < dim.x; ++x)
+                        result[x] = tgt::clamp(result[x], 0.f, 1.f);
+                    combinedVolume->setVoxelsFloat(&result[0], static_cast<size_t>(dim.x) * (y + static_cast<size_t>(dim.y) * z), dim.x);
+                }
+            }
         }
+    }
+}
 
-        // assign clamped result to combined volume
-        combinedVolume->setVoxelFloat(tgt::clamp(result, 0.f, 1.f), pos);
-
-    } // VRN_FOR_EACH_VOXEL_WITH_PROGRESS
+VolumeCombine::InputSampling VolumeCombine::createInputSampling(const Volume* combinedVolume,
+                                                                const Volume* volume) const {
+    InputSampling sampling;
+    sampling.volume = volume;
+    sampling.combinedToInput = computeConversionMatrix(volume, combinedVolume);
+    sampling.maxPos = vec3(volume->getDimensions() - 1);
+
+    // rows along the x axis stay rows of the input, if the x axis is only scaled and shifted
+    const tgt::mat4& m = sampling.combinedToInput;
+    if (volume->getDimensions() == combinedVolume->getDimensions() &&
+        volume->getCubeSize() == combinedVolume->getCubeSize() &&
+        volume->getTransformation() == combinedVolume->getTransformation() &&
+        disableOptimization_.get() == false)
+        sampling.mode = InputSampling::COMMON_GRID;
+    else if (m.t10 == 0.f && m.t20 == 0.f && m.t30 == 0.f && m.t31 == 0.f && m.t32 == 0.f && m.t33 == 1.f)
+        sampling.mode = InputSampling::AXIS_ALIGNED;
+    else
+        sampling.mode = InputSampling::TRANSFORMED;
+
+    return sampling;
 }
 
-void VolumeCombine::combineVolumesOnCommonGrid(Volume* combinedVolume, const Volume* firstVolume,
-                                               const Volume* secondVolume, CombineOperation operation) const {
-    tgtAssert(combinedVolume && firstVolume && secondVolume, "Null pointer passed");
-    tgtAssert(combinedVolume->getDimensions() == firstVolume->getDimensions() &&
-              combinedVolume->getDimensions() == secondVolume->getDimensions(), "Volume dimensions mismatch");
-
-    const float c = factorC_.get();
-    const float d = factorD_.get();
-    VRN_FOR_EACH_VOXEL_WITH_PROGRESS(pos, tgt::ivec3(0), combinedVolume->getDimensions(), progressBar_) {
-        float valFirst = firstVolume->getVoxelFloat(pos);
-        float valSecond = secondVolume->getVoxelFloat(pos);
-
-        // apply operation to input voxel values
-        float result = 0.f;
-        switch (operation) {
-            case OP_MAX:
-                result = std::max(valFirst, valSecond);
-                break;
-            case OP_MIN:
-                result = std::min(valFirst, valSecond);
-                break;
-            case OP_ADD:
-                result = valFirst + valSecond;
-                break;
-            case OP_A_MINUS_B:
-                result = valFirst - valSecond;
-                break;
-            case OP_B_MINUS_A:
-                result = valSecond - valFirst;
-                break;
-            case OP_AVG:
-                result = (valFirst + valSecond) / 2.f;
-                break;
-            case OP_WEIGHTED_SUM:
-                result = c*valFirst + (1.f-c)*valSecond;
-                break;
-            case OP_WEIGHTED_SUM_2P:
-                result = c*valFirst + d*valSecond;
-                break;
-            case OP_BLEND:
-                result = valFirst + valSecond*(1.f - valFirst);
-                break;
-            case OP_MASK_A_BY_B:
-                result = (valSecond > 0.f) ? valFirst : 0.f;
-                break;
-            case OP_MASK_B_BY_A:
-                result = (valFirst > 0.f) ? valSecond : 0.f;
-                break;
-            case OP_PRIORITY_FIRST:
-                result = (valFirst > 0.f) ? valFirst : valSecond;
-                break;
-            case OP_PRIORITY_SECOND:
-                result = (valSecond > 0.f) ? valSecond : valFirst;
-                break;
-            case OP_TAKE_FIRST:
-                result = valFirst;
-                break;
-            case OP_TAKE_SECOND:
-                result = valSecond;
+void VolumeCombine::sampleRow(const InputSampling& input, int y, int z, int count, float* values,
+                              tgt::vec3* positions) const {
+    const tgt::mat4& m = input.combinedToInput;
+    switch (input.mode) {
+        case InputSampling::COMMON_GRID: {
+            const tgt::ivec3 dim = input.volume->getDimensions();
+            input.volume->getVoxelsFloat(static_cast<size_t>(dim.x) * (y + static_cast<size_t>(dim.y) * z), count, values);
+            break;
+        }
+        case InputSampling::AXIS_ALIGNED: {
+            // step incrementally along the row, which is either completely outside in y/z or not at all
+            vec3 start = m * vec3(0.f, static_cast<float>(y), static_cast<float>(z));
+            if (start.y < 0.f || start.y > input.maxPos.y || start.z < 0.f || start.z > input.maxPos.z) {
+                std::fill(values, values + count, 0.f);
                 break;
-            default:
-                LERROR("Unknown operation: " << combineFunction_.get());
-                return;
+            }
+            vec3 step(m.t00, 0.f, 0.f);
+            input.volume->getVoxelsFloatLinear(start, step, count, values);
+            for (int x = 0; x < count; ++x) {
+                float pos = start.x + static_cast<float>(x) * step.x;
+                if (pos < 0.f || pos > input.maxPos.x)
+                    values[x] = 0.f;
+            }
+            break;
         }
-
-        // assign clamped result to combined volume
-        combinedVolume->setVoxelFloat(tgt::clamp(result, 0.f, 1.f), pos);
-
-    } // VRN_FOR_EACH_VOXEL_WITH_PROGRESS
+        default: {
+            // transform sampling positions to the coordinate system of the input, then zero the outside positions
+            for (int x = 0; x < count; ++x)
+                positions[x] = m * vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+            input.volume->getVoxelsFloatLinear(positions, count, values);
+            for (int x = 0; x < count; ++x) {
+                if (!withinRange(positions[x], tgt::vec3::zero, input.maxPos))
+                    values[x] = 0.f;
+            }
+        }
+    }
 }
 
 Volume* VolumeCombine::createCombinedVolume(const Volume* refVolume, const Volume* secondVolume) const {
@@ -417,8 +480,10 @@ Volume* VolumeCombine::createCombinedVolume(const Volume* refVolume, const Volum
 }
 
 void VolumeCombine::adjustPropertyVisibilities() {
-    factorC_.setVisible(combineFunction_.isSelected("weightedSum") || combineFunction_.isSelected("weightedSum2p"));
-    factorD_.setVisible(combineFunction_.isSelected("weightedSum2p"));
+    factorC_.setVisible(combineFunction_.isSelected("weightedSum") || combineFunction_.isSelected("weightedSum2p") ||
+        combineFunction_.isSelected("expression"));
+    factorD_.setVisible(combineFunction_.isSelected("weightedSum2p") || combineFunction_.isSelected("expression"));
+    expression_.setVisible(combineFunction_.isSelected("expression"));
 }
 
 } // namespace
@@ -133,11 +133,13 @@ void VolumeDecomposer::decomposeVolume() {
     int zEnd = std::min(endSlice_.get(), volume->getDimensions().z-1);
     for (int z=zStart; z<=zEnd; ++z) {
         tgt::Texture* slice = new tgt::Texture(sliceDims, GL_LUMINANCE, GL_FLOAT, tgt::Texture::LINEAR, texRect);
-        for (int x=0; x<slice->getWidth(); ++x) {
-            for (int y=0; y<slice->getHeight(); ++y) {
-                float intensity = volume->getVoxelFloat(x,y,z) * scalingFactor;
-                slice->texel<float>(x,y) = intensity;
-            }
+        // texels and voxels of a slice are both stored row by row
+        float* texels = reinterpret_cast<float*>(slice->getPixelData());
+        size_t numTexels = static_cast<size_t>(sliceDims.x) * sliceDims.y;
+        volume->getVoxelsFloat(numTexels * z, numTexels, texels);
+        if (scalingFactor != 1.f) {
+            for (size_t i = 0; i < numTexels; ++i)
+                texels[i] *= scalingFactor;
         }
         slice->uploadTexture();
         slice->setName(volFilepath);
@@ -67,7 +67,8 @@ Processor* VolumeDistanceTransform::create() const {
 }
 
 std::string VolumeDistanceTransform::getProcessorInfo() const {
-    return "Performs a 3D distance transform of the input volume. ";
+    return "Performs an exact 3D Euclidean distance transform of the input volume. "
+           "Outputs a float volume holding the distance of every voxel to the nearest zero voxel.";
 }
 
 void VolumeDistanceTransform::process() {
@@ -98,84 +99,21 @@ void VolumeDistanceTransform::distanceTransform() {
     }
 
     if (inport_.getData()->getVolume()) {
-        if (!dynamic_cast<VolumeUInt16*>(inport_.getData()->getVolume())) {
-            LWARNING("Currently only 16 bit volumes supported.");
-            return;
+        // distance of every non-zero voxel to the nearest zero voxel
+        Volume* v = 0;
+        try {
+            v = VolumeOperatorDistanceTransform().apply<Volume*>(inport_.getData()->getVolume());
         }
-
-        VolumeUInt16* v = dynamic_cast<VolumeUInt16*>(inport_.getData()->getVolume()->clone());
-        uint16_t val = 65535;
-        uint16_t dist = 0;
-
-        for (int z=1; z<v->getDimensions().z-1 ; z++){
-            for (int x=1; x<v->getDimensions().x-1 ; x++)
-                for (int y=1 ;y<v->getDimensions().y-1 ; y++)
-                    if (v->voxel(x,y,z) > 0) {
-
-                        dist = 0;
-                        val =  255;
-
-                        if (v->voxel(x-1,y,z) + 1 < val + dist)         {   val = v->voxel(x-1,y,z);  dist = 3; }
-                        if (v->voxel(x,y-1,z) + 3 < val + dist)         {   val = v->voxel(x,y-1,z);  dist = 3; }
-                        if (v->voxel(x-1,y-1,z) + 4 < val + dist )      {   val = v->voxel(x-1,y-1,z); dist = 4; }
-                        if (v->voxel(x+1,y-1,z) + 4 < val + dist )      {   val = v->voxel(x+1,y-1,z); dist = 4; }
-                        if (v->voxel(x,y,z-1) + 3 < val + dist)         {   val = v->voxel(x,y,z-1);  dist = 3; }
-
-                        if (v->voxel(x-1,y,z-1) + 4  < val + dist){ val = v->voxel(x-1,y,z-1); dist = 4; }
-                        if (v->voxel(x,y-1,z-1) + 4  < val + dist){ val = v->voxel(x,y-1,z-1); dist = 4; }
-
-                        if (v->voxel(x-1,y,z+1) + 4  < val + dist){ val = v->voxel(x-1,y,z+1); dist = 4; }
-                        if (v->voxel(x,y-1,z+1) + 4  < val + dist){ val = v->voxel(x,y-1,z+1); dist = 4; }
-
-
-                        if (v->voxel(x-1,y-1,z+1) + 5 < val + dist){ val = v->voxel(x-1,y-1,z+1); dist = 5; }
-                        if (v->voxel(x-1,y-1,z-1) + 5 < val + dist){ val = v->voxel(x-1,y-1,z-1); dist = 5; }
-
-                        if (v->voxel(x+1,y-1,z-1) + 5 < val + dist){ val = v->voxel(x+1,y-1,z-1); dist = 5; }
-                        if (v->voxel(x+1,y-1,z+1) + 5 < val + dist){ val = v->voxel(x+1,y-1,z+1); dist = 5; }
-
-                        v->voxel(x,y,z) = val + dist;
-                    }
+        catch (const std::bad_alloc&) {
+            LERROR("Failed to create the distance volume: bad allocation");
         }
-
-        for (int z=v->getDimensions().z-2; z>2; z--){
-            for (int x=v->getDimensions().x-2; x>2; x--)
-                for (int y=v->getDimensions().y-2; y>2; y--)
-                    if (v->voxel(x,y,z) > 0) {
-                        dist = 0;
-                        val = v->voxel(x,y,z);
-
-                        if (v->voxel(x+1,y,z) + 3 < val + dist)          { val = v->voxel(x+1,y,z); dist = 3; }
-                        if (v->voxel(x,y+1,z) + 3 < val + dist)          { val = v->voxel(x,y+1,z); dist = 3; }
-                        if (v->voxel(x+1,y+1,z) + 4 < val + dist)        { val = v->voxel(x+1,y+1,z); dist = 4; }
-                        if (v->voxel(x,y,z+1) + 3  < val + dist)         { val = v->voxel(x,y,z+1); dist = 3; }
-
-                        if (v->voxel(x-1,y+1,z) + 4 < val + dist){ val = v->voxel(x-1,y+1,z); dist = 4; }
-                        if (v->voxel(x-1,y+1,z+1) + 5 < val + dist){ val = v->voxel(x-1,y+1,z+1); dist = 5; }
-                        if (v->voxel(x-1,y+1,z-1) + 5 < val + dist){ val = v->voxel(x-1,y+1,z-1); dist = 5; }
-
-                        if (v->voxel(x+1,y,z+1) + 4 < val + dist){ val = v->voxel(x+1,y,z+1); dist = 4; }
-                        if (v->voxel(x,y+1,z+1) + 4 < val + dist){ val = v->voxel(x,y+1,z+1); dist = 4; }
-                        if (v->voxel(x+1,y+1,z+1) + 5 < val + dist){ val = v->voxel(x+1,y+1,z+1); dist = 5; }
-
-                        if (v->voxel(x+1,y,z-1) + 4 < val + dist){ val = v->voxel(x+1,y,z-1); dist = 4; }
-                        if (v->voxel(x,y+1,z-1) + 4 < val + dist){ val = v->voxel(x,y,z-1); dist = 4; }
-                        if (v->voxel(x+1,y+1,z-1)+ 5 < val + dist){ val = v->voxel(x+1,y+1,z-1); dist = 5; }
-
-                        if ((val + dist) <  v->voxel(x,y,z)) v->voxel(x,y,z) =  val + dist;
-
-                    }
-
+        catch (const VolumeOperatorUnsupportedTypeException&) {
+            LWARNING("Only scalar volumes are supported.");
+        }
+        if (!v) {
+            outport_.setData(0);
+            return;
         }
-
-        //border cleaning, it was not transformed by distance mapping, property of the algorithm
-        for (int x =0; x< v->getDimensions().x;x++)
-            for (int y =0; y< v->getDimensions().y;y++)
-                for (int z =0; z< v->getDimensions().z;z++){
-                    if ( (x < 3) || (x > v->getDimensions().x-3) || (y < 3) || (y > v->getDimensions().y-3)
-                        || (z < 3) || (z > v->getDimensions().z-3)) v->voxel(x,y,z) = 0;
-
-                }
         outport_.setData(new VolumeHandle(v));
         volumeOwner_ = true;
     }
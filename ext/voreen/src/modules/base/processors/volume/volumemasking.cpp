@@ -109,21 +109,35 @@ void VolumeMasking::maskVolume() {
         maskTexture->downloadTexture();
         const int maskTexDim = maskTexture->getDimensions().x;
 
-        // apply masking
-        if (passedVoxelAction_.isSelected("maxIntensity")) {
-            for (size_t i=0; i<v->getNumVoxels(); i++) {
-                float intensity = v->getVoxelFloat(i);
-                int alpha = maskTexture->texel< tgt::Vector4<uint8_t> >(static_cast<size_t>(intensity*(maskTexDim-1))).a;
-                v->setVoxelFloat(alpha == 0 ? 0.f : 1.f, i);
-                //progressBar_->setProgress(static_cast<float>(i) / static_cast<float>(v->getNumVoxels()));
+        // apply masking, converting the voxels slice by slice
+        const bool maxIntensity = passedVoxelAction_.isSelected("maxIntensity");
+        const bool passThrough = passedVoxelAction_.isSelected("passThrough");
+        const size_t numVoxels = v->getNumVoxels();
+        const size_t sliceSize = static_cast<size_t>(v->getDimensions().x) * v->getDimensions().y;
+        std::vector<float> values(sliceSize);
+        const std::vector<float> zeros(sliceSize, 0.f);
+        for (size_t first = 0; (maxIntensity || passThrough) && first < numVoxels; first += sliceSize) {
+            size_t count = std::min(sliceSize, numVoxels - first);
+            v->getVoxelsFloat(first, count, &values[0]);
+            if (maxIntensity) {
+                for (size_t i = 0; i < count; ++i) {
+                    int alpha = maskTexture->texel< tgt::Vector4<uint8_t> >(static_cast<size_t>(values[i]*(maskTexDim-1))).a;
+                    values[i] = (alpha == 0 ? 0.f : 1.f);
+                }
+                v->setVoxelsFloat(&values[0], first, count);
             }
-        }
-        else if (passedVoxelAction_.isSelected("passThrough")) {
-            for (size_t i=0; i<v->getNumVoxels(); i++) {
-                float intensity = v->getVoxelFloat(i);
-                int alpha = maskTexture->texel< tgt::Vector4<uint8_t> >(static_cast<size_t>(intensity*(maskTexDim-1))).a;
-                if (alpha == 0)
-                    v->setVoxelFloat(0.f, i);
+            else {
+                // only the masked voxels are written, in runs
+                size_t i = 0;
+                while (i < count) {
+                    size_t runStart = i;
+                    while (i < count && maskTexture->texel< tgt::Vector4<uint8_t> >(static_cast<size_t>(values[i]*(maskTexDim-1))).a == 0)
+                        ++i;
+                    if (i > runStart)
+                        v->setVoxelsFloat(&zeros[0], first + runStart, i - runStart);
+                    else
+                        ++i;
+                }
             }
         }
 
@@ -26,12 +26,35 @@
  **********************************************************************/
 
 #include "voreen/modules/connectedcomponents/connectedcomponents3d.h"
-#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/datastructures/volume/volumeoperator.h"
 
-#include "connexe/connexe.h"
+#include <algorithm>
 
 namespace voreen {
 
+namespace {
+
+// Components of equal size are ordered by label, i.e., by their first voxel.
+struct LargerComponent {
+    bool operator()(const ConnectedComponent* a, const ConnectedComponent* b) const {
+        return a->numVoxels > b->numVoxels || (a->numVoxels == b->numVoxels && a->label < b->label);
+    }
+};
+
+struct SmallerComponent {
+    bool operator()(const ConnectedComponent* a, const ConnectedComponent* b) const {
+        return a->numVoxels < b->numVoxels || (a->numVoxels == b->numVoxels && a->label < b->label);
+    }
+};
+
+struct EarlierComponent {
+    bool operator()(const ConnectedComponent* a, const ConnectedComponent* b) const {
+        return a->label < b->label;
+    }
+};
+
+} // namespace
+
 const std::string ConnectedComponents3D::loggerCat_("voreen.ConnectedComponents3D");
 
 ConnectedComponents3D::ConnectedComponents3D()
@@ -41,7 +64,7 @@ ConnectedComponents3D::ConnectedComponents3D()
       enableProcessing_("enabled", "Enable", true),
       connectivity_("connectivity", "Connectivity"),
       minComponentSize_("minComponentSize", "Min Component Size", 1, 1, 10000000),
-      maxComponents_("maxComponents", "Max Components", (1<<16)-1, 1, (1<<16)-1),
+      maxComponents_("maxComponents", "Max Components", (1<<16)-1, 1, (1<<30)),
       componentSorting_("sorting", "Component Sorting"),
       binarizeOutput_("binarizeOutput", "Binarize Output", false),
       stretchLabels_("stretchLabels", "Stretch Labels", true),
@@ -77,8 +100,9 @@ Processor* ConnectedComponents3D::create() const {
 }
 
 std::string ConnectedComponents3D::getProcessorInfo() const {
-    return "Detects connected components in a volume data set and intensity-codes the assigned labels "
-        "in a 16 bit output volume of the same dimensions."
+    return "Detects connected components in a volume data set and puts out their labels "
+        "in a 32 bit volume of the same dimensions, or intensity-coded in a 16 bit volume "
+        "if the labels are stretched or binarized."
         "<p><strong>Properties</strong>:"
         "<ul>"
         "  <li>Connectivity: voxel neighborhood to consider.</li>"
@@ -86,7 +110,7 @@ std::string ConnectedComponents3D::getProcessorInfo() const {
         "  <li>Max Components: maximal number of connected components to put out.</li>"
         "  <li>Component Sorting: determines in which order the component labels are assigned.</li>"
         "  <li>Binarize Output: all connected components are assigned the same label (max intensity).</li>"
-        "  <li>Stretch Labels: component labels are stretched over the whole intensity range of the output volume in order to maximize contrast.</li>"
+        "  <li>Stretch Labels: component labels are stretched over the whole intensity range of a 16 bit output volume in order to maximize contrast.</li>"
         "</ul></p>"
         "<p><strong>See</strong>: ConnectedComponents2D</p>";
 }
@@ -102,51 +126,76 @@ void ConnectedComponents3D::process() {
     }
 
     Volume* volume = inport_.getData()->getVolume();
-    tgt::ivec3 volDim = volume->getDimensions();
-
-    VolumeUInt8* volUint8 = dynamic_cast<VolumeUInt8*>(volume);
-    VolumeUInt16* volUint16 = dynamic_cast<VolumeUInt16*>(volume);
-    VolumeFloat* volFloat = dynamic_cast<VolumeFloat*>(volume);
-    if (!volUint8 && !volUint16 && !volFloat) {
-        LERROR("Unsupported volume type: VolumeUInt8, VolumeUInt16 or VolumeFloat expected.");
-        outport_.setData(0, volumeOwner_);
-        volumeOwner_ = false;
-        return;
-    }
 
     // compute connected component labels
-    uint16_t* labels = 0;
+    std::vector<ConnectedComponent> components;
+    VolumeUInt32* labelVolume = 0;
     try {
-        labels = new uint16_t[volume->getNumVoxels()];
+        labelVolume = static_cast<VolumeUInt32*>(VolumeOperatorConnectedComponents(connectivity_.getValue(),
+            ConnectedComponentLabeling::NONZERO, &components, 1.0).apply<Volume*>(volume));
     }
-    catch (std::bad_alloc) {
+    catch (const std::bad_alloc&) {
         LERROR("Failed to create label volume: bad allocation");
+    }
+    catch (const VoreenException& e) {
+        LERROR("Failed to label the volume: " << e.what());
+    }
+    if (!labelVolume) {
         outport_.setData(0, volumeOwner_);
         volumeOwner_ = false;
         return;
     }
-    int numLabels = CountConnectedComponentsWithAllParams(
-        reinterpret_cast<void*>(volume->getData()), (volUint8 ? UCHAR_TYPE : (volUint16 ? USHORT_TYPE : FLOAT_TYPE)),
-        reinterpret_cast<void*>(labels), USHORT_TYPE, volume->getDimensions().elem, 1.0,
-        connectivity_.getValue(),minComponentSize_.get(), maxComponents_.get(), binarizeOutput_.get() ? 1 : 0);
-
-    // sort components
-    if ((numLabels > 0) && !componentSorting_.isSelected("none") && !binarizeOutput_.get()) {
-        int decreasing = componentSorting_.isSelected("decreasing") ? 1 : 0;
-        RelabelConnectedComponentsBySize(labels, USHORT_TYPE, volDim.elem, decreasing);
+
+    // discard small components, keep the maxComponents largest ones and sort them
+    std::vector<const ConnectedComponent*> kept;
+    for (size_t i=0; i<components.size(); i++) {
+        if (components[i].numVoxels >= static_cast<uint64_t>(minComponentSize_.get()))
+            kept.push_back(&components[i]);
+    }
+    const size_t maxComponents = static_cast<size_t>(maxComponents_.get());
+    if (kept.size() > maxComponents) {
+        std::nth_element(kept.begin(), kept.begin() + maxComponents, kept.end(), LargerComponent());
+        kept.resize(maxComponents);
+    }
+    if (componentSorting_.isSelected("decreasing"))
+        std::sort(kept.begin(), kept.end(), LargerComponent());
+    else if (componentSorting_.isSelected("increasing"))
+        std::sort(kept.begin(), kept.end(), SmallerComponent());
+    else
+        std::sort(kept.begin(), kept.end(), EarlierComponent());
+    const uint32_t numLabels = static_cast<uint32_t>(kept.size());
+
+    // map the labels to the output range
+    const bool stretch = stretchLabels_.get() && !binarizeOutput_.get() && numLabels > 0;
+    const float scale = stretch ? static_cast<float>((1<<16) - 2) / numLabels : 1.f;
+    std::vector<uint32_t> labelMap(components.size() + 1, 0);
+    for (uint32_t i=0; i<numLabels; i++) {
+        uint32_t label = binarizeOutput_.get() ? (1<<16) - 1 : i + 1;
+        if (stretch)
+            label = tgt::ifloor(label * scale);
+        labelMap[kept[i]->label] = label;
     }
 
-    // stretch labels to use full range
-    if ((numLabels > 0) && stretchLabels_.get() && !binarizeOutput_.get()) {
-        float scale = static_cast<float>((1<<16) - 2) / numLabels;
-        for (size_t i=0; i<volume->getNumVoxels(); i++)
-            labels[i] = tgt::ifloor(labels[i]*scale);
+    uint32_t* labels = labelVolume->voxel();
+    const size_t numVoxels = labelVolume->getNumVoxels();
+    Volume* outputVolume = labelVolume;
+    if (stretch || binarizeOutput_.get()) {
+        // 16 bit output for display
+        VolumeUInt16* displayVolume = new VolumeUInt16(labelVolume->getDimensions(), labelVolume->getSpacing(),
+                                                       labelVolume->getTransformation());
+        uint16_t* display = displayVolume->voxel();
+        for (size_t i=0; i<numVoxels; i++)
+            display[i] = static_cast<uint16_t>(labelMap[labels[i]]);
+        delete labelVolume;
+        outputVolume = displayVolume;
+    }
+    else {
+        for (size_t i=0; i<numVoxels; i++)
+            labels[i] = labelMap[labels[i]];
     }
 
     // assign label volume to outport
-    VolumeUInt16* labelVolume = new VolumeUInt16(labels, volume->getDimensions(), volume->getSpacing());
-    labelVolume->setTransformation(volume->getTransformation());
-    outport_.setData(new VolumeHandle(labelVolume), volumeOwner_);
+    outport_.setData(new VolumeHandle(outputVolume), volumeOwner_);
     volumeOwner_ = true;
 
     LGL_ERROR;
@@ -1,5 +1,3 @@
-#include <boost/interprocess/sync/scoped_lock.hpp>
-
 #include "voreen/core/datastructures/volume/volume.h"
 #include "voreen/core/datastructures/volume/volumeatomic.h"
 #include "voreen/core/datastructures/volume/volumehandle.h"
@@ -8,6 +6,8 @@
 
 #include "voreen/modules/ipc/ipcvolumesource.h"
 
+#include <boost/bind/bind.hpp>
+
 namespace voreen
 {
 
@@ -20,6 +20,22 @@ const string IPCVolumeSource::_loggerCat("voreen.IPCVolumeSource");
 
 const uint IPCVolumeSource::_default_timer_interval(1000);
 
+//! IPCFrameVolume
+//
+IPCFrameVolume::IPCFrameVolume(ipc_volume_info* info, uint32_t slot, const tgt::ivec3& dimensions)
+    : VolumeUInt16(info->frames[slot].data.get(), dimensions)
+    , _info(info)
+    , _slot(slot)
+{
+}
+
+IPCFrameVolume::~IPCFrameVolume()
+{
+    // The voxels belong to the shared segment
+    data_ = 0;
+    _info->release_lease(_slot);
+}
+
 //! IPCVolumeSource
 //
 IPCVolumeSource::IPCVolumeSource()
@@ -28,24 +44,39 @@ IPCVolumeSource::IPCVolumeSource()
 	  , _x_dimension("x_dimension", "x dimension", 64, 2, 512, Processor::VALID) 
 	  , _y_dimension("y_dimension", "y dimension", 64, 2, 512, Processor::VALID) 
 	  , _z_dimension("z_dimension", "z dimension", 64, 2, 512, Processor::VALID) 
-	  , _timer_interval("timer_interval", "New data check interval", _default_timer_interval, 40, 5000, Processor::VALID) 
       , _toggle_ipc("toggle_ipc", "Enable IPC reading", true)
       , _enable_ipc(true) // same as above
-      , _create_double_buffer("create_double_buffer", "Double-buffered volume", true)
-      , _double_buffer(true) // same as above
-      , _current_shared_memory_name(SHARED_MEMORY_DEFAULT_NAME)
-	  , _shared_memory_name("shared_memory_name", "Shared memory name", SHARED_MEMORY_DEFAULT_NAME, Processor::VALID)
+      , _ring_frames("ring_frames", "Frames in shared ring", IPC_VOLUME_DEFAULT_FRAMES, IPC_VOLUME_MIN_FRAMES, IPC_VOLUME_MAX_FRAMES, Processor::VALID)
+      , _zero_copy("zero_copy", "Zero-copy shared volume", false)
+      , _event_driven("event_driven", "Wake up on published frames", true)
+	  , _timer_interval("timer_interval", "New data check interval", _default_timer_interval, 40, 5000, Processor::VALID) 
       , _timer(0)
       , _eventHandler()
+      , _waiter(0)
+      , _stop_waiter(0)
+      , _wakeup_pending(0)
+	  , _shared_memory_name("shared_memory_name", "Shared memory name", SHARED_MEMORY_DEFAULT_NAME, Processor::VALID)
+      , _current_shared_memory_name(SHARED_MEMORY_DEFAULT_NAME)
+      , _allocator(0)
+      , _shared_segment(0)
+      , _volumeinfo(0)
+      , _volumedata(0)
+      , _last_step(0)
+      , _received_frame(false)
+      , _frame_publish_time(0)
+      , _writer_epoch(0)
+      , _target_consistent(false)
 	  , _target(0)
 {
 	addPort(_outport);
 
 	addProperty(&_toggle_ipc);
-	addProperty(&_create_double_buffer);
+	addProperty(&_ring_frames);
+	addProperty(&_zero_copy);
 	addProperty(&_x_dimension);
 	addProperty(&_y_dimension);
 	addProperty(&_z_dimension);
+	addProperty(&_event_driven);
 	addProperty(&_timer_interval);
 	addProperty(&_shared_memory_name);
 
@@ -53,7 +84,10 @@ IPCVolumeSource::IPCVolumeSource()
 
     _toggle_ipc.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::toggleIPCRead));
 
-    _create_double_buffer.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::toggleDoubleBuffer));
+    _event_driven.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::toggleEventDriven));
+
+    _ring_frames.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::changeRingFrames));
+    _zero_copy.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::changeRingFrames));
     _x_dimension.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::adaptSharedSegment));
     _y_dimension.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::adaptSharedSegment));
     _z_dimension.onChange(CallMemberAction<IPCVolumeSource>(this, &IPCVolumeSource::adaptSharedSegment));
@@ -84,33 +118,7 @@ void IPCVolumeSource::initialize() throw (VoreenException)
     // If there is more than one instance, change wait to generate until a change in properties is made
     // TODO: also a check for same name should be performed,
     // otherwise it can break with multiple instances of this processor
-    uint size_x = _x_dimension.get();
-    uint size_y = _y_dimension.get();
-    uint size_z = _z_dimension.get();
-    shared_memory_object::remove(_current_shared_memory_name.c_str());
-
-    size_t buffer_size = size_x * size_y * size_z * sizeof(uint16_t);
-    // TODO: Why do I need to add extra allocation? [2 places]
-    _double_buffer ? 
-        _shared_segment = new managed_shared_memory(create_only
-                                                    ,_current_shared_memory_name.c_str()
-                                                    ,(buffer_size * 2) + sizeof(ipc_volume_info) + 65536):
-        _shared_segment = new managed_shared_memory(create_only
-                                                    ,_current_shared_memory_name.c_str()
-                                                    ,buffer_size + sizeof(ipc_volume_info) + 65536);
-
-
-    _allocator = new node_allocator_t(_shared_segment->get_segment_manager());
-
-    _volumeinfo = _shared_segment->construct<ipc_volume_info>(unique_instance)();
-    _volumeinfo->size_x = size_x;
-    _volumeinfo->size_y = size_y;
-    _volumeinfo->size_z = size_z;
-    _volumeinfo->double_buffer = _double_buffer;
-
-    _double_buffer ? 
-        _volumedata = _shared_segment->construct<uint16_t>(unique_instance)[size_x*size_y*size_z * 2]():
-        _volumedata = _shared_segment->construct<uint16_t>(unique_instance)[size_x*size_y*size_z]();
+    createSharedSegment();
 
     if (_timer)
     {
@@ -121,10 +129,13 @@ void IPCVolumeSource::initialize() throw (VoreenException)
         LWARNING("No timer.");
         return;
     }
+
+    startWaiter();
 }
 
 void IPCVolumeSource::deinitialize() throw (VoreenException)
 {
+    stopWaiter();
     VolumeProcessor::deinitialize();
     _timer->stop();
     _outport.deleteVolume();
@@ -146,101 +157,309 @@ void IPCVolumeSource::toggleIPCRead()
     _enable_ipc = _toggle_ipc.get();
 }
 
-void IPCVolumeSource::toggleDoubleBuffer()
+void IPCVolumeSource::changeRingFrames()
 {
-    _double_buffer = _create_double_buffer.get();
     adaptSharedSegment();
 }
 
+void IPCVolumeSource::toggleEventDriven()
+{
+    if(!isInitialized()) return;
+    stopWaiter();
+    startWaiter();
+}
+
+void IPCVolumeSource::startWaiter()
+{
+    if(_waiter || !_event_driven.get() || !_timer || !_volumeinfo) return;
+    _stop_waiter = 0;
+    _waiter = new boost::thread(boost::bind(&IPCVolumeSource::waitForFrames, this));
+}
+
+void IPCVolumeSource::stopWaiter()
+{
+    if(!_waiter) return;
+    ipc_volume_info::write(&_stop_waiter, 1);
+    _volumeinfo->interrupt_wait();
+    _waiter->join();
+    delete _waiter;
+    _waiter = 0;
+}
+
+void IPCVolumeSource::waitForFrames()
+{
+    while(!ipc_volume_info::read(&_stop_waiter))
+    {
+        // Timeout only to notice a lost shutdown request
+        if(!_volumeinfo->wait_publish(500)) continue;
+        if(ipc_volume_info::read(&_stop_waiter)) break;
+
+        if(boost::interprocess::ipcdetail::atomic_cas32(&_wakeup_pending, 1, 0) == 0)
+            _timer->wakeup();
+    }
+}
+
+void IPCVolumeSource::createSharedSegment()
+{
+    uint size_x = _x_dimension.get();
+    uint size_y = _y_dimension.get();
+    uint size_z = _z_dimension.get();
+    uint num_frames = _ring_frames.get();
+    // Leased frames stay pinned until the next one replaces them on the
+    // outport, so two leases may be held at once
+    if(_zero_copy.get() && num_frames < IPC_VOLUME_MIN_FRAMES + 1)
+    {
+        num_frames = IPC_VOLUME_MIN_FRAMES + 1;
+        LINFO("Zero-copy export needs " << num_frames << " frames in the ring");
+    }
+
+    _current_shared_memory_name = _shared_memory_name.get();
+    shared_memory_object::remove(_current_shared_memory_name.c_str());
+
+    // TODO: Why do I need to add extra allocation?
+    size_t buffer_size = size_x * size_y * size_z * sizeof(uint16_t);
+    _shared_segment = new managed_shared_memory(create_only
+                                                ,_current_shared_memory_name.c_str()
+                                                ,(buffer_size * num_frames) + sizeof(ipc_volume_info)
+                                                 + (buffer_size / sizeof(uint16_t) / 1024 + 1) * sizeof(ipc_volume_info::atomic_t)
+                                                 + 65536);
+
+    _allocator = new node_allocator_t(_shared_segment->get_segment_manager());
+
+    _volumeinfo = _shared_segment->construct<ipc_volume_info>(unique_instance)();
+    _volumeinfo->size_x = size_x;
+    _volumeinfo->size_y = size_y;
+    _volumeinfo->size_z = size_z;
+
+    _volumedata = _shared_segment->construct<uint16_t>(unique_instance)[size_x*size_y*size_z * num_frames]();
+    _volumeinfo->set_frames(_volumedata, num_frames);
+
+    uint bricks = ((size_x + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE)
+                * ((size_y + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE)
+                * ((size_z + IPC_VOLUME_BRICK_SIZE - 1) / IPC_VOLUME_BRICK_SIZE);
+    _volumeinfo->set_bricks(_shared_segment->construct<ipc_volume_info::atomic_t>("brick_steps")[bricks]());
+
+    _received_frame = false;
+    _target_consistent = false;
+    _target = 0;
+}
+
 void IPCVolumeSource::adaptSharedSegment()
 {
     if(isInitialized())
     {
+        // Leased frames must be given back before the segment goes away
+        _outport.setData(0, true);
+
+        stopWaiter();
+
         // Remove previous shared memory
         if(_allocator) { delete _allocator; _allocator = 0; }
         if(_shared_segment) { delete _shared_segment; _shared_segment = 0; }
         shared_memory_object::remove(_current_shared_memory_name.c_str());
 
         // Create new shared memory
-        uint size_x = _x_dimension.get();
-        uint size_y = _y_dimension.get();
-        uint size_z = _z_dimension.get();
+        createSharedSegment();
 
-        _current_shared_memory_name = _shared_memory_name.get();
-        shared_memory_object::remove(_current_shared_memory_name.c_str());
-        // TODO: Why do I need to add extra allocation? [2 places]
-        size_t buffer_size = size_x * size_y * size_z * sizeof(uint16_t);
+        startWaiter();
 
-        _double_buffer ? 
-            _shared_segment = new managed_shared_memory(create_only
-                    ,_current_shared_memory_name.c_str()
-                    ,(buffer_size * 2) + sizeof(ipc_volume_info) + 65536):
-            _shared_segment = new managed_shared_memory(create_only
-                    ,_current_shared_memory_name.c_str()
-                    ,buffer_size + sizeof(ipc_volume_info) + 65536);
+        LINFO("Shared memory for IPC reallocated");
+    }
+}
+
+uint32_t IPCVolumeSource::getFramesPublished() const
+{
+    return _volumeinfo ? ipc_volume_info::read(&_volumeinfo->frames_published) : 0;
+}
+
+uint32_t IPCVolumeSource::getFramesDropped() const
+{
+    return _volumeinfo ? ipc_volume_info::read(&_volumeinfo->frames_dropped) : 0;
+}
 
-        _allocator = new node_allocator_t(_shared_segment->get_segment_manager());
+std::vector<uint32_t> IPCVolumeSource::getLatencyHistogram() const
+{
+    std::vector<uint32_t> histogram(IPC_VOLUME_LATENCY_BUCKETS, 0);
+    if(_volumeinfo)
+    {
+        for(int i=0; i<IPC_VOLUME_LATENCY_BUCKETS; i++)
+            histogram[i] = ipc_volume_info::read(&_volumeinfo->latency_histogram[i]);
+    }
+    return histogram;
+}
 
-        _volumeinfo = _shared_segment->construct<ipc_volume_info>(unique_instance)();
-        _volumeinfo->size_x = size_x;
-        _volumeinfo->size_y = size_y;
-        _volumeinfo->size_z = size_z;
-        _volumeinfo->double_buffer = _double_buffer;
+bool IPCVolumeSource::copyLatestFrame(uint32_t& step)
+{
+    uint32_t epoch = ipc_volume_info::read(&_volumeinfo->writer_epoch);
+    uint32_t slot, sequence;
+    if(!_volumeinfo->acquire_latest(slot, sequence, step)) return false;
+    if(_received_frame && step == _last_step && epoch == _writer_epoch) return false;
+    uint64_t publish_time = _volumeinfo->frames[slot].publish_time;
+
+    ivec3 dims(_x_dimension.get(), _y_dimension.get(), _z_dimension.get());
+    VolumeHandle* handle = _outport.getData();
+    bool reuse = _target && handle && handle->getVolume() == _target;
+
+    // Collect the regions changed since the frame the output volume holds
+    std::vector<std::pair<ivec3, ivec3> > regions;
+    std::vector<uint8_t> dirty;
+    if(reuse && _target_consistent && _received_frame && step > _last_step
+       && _volumeinfo->dirty_bricks(_last_step, _writer_epoch, dirty))
+    {
+        collectDirtyRegions(dirty, regions);
+    }
+    else
+    {
+        regions.push_back(std::make_pair(ivec3(0), dims));
+    }
 
-        _double_buffer ? 
-            _volumedata = _shared_segment->construct<uint16_t>(unique_instance)[size_x*size_y*size_z * 2]():
-            _volumedata = _shared_segment->construct<uint16_t>(unique_instance)[size_x*size_y*size_z]();
+    size_t changed = 0;
+    for(size_t r=0; r<regions.size(); r++) changed += tgt::hmul(regions[r].second - regions[r].first);
+    // One upload of everything beats many small ones
+    if(changed * 2 > _volumeinfo->num_voxels())
+    {
+        regions.clear();
+        regions.push_back(std::make_pair(ivec3(0), dims));
+    }
 
-        LINFO("Shared memory for IPC reallocated");
+    VolumeUInt16* target = reuse ? _target : new VolumeUInt16(dims);
+    const uint16_t *p = _volumeinfo->frames[slot].data.get();
+    uint16_t *q = target->voxel();
+    for(size_t r=0; r<regions.size(); r++)
+    {
+        const ivec3& first = regions[r].first;
+        const ivec3& last = regions[r].second;
+        for(int k=first.z; k<last.z; k++)
+            for(int j=first.y; j<last.y; j++)
+            {
+                size_t i = first.x + dims.x * (j + size_t(dims.y) * k);
+                std::copy(p + i, p + i + (last.x - first.x), q + i);
+            }
     }
+
+    // The simulator went around the ring while copying, try again next tick.
+    // After a torn delta copy the next one covers the same bricks again, but a
+    // torn full copy leaves nothing to build on.
+    if(!_volumeinfo->validate(slot, sequence))
+    {
+        if(!reuse) delete target;
+        else if(regions.size() == 1 && regions[0].first == ivec3(0) && regions[0].second == dims)
+            _target_consistent = false;
+        return false;
+    }
+
+    _writer_epoch = epoch;
+    _target_consistent = true;
+    _frame_publish_time = publish_time;
+    target->invalidate();
+
+    if(!reuse)
+    {
+        _target = target;
+        _outport.setData(new VolumeHandle(_target, static_cast<float>(step)), true);
+        return true;
+    }
+
+    // Patch the existing texture instead of rebuilding it
+    if(handle->hasHardwareVolumes(VolumeHandle::HARDWARE_VOLUME_GL))
+    {
+        for(size_t r=0; r<regions.size(); r++)
+            handle->getVolumeGL()->updateSubVolume(regions[r].first, regions[r].second);
+    }
+    handle->setTimestep(static_cast<float>(step));
+    _outport.invalidate();
+    return true;
+}
+
+void IPCVolumeSource::collectDirtyRegions(const std::vector<uint8_t>& dirty,
+                                          std::vector<std::pair<ivec3, ivec3> >& regions) const
+{
+    ivec3 grid(_volumeinfo->bricks_x, _volumeinfo->bricks_y, _volumeinfo->bricks_z);
+    ivec3 dims(_volumeinfo->size_x, _volumeinfo->size_y, _volumeinfo->size_z);
+
+    // Runs of dirty bricks along x, merged with the same run of the row below
+    std::vector<std::pair<ivec3, ivec3> > boxes;
+    for(int z=0; z<grid.z; z++)
+        for(int y=0; y<grid.y; y++)
+            for(int x=0; x<grid.x; x++)
+            {
+                if(!dirty[(size_t(z)*grid.y + y)*grid.x + x]) continue;
+                int x0 = x;
+                while(x < grid.x && dirty[(size_t(z)*grid.y + y)*grid.x + x]) x++;
+
+                size_t b = 0;
+                for(; b<boxes.size(); b++)
+                    if(boxes[b].first.z == z && boxes[b].second.y == y
+                       && boxes[b].first.x == x0 && boxes[b].second.x == x) break;
+                if(b < boxes.size()) boxes[b].second.y++;
+                else boxes.push_back(std::make_pair(ivec3(x0, y, z), ivec3(x, y+1, z+1)));
+            }
+
+    // Stack equal boxes of consecutive slices
+    for(size_t b=0; b<boxes.size(); b++)
+    {
+        size_t c = 0;
+        for(; c<regions.size(); c++)
+            if(regions[c].second.z == boxes[b].first.z
+               && regions[c].first.x == boxes[b].first.x && regions[c].second.x == boxes[b].second.x
+               && regions[c].first.y == boxes[b].first.y && regions[c].second.y == boxes[b].second.y) break;
+        if(c < regions.size()) regions[c].second.z = boxes[b].second.z;
+        else regions.push_back(boxes[b]);
+    }
+
+    for(size_t r=0; r<regions.size(); r++)
+    {
+        regions[r].first *= IPC_VOLUME_BRICK_SIZE;
+        regions[r].second = tgt::min(regions[r].second * IPC_VOLUME_BRICK_SIZE, dims);
+    }
+}
+
+VolumeUInt16* IPCVolumeSource::leaseLatestFrame(uint32_t& step)
+{
+    uint32_t slot;
+    if(!_volumeinfo->acquire_lease(slot, step)) return 0;
+    if(_received_frame && step == _last_step)
+    {
+        _volumeinfo->release_lease(slot);
+        return 0;
+    }
+    _frame_publish_time = _volumeinfo->frames[slot].publish_time;
+
+    uint size_x = _x_dimension.get();
+    uint size_y = _y_dimension.get();
+    uint size_z = _z_dimension.get();
+    return new IPCFrameVolume(_volumeinfo, slot, ivec3(size_x,size_y,size_z));
 }
 
 void IPCVolumeSource::timerEvent(tgt::TimeEvent* te)
 {
 	try
     {
-		scoped_lock<interprocess_mutex> lock(_volumeinfo->mutex);
-        // Test for new data from server process
-        if(!_enable_ipc || !_volumeinfo->fresh_data) return;
+        // Ticks and wakeups alike pick up everything published so far
+        ipc_volume_info::write(&_wakeup_pending, 0);
 
-        uint size_x = _x_dimension.get();
-        uint size_y = _y_dimension.get();
-        uint size_z = _z_dimension.get();
-		_target = new VolumeUInt16(ivec3(size_x,size_y,size_z));
+        if(!_enable_ipc) return;
 
-        if(_double_buffer)
+        // Test for new data from server process
+        uint32_t step;
+        if(_zero_copy.get())
         {
-            uint16_t *p = _volumeinfo->offset_ptr.get();
-            for(int k=0; k<size_z; k++)
-                for(int j=0; j<size_y; j++)
-                    for(int i=0; i<size_x; i++)
-                    {
-                        _target->voxel(i,j,k) = *p++;
-                    }
+            VolumeUInt16* frame = leaseLatestFrame(step);
+            if(!frame) return;
+            _target = frame;
+            _outport.setData(new VolumeHandle(_target, static_cast<float>(step)), true);
         }
-        else
+        else if(!copyLatestFrame(step))
         {
-            uint16_t *p = _volumedata;
-            for(int k=0; k<size_z; k++)
-                for(int j=0; j<size_y; j++)
-                    for(int i=0; i<size_x; i++)
-                    {
-                        _target->voxel(i,j,k) = *p++;
-                    }
+            return;
         }
 
-        _volumeinfo->fresh_data = false;
-        _volumeinfo->cond_processing_visuals.notify_one();
+        _volumeinfo->consume(step, _last_step, !_received_frame);
+        _last_step = step;
+        _received_frame = true;
 
-		if (_target)
-        {
-			_outport.setData(new VolumeHandle(_target), true);
-		}
-        else
-        {
-			_outport.setData(0, true);
-		}
 		invalidate();
+        _volumeinfo->record_latency(_frame_publish_time);
 	}
     catch(interprocess_exception &e)
     {
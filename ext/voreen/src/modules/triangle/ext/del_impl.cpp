@@ -39,8 +39,8 @@ void Delaunay::generateVoronoiRegions(const voreen::PlotData& data, std::vector<
     outVoronoiRegions.resize(pvorout->edgesOfVoronoiFaces.size());
     
     for (size_t i=0; i<pvorout->edgesOfVoronoiFaces.size(); ++i) {
-        double px = data.getRow(i).getValueAt(0);
-        double py = data.getRow(i).getValueAt(1);
+        double px = data.getValueAt(static_cast<int>(i), 0);
+        double py = data.getValueAt(static_cast<int>(i), 1);
         
         // first use a map to efficiently sort vertices of voronoi regions by polar angle
         std::map<double, Point> vertexMap;
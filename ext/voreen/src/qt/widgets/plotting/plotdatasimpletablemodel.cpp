@@ -100,20 +100,14 @@ QVariant PlotDataSimpleTableModel::data(const QModelIndex &index, int role) cons
 QVariant PlotDataSimpleTableModel::getCellAt(int row, int column) const {
     if (!pData_ || pData_->getRowsCount() == 0)
         return QVariant();
-    std::vector<PlotRowValue>::const_iterator it = pData_->getRowsBegin();
-    it += row;
-
-    PlotCellValue cell = it->getCellAt(column);
+    PlotCellValue cell = pData_->getCellAt(row, column);
     return (cell.isValue() ? QVariant(cell.getValue()) : QVariant(QString::fromStdString(cell.getTag())));
 }
 
 PlotCellValue PlotDataSimpleTableModel::getPlotCellAt(int row, int column) const {
     if (!pData_ || pData_->getRowsCount() == 0)
         return PlotCellValue();
-    std::vector<PlotRowValue>::const_iterator it = pData_->getRowsBegin();
-    it += row;
-
-    return it->getCellAt(column);
+    return pData_->getCellAt(row, column);
 }
 
 
@@ -1,8 +1,7 @@
 #include "basic.hpp"
 
-#include "ipc_volume.hpp"
-
 #include <iostream>
+#include <stdexcept>
 
 namespace voxel_state
 {
@@ -42,153 +41,102 @@ namespace voxel_state
     };
 }
 
-using namespace voreen;
 using namespace std;
 using namespace tgt;
 
-inline void move_voxel(VolumeUInt16* w, ivec3 origin, ivec3 destination)
-{
-    w->voxel(destination) = w->voxel(origin);
-    w->voxel(origin) = voxel_state::empty;
-}
-
-//!
-//! Keep all the persistent data of the algorithm here
-struct basic_algorithm_data
+///// ALGORITMOS DE COMPORTAMIENTO
+// Especializaci�n de c�lulas madre
+enum main_phases
 {
-    unsigned int current_main_phase;
-    bool entry_found;
-    ivec3 conquistador;
-
-    basic_algorithm_data() :
-        current_main_phase(0),
-        entry_found(false),
-        conquistador(ivec3(0,0,0))
-    {}
+    find_entry,
+    create_external_infrastructure,
+    penetrate_soil,
+    irrigate_soil,
+    grow_internal,
+    grow_external,
 };
 
-
-void basic_algorithm(uint size_x, uint size_y, uint size_z, VolumeUInt16* v1, VolumeUInt16* v2)
+inline void move_voxel(const ca_step_context& c, ivec3 origin, ivec3 destination)
 {
+    c.dst[c.index(destination.x, destination.y, destination.z)] = c.dst[c.index(origin.x, origin.y, origin.z)];
+    c.dst[c.index(origin.x, origin.y, origin.z)] = voxel_state::empty;
+}
 
-///// ALGORITMOS DE COMPORTAMIENTO
-// Especializacin de clulas madre
-    enum main_phases
-    {
-        find_entry,
-        create_external_infrastructure,
-        penetrate_soil,
-        irrigate_soil,
-        grow_internal,
-        grow_external,
-    };
-
-    static basic_algorithm_data o;
-
-    static VolumeUInt16* w = v2;
-    // Double buffer
-    if(v2)
-    {
-        if(w == v1)
-            w = v2;
-        else if(w == v2)
-            w = v1;
-        else
-            cout << "Warning: problem swapping buffers inside algorithm" << endl;
+void basic_algorithm::begin_step(const ca_step_context& c)
+{
+    ca_stencil_rule<basic_algorithm, ca_moore<0> >::begin_step(c);
+    saturate = 0;
 
-    }
-    // Single buffer
-    else
-    {
-        w = v1;
-    }
+    // Report phase changes only, a line per step costs more than the step
+    // on small lattices
+    bool report = o.current_main_phase != reported_phase;
+    reported_phase = o.current_main_phase;
 
     switch(o.current_main_phase)
     {
         ////////////////////////////////////////////////////////////////////////
         // Phase 1: Find entry
         case find_entry:
-        cout << "Step: find entry" << endl;
-        move_voxel(w, o.conquistador, ivec3(rand()%2, rand()%2, rand()%2));
-        if(w == v2)
-        {
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = 0xffff;
-                }
-        }
-        else
         {
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
-        }
-        if(o.entry_found) o.current_main_phase++;
+        if(report) cout << "Phase: find entry" << endl;
+        ca_rng rng(c.seed, c.step, ~0ULL);
+        move_voxel(c, o.conquistador, ivec3(rng(2), rng(2), rng(2)));
+        // Alternate between a saturated and a random lattice
+        if(c.step % 2) saturate = 0xffff;
         break;
+        }
 
         ////////////////////////////////////////////////////////////////////////
         // Phase 2: Create external infrastructure
         case create_external_infrastructure:
-        cout << "Step: create external infrastructure" << endl;
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
+        if(report) cout << "Phase: create external infrastructure" << endl;
         break;
 
         ////////////////////////////////////////////////////////////////////////
         // Phase 3: Penetrate soil
         case penetrate_soil:
-        cout << "Step: penetrate soil" << endl;
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
+        if(report) cout << "Phase: penetrate soil" << endl;
         break;
 
         ////////////////////////////////////////////////////////////////////////
         // Phase 4: Irrigate soil
         case irrigate_soil:
-        cout << "Step: irrigate soil" << endl;
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
+        if(report) cout << "Phase: irrigate soil" << endl;
         break;
 
         ////////////////////////////////////////////////////////////////////////
         // Phase 5: Grow internal
         case grow_internal:
-        cout << "Step: grow internal" << endl;
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
+        if(report) cout << "Phase: grow internal" << endl;
         break;
 
         ////////////////////////////////////////////////////////////////////////
         // Phase 6: Grow external
         case grow_external:
-        cout << "Step: grow external" << endl;
-        for(int k=0; k<size_z; k++)
-            for(int j=0; j<size_y; j++)
-                for(int i=0; i<size_x; i++)
-                {
-                    w->voxel(i,j,k) = rand()%0xffff;
-                }
+        if(report) cout << "Phase: grow external" << endl;
         break;
     }
 }
+
+void basic_algorithm::end_step(const ca_step_context&)
+{
+    if(o.current_main_phase == find_entry && o.entry_found) o.current_main_phase++;
+}
+
+void basic_algorithm::save_state(ostream& out) const
+{
+    uint8_t entry_found = o.entry_found;
+    out.write(reinterpret_cast<const char*>(&o.current_main_phase), sizeof(o.current_main_phase));
+    out.write(reinterpret_cast<const char*>(&entry_found), sizeof(entry_found));
+    out.write(reinterpret_cast<const char*>(o.conquistador.elem), sizeof(o.conquistador.elem));
+}
+
+void basic_algorithm::load_state(istream& in)
+{
+    uint8_t entry_found;
+    in.read(reinterpret_cast<char*>(&o.current_main_phase), sizeof(o.current_main_phase));
+    in.read(reinterpret_cast<char*>(&entry_found), sizeof(entry_found));
+    in.read(reinterpret_cast<char*>(o.conquistador.elem), sizeof(o.conquistador.elem));
+    if(!in) throw runtime_error("Truncated basic_algorithm state");
+    o.entry_found = entry_found;
+}
@@ -1,8 +1,54 @@
 #ifndef BASIC_HPP
 #define BASIC_HPP
 
-#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "ca_engine/ca_stencil.hpp"
 
-void basic_algorithm(uint, uint, uint, voreen::VolumeUInt16*, voreen::VolumeUInt16*);
+//!
+//! Keep all the persistent data of the algorithm here
+struct basic_algorithm_data
+{
+    unsigned int current_main_phase;
+    bool entry_found;
+    tgt::ivec3 conquistador;
+
+    basic_algorithm_data() :
+        current_main_phase(0),
+        entry_found(false),
+        conquistador(tgt::ivec3(0,0,0))
+    {}
+};
+
+//!
+//! Basic architectural growth algorithm
+class basic_algorithm : public ca_stencil_rule<basic_algorithm, ca_moore<0> >
+{
+public:
+    basic_algorithm() : saturate(0), reported_phase(~0u) {}
+
+    virtual void begin_step(const ca_step_context& ctx);
+
+    virtual void end_step(const ca_step_context& ctx);
+
+    virtual void save_state(std::ostream& out) const;
+
+    virtual void load_state(std::istream& in);
+
+    //! Per-cell kernel
+    inline uint16_t update(const neighbors& n, ca_rng& rng);
+
+    const basic_algorithm_data& data() const { return o; }
+
+private:
+    basic_algorithm_data o;
+    //! Fill value of the current step, or 0 for random states
+    uint16_t saturate;
+    //! Last phase announced on stdout
+    unsigned int reported_phase;
+};
+
+inline uint16_t basic_algorithm::update(const neighbors&, ca_rng& rng)
+{
+    return saturate ? saturate : rng(0xffff);
+}
 
 #endif
@@ -0,0 +1,343 @@
+#include "ca_engine/ca_engine.hpp"
+#include "ca_engine/ca_stencil.hpp"
+#include "ca_algorithms/basic.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+//! Headless throughput benchmark for ca_engine: runs a rule on synthetic
+//! lattices of several sizes and sparsity levels for a range of thread
+//! counts, without shared memory or a viewer.
+
+using namespace std;
+using namespace tgt;
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmark rules
+
+//! Identity with a single-cell neighbourhood: bounded by memory bandwidth
+class copy_rule : public ca_stencil_rule<copy_rule, ca_moore<0> >
+{
+public:
+    uint16_t update(const neighbors& n, ca_rng&) { return n.center(); }
+};
+
+//! Live cells (non-zero) toggle their low bit every step after counting
+//! their live neighbours, empty cells stay empty. The set of changing tiles
+//! therefore never moves, which makes the sparsity of a lattice stable.
+class flicker_rule : public ca_stencil_rule<flicker_rule, ca_moore<1> >
+{
+public:
+    uint16_t update(const neighbors& n, ca_rng&)
+    {
+        uint16_t c = n.center();
+        if(!c) return 0;
+        int live = ca_moore<1>::size - n.count(0);
+        return uint16_t((c ^ 1) | (live > 0 ? 2 : 0));
+    }
+
+    virtual bool quiescent_stable() const { return true; }
+};
+
+//! Fill a fraction of the tiles with live cells
+static void fill_lattice(uint16_t* lattice, const ca_engine& engine, double density, uint64_t seed)
+{
+    const ivec3& size = engine.size();
+    memset(lattice, 0, size_t(hmul(size)) * sizeof(uint16_t));
+
+    const vector<ca_tile>& tiles = engine.tiles();
+    ca_rng rng(seed);
+    size_t wanted = max<size_t>(1, size_t(density * tiles.size() + 0.5));
+    for(size_t t=0; t<tiles.size(); t++)
+    {
+        // Spread the live tiles evenly over the lattice
+        if(size_t((t + 1) * wanted / tiles.size()) == size_t(t * wanted / tiles.size())) continue;
+
+        const ca_tile& tile = tiles[t];
+        for(int k=tile.begin.z; k<tile.end.z; k++)
+            for(int j=tile.begin.y; j<tile.end.y; j++)
+                for(int i=tile.begin.x; i<tile.end.x; i++)
+                    lattice[i + size_t(size.x) * (j + size_t(size.y) * k)] = uint16_t(2 + rng(2));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Harness
+
+struct bench_result
+{
+    string rule;
+    int size;
+    double density;
+    uint threads;
+    uint64_t steps;
+    double seconds;
+    double active_fraction;
+    double cells_per_second;
+    double ns_per_cell;
+    double bandwidth;
+    double speedup;
+};
+
+static double now_seconds()
+{
+    static const boost::posix_time::ptime epoch = boost::posix_time::microsec_clock::universal_time();
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds() * 1e-6;
+}
+
+//! Memory traffic of a step per evaluated cell. A tile reads the front
+//! buffer over its extent plus the halo of the rule radius (clipped to the
+//! lattice; every cell counted once, assuming the neighbourhood rows stay in
+//! cache while the tile is processed) and writes the back buffer over its
+//! extent. Change tracking then reads both buffers once more, which is an
+//! upper bound since the comparison stops at the first changed row. Copies of
+//! skipped tiles into older buffers are not counted.
+static double bytes_per_cell(const ca_engine& engine, int radius)
+{
+    const vector<ca_tile>& tiles = engine.tiles();
+    double read = 0;
+    double written = 0;
+    for(size_t t=0; t<tiles.size(); t++)
+    {
+        ivec3 lo = max(tiles[t].begin - ivec3(radius), ivec3(0));
+        ivec3 hi = min(tiles[t].end + ivec3(radius), engine.size());
+        ivec3 extent = tiles[t].end - tiles[t].begin;
+        read += double(hi.x - lo.x) * (hi.y - lo.y) * (hi.z - lo.z);
+        written += double(extent.x) * extent.y * extent.z;
+    }
+
+    double bytes = (read / written + 1) * sizeof(uint16_t);
+    if(engine.get_options().sparse || engine.get_options().track_changes)
+        bytes += 2 * sizeof(uint16_t);
+    return bytes;
+}
+
+static ca_rule* create_rule(const string& name)
+{
+    if(name == "copy") return new copy_rule();
+    if(name == "flicker") return new flicker_rule();
+    if(name == "basic") return new basic_algorithm();
+    return 0;
+}
+
+static bench_result run_benchmark( const string& rule_name
+                                   , int size
+                                   , double density
+                                   , uint threads
+                                   , const ca_engine::options& base_options
+                                   , uint64_t min_steps
+                                   , double min_seconds )
+{
+    ca_engine::options opts = base_options;
+    opts.num_threads = threads;
+    ca_engine engine(ivec3(size), opts);
+
+    size_t cells = size_t(size) * size * size;
+    vector<uint16_t> a(cells), b(cells);
+    fill_lattice(&a[0], engine, density, opts.seed);
+    b = a;
+
+    ca_rule* rule = create_rule(rule_name);
+    uint16_t* front = &a[0];
+    uint16_t* back = &b[0];
+
+    // Warm up: the first steps are always dense
+    for(int i=0; i<2; i++)
+    {
+        engine.step(front, back, *rule);
+        swap(front, back);
+    }
+
+    bench_result r;
+    r.rule = rule_name;
+    r.size = size;
+    r.density = density;
+    r.threads = engine.num_threads();
+
+    uint64_t steps = 0;
+    size_t evaluated = 0;
+    double start = now_seconds();
+    double elapsed = 0;
+    while(steps < min_steps || elapsed < min_seconds)
+    {
+        engine.step(front, back, *rule);
+        swap(front, back);
+        evaluated += engine.active_tiles();
+        steps++;
+        elapsed = now_seconds() - start;
+    }
+    double bytes = bytes_per_cell(engine, rule->radius());
+    delete rule;
+
+    r.steps = steps;
+    r.seconds = elapsed;
+    r.active_fraction = double(evaluated) / (double(steps) * engine.tiles().size());
+    r.cells_per_second = double(cells) * steps / elapsed;
+    r.ns_per_cell = 1e9 / r.cells_per_second;
+    r.bandwidth = r.active_fraction * r.cells_per_second * bytes;
+    r.speedup = 1;
+    return r;
+}
+
+static vector<string> split_list(const string& list)
+{
+    vector<string> items;
+    stringstream ss(list);
+    string item;
+    while(getline(ss, item, ',')) if(!item.empty()) items.push_back(item);
+    return items;
+}
+
+static void usage(const char* program)
+{
+    cout << "Usage: " << program << " [options]" << endl
+         << "  --rule NAME         copy, flicker or basic (default: flicker)" << endl
+         << "  --sizes LIST        lattice edge lengths (default: 64,128,256,512,1024)" << endl
+         << "  --densities LIST    fractions of live tiles (default: 1,0.1,0.01)" << endl
+         << "  --threads LIST      thread counts (default: 1,2,4,... up to all cores)" << endl
+         << "  --steps N           minimum steps per run (default: 10)" << endl
+         << "  --min-time S        minimum seconds per run (default: 1)" << endl
+         << "  --slabs             tile the lattice in z-slabs instead of 3D bricks" << endl
+         << "  --brick X Y Z       brick dimensions (default: 32 32 16)" << endl
+         << "  --dense             evaluate every tile (disable sparse stepping)" << endl
+         << "  --output FILE       write the results as JSON (default: ca_bench.json)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    string rule_name = "flicker";
+    vector<string> sizes = split_list("64,128,256,512,1024");
+    vector<string> densities = split_list("1,0.1,0.01");
+    vector<uint> thread_counts;
+    uint64_t min_steps = 10;
+    double min_seconds = 1;
+    string output = "ca_bench.json";
+
+    ca_engine::options engine_options;
+    engine_options.deterministic = true;
+    engine_options.sparse = true;
+    engine_options.seed = 1;
+
+    for(int a=1; a<argc; a++)
+    {
+        string arg = argv[a];
+        if(arg == "--rule" && a+1 < argc) rule_name = argv[++a];
+        else if(arg == "--sizes" && a+1 < argc) sizes = split_list(argv[++a]);
+        else if(arg == "--densities" && a+1 < argc) densities = split_list(argv[++a]);
+        else if(arg == "--threads" && a+1 < argc)
+        {
+            vector<string> list = split_list(argv[++a]);
+            for(size_t i=0; i<list.size(); i++) thread_counts.push_back(atoi(list[i].c_str()));
+        }
+        else if(arg == "--steps" && a+1 < argc) min_steps = strtoull(argv[++a], 0, 10);
+        else if(arg == "--min-time" && a+1 < argc) min_seconds = atof(argv[++a]);
+        else if(arg == "--slabs") engine_options.tiling = ca_engine::z_slabs;
+        else if(arg == "--brick" && a+3 < argc)
+        {
+            engine_options.brick_size.x = atoi(argv[++a]);
+            engine_options.brick_size.y = atoi(argv[++a]);
+            engine_options.brick_size.z = atoi(argv[++a]);
+        }
+        else if(arg == "--dense") engine_options.sparse = false;
+        else if(arg == "--output" && a+1 < argc) output = argv[++a];
+        else if(arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ca_rule* probe = create_rule(rule_name);
+    if(!probe)
+    {
+        cerr << "Unknown rule " << rule_name << endl;
+        return 1;
+    }
+    delete probe;
+
+    uint hardware = max(boost::thread::hardware_concurrency(), 1u);
+    if(thread_counts.empty())
+    {
+        for(uint t=1; t<hardware; t*=2) thread_counts.push_back(t);
+        thread_counts.push_back(hardware);
+    }
+
+    cout << "CA step benchmark: rule " << rule_name << ", " << hardware << " hardware threads, "
+         << (engine_options.sparse ? "sparse" : "dense") << " stepping" << endl;
+    cout << setw(6) << "size" << setw(9) << "density" << setw(8) << "threads" << setw(8) << "steps"
+         << setw(9) << "active" << setw(14) << "Mcells/s" << setw(10) << "ns/cell"
+         << setw(10) << "GB/s" << setw(9) << "speedup" << endl;
+
+    vector<bench_result> results;
+    for(size_t s=0; s<sizes.size(); s++)
+        for(size_t d=0; d<densities.size(); d++)
+        {
+            double baseline = 0;
+            for(size_t t=0; t<thread_counts.size(); t++)
+            {
+                bench_result r = run_benchmark(rule_name, atoi(sizes[s].c_str()), atof(densities[d].c_str()),
+                                               thread_counts[t], engine_options, min_steps, min_seconds);
+                if(t == 0) baseline = r.cells_per_second;
+                r.speedup = r.cells_per_second / baseline;
+                results.push_back(r);
+
+                cout << setw(6) << r.size << setw(9) << r.density << setw(8) << r.threads << setw(8) << r.steps
+                     << setw(8) << fixed << setprecision(1) << r.active_fraction * 100 << "%"
+                     << setw(14) << setprecision(1) << r.cells_per_second * 1e-6
+                     << setw(10) << setprecision(3) << r.ns_per_cell
+                     << setw(10) << setprecision(2) << r.bandwidth * 1e-9
+                     << setw(9) << setprecision(2) << r.speedup << endl;
+                cout.unsetf(ios::fixed);
+                cout << setprecision(6);
+            }
+        }
+
+    ofstream json(output.c_str());
+    if(!json.is_open())
+    {
+        cerr << "Unable to write " << output << endl;
+        return 1;
+    }
+    json << "{" << endl
+         << "  \"benchmark\": \"ca_step\"," << endl
+         << "  \"rule\": \"" << rule_name << "\"," << endl
+         << "  \"timestamp\": " << time(NULL) << "," << endl
+         << "  \"hardware_threads\": " << hardware << "," << endl
+         << "  \"sparse\": " << (engine_options.sparse ? "true" : "false") << "," << endl
+         << "  \"tiling\": \"" << (engine_options.tiling == ca_engine::z_slabs ? "z_slabs" : "bricks") << "\"," << endl
+         << "  \"brick_size\": [" << engine_options.brick_size.x << ", " << engine_options.brick_size.y
+         << ", " << engine_options.brick_size.z << "]," << endl
+         << "  \"results\": [" << endl;
+    for(size_t i=0; i<results.size(); i++)
+    {
+        const bench_result& r = results[i];
+        json << "    {\"size\": " << r.size
+             << ", \"density\": " << r.density
+             << ", \"threads\": " << r.threads
+             << ", \"steps\": " << r.steps
+             << ", \"seconds\": " << r.seconds
+             << ", \"active_fraction\": " << r.active_fraction
+             << ", \"cells_per_second\": " << r.cells_per_second
+             << ", \"ns_per_cell\": " << r.ns_per_cell
+             << ", \"bytes_per_second\": " << r.bandwidth
+             << ", \"speedup\": " << r.speedup << "}"
+             << (i+1 < results.size() ? "," : "") << endl;
+    }
+    json << "  ]" << endl << "}" << endl;
+
+    cout << "Results written to " << output << endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "voreen/core/datastructures/volume/volumeoperator.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+//! Per-call overhead of VolumeOperatorUnary::apply on small volumes, comparing
+//! the format id dispatch against the dynamic_cast chain it replaced, and
+//! per-brick apply() calls against a single applyBatch().
+
+using namespace std;
+using namespace voreen;
+
+//! Operator doing almost nothing, so the dispatch dominates
+class volume_operator_touch : public VolumeOperatorUnary<volume_operator_touch>
+{
+    friend class VolumeOperatorUnary<volume_operator_touch>;
+
+public:
+    //! The dispatch the volume operators used before format ids: one
+    //! dynamic_cast per candidate type, in the original order
+    size_t apply_legacy(Volume* volume) const;
+
+private:
+    template<typename T>
+    size_t apply_internal(VolumeAtomic<T>* volume) const
+    {
+        return volume->getNumVoxels();
+    }
+};
+
+#define LEGACY_CAST(TYPE) \
+    if(VolumeAtomic<TYPE >* v = dynamic_cast<VolumeAtomic<TYPE >*>(volume)) return apply_internal(v);
+
+size_t volume_operator_touch::apply_legacy(Volume* volume) const
+{
+    // Typedef and template spelling were both probed, as in the old chain
+    LEGACY_CAST(uint8_t) LEGACY_CAST(uint8_t)
+    LEGACY_CAST(uint16_t) LEGACY_CAST(uint16_t)
+    LEGACY_CAST(uint32_t) LEGACY_CAST(uint32_t)
+    LEGACY_CAST(int8_t) LEGACY_CAST(int8_t)
+    LEGACY_CAST(int16_t) LEGACY_CAST(int16_t)
+    LEGACY_CAST(int32_t) LEGACY_CAST(int32_t)
+    LEGACY_CAST(float) LEGACY_CAST(float)
+    LEGACY_CAST(double) LEGACY_CAST(double)
+    LEGACY_CAST(tgt::vec3) LEGACY_CAST(tgt::vec3)
+    LEGACY_CAST(tgt::dvec3) LEGACY_CAST(tgt::dvec3)
+    LEGACY_CAST(tgt::vec4) LEGACY_CAST(tgt::vec4)
+    LEGACY_CAST(tgt::dvec4) LEGACY_CAST(tgt::dvec4)
+    throw VolumeOperatorUnsupportedTypeException(typeid(*volume).name());
+}
+
+#undef LEGACY_CAST
+
+static double now_seconds()
+{
+    static const boost::posix_time::ptime epoch = boost::posix_time::microsec_clock::universal_time();
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds() * 1e-6;
+}
+
+//! Volumes without data: only the dispatch is measured
+template<typename T>
+static Volume* create_volume(int edge)
+{
+    return new VolumeAtomic<T>(tgt::ivec3(edge), tgt::vec3(1.f), tgt::mat4::identity,
+                               VolumeAtomic<T>::BITS_PER_VOXEL, false);
+}
+
+struct format_case
+{
+    const char* name;
+    Volume* volume;
+};
+
+int main(int argc, char** argv)
+{
+    size_t calls = 2000000;
+    size_t bricks = 4096;
+    for(int a=1; a<argc; a++)
+    {
+        string arg = argv[a];
+        if(arg == "--calls" && a+1 < argc) calls = strtoul(argv[++a], 0, 10);
+        else if(arg == "--bricks" && a+1 < argc) bricks = strtoul(argv[++a], 0, 10);
+        else
+        {
+            cout << "Usage: " << argv[0] << " [--calls N] [--bricks N]" << endl;
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    volume_operator_touch op;
+    size_t checksum = 0;
+
+    // First, middle and last entry of the old chain
+    format_case cases[] = {
+        { "uint8", create_volume<uint8_t>(16) },
+        { "float", create_volume<float>(16) },
+        { "4xdouble", create_volume<tgt::dvec4>(16) }
+    };
+
+    cout << "Single apply(), " << calls << " calls" << endl;
+    cout << setw(10) << "format" << setw(16) << "dynamic_cast" << setw(16) << "format id" << setw(10) << "speedup" << endl;
+    for(size_t c=0; c<sizeof(cases)/sizeof(cases[0]); c++)
+    {
+        double start = now_seconds();
+        for(size_t i=0; i<calls; i++) checksum += op.apply_legacy(cases[c].volume);
+        double legacy = (now_seconds() - start) * 1e9 / calls;
+
+        start = now_seconds();
+        for(size_t i=0; i<calls; i++) checksum += op.apply<size_t>(cases[c].volume);
+        double tagged = (now_seconds() - start) * 1e9 / calls;
+
+        cout << setw(10) << cases[c].name << fixed << setprecision(2)
+             << setw(13) << legacy << " ns" << setw(13) << tagged << " ns"
+             << setw(10) << legacy / tagged << endl;
+        delete cases[c].volume;
+    }
+
+    // Brick lists as produced by the per-brick pipelines
+    vector<Volume*> brick_list;
+    for(size_t i=0; i<bricks; i++) brick_list.push_back(create_volume<uint16_t>(16));
+
+    size_t rounds = max<size_t>(calls / bricks, 1);
+    double start = now_seconds();
+    for(size_t r=0; r<rounds; r++)
+        for(size_t i=0; i<brick_list.size(); i++) checksum += op.apply_legacy(brick_list[i]);
+    double legacy = (now_seconds() - start) * 1e9 / (rounds * bricks);
+
+    start = now_seconds();
+    for(size_t r=0; r<rounds; r++)
+        for(size_t i=0; i<brick_list.size(); i++) checksum += op.apply<size_t>(brick_list[i]);
+    double tagged = (now_seconds() - start) * 1e9 / (rounds * bricks);
+
+    vector<size_t> results;
+    start = now_seconds();
+    for(size_t r=0; r<rounds; r++)
+    {
+        results.clear();
+        op.applyBatch(brick_list, results);
+        checksum += results.back();
+    }
+    double batch = (now_seconds() - start) * 1e9 / (rounds * bricks);
+
+    cout << endl << "uint16 brick list, " << bricks << " bricks, per brick:" << endl
+         << "  dynamic_cast apply  " << setw(8) << legacy << " ns" << endl
+         << "  format id apply     " << setw(8) << tagged << " ns" << endl
+         << "  applyBatch          " << setw(8) << batch << " ns" << endl;
+
+    for(size_t i=0; i<brick_list.size(); i++) delete brick_list[i];
+
+    // Keeps the loops from being optimized away
+    cout << endl << "checksum " << checksum << endl;
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "ca_engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/bind/bind.hpp>
+
+using namespace std;
+using namespace tgt;
+using namespace boost::placeholders;
+
+ca_engine::ca_engine(const ivec3& size, const options& o)
+    : lattice_size(size)
+    , opts(o)
+    , pool(o.num_threads)
+    , step_count(0)
+    , all_dirty(true)
+    , track_changes(false)
+    , new_version(0)
+    , src_versions(0)
+    , dst_versions(0)
+    , current_rule(0)
+{
+    for(uint i=0; i<pool.size(); i++)
+        worker_rngs.push_back(ca_rng(opts.seed, 0, i));
+
+    current.src = 0;
+    current.dst = 0;
+    current.size = lattice_size;
+    current.stride_y = lattice_size.x;
+    current.stride_z = size_t(lattice_size.x) * lattice_size.y;
+    current.step = 0;
+    current.seed = opts.seed;
+    current.engine = this;
+
+    build_tiles();
+}
+
+void ca_engine::build_tiles()
+{
+    tile_list.clear();
+
+    if(opts.tiling == z_slabs)
+    {
+        // In deterministic mode the slab count must not depend on the number
+        // of workers, so slabs get the brick depth instead
+        int slabs = opts.deterministic ? 0 : pool.size() * max(opts.slabs_per_worker, 1u);
+        int depth = slabs ? (lattice_size.z + slabs - 1) / slabs : opts.brick_size.z;
+        brick = ivec3(lattice_size.x, lattice_size.y, max(depth, 1));
+    }
+    else
+    {
+        brick = max(opts.brick_size, ivec3(1));
+    }
+
+    grid = (lattice_size + brick - ivec3(1)) / brick;
+
+    ca_tile t;
+    t.index = 0;
+    for(int z=0; z<lattice_size.z; z+=brick.z)
+        for(int y=0; y<lattice_size.y; y+=brick.y)
+            for(int x=0; x<lattice_size.x; x+=brick.x)
+            {
+                t.begin = ivec3(x, y, z);
+                t.end = min(t.begin + brick, lattice_size);
+                tile_list.push_back(t);
+                t.index++;
+            }
+
+    changed.assign(tile_list.size(), 1);
+    last_changed.assign(tile_list.size(), 1);
+    active.assign(tile_list.size(), 1);
+}
+
+void ca_engine::step(const uint16_t* src, uint16_t* dst, ca_rule& rule)
+{
+    current.src = src;
+    current.dst = dst;
+    current.step = step_count;
+    current_rule = &rule;
+
+    // Start a fresh change set; serial hooks may already add to it
+    changed.swap(last_changed);
+    fill(changed.begin(), changed.end(), 0);
+
+    // Change tracking compares the written tile against the front buffer,
+    // which is impossible when stepping in place
+    bool sparse = opts.sparse && src != dst;
+    track_changes = (opts.sparse || opts.track_changes) && src != dst;
+    copy_list.clear();
+    src_versions = 0;
+    dst_versions = 0;
+    if(sparse)
+    {
+        // Look the buffers up first: the stamp for this step must be newer
+        // than the versions a buffer seen for the first time starts with
+        src_versions = &buffer_versions(src);
+        dst_versions = &buffer_versions(dst);
+        new_version++;
+    }
+
+    bool skip_quiescent = sparse && !all_dirty;
+    if(skip_quiescent)
+    {
+        build_active_list(rule.radius());
+
+        // Skipped tiles did not change, so the back buffer only needs them
+        // if it holds an older version than the front buffer (it never does
+        // when two buffers simply alternate). They are carried over before
+        // the serial hooks run, which may write into the back buffer; if the
+        // rule turns out not to allow skipping, the copies are overwritten.
+        for(size_t i=0; i<active.size(); i++)
+            if(!active[i] && (*dst_versions)[i] != (*src_versions)[i]) copy_list.push_back(i);
+        pool.run(copy_list.size(), boost::bind(&ca_engine::copy_tile, this, _1, _2));
+    }
+
+    rule.begin_step(current);
+
+    if(skip_quiescent && rule.quiescent_stable())
+    {
+        // Skipped tiles the hooks wrote into no longer match the front buffer
+        for(size_t i=0; i<active.size(); i++)
+            if(!active[i] && changed[i]) (*dst_versions)[i] = new_version;
+    }
+    else
+    {
+        active_list.resize(tile_list.size());
+        for(size_t i=0; i<tile_list.size(); i++) active_list[i] = i;
+    }
+    all_dirty = !sparse;
+
+    pool.run(active_list.size(), boost::bind(&ca_engine::run_tile, this, _1, _2));
+
+    rule.end_step(current);
+
+    current_rule = 0;
+    step_count++;
+}
+
+void ca_engine::invalidate()
+{
+    all_dirty = true;
+    versions.clear();
+}
+
+void ca_engine::restart_at(uint64_t step)
+{
+    step_count = step;
+    invalidate();
+}
+
+//! Per-tile content versions of a buffer. A buffer seen for the first time
+//! gets a fresh version that neither another buffer nor any stamped tile
+//! carries.
+vector<uint32_t>& ca_engine::buffer_versions(const uint16_t* buffer)
+{
+    map<const uint16_t*, vector<uint32_t> >::iterator it = versions.find(buffer);
+    if(it != versions.end()) return it->second;
+
+    all_dirty = true;
+    return versions[buffer] = vector<uint32_t>(tile_list.size(), ++new_version);
+}
+
+void ca_engine::mark_changed(const ivec3& cell)
+{
+    ivec3 t = cell / brick;
+    changed[(size_t(t.z)*grid.y + t.y)*grid.x + t.x] = 1;
+}
+
+//! Dilate the tiles changed in the last step by the rule radius (in tiles,
+//! wrapping around so periodic boundaries are covered)
+void ca_engine::build_active_list(int radius)
+{
+    ivec3 reach = (ivec3(radius) + brick - ivec3(1)) / brick;
+    reach = min(reach, grid);
+
+    fill(active.begin(), active.end(), 0);
+    for(int z=0; z<grid.z; z++)
+        for(int y=0; y<grid.y; y++)
+            for(int x=0; x<grid.x; x++)
+            {
+                if(!last_changed[(size_t(z)*grid.y + y)*grid.x + x]) continue;
+
+                for(int dz=-reach.z; dz<=reach.z; dz++)
+                    for(int dy=-reach.y; dy<=reach.y; dy++)
+                        for(int dx=-reach.x; dx<=reach.x; dx++)
+                        {
+                            int nx = (x + dx + grid.x) % grid.x;
+                            int ny = (y + dy + grid.y) % grid.y;
+                            int nz = (z + dz + grid.z) % grid.z;
+                            active[(size_t(nz)*grid.y + ny)*grid.x + nx] = 1;
+                        }
+            }
+
+    active_list.clear();
+    for(size_t i=0; i<active.size(); i++)
+        if(active[i]) active_list.push_back(i);
+}
+
+void ca_engine::run_tile(size_t task, uint worker)
+{
+    const ca_tile& t = tile_list[active_list[task]];
+    if(opts.deterministic)
+    {
+        ca_rng rng(opts.seed, current.step, t.index);
+        current_rule->process_tile(current, t, rng);
+    }
+    else
+    {
+        current_rule->process_tile(current, t, worker_rngs[worker]);
+    }
+
+    if(!track_changes) return;
+
+    // Rows of a tile are contiguous in x, compare them against the front buffer
+    size_t row_bytes = (t.end.x - t.begin.x) * sizeof(uint16_t);
+    for(int k=t.begin.z; k<t.end.z && !changed[t.index]; k++)
+        for(int j=t.begin.y; j<t.end.y; j++)
+        {
+            size_t i = current.index(t.begin.x, j, k);
+            if(memcmp(current.src + i, current.dst + i, row_bytes))
+            {
+                changed[t.index] = 1;
+                break;
+            }
+        }
+
+    if(dst_versions)
+        (*dst_versions)[t.index] = changed[t.index] ? new_version : (*src_versions)[t.index];
+}
+
+//! Carry an unchanged tile from the front into the back buffer
+void ca_engine::copy_tile(size_t task, uint)
+{
+    const ca_tile& t = tile_list[copy_list[task]];
+    size_t row_bytes = (t.end.x - t.begin.x) * sizeof(uint16_t);
+    for(int k=t.begin.z; k<t.end.z; k++)
+        for(int j=t.begin.y; j<t.end.y; j++)
+        {
+            size_t i = current.index(t.begin.x, j, k);
+            memcpy(current.dst + i, current.src + i, row_bytes);
+        }
+
+    (*dst_versions)[t.index] = (*src_versions)[t.index];
+}
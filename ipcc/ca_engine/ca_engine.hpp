@@ -0,0 +1,236 @@
+#ifndef CA_ENGINE_HPP
+#define CA_ENGINE_HPP
+
+#include <vector>
+#include <map>
+#include <iosfwd>
+
+#include "tgt/types.h"
+#include "tgt/vector.h"
+
+#include "worker_pool.hpp"
+
+//!
+//! Small counter-based random generator (splitmix64). It can be seeded from
+//! (seed, step, tile) so that every tile draws the same sequence no matter
+//! which thread evaluates it.
+class ca_rng
+{
+public:
+    explicit ca_rng(uint64_t seed = 0) : state(seed) {}
+
+    ca_rng(uint64_t seed, uint64_t step, uint64_t stream)
+        : state(mix(mix(seed ^ 0x9e3779b97f4a7c15ULL) ^ step) ^ (stream * 0xbf58476d1ce4e5b9ULL))
+    {}
+
+    uint64_t next()
+    {
+        return mix(state += 0x9e3779b97f4a7c15ULL);
+    }
+
+    //! Uniform integer in [0, n)
+    uint32_t operator()(uint32_t n)
+    {
+        return static_cast<uint32_t>(((next() >> 32) * n) >> 32);
+    }
+
+private:
+    static uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t state;
+};
+
+class ca_engine;
+
+//!
+//! An axis-aligned block of cells [begin, end) processed as one task
+struct ca_tile
+{
+    uint index;
+    tgt::ivec3 begin;
+    tgt::ivec3 end;
+};
+
+//!
+//! Everything a rule needs to evaluate one step on a raw lattice
+struct ca_step_context
+{
+    //! Current state (front buffer)
+    const uint16_t* src;
+    //! Next state (back buffer). Equals src when stepping in place.
+    uint16_t* dst;
+    //! Lattice dimensions
+    tgt::ivec3 size;
+    //! Element strides between neighbouring rows and slices
+    size_t stride_y;
+    size_t stride_z;
+    //! Number of steps computed before this one
+    uint64_t step;
+    //! Engine seed, for rules drawing random numbers in the serial hooks
+    uint64_t seed;
+    //! Engine running the step. Serial hooks writing cells directly must
+    //! report them through engine->mark_changed() for sparse stepping.
+    ca_engine* engine;
+
+    size_t index(int x, int y, int z) const
+    {
+        return x + y*stride_y + z*stride_z;
+    }
+};
+
+//!
+//! Interface for CA rules driven by ca_engine
+class ca_rule
+{
+public:
+    virtual ~ca_rule() {}
+
+    //! Serial hook, runs on the driver thread before any tile of the step
+    virtual void begin_step(const ca_step_context&) {}
+
+    //! Evaluate every cell of tile. Called concurrently for disjoint tiles, so
+    //! implementations must only write cells inside the tile.
+    virtual void process_tile(const ca_step_context& ctx, const ca_tile& tile, ca_rng& rng) = 0;
+
+    //! Serial hook, runs on the driver thread after every tile has finished
+    virtual void end_step(const ca_step_context&) {}
+
+    //! Neighbourhood radius the rule reads, used to dilate active tiles
+    virtual int radius() const { return 0; }
+
+    //! Whether a cell whose neighbourhood did not change in the last step
+    //! keeps its state. Only such steps can skip quiescent tiles. Queried
+    //! after begin_step, so a rule can return false on steps where global
+    //! state (a phase change, random seeding) affects every cell.
+    virtual bool quiescent_stable() const { return false; }
+
+    //! Write the persistent state of the rule (phases, counters) for
+    //! checkpoints. Stateless rules need not override this.
+    virtual void save_state(std::ostream&) const {}
+
+    //! Restore the state written by save_state()
+    virtual void load_state(std::istream&) {}
+};
+
+//!
+//! Tiled stepping engine: cuts the lattice into z-slabs or cache-sized bricks
+//! and evaluates them on a persistent worker_pool.
+class ca_engine
+{
+public:
+    enum tiling_mode
+    {
+        //! Whole xy-planes, a few slabs per worker
+        z_slabs,
+        //! Fixed-size 3D bricks
+        bricks
+    };
+
+    struct options
+    {
+        //! Worker threads, 0 means one per hardware thread
+        uint num_threads;
+        tiling_mode tiling;
+        //! Brick dimensions for the bricks tiling
+        tgt::ivec3 brick_size;
+        //! Slabs per worker for the z_slabs tiling (ignored when deterministic)
+        uint slabs_per_worker;
+        //! Same results for every thread count: the tile grid does not depend
+        //! on the number of workers and every tile gets its own random stream
+        bool deterministic;
+        //! Base seed for the random streams
+        uint64_t seed;
+        //! Only evaluate tiles that changed in the last step or border one.
+        //! Needs distinct front and back buffers.
+        bool sparse;
+        //! Flag the tiles each step changed (implied by sparse). Needs
+        //! distinct front and back buffers.
+        bool track_changes;
+
+        options()
+            : num_threads(0)
+            , tiling(bricks)
+            , brick_size(32, 32, 16)
+            , slabs_per_worker(4)
+            , deterministic(false)
+            , seed(0)
+            , sparse(false)
+            , track_changes(false)
+        {}
+    };
+
+    ca_engine(const tgt::ivec3& size, const options& opts = options());
+
+    //! Evaluate one step of rule from src into dst (src == dst steps in place).
+    //! In sparse mode src and dst may rotate through any number of buffers.
+    void step(const uint16_t* src, uint16_t* dst, ca_rule& rule);
+
+    //! Flag the tile holding cell as changed in the current step
+    void mark_changed(const tgt::ivec3& cell);
+
+    //! Force a full step next time, e.g. after the lattice was modified
+    //! outside of the engine
+    void invalidate();
+
+    //! Continue a run restored from a checkpoint: the next step gets the
+    //! given number (and thereby the same random streams as originally)
+    void restart_at(uint64_t step);
+
+    const tgt::ivec3& size() const { return lattice_size; }
+    const options& get_options() const { return opts; }
+    const std::vector<ca_tile>& tiles() const { return tile_list; }
+    uint num_threads() const { return pool.size(); }
+    uint64_t steps() const { return step_count; }
+
+    //! Number of tiles evaluated in the last step
+    size_t active_tiles() const { return active_list.size(); }
+
+    //! Per-tile flags: did the last step change the tile (only tracked
+    //! with sparse or track_changes, plus cells flagged by mark_changed())
+    const std::vector<uint8_t>& changed_tiles() const { return changed; }
+
+private:
+    void build_tiles();
+    void build_active_list(int radius);
+    void run_tile(size_t task, uint worker);
+    void copy_tile(size_t task, uint worker);
+    std::vector<uint32_t>& buffer_versions(const uint16_t* buffer);
+
+    tgt::ivec3 lattice_size;
+    options opts;
+    worker_pool pool;
+    std::vector<ca_tile> tile_list;
+    //! Tile grid dimensions and tile extent
+    tgt::ivec3 grid;
+    tgt::ivec3 brick;
+    //! Per-worker random streams for the non-deterministic mode
+    std::vector<ca_rng> worker_rngs;
+    uint64_t step_count;
+
+    //! Sparse stepping state
+    std::vector<uint8_t> changed;
+    std::vector<uint8_t> last_changed;
+    std::vector<uint8_t> active;
+    std::vector<size_t> active_list;
+    std::vector<size_t> copy_list;
+    bool all_dirty;
+    bool track_changes;
+    //! Per-buffer, per-tile content versions, so skipped tiles are only
+    //! copied into buffers holding an older state (rings of more than two
+    //! buffers)
+    std::map<const uint16_t*, std::vector<uint32_t> > versions;
+    uint32_t new_version;
+    std::vector<uint32_t>* src_versions;
+    std::vector<uint32_t>* dst_versions;
+
+    //! State of the step in flight
+    ca_step_context current;
+    ca_rule* current_rule;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef CA_STENCIL_HPP
+#define CA_STENCIL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "tgt/assert.h"
+
+#include "ca_engine.hpp"
+
+//!
+//! Moore neighborhood: the full (2R+1)^3 cube around a cell
+template<int R>
+struct ca_moore
+{
+    enum
+    {
+        radius = R,
+        size = (2*R+1) * (2*R+1) * (2*R+1)
+    };
+
+    static bool contains(int, int, int) { return true; }
+};
+
+//!
+//! von Neumann neighborhood: cells within Manhattan distance R
+template<int R>
+struct ca_von_neumann
+{
+    enum
+    {
+        radius = R,
+        size = (2*R+1) * (2*R*R + 2*R + 3) / 3
+    };
+
+    static bool contains(int dx, int dy, int dz)
+    {
+        return std::abs(dx) + std::abs(dy) + std::abs(dz) <= R;
+    }
+};
+
+//!
+//! Boundary policies: value seen for neighbours outside the lattice
+template<uint16_t V>
+struct ca_boundary_constant
+{
+    static uint16_t fetch(const ca_step_context& c, int x, int y, int z)
+    {
+        if(x < 0 || y < 0 || z < 0 || x >= c.size.x || y >= c.size.y || z >= c.size.z) return V;
+        return c.src[c.index(x, y, z)];
+    }
+};
+
+struct ca_boundary_clamp
+{
+    static uint16_t fetch(const ca_step_context& c, int x, int y, int z)
+    {
+        x = std::min(std::max(x, 0), c.size.x - 1);
+        y = std::min(std::max(y, 0), c.size.y - 1);
+        z = std::min(std::max(z, 0), c.size.z - 1);
+        return c.src[c.index(x, y, z)];
+    }
+};
+
+struct ca_boundary_periodic
+{
+    static uint16_t fetch(const ca_step_context& c, int x, int y, int z)
+    {
+        x = ((x % c.size.x) + c.size.x) % c.size.x;
+        y = ((y % c.size.y) + c.size.y) % c.size.y;
+        z = ((z % c.size.z) + c.size.z) % c.size.z;
+        return c.src[c.index(x, y, z)];
+    }
+};
+
+//!
+//! View of the neighbourhood of one cell as handed to a rule kernel.
+//!
+//! In the interior it points straight into the front buffer; at the lattice
+//! boundary it points into a small gathered (2R+1)^3 cube. Kernels see the
+//! same interface in both cases.
+template<class N>
+class ca_neighbors
+{
+public:
+    //! State of the cell itself
+    uint16_t center() const { return *ptr; }
+
+    //! Neighbour at a relative offset, |d| <= radius on every axis. Offsets
+    //! outside the neighbourhood read 0 at the lattice boundary.
+    uint16_t at(int dx, int dy, int dz) const
+    {
+        return ptr[dx + ptrdiff_t(dy)*stride_y + ptrdiff_t(dz)*stride_z];
+    }
+
+    //! k-th neighbour in the neighbourhood, k in [0, N::size), z-major order
+    uint16_t operator[](int k) const { return ptr[offsets[k]]; }
+
+    //! Number of neighbours (including the center) equal to value
+    int count(uint16_t value) const
+    {
+        int n = 0;
+        for(int k=0; k<N::size; k++) n += (ptr[offsets[k]] == value);
+        return n;
+    }
+
+    //! Lattice position of the cell
+    tgt::ivec3 position;
+
+private:
+    template<class D, class M, class B> friend class ca_stencil_rule;
+
+    const uint16_t* ptr;
+    const ptrdiff_t* offsets;
+    ptrdiff_t stride_y;
+    ptrdiff_t stride_z;
+};
+
+//!
+//! Base class for CA rules that only compute a cell from its neighbourhood.
+//!
+//! Derived (CRTP) supplies
+//!     uint16_t update(const ca_neighbors<N>& n, ca_rng& rng)
+//! and the base generates the loop nest: neighbour offsets are precomputed
+//! from the lattice strides once, interior rows run without any bounds
+//! checks, and only the cells within R of the lattice border take the
+//! Boundary policy path. Requires distinct front and back buffers whenever
+//! the radius is positive. Derived rules overriding begin_step must call
+//! ca_stencil_rule::begin_step first.
+template<class Derived, class N, class Boundary = ca_boundary_constant<0> >
+class ca_stencil_rule : public ca_rule
+{
+public:
+    typedef N neighborhood;
+    typedef Boundary boundary;
+    typedef ca_neighbors<N> neighbors;
+
+    ca_stencil_rule() : stride_y(-1), stride_z(-1)
+    {
+        const int w = 2*N::radius + 1;
+        for(int dz=-N::radius; dz<=N::radius; dz++)
+            for(int dy=-N::radius; dy<=N::radius; dy++)
+                for(int dx=-N::radius; dx<=N::radius; dx++)
+                {
+                    if(!N::contains(dx, dy, dz)) continue;
+                    deltas.push_back(tgt::ivec3(dx, dy, dz));
+                    gather_offsets.push_back(dx + dy*w + dz*w*w);
+                }
+        tgtAssert(deltas.size() == size_t(N::size), "Neighbourhood size mismatch");
+    }
+
+    virtual int radius() const { return N::radius; }
+
+    //! Recomputes the neighbour offsets when the lattice strides change
+    virtual void begin_step(const ca_step_context& c)
+    {
+        if(stride_y == ptrdiff_t(c.stride_y) && stride_z == ptrdiff_t(c.stride_z)) return;
+
+        stride_y = c.stride_y;
+        stride_z = c.stride_z;
+        lattice_offsets.clear();
+        for(size_t i=0; i<deltas.size(); i++)
+            lattice_offsets.push_back(deltas[i].x + deltas[i].y*stride_y + deltas[i].z*stride_z);
+    }
+
+    virtual void process_tile(const ca_step_context& c, const ca_tile& t, ca_rng& rng)
+    {
+        tgtAssert(N::radius == 0 || c.src != c.dst, "Stencil rules need a double-buffered lattice");
+        tgtAssert(stride_y == ptrdiff_t(c.stride_y) && stride_z == ptrdiff_t(c.stride_z),
+                  "ca_stencil_rule::begin_step was not called");
+
+        const int r = N::radius;
+        const tgt::ivec3 lo(r, r, r);
+        const tgt::ivec3 hi = c.size - lo;
+
+        for(int k=t.begin.z; k<t.end.z; k++)
+            for(int j=t.begin.y; j<t.end.y; j++)
+            {
+                uint16_t* out = c.dst + c.index(0, j, k);
+                if(j < lo.y || j >= hi.y || k < lo.z || k >= hi.z)
+                {
+                    boundary_span(c, out, t.begin.x, t.end.x, j, k, rng);
+                    continue;
+                }
+
+                int x0 = std::min(std::max(t.begin.x, lo.x), t.end.x);
+                int x1 = std::max(std::min(t.end.x, hi.x), x0);
+                boundary_span(c, out, t.begin.x, x0, j, k, rng);
+                interior_span(c, out, x0, x1, j, k, rng);
+                boundary_span(c, out, x1, t.end.x, j, k, rng);
+            }
+    }
+
+private:
+    //! Fast path: every neighbour is inside the lattice
+    void interior_span(const ca_step_context& c, uint16_t* out, int x0, int x1, int j, int k, ca_rng& rng)
+    {
+        Derived& rule = static_cast<Derived&>(*this);
+        neighbors n;
+        n.offsets = &lattice_offsets[0];
+        n.stride_y = stride_y;
+        n.stride_z = stride_z;
+        n.position = tgt::ivec3(x0, j, k);
+        n.ptr = c.src + c.index(x0, j, k);
+        for(int i=x0; i<x1; i++, n.ptr++, n.position.x++)
+            out[i] = rule.update(n, rng);
+    }
+
+    //! Slow path: gather the neighbourhood through the boundary policy first
+    void boundary_span(const ca_step_context& c, uint16_t* out, int x0, int x1, int j, int k, ca_rng& rng)
+    {
+        const int r = N::radius;
+        const int w = 2*r + 1;
+        uint16_t cube[(2*N::radius+1) * (2*N::radius+1) * (2*N::radius+1)];
+        uint16_t* center = cube + r + r*w + r*w*w;
+
+        // Cells of the cube outside the neighbourhood (the corners of a von
+        // Neumann one) are never gathered, keep at() from reading garbage
+        if(N::size != w*w*w) std::fill(cube, cube + w*w*w, uint16_t(0));
+
+        Derived& rule = static_cast<Derived&>(*this);
+        neighbors n;
+        n.offsets = &gather_offsets[0];
+        n.stride_y = w;
+        n.stride_z = w*w;
+        n.ptr = center;
+        for(int i=x0; i<x1; i++)
+        {
+            for(size_t d=0; d<deltas.size(); d++)
+                center[gather_offsets[d]] = Boundary::fetch(c, i + deltas[d].x, j + deltas[d].y, k + deltas[d].z);
+            n.position = tgt::ivec3(i, j, k);
+            out[i] = rule.update(n, rng);
+        }
+    }
+
+    std::vector<tgt::ivec3> deltas;
+    std::vector<ptrdiff_t> gather_offsets;
+    std::vector<ptrdiff_t> lattice_offsets;
+    ptrdiff_t stride_y;
+    ptrdiff_t stride_z;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "worker_pool.hpp"
+
+#include <stdexcept>
+#include <exception>
+
+#include <boost/bind/bind.hpp>
+
+using namespace std;
+
+worker_pool::worker_pool(uint num_threads)
+    : num_workers(num_threads)
+    , job(0)
+    , generation(0)
+    , busy_workers(0)
+    , shutting_down(false)
+{
+    if(!num_workers) num_workers = boost::thread::hardware_concurrency();
+    if(!num_workers) num_workers = 1;
+
+    for(uint i=0; i<num_workers; i++)
+        queues.push_back(new task_queue());
+
+    // Worker 0 is the thread calling run()
+    for(uint i=1; i<num_workers; i++)
+        threads.create_thread(boost::bind(&worker_pool::worker_main, this, i));
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        boost::mutex::scoped_lock lock(control_mutex);
+        shutting_down = true;
+    }
+    cond_start.notify_all();
+    threads.join_all();
+
+    for(size_t i=0; i<queues.size(); i++) delete queues[i];
+}
+
+void worker_pool::run(size_t num_tasks, const task_function& f)
+{
+    if(!num_tasks) return;
+
+    // Hand out contiguous chunks so that neighbouring tasks stay together
+    for(uint i=0; i<num_workers; i++)
+    {
+        boost::mutex::scoped_lock lock(queues[i]->mutex);
+        queues[i]->begin = (num_tasks * i) / num_workers;
+        queues[i]->end = (num_tasks * (i+1)) / num_workers;
+    }
+
+    if(num_workers == 1)
+    {
+        job = &f;
+        execute(0);
+        job = 0;
+    }
+    else
+    {
+        {
+            boost::mutex::scoped_lock lock(control_mutex);
+            job = &f;
+            job_error.clear();
+            busy_workers = num_workers;
+            generation++;
+        }
+        cond_start.notify_all();
+
+        execute(0);
+
+        boost::mutex::scoped_lock lock(control_mutex);
+        busy_workers--;
+        while(busy_workers) cond_done.wait(lock);
+        job = 0;
+    }
+
+    if(!job_error.empty())
+    {
+        string error;
+        error.swap(job_error);
+        throw runtime_error(error);
+    }
+}
+
+void worker_pool::worker_main(uint id)
+{
+    uint64_t seen_generation = 0;
+    while(true)
+    {
+        {
+            boost::mutex::scoped_lock lock(control_mutex);
+            while(!shutting_down && generation == seen_generation) cond_start.wait(lock);
+            if(shutting_down) return;
+            seen_generation = generation;
+        }
+
+        execute(id);
+
+        boost::mutex::scoped_lock lock(control_mutex);
+        if(--busy_workers == 0) cond_done.notify_all();
+    }
+}
+
+//! Drain the local queue, then keep stealing until every queue is empty
+void worker_pool::execute(uint id)
+{
+    size_t task;
+    do
+    {
+        while(pop_local(id, task))
+        {
+            try
+            {
+                (*job)(task, id);
+            }
+            catch(exception& e)
+            {
+                boost::mutex::scoped_lock lock(control_mutex);
+                if(job_error.empty()) job_error = e.what();
+            }
+        }
+    }
+    while(steal(id));
+}
+
+bool worker_pool::pop_local(uint id, size_t& task)
+{
+    task_queue& q = *queues[id];
+    boost::mutex::scoped_lock lock(q.mutex);
+    if(q.begin >= q.end) return false;
+    task = q.begin++;
+    return true;
+}
+
+//! Move the upper half of the fullest queue into the thief's queue
+bool worker_pool::steal(uint thief)
+{
+    while(true)
+    {
+        uint victim = thief;
+        size_t most = 0;
+        for(uint i=0; i<num_workers; i++)
+        {
+            if(i == thief) continue;
+            size_t remaining;
+            {
+                boost::mutex::scoped_lock lock(queues[i]->mutex);
+                remaining = queues[i]->end > queues[i]->begin ? queues[i]->end - queues[i]->begin : 0;
+            }
+            if(remaining > most)
+            {
+                most = remaining;
+                victim = i;
+            }
+        }
+        if(victim == thief) return false;
+
+        size_t begin, end;
+        {
+            // The victim may have drained its queue since it was inspected
+            boost::mutex::scoped_lock lock(queues[victim]->mutex);
+            if(queues[victim]->begin >= queues[victim]->end) continue;
+            end = queues[victim]->end;
+            begin = queues[victim]->begin + (end - queues[victim]->begin) / 2;
+            queues[victim]->end = begin;
+        }
+
+        boost::mutex::scoped_lock lock(queues[thief]->mutex);
+        queues[thief]->begin = begin;
+        queues[thief]->end = end;
+        return true;
+    }
+}
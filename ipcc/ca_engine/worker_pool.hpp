@@ -0,0 +1,74 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <vector>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "tgt/types.h"
+
+//!
+//! Persistent pool of worker threads with per-worker task queues and
+//! work-stealing.
+//!
+//! A job is a range of task indices [0, num_tasks). Each worker starts with a
+//! contiguous chunk of the range (so neighbouring tiles stay on the same core)
+//! and, once its own chunk is exhausted, steals half of the remaining chunk of
+//! the most loaded worker. The calling thread takes part as worker 0, so a pool
+//! of size 1 runs everything inline without any synchronization.
+class worker_pool : private boost::noncopyable
+{
+public:
+    //! Task callback: (task index, worker index)
+    typedef boost::function<void (size_t, uint)> task_function;
+
+    //! Create a pool with num_threads workers (0 means one per hardware thread)
+    explicit worker_pool(uint num_threads = 0);
+
+    //! Joins all worker threads
+    ~worker_pool();
+
+    //! Number of workers, including the calling thread
+    uint size() const { return num_workers; }
+
+    //! Run f for every task in [0, num_tasks) and block until all are done.
+    //! Throws std::runtime_error if any task threw.
+    void run(size_t num_tasks, const task_function& f);
+
+private:
+    //! Range of task indices still owned by a worker
+    struct task_queue
+    {
+        boost::mutex mutex;
+        size_t begin;
+        size_t end;
+
+        task_queue() : begin(0), end(0) {}
+    };
+
+    void worker_main(uint id);
+    void execute(uint id);
+    bool pop_local(uint id, size_t& task);
+    bool steal(uint thief);
+
+    uint num_workers;
+    std::vector<task_queue*> queues;
+    boost::thread_group threads;
+
+    //! Job control, protected by control_mutex
+    boost::mutex control_mutex;
+    boost::condition_variable cond_start;
+    boost::condition_variable cond_done;
+    const task_function* job;
+    uint64_t generation;
+    uint busy_workers;
+    bool shutting_down;
+    std::string job_error;
+};
+
+#endif
@@ -1,20 +1,21 @@
 #include "ipc_volume.hpp"
+#include "ca_engine/ca_engine.hpp"
 #include "ca_algorithms/basic.hpp"
+#include "seed_loader.hpp"
+#include "snapshot.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <csignal>
 #include <ctime>
-#include <fstream>
 #include <cstdlib>
 #include <cstring>
-#include <libgen.h>
 #ifdef _FORK_IPVR
 #include <unistd.h>
 #endif
 
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
-#include <boost/algorithm/string.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "voreen/core/datastructures/volume/volumeatomic.h"
 
@@ -23,17 +24,22 @@ using namespace boost::interprocess;
 using namespace tgt;
 using namespace voreen;
 
-typedef offset_ptr<uint16_t> offset_uint16_ptr;
-
 //! Globals
 //!
-char* memblock = 0;
+seed_volume* seed = 0;
+snapshot_writer* snapshots = 0;
+//! Set by the signal handler, the loops in main exit on it
+volatile sig_atomic_t exit_requested = 0;
 
 //! Clean up global stuff
 //!
 void cleanup()
 {
-    if(memblock) free(memblock);
+    delete seed;
+    seed = 0;
+    // Flushes the snapshots still queued
+    delete snapshots;
+    snapshots = 0;
 }
 
 //! Exit with a message
@@ -47,62 +53,193 @@ void exit_message(const string msg)
 
 //! Catch signals for exiting program
 //!
-void signal_exit_program(const int sig)
+void signal_exit_program(const int)
 {
-    printf("Catched signal: %d ... !!\n", sig);
+    // Only flag the request: cleanup() joins the snapshot thread, which is
+    // not safe inside a signal handler
+    exit_requested = 1;
     // redirect the SIGINT signal to default handling
     (void) signal(SIGINT, SIG_DFL);
-    cleanup();
-    exit(0);
 }
 
-//! Calculate next step of the 3d CA (double-buffered version)
+//! Take a frame of the ring for writing, waiting while the viewer leases
+//! every spare one. Returns IPC_VOLUME_NO_FRAME when asked to exit.
 //!
-void ca_step_double_buffer( const uint size_x
-                            , const uint size_y
-                            , const uint size_z
-                            , VolumeUInt16* v1
-                            , VolumeUInt16* v2
-                            , void (*f)(uint, uint, uint, VolumeUInt16*, VolumeUInt16*) )
+uint32_t acquire_frame(ipc_volume_info* volumeinfo)
 {
-    f(size_x, size_y, size_z, v1, v2);
+    uint32_t next;
+    while((next = volumeinfo->begin_write()) == IPC_VOLUME_NO_FRAME && !exit_requested)
+        boost::this_thread::yield();
+    return next;
 }
 
-//! Swap buffers in IPC shared memory
-//
-void ca_step_swap_buffers(offset_uint16_ptr &p_current, offset_uint16_ptr p1, offset_uint16_ptr p2)
+//! Calculate next step of the 3d CA
+//! Reads the current state from front and writes the next one into back
+//!
+void ca_step_double_buffer( ca_engine& engine
+                            , const VolumeUInt16* front
+                            , VolumeUInt16* back
+                            , ca_rule& rule )
+{
+    engine.step(front->voxel(), back->voxel(), rule);
+}
+
+//! Stamp the bricks changed by the last step in the shared header, so the
+//! viewer only takes those regions
+//!
+void mark_dirty_regions( const ca_engine& engine
+                         , ipc_volume_info* volumeinfo
+                         , uint32_t step )
 {
-    if(p_current == p1)
+    if(!engine.get_options().track_changes && !engine.get_options().sparse)
     {
-        p_current = p2;
+        volumeinfo->mark_dirty(ivec3(0), engine.size(), step);
         return;
     }
-    else if (p_current == p2)
+
+    const vector<ca_tile>& tiles = engine.tiles();
+    const vector<uint8_t>& changed = engine.changed_tiles();
+    for(size_t i=0; i<tiles.size(); i++)
+        if(changed[i]) volumeinfo->mark_dirty(tiles[i].begin, tiles[i].end, step);
+}
+
+//! Publish the frames of a step log as fast as the ring allows
+//!
+void replay_step_log( step_log_reader& log
+                      , ipc_volume_info* volumeinfo )
+{
+    vector<uint16_t> lattice(volumeinfo->num_voxels());
+    ivec3 size(volumeinfo->size_x, volumeinfo->size_y, volumeinfo->size_z);
+    uint64_t step = 0;
+    while(!exit_requested && log.next(step, &lattice[0]))
     {
-        p_current = p1;
-        return;
+        uint32_t next = acquire_frame(volumeinfo);
+        if(next == IPC_VOLUME_NO_FRAME) break;
+        memcpy(volumeinfo->frames[next].data.get(), &lattice[0], lattice.size() * sizeof(uint16_t));
+        volumeinfo->mark_dirty(ivec3(0), size, uint32_t(step));
+        volumeinfo->publish(next, uint32_t(step));
     }
-    else cout << "Warning: problem swapping buffers!" << endl;
+    cout << "Step log replayed up to step " << step << endl;
 }
 
-
-//! Calculate next step of the 3d CA (single-buffered version)
+//! Print command line usage
 //!
-void ca_step_single_buffer( uint size_x
-                            , uint size_y
-                            , uint size_z
-                            , VolumeUInt16* v
-                            , void (*f)(uint, uint, uint, VolumeUInt16*, VolumeUInt16*) )
+void usage(const char* program)
 {
-    f(size_x, size_y, size_z, v, NULL);
+    cout << "Usage: " << program << " [options] [seed.dat|seed.pvm|seed.3b]" << endl
+         << "  --threads N      number of worker threads (default: all cores)" << endl
+         << "  --slabs          tile the lattice in z-slabs instead of 3D bricks" << endl
+         << "  --brick X Y Z    brick dimensions (default: 32 32 16)" << endl
+         << "  --deterministic  same results for any number of threads" << endl
+         << "  --sparse         skip tiles whose neighbourhood did not change" << endl
+         << "  --no-delta       do not track changed regions, the viewer takes whole frames" << endl
+         << "  --seed N         random seed (default: current time)" << endl
+         << "  --snapshot-dir D directory for checkpoints and the step log (default: .)" << endl
+         << "  --checkpoint-every N  write a checkpoint every N steps" << endl
+         << "  --keep-checkpoints N  checkpoints kept on disk (default: 2)" << endl
+         << "  --log-every N    append every Nth frame to the step log" << endl
+         << "  --log-deltas     log every step as a delta against the previous one" << endl
+         << "  --restore FILE   continue the run saved in a checkpoint" << endl
+         << "  --replay FILE    publish the frames of a step log instead of simulating" << endl;
 }
 
 int main(int argc, char** argv)
 {
     // SIGINT callback
     (void) signal(SIGINT, signal_exit_program);
-    // Random seed
-    srand ( time(NULL) );
+    // Engine options
+    ca_engine::options engine_options;
+    engine_options.seed = time(NULL);
+    engine_options.track_changes = true;
+    char* dat_file = 0;
+    // Snapshot options
+    snapshot_writer::options snapshot_options;
+    char* restore_file = 0;
+    char* replay_file = 0;
+    for(int a=1; a<argc; a++)
+    {
+        string arg = argv[a];
+        if(arg == "--threads" && a+1 < argc)
+        {
+            engine_options.num_threads = atoi(argv[++a]);
+        }
+        else if(arg == "--slabs")
+        {
+            engine_options.tiling = ca_engine::z_slabs;
+        }
+        else if(arg == "--brick" && a+3 < argc)
+        {
+            engine_options.brick_size.x = atoi(argv[++a]);
+            engine_options.brick_size.y = atoi(argv[++a]);
+            engine_options.brick_size.z = atoi(argv[++a]);
+        }
+        else if(arg == "--deterministic")
+        {
+            engine_options.deterministic = true;
+        }
+        else if(arg == "--sparse")
+        {
+            engine_options.sparse = true;
+        }
+        else if(arg == "--no-delta")
+        {
+            engine_options.track_changes = false;
+        }
+        else if(arg == "--seed" && a+1 < argc)
+        {
+            engine_options.seed = strtoull(argv[++a], 0, 10);
+        }
+        else if(arg == "--snapshot-dir" && a+1 < argc)
+        {
+            snapshot_options.directory = argv[++a];
+        }
+        else if(arg == "--checkpoint-every" && a+1 < argc)
+        {
+            snapshot_options.checkpoint_interval = atoi(argv[++a]);
+        }
+        else if(arg == "--keep-checkpoints" && a+1 < argc)
+        {
+            snapshot_options.checkpoints_kept = atoi(argv[++a]);
+        }
+        else if(arg == "--log-every" && a+1 < argc)
+        {
+            snapshot_options.log_interval = atoi(argv[++a]);
+        }
+        else if(arg == "--log-deltas")
+        {
+            snapshot_options.log_deltas = true;
+            snapshot_options.log_interval = 1;
+        }
+        else if(arg == "--restore" && a+1 < argc)
+        {
+            restore_file = argv[++a];
+        }
+        else if(arg == "--replay" && a+1 < argc)
+        {
+            replay_file = argv[++a];
+        }
+        else if(arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if(arg[0] != '-' && !dat_file)
+        {
+            dat_file = argv[a];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(dat_file && restore_file)
+    {
+        cerr << "A seed volume and --restore cannot be combined" << endl;
+        usage(argv[0]);
+        return 1;
+    }
 
 #ifdef _FORK_IPVR
     pid_t pID = fork();
@@ -117,76 +254,38 @@ int main(int argc, char** argv)
     }
 #endif
 
-    // Load a seed .dat volume if given an argument
-    string raw_file;
-    uint file_size_x;
-    uint file_size_y;
-    uint file_size_z;
-    uint byte_depth;
-    if(argc > 1)
+    // Open the seed volume if given an argument, its voxels are decoded
+    // straight into the first frame
+    if(dat_file)
     {
-        ifstream datfile (argv[1]);
-
-        string line;
-        if(datfile.is_open())
+        try
         {
-            while(datfile.good())
-            {
-                getline(datfile,line);
-
-                string object_file_name_string = "ObjectFileName:";
-                string resolution_string = "Resolution:";
-                string format_string = "Format:";
-                if( line.find(object_file_name_string) != string::npos )
-                {
-                    line.erase(0,object_file_name_string.size());
-                    boost::trim(line);
-                    raw_file = dirname(argv[1]) + string("/") + line;
-                }
-                else if( line.find(resolution_string) != string::npos )
-                {
-                    line.erase(0,resolution_string.size());
-                    vector<string> split_vec;
-                    boost::trim(line);
-                    boost::split( split_vec, line, boost::is_any_of(" ") );
-                    if(split_vec.size()!=3) exit_message("Error: dat file has wrong number of size parameters");
-
-                    if( !(stringstream(split_vec[0]) >> file_size_x) ) exit_message("Error parsing x size parameters");
-                    if( !(stringstream(split_vec[0]) >> file_size_y) ) exit_message("Error parsing y size parameters");
-                    if( !(stringstream(split_vec[0]) >> file_size_z) ) exit_message("Error parsing z size parameters");
-                }
-                else if( line.find(format_string) != string::npos )
-                {
-                    line.erase(0,format_string.size());
-                    if( line.find("UCHAR") != string::npos )
-                    {
-                        byte_depth = 1;
-                    }
-                    else if( line.find("USHORT") != string::npos )
-                    {
-                        byte_depth = 2;
-                    }
-                    else exit_message("Error: unknown bit depth specified in .dat file");
-                }
-            }
-            datfile.close();
-
-            if(!raw_file.size()) exit_message("Error: dat file missing some basic information");
-
-            size_t file_size;
-            ifstream file (raw_file.c_str(), ios::in|ios::binary|ios::ate);
-            if (file.is_open())
-            {
-                file_size = file.tellg();
-                memblock = new char [file_size];
-                file.seekg (0, ios::beg);
-                file.read (memblock, file_size);
-                file.close();
+            seed = new seed_volume(dat_file);
+        }
+        catch(exception& e)
+        {
+            exit_message(e.what());
+        }
+        ivec3 seed_size = seed->size();
+        cout << "Seed volume: " << seed_size.x << " x " << seed_size.y << " x " << seed_size.z << endl;
+    }
 
-                cout << "The file has " << file_size << " bytes" << endl;
-            }
-            else exit_message("Unable to open raw file");
+    // A checkpoint takes the place of the seed and carries the random seed
+    // of its run
+    ca_checkpoint checkpoint;
+    checkpoint.step = 0;
+    if(restore_file)
+    {
+        try
+        {
+            read_checkpoint(restore_file, checkpoint);
         }
+        catch(exception& e)
+        {
+            exit_message(e.what());
+        }
+        engine_options.seed = checkpoint.seed;
+        cout << "Restoring step " << checkpoint.step << " from " << restore_file << endl;
     }
 
     // Enter shared segment
@@ -203,113 +302,145 @@ int main(int argc, char** argv)
         uint size_y = volumeinfo->size_y;
         uint size_z = volumeinfo->size_z;
 
-        if( memblock
-            && (size_x != file_size_x
-                || size_y != file_size_y
-                || size_z != file_size_z) )
+        if( seed
+            && (size_x != uint(seed->size().x)
+                || size_y != uint(seed->size().y)
+                || size_z != uint(seed->size().z)) )
         {
             cerr << "Host shared volume sizes doesn't match the loaded volume sizes" << endl;
             cerr << "Host offers: "
                  << size_x << " (x), " << size_y << " (y), " << size_z << " (z) " << endl;
             cerr << "Loaded file needs: "
-                 << file_size_x << " (x), " << file_size_y << " (y), " << file_size_z << " (z) " << endl;
+                 << seed->size().x << " (x), " << seed->size().y << " (y), " << seed->size().z << " (z) " << endl;
             exit(1);
         }
 
-        pair<uint16_t*,size_t> full_stream_shared = segment.find<uint16_t>(unique_instance);
-
-        if(volumeinfo->double_buffer)
+        if( restore_file
+            && checkpoint.size != ivec3(size_x, size_y, size_z) )
         {
-            cout << "Executing Double buffer version" << endl;
+            exit_message("Host shared volume sizes doesn't match the checkpoint sizes");
+        }
+
+        uint num_frames = volumeinfo->num_frames;
+        cout << "Executing frame ring version (" << num_frames << " frames)" << endl;
 #ifdef _DEBUG
-            assert(full_stream_shared.second == size_x*size_y*size_z*2);
+        pair<uint16_t*,size_t> full_stream_shared = segment.find<uint16_t>(unique_instance);
+        assert(full_stream_shared.second == size_x*size_y*size_z*num_frames);
 #endif
 
-            uint16_t* stream_pos1 = full_stream_shared.first;
-            uint16_t* stream_pos2 = stream_pos1 + (size_x*size_y*size_z);
-
-            VolumeUInt16* vol1 = new VolumeUInt16( stream_pos1
-                                                   ,ivec3(size_x
-                                                   ,size_y
-                                                   ,size_z) );
-            VolumeUInt16* vol2 = new VolumeUInt16( stream_pos2
-                                                   ,ivec3(size_x
-                                                   ,size_y
-                                                   ,size_z) );
-            volumeinfo->offset_ptr = stream_pos1;
-            offset_uint16_ptr offset_pos1 = stream_pos1;
-            offset_uint16_ptr offset_pos2 = stream_pos2;
-
-            // Copy data of opened volume
-            if(memblock)
+        // Wrap every frame of the ring
+        vector<VolumeUInt16*> frames;
+        for(uint f=0; f<num_frames; f++)
+            frames.push_back(new VolumeUInt16( volumeinfo->frames[f].data.get()
+                                               ,ivec3(size_x
+                                                      ,size_y
+                                                      ,size_z) ));
+
+        // Dirty bricks of a previous simulator run are meaningless now
+        volumeinfo->attach_writer();
+
+        if(replay_file)
+        {
+            try
             {
-                for(int k=0; k<size_z; k++)
-                    for(int j=0; j<size_y; j++)
-                        for(int i=0; i<size_x; i++)
-                        {
-                            vol1->voxel(i,j,k) = *memblock;
-                            memblock += byte_depth;
-                        }
+                step_log_reader log(replay_file);
+                if(log.size() != ivec3(size_x, size_y, size_z))
+                    exit_message("Host shared volume sizes doesn't match the step log sizes");
+                replay_step_log(log, volumeinfo);
             }
-
-            while(true)
+            catch(exception& e)
             {
-                scoped_lock<interprocess_mutex> lock(volumeinfo->mutex);
-                if(volumeinfo->fresh_data)
-                {
-                    volumeinfo->cond_processing_visuals.wait(lock);
-                }
-
-                ca_step_double_buffer(size_x, size_y, size_z, vol1, vol2, basic_algorithm);
-                ca_step_swap_buffers(volumeinfo->offset_ptr, offset_pos1, offset_pos2);
-                
-                // notify the client that the CA processing is finished
-                volumeinfo->fresh_data = true;
-                // mutex is released here
+                exit_message(e.what());
             }
+            cleanup();
+            return 0;
         }
-        else
-        {
-            cout << "Executing Single buffer version" << endl;
-#ifdef _DEBUG
-            assert(full_stream_shared.second == size_x*size_y*size_z);
-#endif
-
-            uint16_t* stream_pos = full_stream_shared.first;
 
-            VolumeUInt16* vol = new VolumeUInt16( stream_pos
-                                                  ,ivec3(size_x
-                                                         ,size_y
-                                                         ,size_z) );
-            volumeinfo->offset_ptr = stream_pos;
+        // The seed, checkpoint (or an empty lattice) is the first published frame
+        uint32_t step = checkpoint.step;
+        uint32_t current = acquire_frame(volumeinfo);
+        if(current == IPC_VOLUME_NO_FRAME)
+        {
+            cleanup();
+            return 0;
+        }
+        if(seed)
+        {
+            seed->copy_to(frames[current]->voxel());
+            delete seed;
+            seed = 0;
+        }
+        else if(restore_file)
+        {
+            memcpy(frames[current]->voxel(), &checkpoint.lattice[0], checkpoint.lattice.size() * sizeof(uint16_t));
+            vector<uint16_t>().swap(checkpoint.lattice);
+        }
+        volumeinfo->publish(current, step);
 
-            // Copy data of opened volume
-            if(memblock)
+        ca_engine engine(ivec3(size_x, size_y, size_z), engine_options);
+        basic_algorithm algorithm;
+        if(restore_file)
+        {
+            istringstream state(checkpoint.rule_state);
+            try
             {
-                for(int k=0; k<size_z; k++)
-                    for(int j=0; j<size_y; j++)
-                        for(int i=0; i<size_x; i++)
-                        {
-                            vol->voxel(i,j,k) = *memblock;
-                            memblock += byte_depth;
-                        }
+                algorithm.load_state(state);
             }
+            catch(exception& e)
+            {
+                exit_message(e.what());
+            }
+            engine.restart_at(step);
+        }
 
-            while(true)
+        if(snapshot_options.checkpoint_interval || snapshot_options.log_interval)
+        {
+            try
+            {
+                snapshots = new snapshot_writer(ivec3(size_x, size_y, size_z), engine_options.seed, snapshot_options);
+            }
+            catch(exception& e)
             {
-                scoped_lock<interprocess_mutex> lock(volumeinfo->mutex);
-                if(volumeinfo->fresh_data)
-                {
-                    volumeinfo->cond_processing_visuals.wait(lock);
-                }
+                exit_message(e.what());
+            }
+        }
+        cout << "CA engine: " << engine.num_threads() << " threads, "
+             << engine.tiles().size() << " tiles"
+             << (engine_options.deterministic ? " (deterministic)" : "") << endl;
 
-                ca_step_single_buffer(size_x, size_y, size_z, vol, basic_algorithm);
+        // The simulator never waits for the viewer: each step overwrites the
+        // oldest frame and publishes it as the latest one
+        while(!exit_requested)
+        {
+            uint32_t next = acquire_frame(volumeinfo);
+            if(next == IPC_VOLUME_NO_FRAME) break;
+            ca_step_double_buffer(engine, frames[current], frames[next], algorithm);
+            mark_dirty_regions(engine, volumeinfo, ++step);
+            volumeinfo->publish(next, step);
+            current = next;
+
+            // Snapshots only copy the frame here, writing happens elsewhere
+            if(snapshots && snapshots->wants(step))
+            {
+                ostringstream state;
+                algorithm.save_state(state);
+                snapshots->submit(step, frames[current]->voxel(), state.str());
+            }
 
-                // notify the client that the CA processing is finished
-                volumeinfo->fresh_data = true;
-                // mutex is released here
+            if(step % 100 == 0)
+            {
+                cout << "Frames: " << ipc_volume_info::read(&volumeinfo->frames_published) << " published, "
+                     << ipc_volume_info::read(&volumeinfo->frames_consumed) << " shown, "
+                     << ipc_volume_info::read(&volumeinfo->frames_dropped) << " dropped, "
+                     << ipc_volume_info::read(&volumeinfo->frames_torn) << " torn"
+                     << (snapshots ? ", " : "");
+                if(snapshots) cout << snapshots->dropped() << " snapshots dropped";
+                cout << endl;
+                cout << "Display latency: p50 < " << volumeinfo->latency_percentile(0.5) << " us, "
+                     << "p99 < " << volumeinfo->latency_percentile(0.99) << " us" << endl;
             }
         }
+        cout << "Stopped at step " << step << endl;
     }
     catch(interprocess_exception &e)
     {
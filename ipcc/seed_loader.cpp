@@ -0,0 +1,222 @@
+#include "seed_loader.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/datastructures/volume/volumecollection.h"
+#include "voreen/core/datastructures/volume/volumehandle.h"
+#include "voreen/core/io/datvolumereader.h"
+#ifdef VRN_MODULE_COAT
+#include "voreen/modules/coat/coatvolumereader.h"
+#endif
+#ifdef VRN_MODULE_PVM
+#include "voreen/modules/pvm/pvmvolumereader.h"
+#endif
+
+using namespace std;
+using namespace tgt;
+using namespace boost::interprocess;
+
+//! Number of voxels, without overflowing int for large volumes
+static size_t num_voxels(const ivec3& dimensions)
+{
+    return size_t(dimensions.x) * size_t(dimensions.y) * size_t(dimensions.z);
+}
+
+void widen_voxels(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for(; i<n; i++) dst[i] = src[i];
+}
+
+void copy_voxels(const uint16_t* src, uint16_t* dst, size_t n, bool swap_bytes)
+{
+    if(!swap_bytes)
+    {
+        memcpy(dst, src, n * sizeof(uint16_t));
+        return;
+    }
+
+    size_t i = 0;
+#ifdef __SSE2__
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#endif
+    for(; i<n; i++) dst[i] = uint16_t((src[i] << 8) | (src[i] >> 8));
+}
+
+seed_volume::seed_volume(const string& file_name)
+    : dimensions(0)
+    , bytes_per_voxel(0)
+    , swap_bytes(false)
+{
+    string extension = file_name.substr(file_name.find_last_of('.') + 1);
+    boost::to_lower(extension);
+
+    if(extension != "dat" || !open_dat(file_name)) open_voreen(file_name);
+}
+
+seed_volume::~seed_volume()
+{
+}
+
+//! Parse a .dat header and map its raw file. Returns false for formats the
+//! Voreen reader has to handle.
+bool seed_volume::open_dat(const string& file_name)
+{
+    ifstream dat(file_name.c_str());
+    if(!dat.is_open()) throw runtime_error("Unable to open " + file_name);
+
+    string raw_file;
+    string format;
+    string byte_order;
+    string line;
+    while(getline(dat, line))
+    {
+        istringstream args(line);
+        string key;
+        args >> key;
+        if(key == "ObjectFileName:")
+        {
+            getline(args, raw_file);
+            boost::trim(raw_file);
+        }
+        else if(key == "Resolution:")
+        {
+            if(!(args >> dimensions.x >> dimensions.y >> dimensions.z))
+                throw runtime_error("Error parsing the resolution of " + file_name);
+        }
+        else if(key == "Format:")
+        {
+            args >> format;
+        }
+        else if(key == "ByteOrder:")
+        {
+            args >> byte_order;
+        }
+    }
+
+    if(raw_file.empty() || dimensions.x <= 0 || dimensions.y <= 0 || dimensions.z <= 0)
+        throw runtime_error("Error: dat file missing some basic information");
+
+    if(format == "UCHAR") bytes_per_voxel = 1;
+    else if(format == "USHORT") bytes_per_voxel = 2;
+    else return false;
+
+    // The raw file is relative to the .dat file
+    size_t slash = file_name.find_last_of('/');
+    if(raw_file[0] != '/' && slash != string::npos) raw_file = file_name.substr(0, slash + 1) + raw_file;
+
+    bool big_endian_data = boost::istarts_with(byte_order, "big");
+    uint16_t probe = 1;
+    bool big_endian_host = *reinterpret_cast<uint8_t*>(&probe) == 0;
+    swap_bytes = bytes_per_voxel == 2 && big_endian_data != big_endian_host;
+
+    try
+    {
+        file.reset(new file_mapping(raw_file.c_str(), read_only));
+        region.reset(new mapped_region(*file, read_only));
+    }
+    catch(interprocess_exception& e)
+    {
+        throw runtime_error("Unable to map raw file " + raw_file + ": " + e.what());
+    }
+
+    if(region->get_size() < num_voxels(dimensions) * bytes_per_voxel)
+        throw runtime_error("Raw file " + raw_file + " is smaller than its resolution says");
+
+    // The data is read front to back exactly once
+    region->advise(mapped_region::advice_sequential);
+    return true;
+}
+
+void seed_volume::open_voreen(const string& file_name)
+{
+    string extension = file_name.substr(file_name.find_last_of('.') + 1);
+    boost::to_lower(extension);
+
+    boost::scoped_ptr<voreen::VolumeReader> reader;
+    if(extension == "dat") reader.reset(new voreen::DatVolumeReader());
+#ifdef VRN_MODULE_COAT
+    else if(extension == "3b") reader.reset(new voreen::CoatVolumeReader());
+#endif
+#ifdef VRN_MODULE_PVM
+    else if(extension == "pvm") reader.reset(new voreen::PVMVolumeReader(0));
+#endif
+    else throw runtime_error("No reader for seed volume " + file_name);
+
+    voreen::VolumeCollection* collection = 0;
+    try
+    {
+        collection = reader->read(file_name);
+    }
+    catch(tgt::FileException& e)
+    {
+        throw runtime_error(string("Unable to read ") + file_name + ": " + e.what());
+    }
+    if(!collection || collection->empty())
+    {
+        delete collection;
+        throw runtime_error("No volume in " + file_name);
+    }
+
+    // Keep the first volume, drop everything else the reader created
+    vector<voreen::VolumeHandle*> handles;
+    for(size_t i=0; i<collection->size(); i++) handles.push_back(collection->at(i));
+    delete collection;
+
+    // Owned from here on, so it is freed if the checks below throw
+    volume.reset(handles[0]->getVolume());
+    handles[0]->releaseVolumes();
+    for(size_t i=0; i<handles.size(); i++) delete handles[i];
+
+    if(!dynamic_cast<voreen::VolumeUInt8*>(volume.get()) && !dynamic_cast<voreen::VolumeUInt16*>(volume.get()))
+        throw runtime_error("Seed volume " + file_name + " must hold 8 or 16-bit unsigned voxels");
+
+    dimensions = volume->getDimensions();
+}
+
+void seed_volume::copy_to(uint16_t* lattice) const
+{
+    size_t n = num_voxels(dimensions);
+
+    if(voreen::VolumeUInt8* v = dynamic_cast<voreen::VolumeUInt8*>(volume.get()))
+    {
+        widen_voxels(v->voxel(), lattice, n);
+        return;
+    }
+    if(voreen::VolumeUInt16* v = dynamic_cast<voreen::VolumeUInt16*>(volume.get()))
+    {
+        copy_voxels(v->voxel(), lattice, n, false);
+        return;
+    }
+
+    // Mapped raw data: pages stream in once, straight into the lattice
+    const void* raw = region->get_address();
+    if(bytes_per_voxel == 1)
+        widen_voxels(static_cast<const uint8_t*>(raw), lattice, n);
+    else
+        copy_voxels(static_cast<const uint16_t*>(raw), lattice, n, swap_bytes);
+}
@@ -0,0 +1,66 @@
+#ifndef SEED_LOADER_HPP
+#define SEED_LOADER_HPP
+
+#include <string>
+#include <boost/scoped_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "tgt/types.h"
+#include "tgt/vector.h"
+
+namespace voreen
+{
+    class Volume;
+}
+
+//!
+//! Seed volume the lattice starts from.
+//!
+//! .dat files with UCHAR or USHORT data are handled here: the header is
+//! parsed directly and the .raw file is memory-mapped and widened straight
+//! into the lattice, so the seed is never held in an intermediate buffer.
+//! Every other volume (.pvm, .3b, .dat with other formats) goes through the
+//! Voreen readers and must hold 8 or 16-bit unsigned voxels.
+//!
+//! Errors are reported as std::runtime_error.
+class seed_volume
+{
+public:
+    //! Open the seed and read its header; voxels are decoded by copy_to()
+    explicit seed_volume(const std::string& file_name);
+
+    ~seed_volume();
+
+    //! Resolution of the seed
+    const tgt::ivec3& size() const { return dimensions; }
+
+    //! Decode the seed into a lattice of size() cells
+    void copy_to(uint16_t* lattice) const;
+
+private:
+    bool open_dat(const std::string& file_name);
+    void open_voreen(const std::string& file_name);
+
+    tgt::ivec3 dimensions;
+
+    //! Memory-mapped raw data of the .dat path
+    boost::scoped_ptr<boost::interprocess::file_mapping> file;
+    boost::scoped_ptr<boost::interprocess::mapped_region> region;
+    size_t bytes_per_voxel;
+    bool swap_bytes;
+
+    //! Volume loaded by a Voreen reader
+    boost::scoped_ptr<voreen::Volume> volume;
+
+    seed_volume(const seed_volume&);
+    seed_volume& operator=(const seed_volume&);
+};
+
+//! Widen 8-bit voxels to the 16-bit lattice format
+void widen_voxels(const uint8_t* src, uint16_t* dst, size_t n);
+
+//! Copy 16-bit voxels, optionally swapping the byte order
+void copy_voxels(const uint16_t* src, uint16_t* dst, size_t n, bool swap_bytes);
+
+#endif
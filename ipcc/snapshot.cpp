@@ -0,0 +1,304 @@
+#include "snapshot.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <boost/bind/bind.hpp>
+
+using namespace std;
+using namespace tgt;
+
+//! Compress size bytes into out with the fastest zlib level
+static void compress_voxels(const uint16_t* data, size_t n, vector<unsigned char>& out)
+{
+    uLongf bytes = compressBound(n * sizeof(uint16_t));
+    out.resize(bytes);
+    if(compress2(&out[0], &bytes, reinterpret_cast<const Bytef*>(data), n * sizeof(uint16_t), Z_BEST_SPEED) != Z_OK)
+        throw runtime_error("zlib compression failed");
+    out.resize(bytes);
+}
+
+static void uncompress_voxels(const vector<unsigned char>& in, uint16_t* data, size_t n)
+{
+    uLongf bytes = n * sizeof(uint16_t);
+    if(uncompress(reinterpret_cast<Bytef*>(data), &bytes, &in[0], in.size()) != Z_OK
+       || bytes != n * sizeof(uint16_t))
+        throw runtime_error("Corrupt compressed lattice");
+}
+
+static string checkpoint_name(const string& directory, uint64_t step)
+{
+    ostringstream name;
+    name << directory << "/checkpoint_" << setw(12) << setfill('0') << step << ".cack";
+    return name.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// snapshot_writer
+
+snapshot_writer::snapshot_writer(const ivec3& size, uint64_t s, const options& o)
+    : lattice_size(size)
+    , num_voxels(size_t(size.x) * size.y * size.z)
+    , seed(s)
+    , opts(o)
+    , shutting_down(false)
+    , drop_count(0)
+    , log_broken(true)
+    , records_since_keyframe(0)
+    , force_keyframe(true)
+{
+    for(uint i=0; i<max(opts.max_pending, 1u); i++)
+        free_buffers.push_back(new vector<uint16_t>(num_voxels));
+
+    if(opts.log_interval)
+    {
+        // Append to a log of the same lattice size, e.g. after a restart
+        string log_name = opts.directory + "/steps.calog";
+        ca_step_log_header header;
+        bool append = false;
+        {
+            ifstream existing(log_name.c_str(), ios::binary);
+            if(existing.read(reinterpret_cast<char*>(&header), sizeof(header)))
+                append = header.magic == CA_STEP_LOG_MAGIC && header.version == CA_SNAPSHOT_VERSION
+                      && header.size[0] == size.x && header.size[1] == size.y && header.size[2] == size.z;
+        }
+
+        log.open(log_name.c_str(), append ? ios::binary | ios::app : ios::binary | ios::trunc);
+        if(!log.is_open()) throw runtime_error("Unable to open step log " + log_name);
+        if(!append)
+        {
+            header.magic = CA_STEP_LOG_MAGIC;
+            header.version = CA_SNAPSHOT_VERSION;
+            header.size[0] = size.x;
+            header.size[1] = size.y;
+            header.size[2] = size.z;
+            header.reserved = 0;
+            log.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        if(opts.log_deltas) previous.resize(num_voxels);
+    }
+
+    thread = boost::thread(boost::bind(&snapshot_writer::writer_main, this));
+}
+
+snapshot_writer::~snapshot_writer()
+{
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutting_down = true;
+    }
+    cond.notify_all();
+    thread.join();
+
+    for(size_t i=0; i<free_buffers.size(); i++) delete free_buffers[i];
+}
+
+bool snapshot_writer::wants(uint64_t step) const
+{
+    return (opts.checkpoint_interval && step % opts.checkpoint_interval == 0)
+        || (opts.log_interval && step % opts.log_interval == 0);
+}
+
+bool snapshot_writer::submit(uint64_t step, const uint16_t* lattice, const string& rule_state)
+{
+    job j;
+    j.step = step;
+    j.checkpoint = opts.checkpoint_interval && step % opts.checkpoint_interval == 0;
+    j.log = opts.log_interval && step % opts.log_interval == 0;
+    if(!j.checkpoint && !j.log) return true;
+
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if(free_buffers.empty())
+        {
+            drop_count++;
+            if(j.log) log_broken = true;
+            return false;
+        }
+        j.lattice = free_buffers.back();
+        free_buffers.pop_back();
+        j.keyframe = j.log && log_broken;
+        if(j.log) log_broken = false;
+    }
+
+    // The only work done on the stepping thread
+    memcpy(&(*j.lattice)[0], lattice, num_voxels * sizeof(uint16_t));
+    if(j.checkpoint) j.rule_state = rule_state;
+
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        jobs.push_back(j);
+    }
+    cond.notify_one();
+    return true;
+}
+
+void snapshot_writer::writer_main()
+{
+    while(true)
+    {
+        job j;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while(jobs.empty() && !shutting_down) cond.wait(lock);
+            if(jobs.empty()) return;
+            j = jobs.front();
+            jobs.pop_front();
+        }
+
+        try
+        {
+            // The log record may turn the lattice into a delta, so it goes last
+            if(j.checkpoint) write_checkpoint(j);
+            if(j.log) write_log_record(j);
+        }
+        catch(exception& e)
+        {
+            cerr << "Snapshot of step " << j.step << " failed: " << e.what() << endl;
+            if(j.log) force_keyframe = true;
+        }
+
+        boost::mutex::scoped_lock lock(mutex);
+        free_buffers.push_back(j.lattice);
+    }
+}
+
+void snapshot_writer::write_checkpoint(const job& j)
+{
+    compress_voxels(&(*j.lattice)[0], num_voxels, compressed);
+
+    ca_checkpoint_header header;
+    header.magic = CA_CHECKPOINT_MAGIC;
+    header.version = CA_SNAPSHOT_VERSION;
+    header.size[0] = lattice_size.x;
+    header.size[1] = lattice_size.y;
+    header.size[2] = lattice_size.z;
+    header.step = j.step;
+    header.seed = seed;
+    header.state_bytes = j.rule_state.size();
+    header.compressed_bytes = compressed.size();
+
+    // Written aside and renamed, so a crash never leaves a partial checkpoint
+    string name = checkpoint_name(opts.directory, j.step);
+    string temporary = name + ".tmp";
+    {
+        ofstream out(temporary.c_str(), ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(j.rule_state.data(), j.rule_state.size());
+        out.write(reinterpret_cast<const char*>(&compressed[0]), compressed.size());
+        if(!out) throw runtime_error("Unable to write " + temporary);
+    }
+    if(rename(temporary.c_str(), name.c_str()))
+        throw runtime_error("Unable to rename " + temporary);
+
+    checkpoints.push_back(j.step);
+    while(checkpoints.size() > max(opts.checkpoints_kept, 1u))
+    {
+        remove(checkpoint_name(opts.directory, checkpoints.front()).c_str());
+        checkpoints.erase(checkpoints.begin());
+    }
+}
+
+void snapshot_writer::write_log_record(const job& j)
+{
+    ca_step_log_record record;
+    record.step = j.step;
+    record.reserved = 0;
+    record.type = ca_step_log_record::keyframe;
+
+    uint16_t* lattice = &(*j.lattice)[0];
+    if(opts.log_deltas)
+    {
+        bool keyframe = j.keyframe || force_keyframe || records_since_keyframe + 1 >= max(opts.keyframe_interval, 1u);
+        if(keyframe)
+        {
+            memcpy(&previous[0], lattice, num_voxels * sizeof(uint16_t));
+            records_since_keyframe = 0;
+            force_keyframe = false;
+        }
+        else
+        {
+            // Unchanged cells become zeros, which compress to almost nothing
+            for(size_t i=0; i<num_voxels; i++)
+            {
+                uint16_t v = lattice[i];
+                lattice[i] ^= previous[i];
+                previous[i] = v;
+            }
+            record.type = ca_step_log_record::delta;
+            records_since_keyframe++;
+        }
+    }
+
+    compress_voxels(lattice, num_voxels, compressed);
+    record.compressed_bytes = compressed.size();
+    log.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    log.write(reinterpret_cast<const char*>(&compressed[0]), compressed.size());
+    log.flush();
+    if(!log) throw runtime_error("Unable to append to the step log");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Readers
+
+void read_checkpoint(const string& file_name, ca_checkpoint& checkpoint)
+{
+    ifstream in(file_name.c_str(), ios::binary);
+    if(!in.is_open()) throw runtime_error("Unable to open checkpoint " + file_name);
+
+    ca_checkpoint_header header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+       || header.magic != CA_CHECKPOINT_MAGIC || header.version != CA_SNAPSHOT_VERSION)
+        throw runtime_error(file_name + " is not a checkpoint");
+
+    checkpoint.size = ivec3(header.size[0], header.size[1], header.size[2]);
+    checkpoint.step = header.step;
+    checkpoint.seed = header.seed;
+    checkpoint.rule_state.resize(header.state_bytes);
+    vector<unsigned char> compressed(header.compressed_bytes);
+    if(header.state_bytes) in.read(&checkpoint.rule_state[0], header.state_bytes);
+    if(header.compressed_bytes) in.read(reinterpret_cast<char*>(&compressed[0]), header.compressed_bytes);
+    if(!in) throw runtime_error("Truncated checkpoint " + file_name);
+
+    checkpoint.lattice.resize(hmul(checkpoint.size));
+    uncompress_voxels(compressed, &checkpoint.lattice[0], checkpoint.lattice.size());
+}
+
+step_log_reader::step_log_reader(const string& file_name)
+    : in(file_name.c_str(), ios::binary)
+{
+    ca_step_log_header header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+       || header.magic != CA_STEP_LOG_MAGIC || header.version != CA_SNAPSHOT_VERSION)
+        throw runtime_error(file_name + " is not a step log");
+
+    lattice_size = ivec3(header.size[0], header.size[1], header.size[2]);
+    decoded.resize(hmul(lattice_size));
+}
+
+bool step_log_reader::next(uint64_t& step, uint16_t* lattice)
+{
+    ca_step_log_record record;
+    if(!in.read(reinterpret_cast<char*>(&record), sizeof(record))) return false;
+
+    compressed.resize(record.compressed_bytes);
+    // A record cut off by a crash ends the log
+    if(!in.read(reinterpret_cast<char*>(&compressed[0]), compressed.size())) return false;
+
+    step = record.step;
+    if(record.type == ca_step_log_record::keyframe)
+    {
+        uncompress_voxels(compressed, lattice, decoded.size());
+        return true;
+    }
+
+    uncompress_voxels(compressed, &decoded[0], decoded.size());
+    for(size_t i=0; i<decoded.size(); i++) lattice[i] ^= decoded[i];
+    return true;
+}
@@ -0,0 +1,191 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "tgt/types.h"
+#include "tgt/vector.h"
+
+//! File magics
+#define CA_CHECKPOINT_MAGIC 0x4b434143u // "CACK"
+#define CA_STEP_LOG_MAGIC 0x474c4143u   // "CALG"
+#define CA_SNAPSHOT_VERSION 1
+
+//!
+//! Checkpoint file layout: this header, the rule state, then the zlib
+//! compressed lattice
+struct ca_checkpoint_header
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t size[3];
+    uint64_t step;
+    uint64_t seed;
+    uint64_t state_bytes;
+    uint64_t compressed_bytes;
+};
+
+//!
+//! Step log layout: a ca_step_log_header, then one record per logged step
+struct ca_step_log_header
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t size[3];
+    uint32_t reserved;
+};
+
+struct ca_step_log_record
+{
+    enum record_type
+    {
+        //! The full lattice
+        keyframe = 0,
+        //! XOR against the previous record of the log
+        delta = 1
+    };
+
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t step;
+    uint64_t compressed_bytes;
+};
+
+//!
+//! Asynchronous checkpoint and step log writer.
+//!
+//! The stepping loop hands lattices to submit(), which only copies them into
+//! one of a few staging buffers; compression and file I/O happen on a
+//! background thread. When every staging buffer is still in flight the
+//! snapshot is dropped instead of waiting, so a slow disk can never stall
+//! the simulation. A dropped log entry makes the next one a keyframe, so the
+//! log always replays correctly.
+class snapshot_writer
+{
+public:
+    struct options
+    {
+        //! Directory for checkpoints and the step log
+        std::string directory;
+        //! Steps between checkpoints, 0 disables them
+        uint checkpoint_interval;
+        //! Checkpoints kept on disk, older ones are removed
+        uint checkpoints_kept;
+        //! Steps between step log records, 0 disables the log
+        uint log_interval;
+        //! Log XOR deltas against the previous record instead of full frames
+        bool log_deltas;
+        //! Records between keyframes in delta mode
+        uint keyframe_interval;
+        //! Staging buffers, i.e. snapshots in flight
+        uint max_pending;
+
+        options()
+            : directory(".")
+            , checkpoint_interval(0)
+            , checkpoints_kept(2)
+            , log_interval(0)
+            , log_deltas(false)
+            , keyframe_interval(100)
+            , max_pending(2)
+        {}
+    };
+
+    snapshot_writer(const tgt::ivec3& size, uint64_t seed, const options& opts);
+
+    //! Writes everything still queued before returning
+    ~snapshot_writer();
+
+    //! Whether step is due for a checkpoint or a log record
+    bool wants(uint64_t step) const;
+
+    //! Queue the lattice of step (and the rule state for checkpoints).
+    //! Never blocks; returns false if the snapshot had to be dropped.
+    bool submit(uint64_t step, const uint16_t* lattice, const std::string& rule_state);
+
+    //! Snapshots dropped because the writer fell behind
+    uint64_t dropped() const { return drop_count; }
+
+private:
+    struct job
+    {
+        uint64_t step;
+        std::vector<uint16_t>* lattice;
+        std::string rule_state;
+        bool checkpoint;
+        bool log;
+        bool keyframe;
+    };
+
+    void writer_main();
+    void write_checkpoint(const job& j);
+    void write_log_record(const job& j);
+
+    tgt::ivec3 lattice_size;
+    size_t num_voxels;
+    uint64_t seed;
+    options opts;
+
+    std::vector<std::vector<uint16_t>*> free_buffers;
+    std::deque<job> jobs;
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool shutting_down;
+    uint64_t drop_count;
+    //! Set when a log record was dropped, the next one has to be a keyframe
+    bool log_broken;
+
+    //! Writer thread state
+    std::ofstream log;
+    std::vector<uint16_t> previous;
+    uint records_since_keyframe;
+    //! Set after a failed record, deltas would refer to a lost frame
+    bool force_keyframe;
+    std::vector<uint64_t> checkpoints;
+    std::vector<unsigned char> compressed;
+
+    boost::thread thread;
+};
+
+//!
+//! Checkpoint contents read back for a restart
+struct ca_checkpoint
+{
+    tgt::ivec3 size;
+    uint64_t step;
+    uint64_t seed;
+    std::string rule_state;
+    std::vector<uint16_t> lattice;
+};
+
+//! Read a checkpoint file, throws std::runtime_error on failure
+void read_checkpoint(const std::string& file_name, ca_checkpoint& checkpoint);
+
+//!
+//! Sequential reader for step logs, decoding deltas on the fly
+class step_log_reader
+{
+public:
+    explicit step_log_reader(const std::string& file_name);
+
+    const tgt::ivec3& size() const { return lattice_size; }
+
+    //! Decode the next record into lattice; returns false at the end of the
+    //! log. The lattice must hold the previous record for deltas.
+    bool next(uint64_t& step, uint16_t* lattice);
+
+private:
+    std::ifstream in;
+    tgt::ivec3 lattice_size;
+    std::vector<unsigned char> compressed;
+    std::vector<uint16_t> decoded;
+};
+
+#endif
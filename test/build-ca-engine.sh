@@ -0,0 +1,2 @@
+#!/bin/sh
+g++ test-ca-engine.cpp ../ipcc/ca_engine/ca_engine.cpp ../ipcc/ca_engine/worker_pool.cpp -o test-ca-engine -I../ipcc -I../common -I../ext -DTGT_WITHOUT_DEFINES -lboost_thread -lboost_system -lpthread
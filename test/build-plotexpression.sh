@@ -0,0 +1,2 @@
+#!/bin/sh
+g++ test-plotexpression.cpp -o test-plotexpression -I../common -I../ext -I../ext/voreen/inc -DTGT_WITHOUT_DEFINES -L../ext/voreen/dep -L../ext/tgt/dep -lvoreen -ltgt
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <vector>
+
+#include "ca_engine/ca_engine.hpp"
+
+using namespace std;
+
+int failures = 0;
+
+// Keeps every cell, except that the first step bumps the cell at the origin.
+// Only tile 0 changes, and only once.
+class bump_once : public ca_rule
+{
+public:
+    void process_tile(const ca_step_context& ctx, const ca_tile& tile, ca_rng&)
+    {
+        for(int z=tile.begin.z; z<tile.end.z; z++)
+            for(int y=tile.begin.y; y<tile.end.y; y++)
+                for(int x=tile.begin.x; x<tile.end.x; x++)
+                {
+                    size_t i = ctx.index(x, y, z);
+                    ctx.dst[i] = ctx.src[i];
+                }
+        if(ctx.step == 0 && tile.index == 0) ctx.dst[0]++;
+    }
+
+    bool quiescent_stable() const { return true; }
+};
+
+// Steps a ring of buffers and returns the last published buffer
+vector<uint16_t> run(bool sparse, int buffers, int steps)
+{
+    tgt::ivec3 size(32, 32, 32);
+    size_t cells = size_t(size.x) * size.y * size.z;
+    vector<vector<uint16_t> > ring(buffers, vector<uint16_t>(cells, 0));
+
+    ca_engine::options opts;
+    opts.num_threads = 2;
+    opts.brick_size = tgt::ivec3(8, 8, 8);
+    opts.sparse = sparse;
+    ca_engine engine(size, opts);
+    bump_once rule;
+
+    int front = 0;
+    for(int s=0; s<steps; s++)
+    {
+        int back = (front + 1) % buffers;
+        engine.step(&ring[front][0], &ring[back][0], rule);
+        front = back;
+    }
+    return ring[front];
+}
+
+int main()
+{
+    // every buffer of the ring has to end up with the bumped cell, including
+    // the ones whose tile 0 still holds the initial state
+    for(int buffers=2; buffers<=4; buffers++)
+        for(int steps=1; steps<=3*buffers; steps++)
+        {
+            vector<uint16_t> dense = run(false, buffers, steps);
+            vector<uint16_t> sparse = run(true, buffers, steps);
+            if(dense != sparse || sparse[0] != 1)
+            {
+                cout << buffers << " buffers, " << steps << " steps: sparse result differs from dense" << endl;
+                failures++;
+            }
+        }
+
+    if(failures)
+        return 1;
+    cout << "All tests passed" << endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "tgt/init.h"
+#include "voreen/core/plotting/plotexpression.h"
+
+using namespace std;
+using namespace voreen;
+
+int failures = 0;
+
+bool same(plot_t a, plot_t b) {
+    return a == b || (a != a && b != b);
+}
+
+// Compares evaluateBatch against evaluateAt and the expected values.
+void check(const string& expression, const vector<plot_t>& xs, const vector<plot_t>& expected) {
+    PlotExpression plotExpression(expression);
+    vector<plot_t> batch(xs.size());
+    plotExpression.evaluateBatch(&xs[0], xs.size(), &batch[0]);
+    for (size_t i = 0; i < xs.size(); i++) {
+        plot_t single = plotExpression.evaluateAt(vector<plot_t>(1, xs[i]));
+        if (!same(batch[i], single) || !same(batch[i], expected[i])) {
+            cout << expression << " at " << xs[i] << ": batch " << batch[i] << ", single " << single
+                 << ", expected " << expected[i] << endl;
+            failures++;
+        }
+    }
+}
+
+int main() {
+    // PlotExpression logs through LogMgr
+    tgt::init(tgt::InitFeature::LOG_MANAGER);
+
+    const plot_t inf = numeric_limits<plot_t>::infinity();
+    const plot_t nan = numeric_limits<plot_t>::quiet_NaN();
+
+    // a domain-restricted function next to an unbounded one in the same block,
+    // fac() must only see the points of its domain
+    vector<plot_t> xs, expected;
+    xs.push_back(3);    expected.push_back(6);
+    xs.push_back(1e17); expected.push_back(-1e17);
+    // the default domain (-inf, inf) is open, so the infinities are in no domain
+    xs.push_back(inf);  expected.push_back(nan);
+    xs.push_back(-inf); expected.push_back(nan);
+    xs.push_back(10);   expected.push_back(3628800);
+    xs.push_back(-2);   expected.push_back(2);
+    check("fac(x):[0,10];-x", xs, expected);
+
+    // points outside of every domain are NaN
+    xs.clear(); expected.clear();
+    xs.push_back(0.5); expected.push_back(1);
+    xs.push_back(2);   expected.push_back(nan);
+    xs.push_back(nan); expected.push_back(nan);
+    xs.push_back(4);   expected.push_back(-4);
+    check("2*x:[0,1];-x:(3,10]", xs, expected);
+
+    // more points than one block
+    const plot_t factorials[] = { 0, 1, 2, 6, 24 };
+    xs.clear(); expected.clear();
+    for (int i = 0; i < 5000; i++) {
+        xs.push_back((i % 7 == 0) ? 1e17 : i % 5);
+        expected.push_back((i % 7 == 0) ? -1e17 : factorials[i % 5]);
+    }
+    check("fac(x):[0,10];-x", xs, expected);
+
+    if (failures)
+        cout << failures << " failures" << endl;
+    else
+        cout << "All tests passed" << endl;
+
+    tgt::deinit();
+    return failures ? 1 : 0;
+}